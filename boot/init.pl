@@ -63,6 +63,7 @@ attempt to call the Prolog defined trace interceptor.
 	discontiguous(:),
 	volatile(:),
 	thread_local(:),
+	compact_facts(:),
 	noprofile(:),
 	'$iso'(:),
 	'$hide'(:).
@@ -81,6 +82,7 @@ module_transparent(Spec) :- '$set_pattr'(Spec, pred, (transparent)).
 discontiguous(Spec)	 :- '$set_pattr'(Spec, pred, (discontiguous)).
 volatile(Spec)		 :- '$set_pattr'(Spec, pred, (volatile)).
 thread_local(Spec)	 :- '$set_pattr'(Spec, pred, (thread_local)).
+compact_facts(Spec)	 :- '$set_pattr'(Spec, pred, (compact)).
 noprofile(Spec)		 :- '$set_pattr'(Spec, pred, (noprofile)).
 public(Spec)		 :- '$set_pattr'(Spec, pred, (public)).
 '$iso'(Spec)		 :- '$set_pattr'(Spec, pred, (iso)).
@@ -126,6 +128,8 @@ public(Spec)		 :- '$set_pattr'(Spec, pred, (public)).
 	'$set_pattr'(Spec, M, directive, (volatile)).
 '$pattr_directive'(thread_local(Spec), M) :-
 	'$set_pattr'(Spec, M, directive, (thread_local)).
+'$pattr_directive'(compact_facts(Spec), M) :-
+	'$set_pattr'(Spec, M, directive, (compact)).
 '$pattr_directive'(noprofile(Spec), M) :-
 	'$set_pattr'(Spec, M, directive, (noprofile)).
 '$pattr_directive'(public(Spec), M) :-
@@ -1192,13 +1196,8 @@ compiling :-
 '$term_in_file'(In, Read, RLayout, Term, TLayout, Stream, Parents, Options) :-
 	'$skip_script_line'(In),
 	'$read_clause_options'(Options, ReadOptions),
-	repeat,
-	  read_clause(In, Raw,
-		      [ variable_names(Bindings),
-			term_position(Pos),
-			subterm_positions(RawLayout)
-		      | ReadOptions
-		      ]),
+	'$term_reader'(In, Parents, Options, Reader),
+	'$raw_term'(Reader, In, Raw, RawLayout, Pos, Bindings, ReadOptions),
 	  b_setval('$term_position', Pos),
 	  b_setval('$variable_names', Bindings),
 	  (   Raw == end_of_file
@@ -1225,6 +1224,361 @@ compiling :-
 '$read_clause_option'(term_position(_)).
 '$read_clause_option'(process_comment(_)).
 
+%%	'$term_reader'(+In, +Parents, +Options, -Reader) is det.
+%
+%	Reader is parallel(Path, Count) if the clauses of the file Path,
+%	opened as In, may be read using Count threads.  This requires a
+%	file that can be positioned in an encoding where a newline is
+%	always the byte 10 and more than one CPU.  Reader is sequential
+%	otherwise.
+
+'$term_reader'(In, [Path], Options, parallel(Path, Count)) :-
+	'$option'(parallel(Count), Options, 1),
+	Count > 1,
+	\+ '$option'(stream(_), Options),
+	current_prolog_flag(threads, true),
+	current_prolog_flag(cpu_count, CPUs),
+	CPUs > 1,
+	stream_property(In, reposition(true)),
+	stream_property(In, encoding(Enc)),
+	'$byte_encoding'(Enc), !.
+'$term_reader'(_, _, _, sequential).
+
+'$byte_encoding'(octet).
+'$byte_encoding'(ascii).
+'$byte_encoding'(iso_latin_1).
+'$byte_encoding'(text).
+'$byte_encoding'(utf8).
+
+%%	'$raw_term'(+Reader, +In, -Raw, -RawLayout, -Pos, -Bindings,
+%%		    +ReadOptions) is nondet.
+%
+%	Read the clauses of In on backtracking.  A parallel reader reads
+%	the leading directives and the first clause sequentially. It then
+%	splits the remainder of the file at line boundaries into chunks
+%	that are read by a pool of threads and yields the clauses in
+%	source order.  From the first directive or syntax error after the
+%	first clause onwards, the file is read sequentially.
+
+'$raw_term'(sequential, In, Raw, RawLayout, Pos, Bindings, ReadOptions) :-
+	repeat,
+	  read_clause(In, Raw,
+		      [ variable_names(Bindings),
+			term_position(Pos),
+			subterm_positions(RawLayout)
+		      | ReadOptions
+		      ]).
+'$raw_term'(parallel(Path, Count), In, Raw, RawLayout, Pos, Bindings,
+	    ReadOptions) :-
+	(   '$header_term'(In, Raw, RawLayout, Pos, Bindings, ReadOptions)
+	;   '$parallel_term'(Path, Count, In,
+			     Raw, RawLayout, Pos, Bindings, ReadOptions)
+	;   '$raw_term'(sequential, In, Raw, RawLayout, Pos, Bindings,
+			ReadOptions)
+	).
+
+'$header_term'(In, Raw, RawLayout, Pos, Bindings, ReadOptions) :-
+	'$raw_term'(sequential, In, Raw, RawLayout, Pos, Bindings, ReadOptions),
+	(   '$sequential_term'(Raw)
+	->  true
+	;   !
+	).
+
+%	'$sequential_term'(@Raw) is true if Raw must be read by the
+%	loading thread because it may affect reading the clauses that
+%	follow it.
+
+'$sequential_term'(Var) :-
+	var(Var), !.
+'$sequential_term'(end_of_file).
+'$sequential_term'((:- _)).
+'$sequential_term'((?- _)).
+
+'$parallel_term'(Path, Count, In, Raw, RawLayout, Pos, Bindings,
+		 ReadOptions) :-
+	'$chunks'(Path, Count, In, Chunks),
+	setup_call_cleanup(
+	    '$start_chunk_readers'(Path, Count, In, Chunks, ReadOptions,
+				   Readers),
+	    '$chunk_term'(Readers, In, Raw, RawLayout, Pos, Bindings,
+			  ReadOptions),
+	    '$stop_chunk_readers'(Readers)).
+
+%%	'$chunks'(+Path, +Count, +In, -Chunks) is semidet.
+%
+%	Split the remainder of Path in at least two chunks of 64Kb to
+%	1Mb.  Fails if the remainder is too small.
+
+'$chunks'(Path, Count, In, chunks(Start, Offset, ChunkSize, N)) :-
+	stream_property(In, position(Start)),
+	stream_position_data(byte_count, Start, Offset),
+	size_file(Path, Size),
+	Left is Size - Offset,
+	ChunkSize is max(65536, min(1048576, Left // (4*Count))),
+	N is (Left+ChunkSize-1) // ChunkSize,
+	N > 1.
+
+%	Readers is a term readers(Jobs, Results, Threads, Chunks, Window,
+%	State), where at most Window chunks are submitted to the Jobs
+%	queue ahead of the chunk that is being compiled and State is the
+%	mutable term state(Mode, LineBase, CharBase, Next, File).  For
+%	the current chunk, LineBase and CharBase translate positions
+%	relative to the start of the chunk to positions in the file.
+%	Next describes the clause after the previous chunk.
+
+'$start_chunk_readers'(Path, Count, In, Chunks, ReadOptions,
+		       readers(Jobs, Results, Ids, Chunks, Window, State)) :-
+	Chunks = chunks(Start, _, _, N),
+	stream_property(In, encoding(Enc)),
+	stream_property(In, file_name(File)),
+	'$set_source_module'(Module, Module),
+	(   '$option'(process_comment(Comments), ReadOptions)
+	->  true
+	;   '$comment_hook_active'
+	->  Comments = true
+	;   Comments = false
+	),
+	State = state(parallel, 0, 0, next(start, Start), File),
+	Workers is min(Count, N),
+	Window is 2*Workers,
+	message_queue_create(Jobs),
+	message_queue_create(Results),
+	Submit is min(Window, N) - 1,
+	forall(between(0, Submit, K),
+	       '$submit_chunk'(Jobs, Chunks, K)),
+	findall(Id,
+		( between(1, Workers, _),
+		  thread_create('$chunk_reader'(Jobs, Results, Path, Enc,
+						Module, Comments),
+				Id, [])
+		),
+		Ids).
+
+'$comment_hook_active' :-
+	current_predicate(prolog:comment_hook/3),
+	predicate_property(prolog:comment_hook(_,_,_), number_of_clauses(N)),
+	N > 0.
+
+'$stop_chunk_readers'(readers(Jobs, Results, Ids, _, _, _)) :-
+	forall(thread_get_message(Jobs, _, [timeout(0)]), true),
+	forall('$member'(_, Ids), thread_send_message(Jobs, done)),
+	forall('$member'(Id, Ids), thread_join(Id, _)),
+	message_queue_destroy(Jobs),
+	message_queue_destroy(Results).
+
+'$submit_chunk'(Jobs, chunks(Start, Offset, ChunkSize, N), K) :-
+	(   K =:= 0
+	->  From = pos(Start)
+	;   From is Offset + K*ChunkSize
+	),
+	(   K =:= N-1
+	->  To = eof
+	;   To is Offset + (K+1)*ChunkSize
+	),
+	thread_send_message(Jobs, chunk(K, From, To)).
+
+'$chunk_term'(Readers, In, Raw, RawLayout, Pos, Bindings, ReadOptions) :-
+	Readers = readers(_, _, _, chunks(_, _, _, N), _, State),
+	between(0, N, K),
+	(   arg(1, State, parallel)
+	->  true
+	;   !, fail
+	),
+	'$chunk_items'(Readers, K, In, Items),
+	'$member'(Item, Items),
+	arg(1, State, parallel),
+	'$chunk_item'(Item, State, In, Raw, RawLayout, Pos, Bindings,
+		      ReadOptions).
+
+%%	'$chunk_items'(+Readers, +K, +In, -Items) is semidet.
+%
+%	Get the items of chunk K.  The first clause of the chunk must be
+%	the clause after the previous chunk.  If not, the split was
+%	wrong, e.g., because a quoted atom spans the line at which the
+%	chunk starts.  In that case, or after the last chunk, we
+%	position In at the clause after the previous chunk, switch to
+%	sequential reading and fail.
+
+'$chunk_items'(readers(Jobs, Results, _, Chunks, Window, State),
+	       K, In, Items) :-
+	Chunks = chunks(_, _, _, N),
+	(   K == N
+	->  Items = [],
+	    First = first(none),
+	    Next = next(none, -)
+	;   thread_get_message(Results, chunk(K, Items, First, Next)),
+	    Submit is K + Window,
+	    (   Submit < N
+	    ->  '$submit_chunk'(Jobs, Chunks, Submit)
+	    ;   true
+	    )
+	),
+	'$chunk_start'(State, First, In),
+	nb_setarg(4, State, Next).
+
+'$chunk_start'(State, First, _) :-
+	arg(4, State, Prev),
+	(   Prev = next(start, _)
+	->  First \== first(none)
+	;   Prev = next(term, PrevPos),
+	    First = first(term, FirstPos),
+	    stream_position_data(byte_count, PrevPos, Byte),
+	    stream_position_data(byte_count, FirstPos, Byte)
+	->  '$file_position'(State, PrevPos, Pos),
+	    stream_position_data(line_count, Pos, Line),
+	    stream_position_data(char_count, Pos, Char),
+	    stream_position_data(line_count, FirstPos, FirstLine),
+	    stream_position_data(char_count, FirstPos, FirstChar),
+	    LineBase is Line - FirstLine,
+	    CharBase is Char - FirstChar,
+	    nb_setarg(2, State, LineBase),
+	    nb_setarg(3, State, CharBase)
+	), !.
+'$chunk_start'(State, _, In) :-
+	arg(4, State, next(_, RelPos)),
+	'$file_position'(State, RelPos, Pos),
+	set_stream_position(In, Pos),
+	nb_setarg(1, State, sequential),
+	fail.
+
+'$file_position'(State, '$stream_position'(Char0, Line0, LinePos, Byte),
+		 '$stream_position'(Char, Line, LinePos, Byte)) :-
+	arg(2, State, LineBase),
+	arg(3, State, CharBase),
+	Line is Line0 + LineBase,
+	Char is Char0 + CharBase.
+
+%	'$chunk_item'(+Item, +State, +In, -Raw, -RawLayout, -Pos,
+%		      -Bindings, +ReadOptions) is semidet.
+%
+%	Item is one of t(Raw, Pos) for a clause without named variables
+%	and comments, reread(Pos) if the loading thread must read the
+%	clause itself to report singleton variables or process comments
+%	and stop(Pos) to continue reading sequentially.
+
+'$chunk_item'(t(Raw, RelPos), State, _, Raw, _, Pos, [], _) :-
+	'$file_position'(State, RelPos, Pos),
+	arg(5, State, File),
+	'$set_source_location'(File, Pos).
+'$chunk_item'(reread(RelPos), State, In, Raw, RawLayout, Pos, Bindings,
+	      ReadOptions) :-
+	'$file_position'(State, RelPos, Start),
+	set_stream_position(In, Start),
+	read_clause(In, Raw,
+		    [ variable_names(Bindings),
+		      term_position(Pos),
+		      subterm_positions(RawLayout)
+		    | ReadOptions
+		    ]).
+'$chunk_item'(stop(RelPos), State, In, _, _, _, _, _) :-
+	'$file_position'(State, RelPos, Pos),
+	set_stream_position(In, Pos),
+	nb_setarg(1, State, sequential),
+	fail.
+
+%%	'$chunk_reader'(+Jobs, +Results, +Path, +Enc, +Module, +Comments)
+%
+%	Thread that reads chunks of Path.  For each job chunk(K, From,
+%	To) it sends chunk(K, Items, First, Next) to Results, where
+%	First describes the first clause of the chunk and Next the first
+%	clause that starts after the chunk.  Errors are not printed: the
+%	loading thread reads the chunk sequentially if it gets no valid
+%	result.
+
+'$chunk_reader'(Jobs, Results, Path, Enc, Module, Comments) :-
+	setup_call_cleanup(
+	    open(Path, read, In, [bom(false)]),
+	    '$chunk_reader_loop'(Jobs, Results, In, Enc, Module, Comments),
+	    close(In)).
+
+'$chunk_reader_loop'(Jobs, Results, In, Enc, Module, Comments) :-
+	thread_get_message(Jobs, Job),
+	(   Job = chunk(K, From, To)
+	->  (   catch('$read_chunk'(In, Enc, From, To, Module, Comments,
+				    Items, First, Next),
+		      _, fail)
+	    ->  true
+	    ;   Items = [],
+		First = first(none),
+		Next = next(none, -)
+	    ),
+	    thread_send_message(Results, chunk(K, Items, First, Next)),
+	    '$chunk_reader_loop'(Jobs, Results, In, Enc, Module, Comments)
+	;   true
+	).
+
+%	Positions in a chunk other than the first are relative to the
+%	start of the chunk, which is the start of a line.
+
+'$read_chunk'(In, Enc, From, To, Module, Comments, Items, First, Next) :-
+	(   To == eof
+	->  End = eof
+	;   '$line_start'(In, To, End)
+	),
+	(   From = pos(Start)
+	->  true
+	;   '$line_start'(In, From, Byte),
+	    Start = '$stream_position'(0, 1, 0, Byte)
+	),
+	set_stream_position(In, Start),
+	set_stream(In, encoding(Enc)),
+	'$read_chunk_terms'(In, End, Module, Comments, Items, First, Next).
+
+'$line_start'(In, Offset, Byte) :-
+	set_stream(In, encoding(octet)),
+	Before is Offset - 1,
+	seek(In, Before, bof, _),
+	skip(In, 0'\n),
+	byte_count(In, Byte).
+
+'$read_chunk_terms'(In, End, Module, Comments, Items, First, Next) :-
+	stream_property(In, position(Region)),
+	(   Comments == true
+	->  CommentOptions = [comments(CommentList)]
+	;   CommentOptions = [],
+	    CommentList = []
+	),
+	(   catch(read_term(In, Raw,
+			    [ module(Module),
+			      syntax_errors(error),
+			      term_position(Pos),
+			      variable_names(Bindings)
+			    | CommentOptions
+			    ]),
+		  _, fail)
+	->  (   Raw == end_of_file
+	    ->  '$chunk_first'(First, first(eof, Region)),
+		Items = [],
+		Next = next(eof, Region)
+	    ;   '$chunk_first'(First, first(term, Pos)),
+		stream_position_data(byte_count, Pos, Byte),
+		(   End \== eof,
+		    Byte >= End
+		->  Items = [],
+		    Next = next(term, Pos)
+		;   '$sequential_term'(Raw)
+		->  Items = [stop(Pos)],
+		    Next = next(none, Pos)
+		;   (   Bindings == [],
+			CommentList == []
+		    ->	Items = [t(Raw, Pos)|Rest]
+		    ;	Items = [reread(Region)|Rest]
+		    ),
+		    '$read_chunk_terms'(In, End, Module, Comments,
+					Rest, First, Next)
+		)
+	    )
+	;   '$chunk_first'(First, first(none)),
+	    Items = [stop(Region)],
+	    Next = next(none, Region)
+	).
+
+'$chunk_first'(First, Value) :-
+	(   var(First)
+	->  First = Value
+	;   true
+	).
+
 '$expanded_term'(In, Raw, RawLayout, Read, RLayout, Term, TLayout,
 		 Stream, Parents, Options) :-
 	catch('$expand_term'(Raw, RawLayout, Expanded, ExpandedLayout), E,
@@ -1521,6 +1875,14 @@ load_files(Module:Files, Options) :-
 '$load_files'(File, Module, Options) :-
 	'$load_one_file'(File, Module, Options).
 
+'$load_file_list'(List, Module, Options) :-
+	'$option'(concurrent(Count), Options, 1),
+	Count > 1,
+	current_prolog_flag(threads, true), !,
+	findall('$load_one_file'(File, Module, [concurrent(1)|Options]),
+		'$member'(File, List),
+		Goals),
+	'$concurrent_load'(Goals, Count).
 '$load_file_list'([], _, _).
 '$load_file_list'([File|Rest], Module, Options) :-
 	catch('$load_one_file'(File, Module, Options), E,
@@ -1528,6 +1890,55 @@ load_files(Module:Files, Options) :-
 	'$load_file_list'(Rest, Module, Options).
 
 
+%%	'$concurrent_load'(+Goals, +Count) is semidet.
+%
+%	Run the load goals from the list Goals using at most Count
+%	threads. As for a sequential load of a list of files, errors are
+%	printed and do not stop loading the other files. Fails if some
+%	goal failed.
+
+'$concurrent_load'(Goals, Count) :-
+	length(Goals, Len),
+	Workers is min(Count, Len),
+	setup_call_cleanup(
+	    message_queue_create(Queue),
+	    ( forall('$member'(Goal, Goals),
+		     thread_send_message(Queue, load(Goal))),
+	      forall(between(1, Workers, _),
+		     thread_send_message(Queue, done)),
+	      '$create_load_workers'(Workers, Queue, Ids),
+	      '$join_load_workers'(Ids, Status)
+	    ),
+	    message_queue_destroy(Queue)),
+	Status == true.
+
+'$create_load_workers'(0, _, []) :- !.
+'$create_load_workers'(N, Queue, [Id|Ids]) :-
+	thread_create('$load_worker'(Queue), Id, []),
+	N2 is N - 1,
+	'$create_load_workers'(N2, Queue, Ids).
+
+'$join_load_workers'([], true).
+'$join_load_workers'([Id|Ids], Status) :-
+	thread_join(Id, Status0),
+	'$join_load_workers'(Ids, Status1),
+	(   Status0 == true
+	->  Status = Status1
+	;   Status = Status0
+	).
+
+'$load_worker'(Queue) :-
+	thread_get_message(Queue, Msg),
+	(   Msg = load(Goal)
+	->  (   catch(Goal, E, print_message(error, E))
+	    ->  '$load_worker'(Queue)
+	    ;   '$load_worker'(Queue),
+		fail
+	    )
+	;   true
+	).
+
+
 '$load_one_file'(Spec, Module, Options) :-
 	atom(Spec),
 	'$option'(expand(Expand), Options, false),
@@ -1701,9 +2112,16 @@ load_files(Module:Files, Options) :-
 %	the fact that thread_get_message/1 throws  an existence_error if
 %	the message queue  is  destroyed.  This   is  hacky.  Events  or
 %	condition variables would have made a cleaner design.
+%
+%	Threads that wait are registered in '$load_waiting'/2. If waiting
+%	would close a cycle (the thread loading the file waits, directly
+%	or indirectly, for a file we are loading), the file is handled as
+%	if it is already loaded, as is  done for a file that imports
+%	itself in a single thread.
 
 :- dynamic
-	'$loading_file'/3.		% File, Queue, Thread
+	'$loading_file'/3,		% File, Queue, Thread
+	'$load_waiting'/2.		% Thread, File
 
 '$mt_load_file'(File, FullFile, Module, Options) :-
 	current_prolog_flag(threads, true), !,
@@ -1720,9 +2138,15 @@ load_files(Module:Files, Options) :-
 	'$qdo_load_file'(File, FullFile, Module, Options).
 
 
-'$mt_start_load'(FullFile, queue(Queue), _) :-
+'$mt_start_load'(FullFile, Status, _) :-
 	'$loading_file'(FullFile, Queue, LoadThread),
-	\+ thread_self(LoadThread), !.
+	\+ thread_self(LoadThread), !,
+	thread_self(Me),
+	(   '$load_waits_for'(LoadThread, Me, [LoadThread])
+	->  Status = cycle
+	;   assertz('$load_waiting'(Me, FullFile), Ref),
+	    Status = queue(Queue, Ref)
+	).
 '$mt_start_load'(FullFile, already_loaded, Options) :-
 	'$option'(if(If), Options, true),
 	'$noload'(If, FullFile, Options), !.
@@ -1731,16 +2155,26 @@ load_files(Module:Files, Options) :-
 	message_queue_create(Queue),
 	assertz('$loading_file'(FullFile, Queue, Me), Ref).
 
-'$mt_do_load'(queue(Queue), File, FullFile, Module, Options) :- !,
+'$mt_do_load'(queue(Queue, _), File, FullFile, Module, Options) :- !,
 	catch(thread_get_message(Queue, _), _, true),
-	'$already_loaded'(File, FullFile, Module, Options).
+	(   memberchk('$qlf'(_), Options)	% qcompile/2: always compile
+	->  '$mt_load_file'(File, FullFile, Module, Options)
+	;   '$already_loaded'(File, FullFile, Module, Options)
+	).
+'$mt_do_load'(cycle, File, FullFile, Module, Options) :- !,
+	(   '$current_module'(_, FullFile)
+	->  '$already_loaded'(File, FullFile, Module, Options)
+	;   true
+	).
 '$mt_do_load'(already_loaded, File, FullFile, Module, Options) :- !,
 	'$already_loaded'(File, FullFile, Module, Options).
 '$mt_do_load'(_Ref, File, FullFile, Module, Options) :-
 	'$qdo_load_file'(File, FullFile, Module, Options),
 	'$run_initialization'(FullFile).
 
-'$mt_end_load'(queue(_)) :- !.
+'$mt_end_load'(queue(_, Ref)) :- !,
+	erase(Ref).
+'$mt_end_load'(cycle) :- !.
 '$mt_end_load'(already_loaded) :- !.
 '$mt_end_load'(Ref) :-
 	clause('$loading_file'(_, Queue, _), _, Ref),
@@ -1748,6 +2182,21 @@ load_files(Module:Files, Options) :-
 	thread_send_message(Queue, done),
 	message_queue_destroy(Queue).
 
+%%	'$load_waits_for'(+Thread, +Target, +Seen) is semidet.
+%
+%	True if Thread waits, directly or indirectly, for a file that is
+%	being loaded by Target. Must be called with the mutex '$load_file'
+%	locked.
+
+'$load_waits_for'(Thread, Target, Seen) :-
+	'$load_waiting'(Thread, File),
+	'$loading_file'(File, _, LoadThread),
+	(   LoadThread == Target
+	->  true
+	;   \+ memberchk(LoadThread, Seen),
+	    '$load_waits_for'(LoadThread, Target, [LoadThread|Seen])
+	), !.
+
 
 %%	'$qdo_load_file'(+Spec, +FullFile, +ContextModule, +Options) is det.
 %
@@ -2120,6 +2569,9 @@ load_files(Module:Files, Options) :-
 
 '$check_load_non_module'(File, _) :-
 	'$current_module'(_, File), !.		% File is a module file
+'$check_load_non_module'(File, _) :-
+	'$loading_file'(File, _, LoadThread),	% Checked after the load
+	\+ thread_self(LoadThread), !.
 '$check_load_non_module'(File, Module) :-
 	'$load_context_module'(File, OldModule, _),
 	Module \== OldModule, !,
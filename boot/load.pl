@@ -64,5 +64,6 @@
 	     predopts,
 	     packs,
 	     dicts,
+	     tabling,
 	     user:topvars
 	   ]).
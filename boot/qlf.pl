@@ -56,6 +56,15 @@ qcompile(M:Files, Options) :-
 	qcompile_(Files, M, Options).
 
 qcompile_([], _, _) :- !.
+qcompile_(List, M, Options) :-
+	List = [_,_|_],
+	'$option'(concurrent(Count), Options, 1),
+	Count > 1,
+	current_prolog_flag(threads, true), !,
+	findall('$qlf':qcompile_(File, M, [concurrent(1)|Options]),
+		'$member'(File, List),
+		Goals),
+	'$concurrent_load'(Goals, Count).
 qcompile_([H|T], M, Options) :- !,
 	qcompile_(H, M, Options),
 	qcompile_(T, M, Options).
@@ -776,6 +776,10 @@ define_or_generate(Pred) :-
 	'$get_predicate_attribute'(Pred, (volatile), 1).
 '$predicate_property'((thread_local), Pred) :-
 	'$get_predicate_attribute'(Pred, (thread_local), 1).
+'$predicate_property'(compact, Pred) :-
+	'$get_predicate_attribute'(Pred, compact, 1).
+'$predicate_property'(fact_file(File), Pred) :-
+	'$get_predicate_attribute'(Pred, fact_file, File).
 '$predicate_property'((multifile), Pred) :-
 	'$get_predicate_attribute'(Pred, (multifile), 1).
 '$predicate_property'(imported_from(Module), Pred) :-
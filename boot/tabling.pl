@@ -0,0 +1,154 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 2
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    As a special exception, if you link this library with other files,
+    compiled with a Free Software compiler, to produce an executable, this
+    library does not by itself cause the resulting executable to be covered
+    by the GNU General Public License. This exception does not however
+    invalidate any other reasons why the executable file might be covered by
+    the GNU General Public License.
+*/
+
+:- module('$tabling',
+	  [ (table)/1			% :PI ...
+	  ]).
+
+/** <module> Tabled execution
+
+This  module  implements  the  table/1    directive.   A  tabled  predicate
+remembers the answers for each variant of a  call and reuses them if the
+same variant is called again.  This   makes  left-recursive  definitions
+terminate and avoids re-evaluating subgoals.
+
+The directive renames the clauses of  the   predicate  and defines the
+original predicate as a wrapper that   calls start_tabling/2. The answer
+tables and completion detection are implemented in pl-tabling.c.
+*/
+
+:- meta_predicate
+	table(:).
+
+%%	table(:PredicateIndicators)
+%
+%	Prepare the given PredicateIndicators  for   tabling.  This  is
+%	handled by term expansion and can only be used as a directive.
+
+table(PIList) :-
+	throw(error(context_error(nodirective, table(PIList)), _)).
+
+
+%%	start_tabling(+Wrapper, :Worker)
+%
+%	Execute Wrapper using tabling. Worker is  the renamed predicate
+%	that holds the original clauses.  If   the  table for Wrapper is
+%	complete or being evaluated we return  the answers from the table.
+%	Otherwise we run Worker to a fixpoint before returning the answers.
+
+:- public
+	start_tabling/2.
+
+start_tabling(Wrapper, Worker) :-
+	'$tbl_variant_table'(Wrapper, Table, Status),
+	(   Status == evaluate
+	->  catch(fixpoint(Table, Wrapper, Worker), E,
+		  ( '$tbl_abandon'(Table),
+		    throw(E)
+		  ))
+	;   true
+	),
+	'$tbl_answer'(Table, Wrapper).
+
+fixpoint(Table, Wrapper, Worker) :-
+	'$tbl_new_answers'(Count),
+	(   call(Worker),
+	    '$tbl_add_answer'(Table, Wrapper),
+	    fail
+	;   '$tbl_fixpoint'(Table, Count)
+	->  true
+	;   fixpoint(Table, Wrapper, Worker)
+	).
+
+
+		 /*******************************
+		 *	     EXPANSION		*
+		 *******************************/
+
+%%	wrappers(+PIList)// is det.
+%
+%	Generate the wrapper clause and the '$tabled'/1 declaration for
+%	each tabled predicate.
+
+wrappers(Var) -->
+	{ var(Var), !,
+	  '$instantiation_error'(Var)
+	}.
+wrappers((A,B)) --> !,
+	wrappers(A),
+	wrappers(B).
+wrappers(Name//Arity) -->
+	{ atom(Name), integer(Arity), Arity >= 0, !,
+	  PArity is Arity+2
+	},
+	wrappers(Name/PArity).
+wrappers(Name/Arity) -->
+	{ atom(Name), integer(Arity), Arity >= 0, !,
+	  functor(Head, Name, Arity),
+	  worker_head(Head, WorkerHead),
+	  prolog_load_context(module, Module)
+	},
+	[ '$tabled'(Head),
+	  (   Head :-
+		'$tabling':start_tabling(Module:Head, Module:WorkerHead)
+	  )
+	].
+wrappers(Spec) -->
+	{ '$type_error'(predicate_indicator, Spec) }.
+
+worker_head(Head, WorkerHead) :-
+	Head =.. [Name|Args],
+	atom_concat(Name, ' tabled', WorkerName),
+	WorkerHead =.. [WorkerName|Args].
+
+%%	tabled_head(+Head, -WorkerHead) is semidet.
+%
+%	True if Head is the head of a clause   for a predicate that has
+%	been declared tabled in the module that is being loaded.
+
+tabled_head(Head, WorkerHead) :-
+	callable(Head),
+	prolog_load_context(module, Module),
+	current_predicate(Module:'$tabled'/1),
+	\+ predicate_property(Module:'$tabled'(_), imported_from(_)),
+	Module:'$tabled'(Head), !,
+	worker_head(Head, WorkerHead).
+
+system:term_expansion((:- table(Preds)),
+		      [ (:- discontiguous('$tabled'/1))
+		      | Clauses
+		      ]) :-
+	\+ current_prolog_flag(xref, true),
+	phrase(wrappers(Preds), Clauses).
+system:term_expansion((Head :- Body), (WorkerHead :- Body)) :-
+	tabled_head(Head, WorkerHead).
+system:term_expansion((Head --> Body), (WorkerHead :- Body1)) :-
+	dcg_translate_rule((Head --> Body), (Head1 :- Body1)),
+	tabled_head(Head1, WorkerHead).
+system:term_expansion(Head, WorkerHead) :-
+	tabled_head(Head, WorkerHead).
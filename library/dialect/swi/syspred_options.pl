@@ -180,6 +180,11 @@
 		     [ timeout(number),
 		       deadline(number)
 		     ]).
+:- predicate_options(system:thread_get_messages/3, 3,
+		     [ timeout(number),
+		       deadline(number),
+		       max(positive_integer)
+		     ]).
 :- predicate_options(system:locale_create/3, 3,
 		     [ alias(atom),
 		       decimal_point(atom),
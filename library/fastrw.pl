@@ -38,46 +38,54 @@
 /** <module> Fast reading and writing of terms
 
 This library provides the SICStus   and  Ciao library(fastrw) interface.
-The idea behind this library  is  to   design  a  fast serialization for
-Prolog  terms.  Ideally,  this  should    be   portable  between  Prolog
-implementation. The current implementation provides the API simply using
-canonical read/write.
+On binary streams, terms  are  written  in   a  binary  format  that is
+based on the external records of  PL_record_external()   and  is  read
+back directly onto the global stack,  without parsing. Atoms and functor
+names are written only once per stream:   later occurrences refer to the
+first one. The terms of a binary stream  must therefore be read in the
+order in which they were written. The   binary format is not portable
+between systems with different word sizes. fast_read/2 raises a syntax
+error if it finds a term written in another format.
+
+On text streams, terms are written  canonically   and  read back using
+read_term/3.  Note that the  stream  encoding   must  be  the same.
+Typically, you would like to use   these  predicates using UTF-8 encoded
+streams. See set_stream/2.
 
-Note that the stream encoding must  be   the  same. Typically, you would
-like  to  use  these  predicate  using    UTF-8   encoded  streams.  See
-set_stream/2.
-
-@tbd	Establish a fast and portable binary format.
 @compat The format is not compatible to SICStus/Ciao (which are not
-	compatible either).  Funture versions of this library might
-	implement a different encoding.
+	compatible either).
 @see	PL_record_external() for a C-based fast binary format.
 */
 
 %%	fast_read(-Term)
 %
-%	The next term is read from current standard input and is unified
-%	with Term. The syntax of the term   must  agree with fast_read /
-%	fast_write format. If the end  of   the  input has been reached,
-%	Term is unified with the term   =end_of_file=.  Further calls to
-%	fast_read/1 will then cause an error.
+%	The next term is read from current input and is unified with
+%	Term. The term must have been written by fast_write/1,2.  If the
+%	end of the input has been reached, Term is unified with the term
+%	=end_of_file=.
 
 fast_read(Term) :-
-	read_term(Term, []).
+	current_input(In),
+	fast_read(In, Term).
 
 %%	fast_write(+Term)
 %
-%	Output Term in a way that   fast_read/1  and fast_read/2 will be
-%	able to read it back.
+%	Output Term to current output in a way that fast_read/1 and
+%	fast_read/2 will be able to read it back.
 
 fast_write(Term) :-
-	fast_write(current_output, Term).
+	current_output(Out),
+	fast_write(Out, Term).
 
 %%	fast_write(+Stream, +Term)
 %
 %	Output Term to Stream in a  way that fast_read/1 and fast_read/2
-%	will be able to read it back.
+%	will be able to read it back.  Uses the binary format if Stream
+%	is a binary stream.
 
+fast_write(Stream, Term) :-
+	stream_property(Stream, type(binary)), !,
+	'$fast_write'(Stream, Term).
 fast_write(Stream, Term) :-
 	write_term(Stream, Term,
 		   [ attributes(ignore),
@@ -90,17 +98,19 @@ fast_write(Stream, Term) :-
 %%	fast_read(+Stream, -Term)
 %
 %	The next term is read from  Stream   and  unified with Term. The
-%	syntax of the term must  agree with fast_read/fast_write format.
-%	If the end of the input has   been reached, Term is unified with
-%	the term =end_of_file=. Further calls   to fast_read/2 will then
-%	cause an error.
-
-fast_read(Stream, Term):-
+%	term must have been written by fast_write/1,2.  If the end of
+%	the input has been reached, Term is unified with the term
+%	=end_of_file=.
+
+fast_read(Stream, Term) :-
+	stream_property(Stream, type(binary)), !,
+	'$fast_read'(Stream, Term).
+fast_read(Stream, Term) :-
 	read_term(Stream, Term, []).
 
 %%	fast_write_to_string(+Term, -String, ?Tail)
 %
-%	Perform a fast-write to the difference-slist String\Term.
+%	Perform a fast-write to the difference-slist String\Tail.
 
 fast_write_to_string(T, S, R) :-
 	with_output_to(codes(S,R), fast_write(T)).
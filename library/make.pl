@@ -53,6 +53,8 @@ Prolog internal database after loaded files have been edited.
 :- multifile
 	prolog:make_hook/2.
 
+:- create_prolog_flag(make_threads, 1, [type(integer), keep(true)]).
+
 
 %%	make
 %
@@ -67,6 +69,9 @@ Prolog internal database after loaded files have been edited.
 %
 %	The hooks are called  with  an  empty   list  if  no  files need
 %	reloading.
+%
+%	If the Prolog flag =make_threads= is  larger than one, the files
+%	are reloaded concurrently using at most this number of threads.
 
 make :-
 	notrace(make_no_trace).
@@ -80,7 +85,7 @@ make_no_trace :-
 	;   true
 	),
 	print_message(silent, make(reload(Reload))),
-	maplist(reload_file, Reload),
+	reload_files(Reload),
 	print_message(silent, make(done(Reload))),
 	(   prolog:make_hook(after, Reload)
 	->  true
@@ -107,6 +112,15 @@ modified_file(File) :-
 	).
 
 
+reload_files(Files) :-
+	current_prolog_flag(make_threads, Count),
+	Count > 1,
+	current_prolog_flag(threads, true), !,
+	findall(make:reload_file(File), member(File, Files), Goals),
+	'$concurrent_load'(Goals, Count).
+reload_files(Files) :-
+	maplist(reload_file, Files).
+
 %%	reload_file(File)
 %
 %	Reload file into the proper module.
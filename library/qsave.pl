@@ -56,6 +56,8 @@ also used by the commandline sequence below.
 		       goal(callable),
 		       toplevel(callable),
 		       init_file(atom),
+		       lazy_load(boolean),
+		       shared_code(boolean),
 		       class(oneof([runtime,kernel,development])),
 		       autoload(boolean),
 		       map(atom),
@@ -194,6 +196,8 @@ doption(init_file).
 doption(system_init_file).
 doption(class).
 doption(home).
+doption(lazy_load).
+doption(shared_code).
 
 %%	save_options(+ArchiveHandle, +SaveClass, +Options)
 %
@@ -678,6 +682,8 @@ option_type(foreign,	 oneof([save, no_save])).
 option_type(goal,	 callable).
 option_type(toplevel,	 callable).
 option_type(init_file,	 atom).
+option_type(lazy_load,	 boolean).
+option_type(shared_code, boolean).
 option_type(emulator,	 ground).
 
 check_options([]) :- !.
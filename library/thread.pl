@@ -39,6 +39,7 @@
 :- use_module(library(error)).
 :- use_module(library(lists)).
 :- use_module(library(apply)).
+:- use_module(library(option)).
 
 %:- debug(concurrent).
 
@@ -50,7 +51,8 @@
 	first_solution(-, :, +).
 
 :- predicate_options(concurrent/3, 3,
-		     [ pass_to(system:thread_create/3, 3)
+		     [ pool(boolean),
+		       pass_to(system:thread_create/3, 3)
 		     ]).
 :- predicate_options(first_solution/3, 3,
 		     [ on_fail(oneof([stop,continue])),
@@ -123,6 +125,24 @@ following consequences:
 %	  * If one or more of the goals may fail or produce an errors,
 %	  using a higher number of threads may find this earlier.
 %
+%	If the task pool is used (see Options)   and N does not exceed the
+%	value of the flag =cpu_count=, the goals   are executed by a
+%	persistent pool of worker threads that is   shared by all calls
+%	and is created the first time it is  used. This avoids creating N
+%	threads for each call. The Goals  are   divided  into chunks of
+%	consecutive goals that are distributed   over the workers, where
+%	idle workers steal chunks from busy ones.  At most N chunks run
+%	concurrently.  After each chunk, a  worker   removes  the clauses
+%	of its thread_local/1 predicates and its   global variables.  Note
+%	the differences with using threads for each call:
+%
+%	  * Chunks that are not yet started by a worker when the caller
+%	  starts waiting are run by the calling thread.
+%
+%	  * If a goal fails or raises an exception, chunks that have not
+%	  yet started are skipped, but chunks that are running are not
+%	  abandoned.
+%
 %	@param N Number of worker-threads to create. Using 1, no threads
 %	       are created.  If N is larger than the number of Goals we
 %	       create exactly as many threads as there are Goals.
@@ -130,16 +150,34 @@ following consequences:
 %	@param Options Passed to thread_create/3 for creating the
 %	       workers.  Only options changing the stack-sizes can
 %	       be used. In particular, do not pass the detached or alias
-%	       options.
+%	       options.  In addition, pool(Bool) selects the task pool,
+%	       in which case the thread options are ignored.  The
+%	       default is to use the pool if no other options are
+%	       given.
 %	@see In many cases, concurrent_maplist/2 and friends
 %	     is easier to program and is tractable to program
 %	     analysis.
 
 concurrent(1, M:List, _) :- !,
 	maplist(M:call, List).
-concurrent(N, M:List, Options) :-
+concurrent(N, M:List, Options0) :-
 	must_be(positive_integer, N),
 	must_be(list(callable), List),
+	(   select_option(pool(Pool), Options0, Options)
+	->  must_be(boolean, Pool)
+	;   Options = Options0,
+	    (	Options == []
+	    ->	Pool = true
+	    ;	Pool = false
+	    )
+	),
+	(   Pool == true,
+	    pool_chunks(N, List, Chunks)
+	->  pool_run(List, Chunks, M)
+	;   concurrent_threads(N, M:List, Options)
+	).
+
+concurrent_threads(N, M:List, Options) :-
 	length(List, JobCount),
 	message_queue_create(Done),
 	message_queue_create(Queue),
@@ -160,6 +198,55 @@ concurrent(N, M:List, Options) :-
 	->  throw(Error)
 	).
 
+%%	pool_chunks(+N, +Goals, -Chunks) is semidet.
+%
+%	True when Goals can run on the  task pool using Chunks tasks. If
+%	N is smaller than the pool we use   at most N chunks, such that
+%	at most N goals run concurrently.   Otherwise  we create chunks
+%	for 4 tasks per worker to balance the load.
+
+pool_chunks(N, Goals, Chunks) :-
+	current_prolog_flag(cpu_count, Cores),
+	N =< Cores,
+	'$task_pool_size'(Size),
+	length(Goals, Len),
+	(   N >= Size
+	->  Chunks is max(1, min(Len, 4*Size))
+	;   Chunks is max(1, min(Len, N))
+	).
+
+%%	pool_run(+Goals, +Chunks, +Module) is semidet.
+%
+%	Run Goals on the task pool in  Chunks tasks. The answers of the
+%	pool are the instantiated tasks, which   we  unify with the tasks
+%	to return the bindings.
+
+pool_run(Goals, Chunks, M) :-
+	length(Goals, Len),
+	Size is (Len+Chunks-1)//Chunks,
+	chunk_goals(Goals, Size, M, Tasks),
+	'$task_pool_run'(Tasks, Tasks).
+
+chunk_goals([], _, _, []) :- !.
+chunk_goals(Goals, Size, M, [thread:run_chunk(Chunk, M)|Tasks]) :-
+	take(Size, Goals, Chunk, Rest),
+	chunk_goals(Rest, Size, M, Tasks).
+
+take(0, Rest, [], Rest) :- !.
+take(_, [], [], []) :- !.
+take(N, [H|T0], [H|T], Rest) :-
+	N2 is N - 1,
+	take(N2, T0, T, Rest).
+
+:- public
+	run_chunk/2.
+
+run_chunk([], _).
+run_chunk([H|T], M) :-
+	once(M:H),
+	run_chunk(T, M).
+
+
 %%	submit_goals(+List, +Id0, +Module, +Queue, -Vars) is det.
 %
 %	Send all jobs from List to Queue. Each goal is added to Queue as
@@ -272,14 +359,15 @@ join_all([Id|T]) :-
 %	less  than  two  elements,  this   predicate  simply  calls  the
 %	corresponding maplist/N version.
 %
-%	Note that the the overhead of this predicate is considerable and
-%	therefore Goal must be fairly  expensive   before  one reaches a
-%	speedup.
+%	The goals are executed in chunks by   the  task pool described
+%	with concurrent/3.  Still, the goals and their answers are copied
+%	between threads and therefore Goal must   be fairly expensive
+%	before one reaches a speedup.
 
 concurrent_maplist(Goal, List) :-
 	workers(List, WorkerCount), !,
 	maplist(ml_goal(Goal), List, Goals),
-	concurrent(WorkerCount, Goals, []).
+	pool_concurrent(WorkerCount, Goals).
 concurrent_maplist(Goal, List) :-
 	maplist(Goal, List).
 
@@ -289,7 +377,7 @@ concurrent_maplist(Goal, List1, List2) :-
 	same_length(List1, List2),
 	workers(List1, WorkerCount), !,
 	maplist(ml_goal(Goal), List1, List2, Goals),
-	concurrent(WorkerCount, Goals, []).
+	pool_concurrent(WorkerCount, Goals).
 concurrent_maplist(Goal, List1, List2) :-
 	maplist(Goal, List1, List2).
 
@@ -299,12 +387,21 @@ concurrent_maplist(Goal, List1, List2, List3) :-
 	same_length(List1, List2, List3),
 	workers(List1, WorkerCount), !,
 	maplist(ml_goal(Goal), List1, List2, List3, Goals),
-	concurrent(WorkerCount, Goals, []).
+	pool_concurrent(WorkerCount, Goals).
 concurrent_maplist(Goal, List1, List2, List3) :-
 	maplist(Goal, List1, List2, List3).
 
 ml_goal(Goal, Elem1, Elem2, Elem3, call(Goal, Elem1, Elem2, Elem3)).
 
+%	pool_concurrent(+WorkerCount, +Goals) is semidet.
+%
+%	Run the module-qualified Goals on  the   task  pool.  WorkerCount
+%	does not exceed =cpu_count= and thus pool_chunks/3 succeeds.
+
+pool_concurrent(WorkerCount, Goals) :-
+	pool_chunks(WorkerCount, Goals, Chunks),
+	pool_run(Goals, Chunks, system).
+
 workers(List, Count) :-
 	current_prolog_flag(cpu_count, Cores),
 	Cores > 1,
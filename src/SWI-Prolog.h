@@ -363,6 +363,9 @@ PL_EXPORT(int)		PL_predicate_info(predicate_t pred,
 					  atom_t *name, int *arity,
 					  module_t *module);
 
+			/* Adding clauses */
+PL_EXPORT(int)		PL_assertz_list(term_t clauses, module_t module);
+
 			/* Call-back */
 PL_EXPORT(qid_t)	PL_open_query(module_t m, int flags,
 				      predicate_t pred, term_t t0);
@@ -935,11 +938,31 @@ typedef void (*PL_abort_hook_t)(void);
 typedef void (*PL_initialise_hook_t)(int argc, char **argv);
 typedef int  (*PL_agc_hook_t)(atom_t a);
 
+#define PL_GC_POLICY	0		/* Scheduled by the GC policy */
+#define PL_GC_EXPLICIT	1		/* garbage_collect/0 */
+#define PL_GC_SPACE	2		/* Short of stack space */
+#define PL_GC_EXCEPTION	3		/* Recovering from an exception */
+
+typedef struct pl_gc_event
+{ double	start;			/* Wall time the collection started */
+  double	pause;			/* Wall time spent collecting */
+  int		reason;			/* PL_GC_* */
+  int		minor;			/* Collected the young generation only */
+  size_t	marked;			/* Bytes marked on the global stack */
+  size_t	reclaimed;		/* Bytes reclaimed from global+trail */
+  size_t	local[2];		/* Local stack usage before/after */
+  size_t	global[2];		/* Global stack usage before/after */
+  size_t	trail[2];		/* Trail stack usage before/after */
+} pl_gc_event;
+
+typedef void (*PL_gc_hook_t)(const pl_gc_event *event);
+
 PL_EXPORT(PL_dispatch_hook_t)	PL_dispatch_hook(PL_dispatch_hook_t);
 PL_EXPORT(void)			PL_abort_hook(PL_abort_hook_t);
 PL_EXPORT(void)			PL_initialise_hook(PL_initialise_hook_t);
 PL_EXPORT(int)			PL_abort_unhook(PL_abort_hook_t);
 PL_EXPORT(PL_agc_hook_t)	PL_agc_hook(PL_agc_hook_t);
+PL_EXPORT(PL_gc_hook_t)		PL_gc_hook(PL_gc_hook_t);
 
 
 		/********************************
@@ -32,6 +32,7 @@
 
 test_db :-
 	run_tests([ assert,
+		    assertz_list,
 		    retract,
 		    retractall,
 		    dynamic,
@@ -67,9 +68,49 @@ test(cut_cond, Body = (! -> fail)) :-
 
 :- end_tests(assert).
 
+:- begin_tests(assertz_list).
+
+:- dynamic
+	bulk/2, bulk_rule/1.
+
+clear_bulk :-
+	retractall(bulk(_,_)),
+	retractall(bulk_rule(_)).
+
+test(order, [cleanup(clear_bulk), Xs == [0,1,2,3]]) :-
+	assertz(bulk(0, a)),
+	assertz_list([bulk(1,a), (bulk_rule(X) :- bulk(X,_)), bulk(2,b), bulk(3,c)]),
+	findall(X, bulk_rule(X), Xs).
+test(module, [cleanup(retractall(test_db_bulk:b(_))), X == 1]) :-
+	assertz_list([test_db_bulk:b(1)]),
+	test_db_bulk:b(X).
+test(atomic, [cleanup(clear_bulk), Xs == []]) :-
+	catch(assertz_list([bulk(1,a), 42]), error(type_error(callable, 42), _),
+	      true),
+	findall(X, bulk(X,_), Xs).
+test(atomic_dynamic, fail) :-
+	catch(assertz_list([bulk_undefined(1), 42]), error(type_error(_,_), _),
+	      true),
+	predicate_property(bulk_undefined(_), dynamic).
+test(partial, [cleanup(clear_bulk), error(instantiation_error)]) :-
+	assertz_list([bulk(1,a)|_]).
+test(static, error(permission_error(modify, static_procedure, _))) :-
+	assertz_list([atom_length(a, 1)]).
+test(index, [cleanup(clear_bulk), [X,N] == [b,1050]]) :-
+	forall(between(1, 50, I), assertz(bulk(I, a))),
+	bulk(30, _),
+	assertion(predicate_property(bulk(_,_), indexed(_))),
+	numlist(51, 1050, L),
+	findall(bulk(I,b), member(I, L), Clauses),
+	assertz_list(Clauses),
+	bulk(1000, X),
+	predicate_property(bulk(_,_), number_of_clauses(N)).
+
+:- end_tests(assertz_list).
+
 :- begin_tests(retract).
 
-:- dynamic foo/1.
+:- dynamic foo/1, ctx/1.
 
 test(theorist) :-
 	(   assert((foo(A) :- bar(A))),
@@ -79,6 +120,42 @@ test(theorist) :-
 test(theorist, [cleanup(retractall(foo(_)))]) :-
 	assert((foo(A) :- bar(A))),
 	\+ retract(foo(1) :- bar(2)).
+test(body_context, [cleanup(retractall(ctx(_))), M == lists]) :-
+	context_module(Me),
+	lists:assertz((Me:ctx(X) :- member(X, [a]))),
+	clause(ctx(_), _, Ref),
+	clause_property(Ref, module(M)).
+test(free_body_context,
+     [ condition(exists_file('/proc/self/status')),
+       true(Grow < 50000)
+     ]) :-
+	context_module(Me),
+	ctx_round(Me),
+	rss(RSS0),
+	forall(between(1, 4, _), ctx_round(Me)),
+	rss(RSS1),
+	Grow is RSS1-RSS0.
+
+%	ctx_round(+Module) adds and retracts clauses whose body runs in
+%	another module.  Their memory must be reclaimed.
+
+ctx_round(M) :-
+	forall(between(1, 100000, I),
+	       lists:assertz((M:ctx(I) :- member(I, [I])))),
+	retractall(ctx(_)),
+	garbage_collect_clauses.
+
+rss(KB) :-
+	setup_call_cleanup(
+	    open('/proc/self/status', read, In),
+	    read_string(In, _, Status),
+	    close(In)),
+	sub_string(Status, B, _, _, "VmRSS:"),
+	sub_string(Status, B, _, 0, Rest),
+	split_string(Rest, "\n", "", [Line|_]),
+	split_string(Line, ":", " \t", [_, Value]),
+	split_string(Value, " ", "", [N|_]),
+	number_string(KB, N).
 
 :- end_tests(retract).
 
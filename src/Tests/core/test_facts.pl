@@ -0,0 +1,283 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+:- module(test_facts,
+	  [ test_facts/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+:- use_module(library(readutil)).
+
+/** <module> Test compact fact tables
+
+Tests for predicates declared using compact_facts/1 and compact
+predicates that are attached to a fact file.
+*/
+
+test_facts :-
+	run_tests([ compact_facts,
+		    fact_files
+		  ]).
+
+:- compact_facts(f/2).
+
+f(a, 1).
+f(b, 2).
+f(c, 3).
+
+:- begin_tests(compact_facts).
+
+:- compact_facts((g/3, big/2, upd/1)).
+
+
+test(loaded, L == [a-1,b-2,c-3]) :-
+	findall(X-Y, f(X,Y), L).
+test(bound, X == b) :-
+	f(X, 2).
+test(det, true) :-
+	f(c, 3).
+test(none, fail) :-
+	f(d, _).
+test(property, Ps == [compact,dynamic,number_of_clauses(3)]) :-
+	findall(P, ( member(P, [compact,dynamic,static,foreign,
+				number_of_clauses(_)]),
+		     predicate_property(f(_,_), P)
+		   ), Ps).
+test(assertz, L == [x-y-1,a-b-2]) :-
+	retractall(g(_,_,_)),
+	assertz(g(x,y,1)),
+	assertz(g(a,b,2)),
+	findall(X-Y-Z, g(X,Y,Z), L).
+test(assertz_list, L == [p-q-1,r-s-2]) :-
+	retractall(g(_,_,_)),
+	assertz_list([g(p,q,1), g(r,s,2)]),
+	findall(X-Y-Z, g(X,Y,Z), L).
+test(repeated, L == [a]) :-
+	retractall(g(_,_,_)),
+	assertz_list([g(a,a,1), g(a,b,2)]),
+	findall(X, g(X,X,_), L).
+test(clause, L == [a-1-true,b-2-true,c-3-true]) :-
+	findall(X-Y-B, clause(f(X,Y), B), L).
+test(retract, L == [a-1,c-3]) :-
+	retractall(g(_,_,_)),
+	assertz_list([g(a,x,1), g(b,x,2), g(c,x,3)]),
+	retract(g(b,_,_)),
+	findall(X-Y, g(X,_,Y), L).
+test(retractall, L == [b]) :-
+	retractall(g(_,_,_)),
+	assertz_list([g(a,x,1), g(b,y,2), g(c,x,3)]),
+	retractall(g(_,x,_)),
+	findall(X, g(X,_,_), L).
+test(update_view, L == [a,b]) :-
+	retractall(upd(_)),
+	assertz_list([upd(a), upd(b)]),
+	findall(X, (upd(X), assertz(upd(X))), L).
+test(retract_view, L == [a,b,c]) :-
+	retractall(upd(_)),
+	assertz_list([upd(a), upd(b), upd(c)]),
+	findall(X, (upd(X), retractall(upd(_))), L).
+test(index, L == [5000-x]) :-
+	retractall(big(_,_)),
+	forall(between(1, 10000, I), assertz(big(I, x))),
+	findall(I-X, big(I, X), All),
+	length(All, 10000),
+	findall(5000-X, big(5000, X), L).
+test(compaction, N == 10) :-
+	retractall(big(_,_)),
+	forall(between(1, 10000, I), assertz(big(I, x))),
+	retractall(big(_,x)),
+	forall(between(1, 10, I), assertz(big(I, y))),
+	aggregate_all(count, big(_, y), N).
+test(instantiation, error(instantiation_error)) :-
+	assertz(g(_, a, 1)).
+test(type, error(type_error(compact_argument, h(a)))) :-
+	assertz(g(h(a), a, 1)).
+test(rule, error(permission_error(modify, compact_procedure, _))) :-
+	assertz((g(a,b,c) :- true, true)).
+test(asserta, error(permission_error(modify, compact_procedure, _))) :-
+	asserta(g(a, b, 1)).
+test(clause_ref, error(permission_error(access, compact_procedure, _))) :-
+	clause(f(_,_), _, _).
+test(not_empty, error(permission_error(compact, procedure, _))) :-
+	dynamic(d/1),
+	assertz(d(a)),
+	call_cleanup(compact_facts(d/1), retractall(d(_))).
+test(abolish, error(existence_error(procedure, _))) :-
+	compact_facts(ab/1),
+	assertz(ab(a)),
+	abolish(ab/1),
+	ab(_).
+
+:- end_tests(compact_facts).
+
+:- begin_tests(fact_files, [cleanup(detach_all)]).
+
+:- compact_facts((p/2, q/1)).
+
+detach_all :-
+	forall(member(PI, [p/2, q/1]),
+	       catch(detach_fact_file(PI), _, true)).
+
+fact_file(File) :-
+	tmp_file(facts, File).
+
+reattach(PI, File) :-
+	detach_fact_file(PI),
+	attach_fact_file(PI, File).
+
+test(persist, L == [1-a,3-'ça',4-'\x2200\',5-[]]) :-
+	fact_file(File),
+	attach_fact_file(p/2, File),
+	assertz_list([p(1,a), p(2,b), p(3,'ça')]),
+	retract(p(2,_)),
+	assertz(p(4,'\x2200\')),
+	assertz(p(5,[])),
+	reattach(p/2, File),
+	findall(X-Y, p(X,Y), L),
+	detach_fact_file(p/2),
+	delete_file(File).
+test(compact, L == [1-a,3-c,4-d]) :-
+	fact_file(File),
+	attach_fact_file(p/2, File),
+	assertz_list([p(1,a), p(2,b), p(3,c)]),
+	retract(p(2,_)),
+	compact_fact_file(p/2),
+	assertz(p(4,d)),
+	reattach(p/2, File),
+	findall(X-Y, p(X,Y), L),
+	detach_fact_file(p/2),
+	delete_file(File).
+test(compact_active, L == [1,3,4]) :-
+	fact_file(File),
+	attach_fact_file(q/1, File),
+	assertz_list([q(1), q(2), q(3)]),
+	once(( q(_), compact_fact_file(q/1) )),
+	retract(q(2)),
+	assertz(q(4)),
+	reattach(q/1, File),
+	findall(X, q(X), L),
+	detach_fact_file(q/1),
+	delete_file(File).
+test(retractall, L == [z]) :-
+	fact_file(File),
+	attach_fact_file(q/1, File),
+	assertz_list([q(a), q(b)]),
+	compact_fact_file(q/1),
+	retractall(q(_)),
+	assertz(q(z)),
+	reattach(q/1, File),
+	findall(X, q(X), L),
+	detach_fact_file(q/1),
+	delete_file(File).
+test(index, X == 50) :-
+	fact_file(File),
+	attach_fact_file(p/2, File),
+	forall(between(1, 100, I), assertz(p(I, I))),
+	compact_fact_file(p/2),
+	p(X, 50),
+	detach_fact_file(p/2),
+	delete_file(File).
+test(property, F == File) :-
+	fact_file(File),
+	attach_fact_file(q/1, File),
+	predicate_property(q(_), fact_file(F)),
+	detach_fact_file(q/1),
+	delete_file(File).
+test(not_empty, error(permission_error(attach, compact_procedure, _))) :-
+	fact_file(File),
+	assertz(q(a)),
+	call_cleanup(attach_fact_file(q/1, File), retractall(q(_))).
+test(arity, error(domain_error(fact_file, _))) :-
+	fact_file(File),
+	attach_fact_file(q/1, File),
+	detach_fact_file(q/1),
+	call_cleanup(attach_fact_file(p/2, File), delete_file(File)).
+test(blob, error(type_error(text, _))) :-
+	fact_file(File),
+	attach_fact_file(q/1, File),
+	mutex_create(M),
+	call_cleanup(assertz(q(M)),
+		     ( detach_fact_file(q/1),
+		       mutex_destroy(M),
+		       delete_file(File)
+		     )).
+test(not_attached, error(existence_error(fact_file, _))) :-
+	detach_fact_file(q/1).
+test(truncated, error(domain_error(fact_file, _))) :-
+	fact_file(File),
+	snapshot_codes(File, Codes),
+	length(Codes, Len),
+	Half is Len//2,
+	length(Prefix, Half),
+	append(Prefix, _, Codes),
+	write_codes(File, Prefix),
+	call_cleanup(attach_fact_file(p/2, File), delete_file(File)).
+test(corrupt, true) :-
+	fact_file(File),
+	snapshot_codes(File, Codes),
+	call_cleanup(forall(nth0(I, Codes, _),
+			    attach_corrupt(File, Codes, I)),
+		     delete_file(File)).
+
+%	snapshot_codes(+File, -Codes)
+%
+%	Create a fact file for p/2 that only holds a snapshot and
+%	return its bytes.
+
+snapshot_codes(File, Codes) :-
+	attach_fact_file(p/2, File),
+	forall(between(1, 40, I),
+	       ( atom_concat(a, I, A),
+		 assertz(p(I, A))
+	       )),
+	compact_fact_file(p/2),
+	detach_fact_file(p/2),
+	read_file_to_codes(File, Codes, [type(binary)]).
+
+write_codes(File, Codes) :-
+	setup_call_cleanup(open(File, write, Out, [type(binary)]),
+			   forall(member(C, Codes), put_byte(Out, C)),
+			   close(Out)).
+
+%	attach_corrupt(+File, +Codes, +I)
+%
+%	Write Codes with byte I changed to File, attach it and query p/2.
+%	This may produce wrong facts or an error, but must not crash.
+
+attach_corrupt(File, Codes, I) :-
+	forall(member(V, [0, 0x7f, 0xff]),
+	       ( length(Pre, I),
+		 append(Pre, [_|Post], Codes),
+		 append(Pre, [V|Post], Corrupt),
+		 write_codes(File, Corrupt),
+		 catch(( attach_fact_file(p/2, File),
+			 call_cleanup(( findall(X-Y, p(X,Y), _),
+					findall(X, p(X,a7), _),
+					forall(p(9,_), true)
+				      ),
+				      detach_fact_file(p/2))
+		       ),
+		       error(domain_error(fact_file, _), _),
+		       true)
+	       )).
+
+:- end_tests(fact_files).
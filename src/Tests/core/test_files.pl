@@ -143,5 +143,156 @@ test(at_end_of_stream) :-
 	with_input_stream(
 	    text, 'a', In,
 	    \+ at_end_of_stream(In)).
+test(concurrent_load,
+     [ condition(current_prolog_flag(threads, true)),
+       setup(module_files(conc_load, [[],[],[],[]], Files)),
+       cleanup(delete_files(Files)),
+       Ns == [1,2,3,4]
+     ]) :-
+	load_files(Files, [concurrent(3), imports([]), silent(true)]),
+	findall(N, (between(1, 4, I), conc_module(conc_load, I, M), M:conc(N)),
+		Ns).
+test(concurrent_qcompile,
+     [ condition(current_prolog_flag(threads, true)),
+       setup(module_files(conc_qlf, [[2],[],[4],[3]], Files)),
+       cleanup(delete_files(Files)),
+       true
+     ]) :-
+	qcompile(Files, [concurrent(2), imports([]), silent(true)]),
+	forall(member(File, Files),
+	       ( file_name_extension(Base, pl, File),
+		 file_name_extension(Base, qlf, Qlf),
+		 exists_file(Qlf)
+	       )).
+test(concurrent_dependent,
+     [ condition(current_prolog_flag(threads, true)),
+       setup(module_files(conc_dep, [[2],[]], Files)),
+       cleanup(delete_files(Files)),
+       Ns == [1,2]
+     ]) :-
+	load_files(Files, [concurrent(2), imports([]), silent(true)]),
+	findall(N, (between(1, 2, I), conc_module(conc_dep, I, M), M:conc(N)),
+		Ns).
+test(concurrent_cyclic,
+     [ condition(current_prolog_flag(threads, true)),
+       setup(module_files(conc_cycle, [[2],[1]], Files)),
+       cleanup(delete_files(Files)),
+       Ns == [1,2]
+     ]) :-
+	load_files(Files, [concurrent(2), imports([]), silent(true)]),
+	findall(N, (between(1, 2, I), conc_module(conc_cycle, I, M), M:conc(N)),
+		Ns).
+
+test(parallel,
+     [ condition(current_prolog_flag(threads, true)),
+       setup(fact_file(File)),
+       cleanup(delete_file(File)),
+       true(Clauses =@= Expected)
+     ]) :-
+	current_prolog_flag(cpu_count, CPUs),
+	setup_call_cleanup(
+	    set_prolog_flag(cpu_count, 4),
+	    load_files(File, [parallel(4), silent(true)]),
+	    set_prolog_flag(cpu_count, CPUs)),
+	findall(Line-I-T,
+		( clause(test_par_facts:fact(I, T), true, Ref),
+		  clause_property(Ref, line_count(Line))
+		), Clauses),
+	expected_facts(Expected).
+
+%	fact_file(-File) creates a file of about 400Kb.  Facts with a
+%	multiple of 100 hold a quoted atom that spans two lines and the
+%	fact 3001 holds a variable.  A directive follows fact 5000.
+
+fact_file(File) :-
+	tmp_file(par, Tmp),
+	file_name_extension(Tmp, pl, File),
+	setup_call_cleanup(
+	    open(File, write, Out),
+	    ( format(Out, ':- module(test_par_facts, []).~n', []),
+	      forall(between(1, 8000, I),
+		     write_fact(Out, I))
+	    ),
+	    close(Out)).
+
+write_fact(Out, I) :-
+	fact_value(I, T),
+	(   I =:= 3001
+	->  format(Out, 'fact(~d, f(X, X)).~n', [I])
+	;   atom(T)
+	->  format(Out, 'fact(~d, \'~w\').~n', [I, T])
+	;   format(Out, 'fact(~d, ~q).~n', [I, T])
+	),
+	(   I =:= 5000
+	->  format(Out, ':- discontiguous fact/2.~n', [])
+	;   true
+	).
+
+fact_value(I, T) :-
+	(   I mod 100 =:= 0
+	->  format(atom(T), 'line~d~nline~d', [I, I])
+	;   T = value(I, 'some text to make the file larger')
+	).
+
+expected_facts(Facts) :-
+	findall(Line-I-T,
+		( between(1, 8000, I),
+		  fact_line(I, Line),
+		  (   I =:= 3001
+		  ->  T = f(X, X)
+		  ;   fact_value(I, T)
+		  )
+		), Facts).
+
+fact_line(I, Line) :-
+	(   I > 5000
+	->  Directive = 1
+	;   Directive = 0
+	),
+	Line is I + 1 + (I-1)//100 + Directive.
+
+%	module_files(+Prefix, +Imports, -Files) creates a module file for
+%	each element of Imports, which is the list of (1-based) indices
+%	of the files it uses.  Files that use others first sleep, such that
+%	the concurrent loaders start all files before waiting.
+
+module_files(Prefix, Imports, Files) :-
+	findall(File,
+		( member(_, Imports),
+		  tmp_file(conc, Tmp),
+		  file_name_extension(Tmp, pl, File)
+		), Files),
+	forall(nth1(I, Files, File),
+	       ( nth1(I, Imports, Uses),
+		 module_file(Prefix, I, Uses, Files, File)
+	       )).
+
+module_file(Prefix, I, Uses, Files, File) :-
+	conc_module(Prefix, I, M),
+	setup_call_cleanup(
+	    open(File, write, Out),
+	    ( format(Out, ':- module(~q, [conc/1]).~n', [M]),
+	      (	  Uses == []
+	      ->  true
+	      ;	  format(Out, ':- sleep(0.1).~n', [])
+	      ),
+	      forall(member(U, Uses),
+		     ( nth1(U, Files, UFile),
+		       format(Out, ':- use_module(~q, []).~n', [UFile])
+		     )),
+	      format(Out, 'conc(~q).~n', [I])
+	    ),
+	    close(Out)).
+
+conc_module(Prefix, I, M) :-
+	atomic_list_concat([test, Prefix, I], '_', M).
+
+delete_files(Files) :-
+	forall(member(File, Files),
+	       ( file_name_extension(Base, pl, File),
+		 file_name_extension(Base, qlf, Qlf),
+		 catch(delete_file(Qlf), _, true),
+		 delete_file(File)
+	       )).
 
 :- end_tests(files).
@@ -46,5 +46,12 @@ test(no_stream, error(existence_error(stream, S))) :-
 	format(S, fmt, []).
 test(atom, A == 'a\n') :-
 	format(atom(A), 'a\n', []).
+test(column, Codes == [0' ,0' ,0'a,0xe9,0'|,0'x,0' ,0' ,0'|]) :-
+	format(codes(Codes), '~ta\xe9\~4||~a~t~8||', [x]).
+test(column, Pos == 13) :-
+	with_output_to(string(_),
+		       ( format('lit\ttext~n~w', [abcdefghijklm]),
+			 line_position(current_output, Pos)
+		       )).
 
 :- end_tests(format).
@@ -35,6 +35,8 @@ test_gc :-
 		    gc_crash,
 		    gc_crash2,
 		    gc_mark,
+		    gc_generational,
+		    gc_events,
 		    agc
 		  ]).
 
@@ -73,6 +75,18 @@ nospace(Goal) :-
 	    fail
 	).
 
+%	churn(+N, +Old)
+%
+%	Create lots of garbage while Old is alive, forcing  garbage
+%	collections.
+
+churn(0, _) :- !.
+churn(N, Old) :-
+	numlist(1, 100, L),
+	sum_list(L, _),
+	N2 is N - 1,
+	churn(N2, Old).
+
 :- begin_tests(gc_leak, [sto(rational_trees)]).
 
 det_freeze_loop(N, T) :-
@@ -240,6 +254,77 @@ a(Y) :- length(Y,_).
 :- end_tests(gc_mark).
 
 
+:- begin_tests(gc_generational,
+	       [ setup(set_prolog_flag(gc_generational, true)),
+		 cleanup(set_prolog_flag(gc_generational, false))
+	       ]).
+
+young_refs(0, _) :- !.
+young_refs(N, T) :-			% old term references young data
+	numlist(1, 10, L),
+	setarg(1, T, L),
+	N2 is N - 1,
+	young_refs(N2, T).
+
+test(minor, [true(Minor > Minor0)]) :-
+	statistics(minor_collections, Minor0),
+	numlist(1, 50000, Old),
+	churn(20000, Old),
+	churn(20000, Old),
+	statistics(minor_collections, Minor),
+	sum_list(Old, Sum),
+	Sum =:= 50000*50001//2.
+test(old_to_young, L == L0) :-
+	numlist(1, 50000, Old),
+	T = t(_, Old),
+	churn(20000, T),
+	young_refs(20000, T),
+	churn(20000, T),
+	arg(1, T, L),
+	numlist(1, 10, L0).
+test(nb_setarg, Count == 10000) :-
+	numlist(1, 50000, Old),
+	T = count(0, Old),
+	forall(between(1, 10000, _),
+	       ( arg(1, T, C0),
+		 C is C0+1,
+		 numlist(1, 50, L),
+		 nb_setarg(1, T, C),
+		 sum_list(L, _)
+	       )),
+	arg(1, T, Count).
+
+:- end_tests(gc_generational).
+
+:- begin_tests(gc_events).
+
+test(explicit, Reason-Kind == explicit-full) :-
+	garbage_collect,
+	prolog_gc_events(Events),
+	length(Events, Len),
+	assertion(Len =< 64),
+	last(Events, gc(_Start, Pause, Reason, Kind, _Marked, _Reclaimed,
+			stacks(_,_,_), stacks(_,_,_))),
+	assertion(Pause >= 0.0).
+test(max_pause, Sum =:= 50000*50001//2) :-
+	current_prolog_flag(gc_max_pause, Old),
+	setup_call_cleanup(
+	    ( set_prolog_flag(gc_max_pause, 0.001),
+	      set_prolog_flag(gc_generational, true)
+	    ),
+	    ( numlist(1, 50000, List),
+	      churn(20000, List),
+	      sum_list(List, Sum)
+	    ),
+	    ( set_prolog_flag(gc_max_pause, Old),
+	      set_prolog_flag(gc_generational, false)
+	    )).
+test(max_pause, error(domain_error(not_less_than_zero, -1))) :-
+	set_prolog_flag(gc_max_pause, -1).
+
+:- end_tests(gc_events).
+
+
 :- begin_tests(agc).
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
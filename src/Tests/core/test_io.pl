@@ -35,7 +35,8 @@ of these these are in pre-unit test format in the main test.pl
 
 test_io :-
 	run_tests([ io,
-		    stream_pair
+		    stream_pair,
+		    read_term
 		  ]).
 
 :- begin_tests(io, [sto(rational_trees)]).
@@ -107,3 +108,48 @@ test(close, true) :-
 	assertion(var(Out)).
 
 :- end_tests(stream_pair).
+
+:- begin_tests(read_term).
+
+%	Read long runs of identifiers, digits, layout, comments and
+%	quoted text that cross the stream buffer.  The positions must
+%	be the same as for an encoding that is read character by
+%	character.
+
+test(long_runs, Terms1 =@= Terms2) :-
+	numlist(1, 600, L),
+	maplist(long_item, L, Items),
+	atomic_list_concat(Items, ',\t\t% comment\n\t', Body),
+	format(atom(Text), 'x([~w]).~nfoo(1234567890123, \'\\x41\\b\').~n',
+	       [Body]),
+	read_encoded(Text, utf8, Terms1),
+	read_encoded(Text, unicode_le, Terms2),
+	Terms1 = [t(x(List), _, _, _)|_],
+	assertion(length(List, 600)).
+
+long_item(I, Item) :-
+	format(atom(Item),
+	       'long_identifier_~d(~d, "quoted text ~d")  /* c */',
+	       [I, I, I]).
+
+read_encoded(Text, Enc, Terms) :-
+	tmp_file(read, File),
+	setup_call_cleanup(open(File, write, Out, [encoding(Enc)]),
+			   write(Out, Text),
+			   close(Out)),
+	setup_call_cleanup(open(File, read, In, [encoding(Enc)]),
+			   read_terms(In, Terms),
+			   close(In)),
+	delete_file(File).
+
+read_terms(In, Terms) :-
+	read_term(In, T, [subterm_positions(P), term_position(TP)]),
+	(   T == end_of_file
+	->  Terms = []
+	;   stream_position_data(char_count, TP, C),
+	    stream_position_data(line_count, TP, L),
+	    Terms = [t(T,P,C,L)|Rest],
+	    read_terms(In, Rest)
+	).
+
+:- end_tests(read_term).
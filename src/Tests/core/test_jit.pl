@@ -15,7 +15,10 @@ This module tests behaviour of the just-in-time indexes.
 :- begin_tests(jit).
 
 :- dynamic
-	d/2.
+	d/2,
+	e/2,
+	t/3,
+	v/3.
 
 test(remove, [cleanup(retractall(d(_,_)))]) :-
 	forall(between(1,50,X), assertz(d(X,X))),
@@ -40,4 +43,78 @@ test(retract, [cleanup(retractall(d(_,_))), Xs == Xsok]) :-
 	findall(X, retract(d(a,X)), Xs),
 	numlist(11, 100, Xsok).
 
+test(deep, [cleanup(retractall(e(_,_))), X == 42]) :-
+	forall(between(1,100,X), assertz(e(node(X,t), X))),
+	e(node(42,_), X),
+	predicate_property(e(_,_), indexed([[1,1]-_])).
+test(deep_mixed, [cleanup(retractall(e(_,_))), Xs == [b,c]]) :-
+	forall(between(1,100,X), assertz(e(node(X,t), X))),
+	e(node(42,_), _),
+	assertz(e(other(42), a)),
+	assertz(e(node(42,_), b)),
+	assertz(e(_, c)),
+	findall(X, (e(node(42,_), X), X \== 42), Xs).
+test(deep_nested, [cleanup(retractall(e(_,_))), X == 7]) :-
+	forall(between(1,100,X), assertz(e(f(g(a,X)), X))),
+	e(f(g(a,7)), X),
+	predicate_property(e(_,_), indexed([[1,1,2]-_])).
+test(deep_retract, [cleanup(retractall(e(_,_))), Xs == [41,43]]) :-
+	forall(between(1,100,X), assertz(e(node(X,t), X))),
+	e(node(42,_), _),
+	retract(e(node(42,_), _)),
+	findall(X, (between(41,43,I), e(node(I,_), X)), Xs).
+test(deep_unknown, [cleanup(retractall(e(_,_))), X == 42]) :-
+	forall(between(1,100,X), assertz(e(node(X,t), X))),
+	forall(between(1,1000,I),
+	       ( atom_concat(f, I, F), T =.. [F,I], \+ e(T, _) )),
+	\+ predicate_property(e(_,_), indexed(_)),
+	e(node(42,_), X),
+	predicate_property(e(_,_), indexed([[1,1]-_])).
+
+test(string, [cleanup(retractall(d(_,_))), X == 42]) :-
+	forall(between(1,100,X),
+	       ( format(string(S), 'a long common prefix ~d', [X]),
+		 assertz(d(S,X)) )),
+	d("a long common prefix 42", X),
+	predicate_property(d(_,_), indexed([1-_])).
+test(string_mixed, [cleanup(retractall(d(_,_))), Xs == [x1,any,x2]]) :-
+	forall(between(1,100,X),
+	       ( format(string(S), 'key ~d', [X]),
+		 assertz(d(S,X)) )),
+	d("key 1", _),
+	assertz(d("x", x1)),
+	assertz(d(_, any)),
+	assertz(d(x, atom)),
+	assertz(d("x", x2)),
+	findall(X, d("x", X), Xs).
+test(bigint, [cleanup(retractall(d(_,_))), X == 42]) :-
+	forall(between(1,100,X),
+	       ( B is 2**100+X, assertz(d(B,X)) )),
+	B42 is 2**100+42,
+	d(B42, X),
+	predicate_property(d(_,_), indexed([1-_])).
+test(list_head, [cleanup(retractall(e(_,_))), X == 42]) :-
+	forall(between(1,100,X), assertz(e([X,a,b], X))),
+	e([42|_], X),
+	predicate_property(e(_,_), indexed([[1,1]-_])).
+
+test(multi, [cleanup(retractall(t(_,_,_))), X == 1234]) :-
+	forall(between(0,1999,X),
+	       ( A is X mod 40, B is X // 40, assertz(t(A,B,X)) )),
+	t(34, 30, X),
+	predicate_property(t(_,_,_), indexed([1+2-_])).
+test(multi_update, [cleanup(retractall(t(_,_,_))), Xs == [y,z]]) :-
+	forall(between(0,1999,X),
+	       ( A is X mod 40, B is X // 40, assertz(t(A,B,X)) )),
+	t(34, 30, _),
+	assertz(t(34, 30, x)),
+	assertz(t(_, 30, y)),
+	assertz(t(34, 30, z)),
+	retract(t(34, 30, x)),
+	findall(X, (t(34, 30, X), atom(X)), Xs).
+test(void_args, [cleanup(retractall(v(_,_,_)))]) :-
+	forall(between(1,100,X), assertz(v(_,_,X))),
+	v(_,_,42),
+	predicate_property(v(_,_,_), indexed([3-_])).
+
 :- end_tests(jit).
@@ -0,0 +1,126 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+:- module(test_tabling,
+	  [ test_tabling/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test tabled execution
+
+Tests for the table/1 directive and the answer tables.
+*/
+
+test_tabling :-
+	run_tests([ tabling
+		  ]).
+
+:- table
+	path/2,
+	fib/2,
+	p/1,
+	q/1,
+	exc/1.
+
+edge(a, b).
+edge(b, c).
+edge(c, a).
+edge(c, d).
+
+path(X, Y) :- path(X, Z), edge(Z, Y).
+path(X, Y) :- edge(X, Y).
+
+fib(0, 0).
+fib(1, 1).
+fib(N, F) :-
+	N > 1,
+	N1 is N-1,
+	N2 is N-2,
+	fib(N1, F1),
+	fib(N2, F2),
+	F is F1+F2.
+
+p(X) :- q(X).
+p(1).
+
+q(X) :- p(Y), X is Y+1, X < 5.
+
+exc(X) :- X > 3, throw(exc(X)).
+exc(X) :- Y is X+1, exc(Y).
+
+:- table term/1.
+
+term(f(1.5, "s", 123456789012345678901234567890, _, A, A)).
+term(x).
+term(x).
+term(f(g(1), [a,b|T], T)).
+
+:- table expr//1.
+
+expr(X) --> expr(X0), "+", digit(D), { X is X0+D }.
+expr(X) --> digit(X).
+
+digit(D) --> [C], { code_type(C, digit(D)) }.
+
+:- table abolish_inside/0.
+
+abolish_inside :-
+	abolish_all_tables.
+
+:- begin_tests(tabling, [cleanup(abolish_all_tables)]).
+
+test(left_recursion, L == [a,b,c,d]) :-
+	findall(Y, path(a, Y), L0),
+	msort(L0, L).
+test(left_recursion, N == 12) :-
+	aggregate_all(count, path(_,_), N).
+test(fib, F == 354224848179261915075) :-
+	fib(100, F).
+test(mutual, L == [1,2,3,4]) :-
+	findall(X, p(X), L0),
+	msort(L0, L).
+test(mutual, L == [2,3,4]) :-
+	findall(X, q(X), L0),
+	msort(L0, L).
+test(variant, true(L =@= [ f(1.5, "s", 123456789012345678901234567890, _, A, A),
+			  x,
+			  f(g(1), [a,b|T], T)
+			])) :-
+	findall(X, term(X), L).
+test(dcg, X == 6) :-
+	phrase(expr(X), `1+2+3`).
+test(exception, throws(exc(4))) :-
+	exc(0).
+test(exception, throws(exc(4))) :-
+	catch(exc(0), _, true),
+	exc(0).
+test(abolish, error(permission_error(abolish, table, all))) :-
+	abolish_inside.
+test(abolish, N == 12) :-
+	aggregate_all(count, path(_,_), _),
+	abolish_all_tables,
+	aggregate_all(count, path(_,_), N).
+test(directive, error(context_error(nodirective, _))) :-
+	table(foo/1).
+
+:- end_tests(tabling).
@@ -132,6 +132,17 @@ test(whitespace, error(syntax_error(_))) :-
 	number_codes(_, "/**/42").	% ISO demands acceptance!?
 test(unify, fail) :-
 	number_codes(0, [C,C]).
+test(digits, X == 123456789012345678) :-
+	number_codes(X, "123456789012345678").
+test(digits, X == -9223372036854775808) :-
+	number_codes(X, "-9223372036854775808").
+test(float, X == Y) :-			% exact conversion
+	number_codes(X, "0.0125e2"),
+	number_codes(Y, "1.25000000000000000000").
+test(float, X == 9007199254740992.0) :-	% 2^53+1 rounds to even
+	number_codes(X, "9007199254740993.0").
+test(float, X == 1.0e23) :-		% 10^23 is inexact
+	number_codes(X, "1.0e23").
 
 :- end_tests(number_codes).
 
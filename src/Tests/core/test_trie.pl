@@ -0,0 +1,127 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+:- module(test_trie,
+	  [ test_trie/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(lists)).
+
+/** <module> Test tries
+
+Tests for the trie_* predicates that map terms modulo variant to values.
+*/
+
+test_trie :-
+	run_tests([ trie
+		  ]).
+
+:- begin_tests(trie).
+
+test(insert, V == one) :-
+	trie_new(T),
+	trie_insert(T, f(_,a), one),
+	trie_lookup(T, f(_,a), V).
+test(variant, fail) :-
+	trie_new(T),
+	trie_insert(T, f(X,X), one),
+	trie_lookup(T, f(_,_), _).
+test(duplicate, fail) :-
+	trie_new(T),
+	trie_insert(T, f(_), one),
+	trie_insert(T, f(_), two).
+test(update, V == two) :-
+	trie_new(T),
+	trie_insert(T, f(_), one),
+	trie_update(T, f(_), two),
+	trie_lookup(T, f(_), V).
+test(value, V =@= g(X,X,"s",1.5)) :-
+	trie_new(T),
+	trie_insert(T, key, g(X,X,"s",1.5)),
+	trie_lookup(T, key, V).
+test(indirect, Vs == [1,2,3]) :-
+	trie_new(T),
+	trie_insert(T, f(1.5), 1),
+	trie_insert(T, f("s"), 2),
+	trie_insert(T, f(123456789012345678901234567890), 3),
+	trie_lookup(T, f(1.5), V1),
+	trie_lookup(T, f("s"), V2),
+	trie_lookup(T, f(123456789012345678901234567890), V3),
+	Vs = [V1,V2,V3].
+test(gen, Keys =@= [k,f(_,a),g(1,[x])]) :-
+	trie_new(T),
+	trie_insert(T, g(1,[x])),
+	trie_insert(T, f(_,a)),
+	trie_insert(T, k),
+	findall(K, trie_gen(T, K), Keys0),
+	msort(Keys0, Keys).
+test(gen_partial, Vs == [2,3]) :-
+	trie_new(T),
+	forall(between(1, 3, I), trie_insert(T, f(I,[I]), I)),
+	findall(V, (trie_gen(T, f(I,_), V), I > 1), Vs0),
+	msort(Vs0, Vs).
+test(gen_ground, V == 2) :-
+	trie_new(T),
+	forall(between(1, 3, I), trie_insert(T, f(I), I)),
+	trie_gen(T, f(2), V).
+test(delete, Keys == [b]) :-
+	trie_new(T),
+	trie_insert(T, a),
+	trie_insert(T, b),
+	trie_delete(T, a, true),
+	findall(K, trie_gen(T, K), Keys).
+test(delete_in_gen, [Count,Nodes] == [0,0]) :-
+	trie_new(T),
+	forall(between(1, 10, I), trie_insert(T, f(I,[I]), I)),
+	forall(trie_gen(T, K, _), trie_delete(T, K, _)),
+	trie_property(T, value_count(Count)),
+	trie_property(T, node_count(Nodes)).
+test(property, Props = [node_count(_),value_count(2),size(_)]) :-
+	trie_new(T),
+	trie_insert(T, f(a)),
+	trie_insert(T, f(b)),
+	findall(P, trie_property(T, P), Props).
+test(size, Size1 > Size0) :-
+	trie_new(T),
+	trie_property(T, size(Size0)),
+	trie_insert(T, f(a), "a string value"),
+	trie_property(T, size(Size1)).
+test(destroy, error(existence_error(trie, T))) :-
+	trie_new(T),
+	trie_insert(T, a),
+	trie_destroy(T),
+	assertion(\+ is_trie(T)),
+	trie_lookup(T, a, _).
+test(type, error(type_error(trie, foo))) :-
+	trie_insert(foo, a).
+test(cyclic, error(type_error(acyclic_term, _))) :-
+	X = f(X),
+	trie_new(T),
+	trie_insert(T, X).
+test(agc, true) :-
+	forall(between(1, 1000, I),
+	       ( trie_new(T),
+		 trie_insert(T, f(I), I)
+	       )),
+	garbage_collect_atoms.
+
+:- end_tests(trie).
@@ -35,7 +35,9 @@ Tests that are hard to classify
 test_write :-
 	run_tests([ portray,
 		    write_canonical,
-		    write_variable_names
+		    write_variable_names,
+		    write_float,
+		    write_quoted
 		  ]).
 
 :- begin_tests(portray).
@@ -112,3 +114,36 @@ test(variable_names, X = 'a(A,B)') :-
 		       [variable_names(['B'=A]), numbervars(true)])).
 
 :- end_tests(write_variable_names).
+
+:- begin_tests(write_float).
+
+test(short, L == ['0.1', '-23.45', '1500.0', '1.0e-5', '1.0e+15', '0.003']) :-
+	maplist(term_to_atom, [0.1, -23.45, 1500.0, 0.00001, 1.0e15, 0.003],
+		L).
+test(long, A == '0.30000000000000004') :-
+	X is 0.1+0.2,
+	term_to_atom(X, A).
+test(round_trip, true) :-
+	forall(between(1, 1000, I),
+	       ( X is I/7,
+		 term_to_atom(X, A),
+		 term_to_atom(Y, A),
+		 X == Y
+	       )).
+
+:- end_tests(write_float).
+
+:- begin_tests(write_quoted).
+
+test(escape, A == '\'it\\\'s a\\nb\\\\c\'') :-
+	with_output_to(atom(A), writeq('it\'s a\nb\\c')).
+test(string, A == '"say \\"hi\\""') :-
+	with_output_to(atom(A), writeq("say \"hi\"")).
+test(position, P-L == 3-2) :-
+	with_output_to(string(_),
+		       ( write('a b\nc d'),
+			 line_position(current_output, P),
+			 line_count(current_output, L)
+		       )).
+
+:- end_tests(write_quoted).
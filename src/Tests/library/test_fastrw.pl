@@ -0,0 +1,122 @@
+:- module(test_fastrw,
+	  [ test_fastrw/0
+	  ]).
+:- use_module(library(plunit)).
+:- use_module(library(fastrw)).
+
+/** <module> Test set for library(fastrw)
+*/
+
+test_fastrw :-
+	run_tests([ fastrw
+		  ]).
+
+:- begin_tests(fastrw).
+
+test(round_trip, true) :-
+	atom_codes(Wide, [0x120, 0x41]),
+	Wide2 =.. [Wide, Wide],
+	Terms = [ foo(bar, "string", 1.5, -42, 12345678901234567890),
+		  f(X, Y, X, _, [a, b, c|Y]),
+		  [],
+		  bar,
+		  foo(bar),
+		  Wide2
+		],
+	fast_write_read(Terms, Read),
+	maplist(=@=, Read, Terms).
+test(shared_atoms, Read == Terms) :-
+	numlist(1, 1000, L),
+	findall(p(I, atom, [I, more]), member(I, L), Terms),
+	fast_write_read(Terms, Read).
+test(end_of_file, T == end_of_file) :-
+	with_tmp_file(File,
+		      ( setup_call_cleanup(open(File, write, Out), true, close(Out)),
+			setup_call_cleanup(open(File, read, In, [type(binary)]),
+					   fast_read(In, T),
+					   close(In)))).
+test(illegal, throws(error(syntax_error(illegal_fast_term), _))) :-
+	with_tmp_file(File,
+		      ( setup_call_cleanup(open(File, write, Out),
+					   format(Out, 'hello.~n', []),
+					   close(Out)),
+			setup_call_cleanup(open(File, read, In, [type(binary)]),
+					   fast_read(In, _),
+					   close(In)))).
+test(seek_into_term, throws(error(syntax_error(illegal_fast_term), _))) :-
+	with_tmp_file(File,
+		      ( setup_call_cleanup(open(File, write, Out, [type(binary)]),
+					   ( fast_write(Out, f(hello)),
+					     fast_write(Out, f(hello))
+					   ),
+					   close(Out)),
+			setup_call_cleanup(open(File, read, In, [type(binary)]),
+					   ( seek(In, 15, bof, _),
+					     fast_read(In, _)
+					   ),
+					   close(In)))).
+test(corrupt, true) :-
+	atom_codes(Wide, [0x120, 0x41]),
+	Wide2 =.. [Wide, x],
+	Terms = [f(hello), g(X, "str", 1.5, [a,b|T], T, X), -7, Wide2],
+	with_tmp_file(File,
+		      ( setup_call_cleanup(open(File, write, Out, [type(binary)]),
+					   forall(member(T0, Terms),
+						  fast_write(Out, T0)),
+					   close(Out)),
+			read_file_to_codes(File, Codes, [type(binary)]),
+			forall(nth0(I, Codes, _),
+			       read_corrupt(File, Codes, I)))).
+test(to_string, String == "f(x,'A').\n") :-
+	fast_write_to_string(f(x, 'A'), Codes, []),
+	string_codes(String, Codes).
+test(text_stream, Read =@= Term) :-
+	Term = f(X, 'A', "string", [1.5|X], -(-)),
+	with_output_to(string(String), fast_write(Term)),
+	setup_call_cleanup(open_string(String, In),
+			   fast_read(In, Read),
+			   close(In)).
+
+fast_write_read(Terms, Read) :-
+	with_tmp_file(File,
+		      ( setup_call_cleanup(open(File, write, Out, [type(binary)]),
+					   forall(member(T, Terms),
+						  fast_write(Out, T)),
+					   close(Out)),
+			setup_call_cleanup(open(File, read, In, [type(binary)]),
+					   read_all(In, Read),
+					   close(In)))).
+
+read_all(In, Terms) :-
+	fast_read(In, T),
+	(   T == end_of_file
+	->  Terms = []
+	;   Terms = [T|Rest],
+	    read_all(In, Rest)
+	).
+
+%	read_corrupt(+File, +Codes, +I)
+%
+%	Write Codes with byte I changed to File and read it back.  This
+%	may produce wrong terms or a syntax error, but must not crash.
+
+read_corrupt(File, Codes, I) :-
+	forall(member(V, [0, 0x7f, 0x80, 0xff]),
+	       ( length(Pre, I),
+		 append(Pre, [_|Post], Codes),
+		 append(Pre, [V|Post], Corrupt),
+		 setup_call_cleanup(open(File, write, Out, [type(binary)]),
+				    forall(member(C, Corrupt), put_byte(Out, C)),
+				    close(Out)),
+		 catch(setup_call_cleanup(open(File, read, In, [type(binary)]),
+					  read_all(In, _),
+					  close(In)),
+		       error(syntax_error(_), _),
+		       true)
+	       )).
+
+with_tmp_file(File, Goal) :-
+	tmp_file(fastrw, File),
+	call_cleanup(Goal, catch(delete_file(File), _, true)).
+
+:- end_tests(fastrw).
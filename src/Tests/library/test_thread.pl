@@ -32,4 +32,101 @@ test(first, true(X==1)) :-
 test(first, true(X==1)) :-
 	first_solution(X, [(repeat,fail), X=1], []).
 
+test(pool, true([X,Y]==[1,f(a)])) :-
+	Goals = [X=1, Y=f(a)],
+	'$task_pool_run'(Goals, Goals).
+test(pool, fail) :-
+	Goals = [_=1, fail],
+	'$task_pool_run'(Goals, Goals).
+test(pool, throws(x)) :-
+	Goals = [_=1, throw(x)],
+	'$task_pool_run'(Goals, Goals).
+test(pool_nested, true(L==[1,2,3])) :-
+	Goals = [ '$task_pool_run'([A=1,B=2], [A=1,B=2]),
+		  '$task_pool_run'([C=3], [C=3])
+		],
+	'$task_pool_run'(Goals, Goals),
+	L = [A,B,C].
+test(pool_chunks, true(Squares==Expected)) :-
+	numlist(1, 100, L),
+	maplist(square_goal, L, Squares, Goals),
+	context_module(M),
+	thread:pool_run(Goals, 7, M),
+	maplist(square, L, Expected).
+
+test(pool_option, true(Squares==Expected)) :-
+	numlist(1, 20, L),
+	maplist(square_goal, L, Squares, Goals),
+	concurrent(2, Goals, [pool(true)]),
+	maplist(square, L, Expected).
+test(pool_option, fail) :-
+	concurrent(2, [true, fail, true], [pool(true)]).
+test(maplist_thread_local,
+     [ setup(set_cpu_count(Old, 4)),
+       cleanup(set_prolog_flag(cpu_count, Old)),
+       true(Counts == [0,0,0,0])
+     ]) :-
+	concurrent_maplist(note, [a,b,c,d]),
+	concurrent_maplist(count_seen, [a,b,c,d], Counts).
+test(pool_global_vars, true(Vs == [none,none,none,none])) :-
+	'$task_pool_size'(Size),
+	Count is 2*Size,
+	length(Sets, Count),
+	maplist(=((nb_setval(test_thread_gv, x), sleep(0.05))), Sets),
+	thread_create('$task_pool_run'(Sets, _), Id, []),
+	thread_join(Id, true),
+	length(Vs, 4),
+	maplist(gvar_goal, Vs, Gets),
+	'$task_pool_run'(Gets, Gets).
+test(pool_busy, true(Ys == [2,3,4,5])) :-
+	'$task_pool_size'(Size),
+	Count is Size+1,
+	message_queue_create(Started),
+	message_queue_create(Go),
+	length(Blockers, Count),
+	maplist(=(test_thread:block(Started, Go)), Blockers),
+	thread_create('$task_pool_run'(Blockers, _), Id, []),
+	forall(between(1, Count, _), thread_get_message(Started, started)),
+	'$task_pool_run'([succ(1,A),succ(2,B),succ(3,C),succ(4,D)], Answers),
+	Answers = [succ(1,A),succ(2,B),succ(3,C),succ(4,D)],
+	Ys = [A,B,C,D],
+	forall(between(1, Count, _), thread_send_message(Go, go)),
+	thread_join(Id, Status),
+	assertion(Status == true),
+	message_queue_destroy(Started),
+	message_queue_destroy(Go).
+
+square_goal(X, Y, square(X, Y)).
+square(X, Y) :- Y is X*X.
+
+:- thread_local
+	seen/1.
+
+note(X) :-
+	assertz(seen(X)).
+
+count_seen(_, Count) :-
+	aggregate_all(count, seen(_), Count).
+
+:- public
+	gvar/1,
+	block/2.
+
+gvar(V) :-
+	(   nb_current(test_thread_gv, V0)
+	->  V = V0
+	;   V = none
+	),
+	sleep(0.05).
+
+gvar_goal(V, test_thread:gvar(V)).
+
+block(Started, Go) :-
+	thread_send_message(Started, started),
+	thread_get_message(Go, go).
+
+set_cpu_count(Old, New) :-
+	current_prolog_flag(cpu_count, Old),
+	set_prolog_flag(cpu_count, New).
+
 :- end_tests(thread).
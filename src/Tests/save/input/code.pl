@@ -0,0 +1,95 @@
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Predicates for testing states saved with --lazy-load and --shared-code.
+Each goal writes its result as a Prolog term and halts.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+:- dynamic
+	counter/1.
+
+counter(0).
+
+fact(1).
+fact(2).
+fact(3).
+
+rule(X) :-
+	fact(X),
+	X > 1.
+
+term_expansion(big_facts, Clauses) :-
+	findall(big(I), between(1, 1000, I), Clauses).
+
+big_facts.
+
+echo(Term) :-
+	format('~q.~n', [Term]),
+	halt.
+
+%	Call a predicate that is not yet loaded.
+
+first_call :-
+	findall(X, rule(X), Xs),
+	echo(Xs).
+
+%	Inspect the clauses of a predicate that has not been called.
+
+clauses :-
+	findall(B, clause(rule(_), B), [Body]),
+	Body = (fact(X), Test),
+	(   Test == (X > 1)
+	->  echo(true)
+	;   echo(Body)
+	).
+
+list_rule :-
+	with_output_to(string(S), listing(rule/1)),
+	(   sub_string(S, _, _, _, "fact(A)")
+	->  echo(true)
+	;   echo(S)
+	).
+
+visible :-
+	findall(PI, ( member(PI, [fact/1, rule/1, big/1]),
+		      current_predicate(PI)
+		    ), PIs),
+	echo(PIs).
+
+%	Call big/1 for the first time from several threads at once.
+
+threads :-
+	thread_self(Me),
+	length(Ids, 8),
+	maplist(count_thread(Me), Ids),
+	maplist(thread_join, Ids, _),
+	length(Counts, 8),
+	maplist(get_count, Counts),
+	echo(Counts).
+
+get_count(Count) :-
+	thread_get_message(count(Count)).
+
+count_thread(Me, Id) :-
+	thread_create(( aggregate_all(count, big(_), C),
+			thread_send_message(Me, count(C))
+		      ), Id, []).
+
+%	Properties of clauses that are part of the state.
+
+properties :-
+	clause(rule(_), _, Ref),
+	clause_property(Ref, module(M)),
+	clause_property(Ref, file(File)),
+	file_base_name(File, Base),
+	echo(M-Base).
+
+%	Modify a dynamic predicate of the state.
+
+modify :-
+	retract(counter(0)),
+	assertz(counter(1)),
+	clause(counter(1), true, Ref),
+	erase(Ref),
+	garbage_collect_clauses,
+	assertz(counter(2)),
+	findall(X, counter(X), Xs),
+	echo(Xs).
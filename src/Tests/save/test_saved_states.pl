@@ -154,6 +154,34 @@ run_state(Exe, Args, Result) :-
 remove_state(State) :-
 	catch(delete_file(State), _, true).
 
+%%	code_state(+Option, +Goal, -Result)
+%
+%	Run Goal from input/code.pl in a state saved with Option.
+
+code_state(Option, Goal, Result) :-
+	state_output(Exe),
+	call_cleanup(
+	    ( create_state('input/code.pl', Exe, [Option, '-g', Goal]),
+	      run_state(Exe, [], Result)
+	    ),
+	    remove_state(Exe)).
+
+%%	run_states(+Exe, +Count, -Results)
+%
+%	Start Count processes running Exe at the same time and collect
+%	the terms each of them writes.
+
+run_states(Exe, Count, Results) :-
+	length(Outs, Count),
+	maplist(start_state(Exe), Outs),
+	maplist(read_state, Outs, Results).
+
+start_state(Exe, Out) :-
+	process_create(Exe, [], [stdout(pipe(Out))]).
+
+read_state(Out, Result) :-
+	call_cleanup(read_terms(Out, Result), close(Out)).
+
 %%	read_terms(+In:stream, -Data:list)
 %
 %	True when Data are the Prolog terms on In.
@@ -204,6 +232,34 @@ test(true, Result == [true]) :-
 	    ),
 	    remove_state(Exe)).
 
+test(lazy_first_call, Result == [[2,3]]) :-
+	code_state('--lazy-load', first_call, Result).
+test(lazy_clause, Result == [true]) :-
+	code_state('--lazy-load', clauses, Result).
+test(lazy_listing, Result == [true]) :-
+	code_state('--lazy-load', list_rule, Result).
+test(lazy_current_predicate, Result == [[fact/1,rule/1,big/1]]) :-
+	code_state('--lazy-load', visible, Result).
+test(lazy_threads, Result == [Counts]) :-
+	length(Counts, 8),
+	maplist(=(1000), Counts),
+	code_state('--lazy-load', threads, Result).
+
+test(shared_clause, Result == [true]) :-
+	code_state('--shared-code', clauses, Result).
+test(shared_clause_property, Result == [user-'code.pl']) :-
+	code_state('--shared-code', properties, Result).
+test(shared_modify, Result == [[2]]) :-
+	code_state('--shared-code', modify, Result).
+test(shared_processes, Results == [[[2,3]], [[2,3]]]) :-
+	state_output(Exe),
+	call_cleanup(
+	    ( create_state('input/code.pl', Exe,
+			   ['--shared-code', '-g', first_call]),
+	      run_states(Exe, 2, Results)
+	    ),
+	    remove_state(Exe)).
+
 :- end_tests(saved_state).
 
 :- else.				% No library(process) found
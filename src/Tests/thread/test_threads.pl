@@ -235,5 +235,80 @@ test(size_prop, true) :-
 	message_queue_property(Queue, P),
 	P = size(2), !,
 	message_queue_destroy(Queue).
+test(contention_prop, C >= 0) :-
+	message_queue_create(Queue, []),
+	message_queue_property(Queue, contention(C)),
+	message_queue_destroy(Queue).
+test(mpmc, Sorted == Expected) :-
+	message_queue_create(Queue, []),
+	findall(T, ( between(1, 4, P),
+		     thread_create(send_n(Queue, P, 1000), T, [])
+		   ), Producers),
+	findall(T, ( between(1, 4, _),
+		     thread_create(receive_all(Queue), T, [])
+		   ), Consumers),
+	forall(member(T, Producers), thread_join(T, true)),
+	forall(member(_, Consumers), thread_send_message(Queue, done)),
+	findall(M, ( member(T, Consumers),
+		     thread_join(T, exited(Ms)),
+		     member(M, Ms)
+		   ), All),
+	msort(All, Sorted),
+	findall(m(P,I), (between(1, 4, P), between(1, 1000, I)), Expected),
+	message_queue_destroy(Queue).
+test(selective, true) :-
+	message_queue_create(Queue, []),
+	thread_create(( send_n(Queue, a, 1000),
+			send_n(Queue, b, 1000)
+		      ), T, []),
+	forall(between(1, 1000, I), thread_get_message(Queue, m(b,I))),
+	forall(between(1, 1000, I), thread_get_message(Queue, m(a,I))),
+	thread_join(T, true),
+	message_queue_destroy(Queue).
+
+test(batch, [L1,L2,L3] == [[a,b],[c,d],timeout]) :-
+	message_queue_create(Queue, []),
+	thread_send_messages(Queue, [a,b,c,d]),
+	thread_get_messages(Queue, L1, [max(2)]),
+	thread_get_messages(Queue, L2, []),
+	(   thread_get_messages(Queue, L3, [timeout(0)])
+	->  true
+	;   L3 = timeout
+	),
+	message_queue_destroy(Queue).
+test(batch_max_zero, error(domain_error(not_less_than_one, 0))) :-
+	message_queue_create(Queue, []),
+	call_cleanup(thread_get_messages(Queue, _, [max(0)]),
+		     message_queue_destroy(Queue)).
+test(batch_max_size, L == [1,2,3,4,5]) :-
+	message_queue_create(Queue, [max_size(2)]),
+	thread_create(thread_send_messages(Queue, [1,2,3,4,5]), T, []),
+	get_n(Queue, 5, L),
+	thread_join(T, true),
+	message_queue_destroy(Queue).
+
+get_n(_, 0, []) :- !.
+get_n(Queue, N, L) :-
+	thread_get_messages(Queue, L0, [max(N)]),
+	length(L0, N0),
+	N1 is N - N0,
+	append(L0, L1, L),
+	get_n(Queue, N1, L1).
+
+send_n(Queue, Id, N) :-
+	forall(between(1, N, I),
+	       thread_send_message(Queue, m(Id, I))).
+
+receive_all(Queue) :-
+	receive_all(Queue, Ms),
+	thread_exit(Ms).
+
+receive_all(Queue, Ms) :-
+	thread_get_message(Queue, M),
+	(   M == done
+	->  Ms = []
+	;   Ms = [M|T],
+	    receive_all(Queue, T)
+	).
 
 :- end_tests(message_queue).
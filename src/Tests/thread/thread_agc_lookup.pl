@@ -0,0 +1,55 @@
+:- module(thread_agc_lookup,
+	  [ thread_agc_lookup/0,
+	    thread_agc_lookup/2		% +Threads, +Count
+	  ]).
+
+%%	thread_agc_lookup
+%
+%	Test the lock-free lookup of existing atoms against AGC.  Threads
+%	repeatedly create the same set of atoms, which are garbage after
+%	each iteration, while another thread runs AGC.  Each atom must
+%	keep its text and looking it up again must return the same atom.
+%	A small agc_slice makes the threads run between sweep slices.
+
+thread_agc_lookup :-
+	thread_agc_lookup(4, 2000).
+
+thread_agc_lookup(Threads, Count) :-
+	current_prolog_flag(agc_slice, Old),
+	set_prolog_flag(agc_slice, 100),
+	call_cleanup(test(Threads, Count),
+		     set_prolog_flag(agc_slice, Old)),
+	statistics(agc_slices, Slices),
+	Slices > 0.
+
+test(Threads, Count) :-
+	thread_create(agc, AGC, []),
+	numlist(1, Threads, Is),
+	maplist(create_test(Count), Is, Ids),
+	maplist(thread_join, Ids, States),
+	thread_signal(AGC, abort),
+	thread_join(AGC, _),
+	maplist(==(true), States).
+
+agc :-
+	repeat,
+	sleep(0.001),
+	garbage_collect_atoms,
+	fail.
+
+create_test(Count, _, Id) :-
+	thread_create(test_lookup(10, Count), Id, []).
+
+test_lookup(0, _) :- !.
+test_lookup(I, Count) :-
+	forall(between(1, Count, N),
+	       check_atom(N)),
+	I2 is I - 1,
+	test_lookup(I2, Count).
+
+check_atom(N) :-
+	atom_concat(agc_lookup_, N, A1),
+	atom_concat(agc_lookup_, N, A2),
+	A1 == A2,
+	atom_concat(agc_lookup_, Rest, A1),
+	atom_number(Rest, N).
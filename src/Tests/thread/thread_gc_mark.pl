@@ -0,0 +1,75 @@
+:- module(thread_gc_mark,
+	  [ thread_gc_mark/0,
+	    thread_gc_mark/2		% +Threads, +Count
+	  ]).
+
+%%	thread_gc_mark
+%
+%	Test parallel marking by the garbage collector.  Each thread
+%	builds a list that is large enough to use the marking helpers,
+%	collects its stacks and verifies the list.  As only one engine
+%	can use the helpers at a time, the others use the sequential
+%	algorithm.
+
+thread_gc_mark :-
+	thread_gc_mark(3, 200000).
+
+thread_gc_mark(Threads, Count) :-
+	current_prolog_flag(gc_mark_threads, Old),
+	set_prolog_flag(gc_mark_threads, 2),
+	call_cleanup(( test(Threads, Count),
+		       test_stop_helpers
+		     ),
+		     set_prolog_flag(gc_mark_threads, Old)).
+
+test(Threads, Count) :-
+	numlist(1, Threads, Is),
+	maplist(create_test(Count), Is, Ids),
+	maplist(thread_join, Ids, States),
+	maplist(==(true), States).
+
+%%	test_stop_helpers
+%
+%	Setting gc_mark_threads to 0 must stop the helpers at the next
+%	garbage collection.  Only tested if we can count our threads.
+
+test_stop_helpers :-
+	exists_directory('/proc/self/task'), !,
+	set_prolog_flag(gc_mark_threads, 0),
+	garbage_collect,
+	os_threads(N),
+	prolog_threads(Prolog),
+	N =< Prolog.
+test_stop_helpers.
+
+os_threads(N) :-
+	directory_files('/proc/self/task', Entries),
+	exclude(dot_entry, Entries, Tasks),
+	length(Tasks, N).
+
+dot_entry(.).
+dot_entry(..).
+
+prolog_threads(N) :-
+	aggregate_all(count, thread_property(_, status(running)), N).
+
+create_test(Count, _, Id) :-
+	thread_create(test_gc(Count), Id, [global(1000000)]).
+
+test_gc(Count) :-
+	make_list(Count, L),
+	garbage_collect,
+	check_list(L, Count).
+
+make_list(0, []) :- !.
+make_list(N, [f(N, X, "s", 1.5, 1234567890123456789012345, X)|T]) :-
+	N2 is N - 1,
+	make_list(N2, T).
+
+check_list([], 0).
+check_list([f(N, X, S, F, B, Y)|T], N) :-
+	var(X), X == Y,
+	S == "s", F == 1.5,
+	B == 1234567890123456789012345,
+	N2 is N - 1,
+	check_list(T, N2).
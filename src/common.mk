@@ -20,7 +20,8 @@ OBJ=	pl-atom.o pl-wam.o pl-arith.o pl-bag.o pl-error.o \
 	pl-init.o pl-gmp.o pl-segstack.o pl-hash.o \
 	pl-version.o pl-codetable.o pl-supervisor.o \
 	pl-dbref.o pl-termhash.o pl-variant.o \
-	pl-copyterm.o pl-debug.o pl-ressymbol.o pl-dict.o
+	pl-copyterm.o pl-debug.o pl-ressymbol.o pl-dict.o \
+	pl-trie.o pl-tabling.o pl-facts.o
 
 # Prolog library
 
@@ -30,7 +31,7 @@ PLSRC=	../boot/syspred.pl ../boot/toplevel.pl ../boot/license.pl \
 	../boot/dwim.pl ../boot/rc.pl ../boot/predopts.pl \
 	../boot/parms.pl ../boot/autoload.pl ../boot/qlf.pl \
 	../boot/topvars.pl ../boot/messages.pl ../boot/load.pl \
-	../boot/dicts.pl
+	../boot/dicts.pl ../boot/tabling.pl
 
 PLLIBS= MANUAL helpidx.pl help.pl explain.pl sort.pl \
 	qsave.pl shlib.pl statistics.pl system.pl error.pl \
@@ -400,6 +400,7 @@ PL_EXPORT(ssize_t)	Sread_pending(IOSTREAM *s,
 				      char *buf, size_t limit, int flags);
 PL_EXPORT(size_t)	Spending(IOSTREAM *s);
 PL_EXPORT(int)		Sfputs(const char *q, IOSTREAM *s);
+PL_EXPORT(int)		Sfputsn(const char *q, size_t len, IOSTREAM *s);
 PL_EXPORT(int)		Sputs(const char *q);
 PL_EXPORT(int)		Sfprintf(IOSTREAM *s, const char *fm, ...);
 PL_EXPORT(int)		Sprintf(const char *fm, ...);
@@ -69,3 +69,13 @@ FREE_DTOA_LOCK(int n)
 #endif /*MULTIPLE_THREADS*/
 
 #include "dtoa.c"
+
+/* exact_pow10[] holds the powers of 10 that are exactly represented
+   as a double.  Used for fast float conversion by pl-read.c and
+   pl-write.c.
+*/
+
+const double exact_pow10[MAX_EXACT_POW10+1] =
+{ 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
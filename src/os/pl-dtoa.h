@@ -34,4 +34,9 @@ COMMON(char *)	dtoa(double dd, int mode, int ndigits,
 COMMON(void)	freedtoa(char *s);
 double		strtod(const char *in, char **end);
 
+#define exact_pow10 PL_exact_pow10	/* avoid library conflicts */
+#define MAX_EXACT_POW10 22		/* 10^22 is the last exact double */
+
+extern const double exact_pow10[MAX_EXACT_POW10+1];
+
 #endif /*PL_DTOA_H_INCLUDED*/
@@ -139,6 +139,7 @@ typedef struct
   alias *alias_tail;
   atom_t filename;			/* associated filename */
   unsigned flags;
+  void *fast_terms;			/* fast_write/2 tables (pl-rec.c) */
 } stream_context;
 
 
@@ -152,6 +153,7 @@ getStreamContext(IOSTREAM *s)
     ctx->alias_head = ctx->alias_tail = NULL;
     ctx->filename = NULL_ATOM;
     ctx->flags = 0;
+    ctx->fast_terms = NULL;
     addHTable(streamContext, s, ctx);
     s->context = ctx;
   }
@@ -273,6 +275,9 @@ freeStream(IOSTREAM *s)
       }
     }
 
+    if ( ctx->fast_terms )
+      freeFastTerms(ctx->fast_terms);
+
     freeHeap(ctx, sizeof(*ctx));
     deleteSymbolHTable(streamContext, symb);
   }
@@ -322,6 +327,24 @@ setFileNameStream(IOSTREAM *s, atom_t name)
 }
 
 
+/* Return the location of the atom tables of fast_write/2 and
+   fast_read/2 for s.  See pl-rec.c.
+*/
+
+void **
+streamFastTerms(IOSTREAM *s)
+{ stream_context *ctx;
+
+  if ( !(ctx=getExistingStreamContext(s)) )
+  { LOCK();
+    ctx = getStreamContext(s);
+    UNLOCK();
+  }
+
+  return &ctx->fast_terms;
+}
+
+
 atom_t
 fileNameStream(IOSTREAM *s)
 { atom_t name;
@@ -4760,6 +4783,43 @@ PRED_IMPL("source_location", 2, source_location, 0)
 }
 
 
+/** '$set_source_location'(+File, +Pos)
+
+Set the location reported by source_location/2 for a term that was read
+by another thread.  Pos is a '$stream_position'/4 term.
+*/
+
+static
+PRED_IMPL("$set_source_location", 2, set_source_location, 0)
+{ PRED_LD
+  atom_t file;
+  int64_t charno, byteno;
+  long linepos, lineno;
+  term_t a = PL_new_term_ref();
+
+  if ( !PL_get_atom_ex(A1, &file) )
+    return FALSE;
+  if ( !PL_is_functor(A2, FUNCTOR_dstream_position4) ||
+       !PL_get_arg(1, A2, a) ||
+       !PL_get_int64(a, &charno) ||
+       !PL_get_arg(2, A2, a) ||
+       !PL_get_long(a, &lineno) ||
+       !PL_get_arg(3, A2, a) ||
+       !PL_get_long(a, &linepos) ||
+       !PL_get_arg(4, A2, a) ||
+       !PL_get_int64(a, &byteno) )
+    return PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_stream_position, A2);
+
+  source_file_name = file;
+  source_char_no   = charno;
+  source_line_no   = (int)lineno;
+  source_line_pos  = (int)linepos;
+  source_byte_no   = byteno;
+
+  return TRUE;
+}
+
+
 static int
 at_end_of_stream(term_t stream ARG_LD)
 { IOSTREAM *s;
@@ -5183,6 +5243,7 @@ BeginPredDefs(file)
   PRED_DEF("get_single_char", 1, get_single_char, 0)
   PRED_DEF("read_pending_input", 3, read_pending_input, 0)
   PRED_DEF("source_location", 2, source_location, 0)
+  PRED_DEF("$set_source_location", 2, set_source_location, 0)
   PRED_DEF("copy_stream_data", 3, copy_stream_data3, 0)
   PRED_DEF("copy_stream_data", 2, copy_stream_data2, 0)
   PRED_DEF("stream_pair", 3, stream_pair, 0)
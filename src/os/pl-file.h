@@ -45,6 +45,7 @@ COMMON(int)	        reportStreamError(IOSTREAM *s);
 COMMON(int)		streamStatus(IOSTREAM *s);
 COMMON(int)		setFileNameStream(IOSTREAM *s, atom_t name);
 COMMON(atom_t)		fileNameStream(IOSTREAM *s);
+COMMON(void **)		streamFastTerms(IOSTREAM *s);
 COMMON(int)		getSingleChar(IOSTREAM *s, int signals);
 COMMON(int)		readLine(IOSTREAM *in, IOSTREAM *out, char *buffer);
 COMMON(int)		LockStream(void);
@@ -121,8 +121,9 @@ outchr(format_state *state, int chr)
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Emit ASCII 0-terminated strings resulting from sprintf() on numeric
-arguments.  No fuzz with wide characters here.
+Emit ISO Latin-1 strings, such as the  results of sprintf() on numeric
+arguments and literal text of the  format.   The  rubber buffer is UTF-8
+and can only store ASCII text directly.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
@@ -131,13 +132,22 @@ outstring(format_state *state, const char *s, size_t len)
   const char *e = &s[len];
 
   if ( state->pending_rubber )
-  { addMultipleBuffer(&state->buffer, s, len, char);
+  { for(q=s; q < e && !(*q&0x80); q++)
+      ;
+    if ( q < e )
+    { for(q=s; q < e; q++)
+      { if ( !outchr(state, *q&0xff) )
+	  return FALSE;
+      }
+
+      return TRUE;
+    }
+
+    addMultipleBuffer(&state->buffer, s, len, char);
     state->buffered += len;
   } else
-  { for(q=s; q < e; q++)
-    { if ( Sputcode(*q&0xff, state->out) < 0 )
-	return FALSE;
-    }
+  { if ( Sfputsn(s, len, state->out) < 0 )
+      return FALSE;
   }
 
   for(q=s; q < e; q++)
@@ -850,10 +860,20 @@ do_format(IOSTREAM *fd, PL_chars_t *fmt, int argc, term_t argv, Module m)
 	  break;			/* the '~' switch */
 	}
       default:
-	{ rc = outchr(&state, c);
+	{ if ( fmt->encoding == ENC_ISO_LATIN_1 )
+	  { const char *t = fmt->text.t;
+	    size_t end;			/* literal text upto the next ~ */
+
+	    for(end=here+1; end < fmt->length && t[end] != '~'; end++)
+	      ;
+	    rc = outstring(&state, t+here, end-here);
+	    here = end;
+	  } else
+	  { rc = outchr(&state, c);
+	    here++;
+	  }
 	  if ( !rc )
 	    goto out;
-	  here++;
 	  break;
 	}
     }
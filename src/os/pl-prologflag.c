@@ -673,6 +673,12 @@ set_prolog_flag_unlocked(term_t key, term_t value, int flags)
 #ifdef O_ATOMGC
       if ( k == ATOM_agc_margin )
 	GD->atoms.margin = (size_t)i;
+      else if ( k == ATOM_agc_slice )
+	GD->atoms.sweep_slice = (size_t)i;
+#endif
+#ifdef O_PLMT
+      if ( k == ATOM_gc_mark_threads )
+	GD->gc.mark_threads = (int)i;
 #endif
       break;
     }
@@ -681,6 +687,12 @@ set_prolog_flag_unlocked(term_t key, term_t value, int flags)
 
       if ( !PL_get_float_ex(value, &d) )
 	return FALSE;
+      if ( k == ATOM_gc_max_pause )
+      { if ( d < 0.0 )
+	  return PL_error(NULL, 0, NULL, ERR_DOMAIN,
+			  ATOM_not_less_than_zero, value);
+	GD->gc.max_pause = d;
+      }
       f->value.f = d;
       break;
     }
@@ -1166,8 +1178,14 @@ initPrologFlags(void)
   setPrologFlag("unload_foreign_libraries", FT_BOOL, FALSE, 0);
   setPrologFlag("gc",	  FT_BOOL,	       TRUE,  PLFLAG_GC);
   setPrologFlag("trace_gc",  FT_BOOL,	       FALSE, PLFLAG_TRACE_GC);
+  setPrologFlag("gc_generational", FT_BOOL,   FALSE, PLFLAG_GC_GENERATIONAL);
+  setPrologFlag("gc_max_pause", FT_FLOAT,	       0.0);
+#ifdef O_PLMT
+  setPrologFlag("gc_mark_threads", FT_INTEGER,      GD->gc.mark_threads);
+#endif
 #ifdef O_ATOMGC
   setPrologFlag("agc_margin",FT_INTEGER,	       GD->atoms.margin);
+  setPrologFlag("agc_slice", FT_INTEGER,	       GD->atoms.sweep_slice);
 #endif
 #if defined(HAVE_DLOPEN) || defined(HAVE_SHL_LOAD) || defined(EMULATE_DLOPEN)
   setPrologFlag("open_shared_object",	  FT_BOOL|FF_READONLY, TRUE, 0);
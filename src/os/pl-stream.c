@@ -1901,6 +1901,77 @@ Sfputs(const char *q, IOSTREAM *s)
 }
 
 
+/* Sfputsn() emits len ISO Latin-1 characters.  If the encoding is
+   compatible with ASCII and there is no tee, runs of printable ASCII
+   characters are copied to the buffer in bulk.  Such runs contain no
+   newlines, so updating the position only requires adding the length
+   of the run.
+*/
+
+int
+Sfputsn(const char *q, size_t len, IOSTREAM *s)
+{ const unsigned char *p = (const unsigned char *)q;
+  const unsigned char *e = p+len;
+  int bulk;
+
+  switch(s->encoding)
+  { case ENC_OCTET:
+    case ENC_ASCII:
+    case ENC_ISO_LATIN_1:
+    case ENC_UTF8:
+      bulk = !s->tee;
+      break;
+    default:
+      bulk = FALSE;
+  }
+
+  while(p < e)
+  { const unsigned char *r = p;
+
+    if ( bulk )
+    { while( r < e && *r >= ' ' && *r < 0x7f )
+	r++;
+    }
+
+    if ( r > p )
+    { size_t n = r-p;
+      IOPOS *pos;
+
+      while(p < r)
+      { size_t room = s->limitp - s->bufp;
+
+	if ( room > 0 )
+	{ if ( room > (size_t)(r-p) )
+	    room = r-p;
+	  memcpy(s->bufp, p, room);
+	  s->bufp += room;
+	  p += room;
+	} else
+	{ if ( S__flushbufc(*p, s) < 0 )
+	  { s->lastc = EOF;
+	    return EOF;
+	  }
+	  p++;
+	}
+      }
+
+      s->lastc = r[-1];
+      if ( (pos=s->position) )
+      { pos->byteno  += n;
+	pos->charno  += n;
+	pos->linepos += (int)n;
+      }
+    } else
+    { if ( Sputcode(*p, s) < 0 )
+	return EOF;
+      p++;
+    }
+  }
+
+  return 0;
+}
+
+
 int
 Sputs(const char *q)
 { return Sfputs(q, Soutput);
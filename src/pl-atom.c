@@ -40,6 +40,27 @@ Next, there is a hash-table, which is a normal `open' hash-table mapping
 char * to the atom structure. This   thing is dynamically rehashed. This
 table is used by lookupAtom() below.
 
+Lock-free lookup
+----------------
+
+Finding an existing atom does not  lock L_ATOM. The reader announces it
+is scanning the table by making LD->atoms.lookup_seq odd, scans the
+current table and makes the counter even again. If the scan fails, the
+locked lookup is performed, which is authoritative.  This is safe because
+
+  - New atoms are fully initialised before they are linked as head of
+    their bucket, after a memory barrier.
+  - rehashAtoms() builds a new table and relinks the atoms.  A reader
+    of the old table may follow a relinked chain and miss its atom.
+    This merely causes the locked fallback.  Old tables are kept on
+    the `prev' list until AGC, where they are freed after
+    waitAtomTableReaders() ensured no thread is still scanning.
+  - AGC claims an atom by changing its reference count from 0 to
+    ATOM_DESTROY_REFERENCE using compare-and-swap.  The reader adds its
+    reference using compare-and-swap as well and considers claimed
+    atoms a miss.  Destroyed atoms are unlinked from the table, but
+    their memory is only released after waitAtomTableReaders().
+
 Atom garbage collection
 -----------------------
 
@@ -116,6 +137,9 @@ Note that threads can mark their atoms and continue execution because:
       handling the no-locking case.
     - It is created.  This case blocks on L_ATOM being locked from
       lookupBlob().
+    - It is found by the lock-free lookup.  In this case the reference
+      count is incremented before AGC can claim the atom or the lookup
+      falls back to the locked version.
   - Finally, message queues and bags as used by findall/3 complicate
     the issue.  An atom sent to these structures subsequently may
     become inaccessible from the stack (the normal case for findall/3,
@@ -134,8 +158,12 @@ Note that threads can mark their atoms and continue execution because:
 
 static void	rehashAtoms(void);
 
-#define atom_buckets GD->atoms.buckets
-#define atomTable    GD->atoms.table
+#define atom_buckets GD->atoms.table->buckets
+#define atomTable    GD->atoms.table->table
+
+#if defined(O_PLMT) && defined(ATOMIC_REFERENCES)
+#define O_LOCKFREE_ATOMS 1
+#endif
 
 #if O_DEBUG
 #define lookups GD->atoms.lookups
@@ -367,6 +395,61 @@ PL_handle_signals() decides on the actual invocation of atom-gc and will
 treat the signal as bogus if agc has already been performed.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+#ifdef O_LOCKFREE_ATOMS
+static int
+acquireAtomNoLock(Atom a)
+{ unsigned int oldref, newref;
+
+  if ( indexAtom(a->atom) < GD->atoms.builtin )
+    return TRUE;
+
+  do
+  { oldref = a->references;
+    if ( (oldref & ATOM_DESTROY_REFERENCE) )
+      return FALSE;			/* claimed by AGC */
+    newref = oldref+1;
+  } while( !COMPARE_AND_SWAP(&a->references, oldref, newref) );
+
+  if ( newref == 1 )
+    ATOMIC_DEC(&GD->atoms.unregistered);
+
+  return TRUE;
+}
+
+
+static Atom
+lookupBlobNoLock(const char *s, size_t length, PL_blob_t *type,
+		 unsigned int v0)
+{ GET_LD
+  AtomTable t;
+  Atom a;
+
+  if ( !LD )
+    return NULL;
+
+  LD->atoms.lookup_seq++;		/* odd: scanning */
+  MemoryBarrier();
+  t = GD->atoms.table;
+
+  for(a = t->table[v0 & (t->buckets-1)]; a; a = a->next)
+  { if ( length == a->length &&
+	 type == a->type &&
+	 ( true(type, PL_BLOB_NOCOPY) ? s == a->name
+				      : memcmp(s, a->name, length) == 0 ) )
+    { if ( !acquireAtomNoLock(a) )
+	a = NULL;
+      break;
+    }
+  }
+
+  MemoryBarrier();
+  LD->atoms.lookup_seq++;
+
+  return a;
+}
+#endif /*O_LOCKFREE_ATOMS*/
+
+
 word
 lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
 { unsigned int v0, v;
@@ -376,6 +459,14 @@ lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
     PL_register_blob_type(type);
   v0 = MurmurHashAligned2(s, length, MURMUR_SEED);
 
+#ifdef O_LOCKFREE_ATOMS
+  if ( true(type, PL_BLOB_UNIQUE) &&
+       (a = lookupBlobNoLock(s, length, type, v0)) )
+  { *new = FALSE;
+    return a->atom;
+  }
+#endif
+
   LOCK();
   v  = v0 & (atom_buckets-1);
   DEBUG(MSG_HASH_STAT, lookups++);
@@ -458,6 +549,7 @@ lookupBlob(const char *s, size_t length, PL_blob_t *type, int *new)
   registerAtom(a);
   if ( true(type, PL_BLOB_UNIQUE) )
   { a->next       = atomTable[v];
+    MemoryBarrier();			/* see `Lock-free lookup' */
     atomTable[v]  = a;
   }
   GD->statistics.atoms++;
@@ -662,16 +754,16 @@ know we trapped a bug.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static int
-destroyAtom(Atom *ap, uintptr_t mask)
+destroyAtom(Atom *ap, uintptr_t mask, Buffer destroyed)
 { Atom a = *ap;
   Atom *ap2 = &atomTable[a->hash_value & mask];
 
   if ( a->type->release )
   { if ( !(*a->type->release)(a->atom) )
-      return FALSE;
+      goto keep;
   } else if ( GD->atoms.gc_hook )
   { if ( !(*GD->atoms.gc_hook)(a->atom) )
-      return FALSE;				/* foreign hooks says `no' */
+      goto keep;				/* foreign hooks says `no' */
   }
 
 #if 0
@@ -702,64 +794,166 @@ destroyAtom(Atom *ap, uintptr_t mask)
   { size_t slen = a->length + a->type->padding;
     GD->statistics.atom_string_space -= slen;
     GD->statistics.atom_string_space_freed += slen;
-    PL_free(a->name);
   }
-  freeHeap(a, sizeof(*a));
+  addBuffer(destroyed, a, Atom);	/* freed by freeDestroyedAtoms() */
 
   return TRUE;
+
+keep:
+#ifdef O_LOCKFREE_ATOMS
+  a->references = 0;			/* undo claim from collectAtoms() */
+#endif
+  return FALSE;
 }
 
 
-static size_t
-collectAtoms(void)
-{ int hole_seen = FALSE;
-  size_t reclaimed = 0;
-  size_t unregistered = 0;
-  size_t index;
-  int i, last=FALSE;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+freeDestroyedAtoms() releases the memory of   the atoms destroyed by the
+last collectAtoms() as well as tables   replaced by rehashAtoms(). It is
+called with L_ATOM and L_THREAD  locked.   Lock-free  readers  may still
+hold a pointer into these structures, so  we first wait until all these
+readers have left. See `Lock-free lookup' at the start of this file.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  for(index=GD->atoms.builtin, i=MSB(index); !last; i++)
-  { size_t upto = (size_t)2<<i;
-    Atom *b = GD->atoms.array.blocks[i];
+static void
+freeDestroyedAtoms(Buffer destroyed)
+{ Atom *ap = baseBuffer(destroyed, Atom);
+  Atom *ep = topBuffer(destroyed, Atom);
+  AtomTable t;
+
+#ifdef O_LOCKFREE_ATOMS
+  if ( ap < ep || GD->atoms.table->prev )
+    waitAtomTableReaders();
+#endif
 
-    if ( upto >= GD->atoms.highest )
-    { upto = GD->atoms.highest;
-      last = TRUE;
-    }
+  for(; ap < ep; ap++)
+  { Atom a = *ap;
 
-    for(; index<upto; index++)
-    { Atom a = b[index];
+    if ( false(a->type, PL_BLOB_NOCOPY) )
+      PL_free(a->name);
+    freeHeap(a, sizeof(*a));
+  }
 
-      if ( !a )
-      { if ( !hole_seen )
-	{ hole_seen = TRUE;
+  while( (t=GD->atoms.table->prev) )
+  { GD->atoms.table->prev = t->prev;
+    freeHeap(t->table, t->buckets * sizeof(Atom));
+    freeHeap(t, sizeof(*t));
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+collectAtoms() sweeps the atom  array  after   marking.  The  sweep is
+incremental: it processes at most GD->atoms.sweep_slice atoms (Prolog
+flag agc_slice; 0 means all) while  holding   the  locks and releases
+them between slices, so other threads  can   create  and look up atoms
+and start their GC. This is safe because
+
+  - GD->atoms.gc_active remains TRUE, so PL_unregister_atom() leaves
+    ATOM_MARKED_REFERENCE rather than 0.
+  - Atoms found by a lookup or current_blob/2 have their reference
+    count incremented or are marked before they are handed out.
+  - New atoms are created with a reference count of 1.
+
+The statistics are updated and  gc_active  is   cleared  while we still
+hold L_ATOM, so a  concurrent  statistics/2   or  a  new AGC, which may
+start as soon as gc_active is  FALSE,   sees  consistent values. On entry
+*cpu is the CPU time at which AGC started; on exit it is the CPU time
+used by AGC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+collectAtomSlice(size_t *indexp, size_t *unregistered, Buffer destroyed)
+{ size_t reclaimed = 0;
+  size_t index = *indexp;
+  size_t end = GD->atoms.highest;
+
+  if ( GD->atoms.sweep_slice > 0 && end - index > GD->atoms.sweep_slice )
+    end = index + GD->atoms.sweep_slice;
+
+  for(; index<end; index++)
+  { Atom *ap = &GD->atoms.array.blocks[MSB(index)][index];
+    Atom a = *ap;
+
+    if ( !a )
+    { if ( index < GD->atoms.no_hole_before )
+	GD->atoms.no_hole_before = index;
+      continue;
+    }
+
+#ifdef O_LOCKFREE_ATOMS
+    if ( COMPARE_AND_SWAP(&a->references, 0, ATOM_DESTROY_REFERENCE) )
+#else
+    if ( a->references == 0 )
+#endif
+    { if ( destroyAtom(ap, atom_buckets-1, destroyed) )
+      { reclaimed++;
+	if ( index < GD->atoms.no_hole_before )
 	  GD->atoms.no_hole_before = index;
-	}
-	continue;
       }
-
-      if ( a->references == 0 )
-      { if ( destroyAtom(&b[index], atom_buckets-1) )
-	{ reclaimed++;
-	  if ( !hole_seen )
-	  { hole_seen = TRUE;
-	    GD->atoms.no_hole_before = index;
-	  }
-	}
-      } else
-      {
+    } else
+    {
 #ifdef ATOMIC_REFERENCES
-	ATOMIC_AND(&a->references, ~ATOM_MARKED_REFERENCE);
+      ATOMIC_AND(&a->references, ~ATOM_MARKED_REFERENCE);
 #else
-	a->references &= ~ATOM_MARKED_REFERENCE;
+      a->references &= ~ATOM_MARKED_REFERENCE;
 #endif
-        if ( a->references == 0 )
-	  unregistered++;
-      }
+      if ( a->references == 0 )
+	(*unregistered)++;
     }
   }
 
-  GD->atoms.unregistered = GD->atoms.non_garbage = unregistered;
+  *indexp = index;
+
+  return reclaimed;
+}
+
+
+static size_t
+collectAtoms(double *cpu)
+{ size_t reclaimed = 0;
+  size_t unregistered = 0;
+  size_t index = GD->atoms.builtin;
+  int done = FALSE;
+
+  while( !done )
+  { tmp_buffer destroyed;
+    sigset_t set;
+    size_t gained;
+    double t0, pause;
+
+    PL_LOCK(L_THREAD);
+    PL_LOCK(L_AGC);
+    LOCK();
+    blockSignals(&set);
+    t0 = WallTime();
+    initBuffer(&destroyed);
+    gained = collectAtomSlice(&index, &unregistered, (Buffer)&destroyed);
+    freeDestroyedAtoms((Buffer)&destroyed);
+    discardBuffer(&destroyed);
+    GD->atoms.collected += gained;
+    GD->statistics.atoms -= gained;
+    pause = WallTime() - t0;
+    GD->atoms.slices++;
+    GD->atoms.pause_time += pause;
+    if ( pause > GD->atoms.max_pause )
+      GD->atoms.max_pause = pause;
+    if ( gained > GD->atoms.max_slice_gained )
+      GD->atoms.max_slice_gained = gained;
+    if ( (done = (index >= GD->atoms.highest)) )
+    { GD->atoms.unregistered = GD->atoms.non_garbage = unregistered;
+      *cpu = CpuTime(CPU_USER) - *cpu;
+      GD->atoms.gc_time += *cpu;
+      GD->atoms.gc++;
+      GD->atoms.gc_active = FALSE;
+    }
+    unblockSignals(&set);
+    UNLOCK();
+    PL_UNLOCK(L_AGC);
+    PL_UNLOCK(L_THREAD);
+
+    reclaimed += gained;
+  }
 
   return reclaimed;
 }
@@ -769,7 +963,10 @@ collectAtoms(void)
 pl_garbage_collect_atoms() realised the atom   garbage  collector (AGC).
 
 Issues around the design of the atom  garbage collector are explained at
-the start of this file.
+the start of this file. Marking stops  the   world,  after  which we only
+hold L_AGC and L_ATOM during a sweep slice (see collectAtoms()). While
+sweeping, GD->atoms.gc_active is TRUE and new  requests for AGC as well
+as normal GC are allowed to proceed.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 foreign_t
@@ -777,15 +974,15 @@ pl_garbage_collect_atoms(void)
 { GET_LD
   int64_t oldcollected;
   int verbose;
-  double t;
+  double t, t0, pause;
   sigset_t set;
-  size_t reclaimed;
 
   if ( GD->cleaning != CLN_NORMAL )	/* Cleaning up */
     return TRUE;
 
   PL_LOCK(L_GC);
-  if ( gc_status.blocked )		/* Tricky things; avoid problems. */
+  if ( gc_status.blocked ||		/* Tricky things; avoid problems. */
+       GD->atoms.gc_active )		/* Other thread is sweeping */
   { PL_UNLOCK(L_GC);
     succeed;
   }
@@ -821,6 +1018,7 @@ pl_garbage_collect_atoms(void)
   GD->atoms.gc_active = TRUE;
   blockSignals(&set);
   t = CpuTime(CPU_USER);
+  t0 = WallTime();
   unmarkAtoms();
   markAtomsOnStacks(LD);
 #ifdef O_PLMT
@@ -828,21 +1026,20 @@ pl_garbage_collect_atoms(void)
   markAtomsMessageQueues();
 #endif
   oldcollected = GD->atoms.collected;
-  reclaimed = collectAtoms();
-  GD->atoms.gc_active = FALSE;
-  GD->atoms.collected += reclaimed;
-  GD->statistics.atoms -= reclaimed;
-  t = CpuTime(CPU_USER) - t;
-  GD->atoms.gc_time += t;
-  GD->atoms.gc++;
+  pause = WallTime() - t0;
+  GD->atoms.pause_time += pause;
+  if ( pause > GD->atoms.max_pause )
+    GD->atoms.max_pause = pause;
   unblockSignals(&set);
   UNLOCK();
   PL_UNLOCK(L_STOPTHEWORLD);
   PL_UNLOCK(L_AGC);
   PL_UNLOCK(L_THREAD);
-  gc_status.blocked--;
   PL_UNLOCK(L_GC);
 
+  collectAtoms(&t);
+  gc_status.blocked--;
+
   if ( verbose )
     printMessage(ATOM_informational,
 		 PL_FUNCTOR_CHARS, "agc", 1,
@@ -999,10 +1196,30 @@ PL_unregister_atom(atom_t a)
 		 *	    REHASH TABLE	*
 		 *******************************/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+rehashAtoms() is called with L_ATOM locked. As lock-free readers may be
+scanning the current table, we  build  a   new  table  and keep the old
+one on the `prev' list. It is reclaimed by freeDestroyedAtoms().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static AtomTable
+newAtomTable(unsigned int buckets)
+{ AtomTable t = allocHeapOrHalt(sizeof(*t));
+
+  t->buckets = buckets;
+  t->table   = allocHeapOrHalt(buckets * sizeof(Atom));
+  t->prev    = NULL;
+  memset(t->table, 0, buckets * sizeof(Atom));
+
+  return t;
+}
+
+
 static void
 rehashAtoms(void)
-{ Atom *oldtab   = atomTable;
-  int   oldbucks = atom_buckets;
+{ AtomTable oldtab = GD->atoms.table;
+  AtomTable newtab;
+  Atom *table;
   uintptr_t mask;
   size_t index;
   int i, last=FALSE;
@@ -1010,13 +1227,13 @@ rehashAtoms(void)
   if ( GD->cleaning != CLN_NORMAL )
     return;				/* no point anymore and foreign ->type */
 					/* pointers may have gone */
-  atom_buckets *= 2;
-  mask = atom_buckets-1;
-  atomTable = allocHeapOrHalt(atom_buckets * sizeof(Atom));
-  memset(atomTable, 0, atom_buckets * sizeof(Atom));
+  newtab = newAtomTable(oldtab->buckets*2);
+  mask   = newtab->buckets-1;
+  table  = newtab->table;
 
   DEBUG(MSG_HASH_STAT,
-	Sdprintf("rehashing atoms (%d --> %d)\n", oldbucks, atom_buckets));
+	Sdprintf("rehashing atoms (%d --> %d)\n",
+		 oldtab->buckets, newtab->buckets));
 
   for(index=1, i=0; !last; i++)
   { size_t upto = (size_t)2<<i;
@@ -1033,13 +1250,15 @@ rehashAtoms(void)
       if ( a && true(a->type, PL_BLOB_UNIQUE) )
       { size_t v = a->hash_value & mask;
 
-	a->next = atomTable[v];
-	atomTable[v] = a;
+	a->next = table[v];
+	table[v] = a;
       }
     }
   }
 
-  freeHeap(oldtab, oldbucks * sizeof(Atom));
+  newtab->prev = oldtab;
+  MemoryBarrier();
+  GD->atoms.table = newtab;
 }
 
 
@@ -1157,16 +1376,15 @@ exitAtoms(int status, void *context)
 void
 initAtoms(void)
 { LOCK();
-  if ( !atomTable )			/* Atom hash table */
-  { atom_buckets = ATOMHASHSIZE;
-    atomTable = allocHeapOrHalt(atom_buckets * sizeof(Atom));
-    memset(atomTable, 0, atom_buckets * sizeof(Atom));
+  if ( !GD->atoms.table )		/* Atom hash table */
+  { GD->atoms.table = newAtomTable(ATOMHASHSIZE);
 
     GD->atoms.highest = 1;
     GD->atoms.no_hole_before = 1;
     registerBuiltinAtoms();
 #ifdef O_ATOMGC
     GD->atoms.margin = 10000;
+    GD->atoms.sweep_slice = 100000;
     lockAtoms();
 #endif
     text_atom.atom_name = ATOM_text;
@@ -1240,9 +1458,12 @@ cleanupAtoms(void)
     }
   }
 
-  if ( atomTable )
-  { freeHeap(atomTable, atom_buckets * sizeof(Atom));
-    atomTable = NULL;
+  while( GD->atoms.table )
+  { AtomTable t = GD->atoms.table;
+
+    GD->atoms.table = t->prev;
+    freeHeap(t->table, t->buckets * sizeof(Atom));
+    freeHeap(t, sizeof(*t));
   }
 }
 
@@ -1308,6 +1529,10 @@ current_blob(term_t a, term_t type, frg_code call, intptr_t state ARG_LD)
 	} else if ( false(atom->type, PL_BLOB_TEXT) )
 	  continue;
 
+#ifdef O_ATOMGC
+	if ( GD->atoms.gc_active )	/* see collectAtoms() */
+	  markAtom(atom->atom);
+#endif
 	PL_unify_atom(a, atom->atom);
 	PL_UNLOCK(L_AGC);
 	ForeignRedoInt(index+1);
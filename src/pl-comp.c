@@ -26,6 +26,7 @@
 #include "pl-incl.h"
 #include "pl-dbref.h"
 #include "pl-inline.h"
+#include "pl-facts.h"
 #include <limits.h>
 #ifdef HAVE_DLADDR
 #include <dlfcn.h>
@@ -3437,6 +3438,21 @@ assert_term(term_t term, int where, atom_t owner, SourceLoc loc ARG_LD)
   }
 #endif /*O_PROLOG_HOOK*/
 
+  if ( true(proc->definition, P_FACTS) )	/* compact predicate */
+  { if ( loc )
+    { SourceFile of = lookupSourceFile(owner, TRUE);
+
+      if ( proc != of->current_procedure )
+      { addProcedureSourceFile(of, proc);
+	of->current_procedure = proc;
+      }
+    }
+
+    if ( !assertFactProcedure(proc, head, body, where PASS_LD) )
+      return NULL;
+    return (Clause)-1;			/* there is no clause */
+  }
+
   DEBUG(2,
 	Sdprintf("compiling ");
 	PL_write_term(Serror, term, 1200, PL_WRT_QUOTED);
@@ -3483,7 +3499,8 @@ takes care of reconsult, redefinition, etc.
     }
 
     if ( proc != of->current_procedure )
-    { if ( def->impl.any )	/* i.e. is (might be) defined */
+    { if ( def->impl.any ||		/* i.e. is (might be) defined */
+	   true(def, P_LAZY) )
       { if ( !redefineProcedure(proc, of, 0) )
 	{ freeClause(clause);
 	  return NULL;
@@ -3545,6 +3562,222 @@ mode, the predicate is still undefined and is not dynamic or multifile.
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assert_clause_list() implements assertz_list/1, adding a list of clauses
+to the end of their (dynamic) predicates.  This is much cheaper than
+calling assertz/1 for each clause:
+
+  1. All clauses are compiled, collecting consecutive clauses for the
+     same predicate in a batch.  If this fails, the compiled clauses are
+     discarded and the database is not modified.  Undefined predicates
+     are made dynamic only after all clauses compiled successfully.
+  2. Each batch is appended to its predicate using a single lock by
+     assertClausesProcedure().  If the batch is large compared to the
+     predicate, its clause indexes are deleted rather than updated and
+     recreated by the next call.  Batches for compact predicates (see
+     pl-facts.c) are collected as rows and added by addFactRows().
+  3. The clauses are made visible at once using a single new generation.
+     Until then they are invisible because their created generation is
+     larger than any generation.  The new generation is published using
+     compare-and-swap, such that the global generation never goes back
+     if it is incremented concurrently.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct clause_batch
+{ Procedure	proc;			/* Procedure of the clauses */
+  Definition	def;			/* Predicate of the clauses */
+  ClauseRef	first;			/* First clause of the batch */
+  ClauseRef	last;			/* Last clause of the batch */
+  size_t	clauses;		/* # clauses */
+  size_t	rules;			/* # non-unit clauses */
+  size_t	facts;			/* P_FACTS: offset of the rows */
+} clause_batch;
+
+
+static void
+discard_clause_batches(tmp_buffer *batches)
+{ clause_batch *b = baseBuffer(batches, clause_batch);
+  clause_batch *e = topBuffer(batches, clause_batch);
+
+  for(; b < e; b++)
+  { ClauseRef cref, next;
+
+    for(cref=b->first; cref; cref=next)
+    { next = cref->next;
+      freeClause(cref->value.clause);
+      freeClauseRef(cref);
+    }
+  }
+
+  discardBuffer(batches);
+}
+
+
+static int
+compile_clause_list(term_t list, Module module,
+		    tmp_buffer *batches, tmp_buffer *facts ARG_LD)
+{ term_t tail  = PL_copy_term_ref(list);
+  term_t tmp   = PL_new_term_refs(4);
+  term_t cterm = tmp+0;
+  term_t plain = tmp+1;
+  term_t head  = tmp+2;
+  term_t body  = tmp+3;
+  Procedure proc = NULL;
+
+  while( PL_get_list_ex(tail, cterm, tail) )
+  { Module m = module;
+    Module mhead;
+    functor_t fdef;
+    Procedure p;
+    Clause clause;
+    ClauseRef cref;
+    clause_batch *batch;
+    word key;
+    Word h, b;
+
+    if ( !PL_strip_module_ex(cterm, &m, plain) )
+      return FALSE;
+    mhead = m;
+    if ( !get_head_and_body_clause(plain, head, body, &mhead PASS_LD) ||
+	 !get_head_functor(head, &fdef, 0 PASS_LD) )
+      return FALSE;
+    if ( !(p = isCurrentProcedure(fdef, mhead)) )
+    { if ( checkModifySystemProc(fdef) )
+	p = lookupProcedure(fdef, mhead);
+      if ( !p )
+	return FALSE;
+    }
+
+    if ( p != proc )
+    { Definition def = getProcDefinition(p);
+
+      if ( false(def, P_DYNAMIC|P_FACTS) &&	/* see setDynamicProcedure() */
+	   def->impl.clauses.first_clause && isDefinedProcedure(p) )
+	return PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, p);
+
+      { clause_batch nb = { p, def, NULL, NULL, 0, 0,
+			    entriesBuffer(facts, word) };
+
+	addBuffer(batches, nb, clause_batch);
+      }
+      proc = p;
+    }
+
+    if ( true(proc->definition, P_FACTS) )
+    { if ( !getFactRow(proc, head, body, facts PASS_LD) )
+	return FALSE;
+      batch = topBuffer(batches, clause_batch)-1;
+      batch->clauses++;
+      continue;
+    }
+
+    h = valTermRef(head);
+    b = valTermRef(body);
+    deRef(h);
+    deRef(b);
+    if ( compileClause(&clause, h, b, proc, m, 0 PASS_LD) != TRUE )
+      return FALSE;
+#ifdef O_LOGICAL_UPDATE
+    clause->generation.created = ~(gen_t)0;	/* invisible until published */
+    clause->generation.erased  = ~(gen_t)0;
+#endif
+    argKey(clause->codes, 0, &key);
+    cref = newClauseRef(clause, key);
+
+    batch = topBuffer(batches, clause_batch)-1;
+    if ( batch->last )
+      batch->last->next = cref;
+    else
+      batch->first = cref;
+    batch->last = cref;
+    batch->clauses++;
+    if ( false(clause, UNIT_CLAUSE) )
+      batch->rules++;
+  }
+
+  return PL_get_nil_ex(tail);
+}
+
+
+int
+assert_clause_list(term_t list, Module module ARG_LD)
+{ tmp_buffer batches;
+  tmp_buffer facts;
+  clause_batch *b, *e;
+  term_t plain = PL_new_term_ref();
+  int rc = TRUE;
+
+  if ( !plain || !PL_strip_module_ex(list, &module, plain) )
+    return FALSE;
+
+  initBuffer(&batches);
+  initBuffer(&facts);
+  if ( !compile_clause_list(plain, module, &batches, &facts PASS_LD) )
+  { discard_clause_batches(&batches);
+    discardBuffer(&facts);
+    return FALSE;
+  }
+
+  b = baseBuffer(&batches, clause_batch);
+  e = topBuffer(&batches, clause_batch);
+  for(; b < e; b++)
+  { if ( false(b->def, P_DYNAMIC|P_FACTS) )
+    { if ( !setDynamicProcedure(b->proc, TRUE) )
+      { discard_clause_batches(&batches);
+	discardBuffer(&facts);
+	return FALSE;
+      }
+      b->def = getProcDefinition(b->proc);
+    }
+  }
+
+  for(b=baseBuffer(&batches, clause_batch); b < e; b++)
+  { if ( true(b->def, P_FACTS) )
+    { if ( b->clauses &&
+	   !addFactRows(b->def, baseBuffer(&facts, word)+b->facts, b->clauses) )
+	rc = FALSE;
+    } else
+    { assertClausesProcedure(b->def, b->first, b->last, b->clauses, b->rules);
+    }
+  }
+
+#ifdef O_LOGICAL_UPDATE
+  PL_LOCK(L_MISC);
+  for(;;)
+  { gen_t gen = GD->generation+1;
+
+    for(b=baseBuffer(&batches, clause_batch); b < e; b++)
+    { ClauseRef cref;
+
+      if ( !b->first )
+	continue;
+      for(cref=b->first; ; cref=cref->next)
+      { cref->value.clause->generation.created = gen;
+	if ( cref == b->last )
+	  break;
+      }
+    }
+    if ( COMPARE_AND_SWAP(&GD->generation, gen-1, gen) )
+      break;				/* else: bumped without L_MISC; retry */
+  }
+  PL_UNLOCK(L_MISC);
+#endif
+
+  discardBuffer(&batches);
+  discardBuffer(&facts);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("assertz_list", 1, assertz_list, PL_FA_TRANSPARENT)
+{ PRED_LD
+
+  return assert_clause_list(A1, NULL PASS_LD);
+}
+
+
 static
 PRED_IMPL("assertz", 1, assertz1, PL_FA_TRANSPARENT)
 { PRED_LD
@@ -3570,12 +3803,37 @@ mustBeVar(term_t t ARG_LD)
 }
 
 
+/* Compact predicates (see pl-facts.c) have no clauses, so we cannot
+   return a clause reference for them.
+*/
+
+static int
+mustHaveClauses(term_t term ARG_LD)
+{ term_t tmp = PL_new_term_refs(3);
+  Module m = NULL;
+  functor_t fd;
+  Procedure proc;
+
+  if ( PL_strip_module(term, &m, tmp) &&
+       get_head_and_body_clause(tmp, tmp+1, tmp+2, &m PASS_LD) &&
+       get_head_functor(tmp+1, &fd, 0 PASS_LD) &&
+       (proc = isCurrentProcedure(fd, m)) &&
+       true(proc->definition, P_FACTS) )
+    return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		    ATOM_access, ATOM_compact_procedure, proc);
+
+  PL_clear_exception();
+  succeed;
+}
+
+
 static
 PRED_IMPL("assertz", 2, assertz2, PL_FA_TRANSPARENT)
 { PRED_LD
   Clause clause;
 
-  if ( !mustBeVar(A2 PASS_LD) )
+  if ( !mustBeVar(A2 PASS_LD) ||
+       !mustHaveClauses(A1 PASS_LD) )
     fail;
   if ( !(clause = assert_term(A1, CL_END, NULL_ATOM, NULL PASS_LD)) )
     fail;
@@ -3634,7 +3892,7 @@ record_clause(term_t term, term_t owner, term_t source, term_t ref ARG_LD)
   }
 
   if ( (clause = assert_term(term, CL_END, a_owner, &loc PASS_LD)) )
-  { if ( ref )
+  { if ( ref && clause != (Clause)-1 )
       return PL_unify_clref(ref, clause);
     else
       return TRUE;
@@ -3872,7 +4130,9 @@ skipArgs(Code PC, int skip)
 	if ( nested )
 	  continue;
 	skip -= (int)PC[1];
-	if ( skip <= 0 )
+	if ( skip == 0 )
+	  return nextPC;
+	if ( skip < 0 )
 	  return PC;
 	continue;
       case I_EXITFACT:
@@ -3974,10 +4234,13 @@ argKey(Code PC, int skip, word *key)
       }
       case H_STRING:
       case H_MPZ:
+	*key = indexOfIndirect(PC+1, wsizeofInd(*PC));
+	succeed;
       case H_FIRSTVAR:
       case H_VAR:
       case H_VOID:
       case H_VOID_N:
+      case H_POP:			/* trailing H_VOID in compound */
       case I_EXITCATCH:
       case I_EXITFACT:
       case I_EXIT:			/* fact */
@@ -3999,6 +4262,84 @@ argKey(Code PC, int skip, word *key)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+argKeyDeep() is argKey() for deep (sub-term)  indexes. After skipping to
+the argument, it enters the compounds described   by path and determines
+the key of the sub-term found there. Returns   FALSE if the clause holds
+another term on the path, i.e., the clause cannot match a goal for which
+this path exists. Otherwise returns TRUE and  sets *key to the key or to
+0 if the sub-term is a variable.
+
+NOTE: this function must  be  kept   consistent  with  indexOfWord()  in
+pl-index.c and argKey() above.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+argKeyDeep(Code PC, int skip, const index_path *path, word *key)
+{ int i;
+
+  if ( skip > 0 )
+    PC = skipArgs(PC, skip);
+
+  for(i=0; i<path->depth; i++)
+  { functor_t f = path->functor[i];
+
+    for(;; PC = stepPC(PC))
+    { code c = decode(*PC);
+
+#ifdef O_DEBUGGER
+    again:
+#endif
+      switch(c)
+      { case H_FUNCTOR:
+	case H_RFUNCTOR:
+	  if ( (functor_t)PC[1] != f )
+	    fail;
+	  break;
+	case H_LIST:
+	case H_RLIST:
+	  if ( f != FUNCTOR_dot2 )
+	    fail;
+	  break;
+	case H_LIST_FF:			/* [X|Y] with fresh X and Y */
+	  if ( f != FUNCTOR_dot2 )
+	    fail;
+	  *key = 0;
+	  succeed;
+	case H_FIRSTVAR:
+	case H_VAR:
+	case H_VOID:
+	case H_VOID_N:
+	case H_POP:
+	case I_EXITCATCH:
+	case I_EXITFACT:
+	case I_EXIT:
+	case I_ENTER:
+	  *key = 0;
+	  succeed;
+	case I_NOP:
+	  continue;
+#ifdef O_DEBUGGER
+	case D_BREAK:
+	  c = decode(replacedBreak(PC));
+	  goto again;
+#endif
+	default:			/* atomic value */
+	  fail;
+      }
+      break;
+    }
+
+    PC = stepPC(PC);
+    if ( path->position[i] > 1 )
+      PC = skipArgs(PC, path->position[i]-1);
+  }
+
+  argKey(PC, 0, key);
+  succeed;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Similar to argKey(), but does not do   imprecise  keys and only does the
 first argument. This is used  by   listSupervisor().  This used to share
@@ -5354,7 +5695,15 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
       if ( !get_procedure(head, &proc, 0, GP_FIND) )
 	fail;
       def = getProcDefinition(proc);
-
+      if ( true(def, P_LAZY) )
+	loadLazyDefinition(def);
+
+      if ( true(def, P_FACTS) )
+      { if ( ref )
+	  return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+			  ATOM_access, ATOM_compact_procedure, proc);
+	return factsClause(def, head, body, PL__ctx PASS_LD);
+      }
       if ( true(def, P_FOREIGN) ||
 	   (   truePrologFlag(PLFLAG_ISO) &&
 	       false(def, P_DYNAMIC)
@@ -5368,11 +5717,15 @@ PRED_IMPL("clause", va, clause, PL_FA_TRANSPARENT|PL_FA_NONDETERMINISTIC)
     }
     case FRG_REDO:
       chp  = CTX_PTR;
+      if ( isFactCursor(chp) )
+	return factsClause(NULL, head, body, PL__ctx PASS_LD);
       proc = chp->cref->value.clause->procedure;
       def  = getProcDefinition(proc);
       break;
     case FRG_CUTTED:
       chp = CTX_PTR;
+      if ( isFactCursor(chp) )
+	return factsClause(NULL, head, body, PL__ctx PASS_LD);
       proc = chp->cref->value.clause->procedure;
       def  = getProcDefinition(proc);
       leaveDefinition(def);
@@ -5506,6 +5859,8 @@ pl_nth_clause(term_t p, term_t n, term_t ref, control_t h)
       fail;
 
     def = getProcDefinition(proc);
+    if ( true(def, P_LAZY) )
+      loadLazyDefinition(def);
     cref = def->impl.clauses.first_clause;
     while ( cref && !visibleClause(cref->value.clause, generation) )
       cref = cref->next;
@@ -6903,6 +7258,7 @@ BeginPredDefs(comp)
   PRED_DEF("assert",  2, assertz2, META)
   PRED_DEF("assertz", 2, assertz2, META)
   PRED_DEF("asserta", 2, asserta2, META)
+  PRED_DEF("assertz_list", 1, assertz_list, META)
   PRED_DEF("redefine_system_predicate", 1, redefine_system_predicate, META)
   PRED_DEF("compile_predicates",  1, compile_predicates, META)
   PRED_DEF("$predefine_foreign",  1, predefine_foreign, PL_FA_TRANSPARENT)
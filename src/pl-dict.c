@@ -1532,6 +1532,8 @@ retry:
     if ( (vp=dict_lookup_ptr(m, k PASS_LD)) )
     { if ( (flags&SETDICT_BACKTRACKABLE) )
 	TrailAssignment(vp);
+      else if ( vp < LD->gen_bar )	/* see setarg() */
+	LD->gen_bar = gBase;
       unify_vp(vp, val PASS_LD);
       return TRUE;
     }
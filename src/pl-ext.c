@@ -324,7 +324,7 @@ registerBuiltins(const PL_extension *f)
       if ( f->flags & PL_FA_CREF )	     set(def, P_FOREIGN_CREF);
       if ( f->flags & PL_FA_ISO )		     set(def, P_ISO);
 
-      def->impl.function = f->function;
+      def->impl.foreign.function = f->function;
       createForeignSupervisor(def, f->function);
     } else
     { assert(0);
@@ -382,6 +382,9 @@ DECL_PLIST(term);
 DECL_PLIST(debug);
 DECL_PLIST(locale);
 DECL_PLIST(dict);
+DECL_PLIST(tabling);
+DECL_PLIST(trie);
+DECL_PLIST(facts);
 
 void
 initBuildIns(void)
@@ -441,6 +444,9 @@ initBuildIns(void)
 #endif
   REG_PLIST(debug);
   REG_PLIST(dict);
+  REG_PLIST(tabling);
+  REG_PLIST(trie);
+  REG_PLIST(facts);
 
 #define LOOKUPPROC(name) \
 	{ GD->procedures.name = lookupProcedure(FUNCTOR_ ## name, m); \
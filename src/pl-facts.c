@@ -0,0 +1,2560 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*#define O_DEBUG 1*/
+#include "pl-incl.h"
+#include "pl-inline.h"
+#include "pl-facts.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_MMAP) && defined(CAN_MMAP_FILES)
+#define O_MAP_FACTS 1
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Compact predicates.  See pl-facts.h  for   the  representation. A compact
+predicate is a non-deterministic P_VARARG  foreign predicate that matches
+the call directly against the rows   of  its fact table. assertz/1 (also
+from loading a file), retract/1,  retractall/1   and  clause/2 call the
+functions below.
+
+Readers do not lock the table.  They increment the reference count and
+take a snapshot of the number  of   published  rows and the generation.
+Rows are added after the published rows and become visible by updating
+the count after a memory barrier. Indexes  that are replaced and erased
+rows are discarded when the reference count drops to zero.
+
+A compact predicate can be  attached  to   a  fact  file  that holds a
+snapshot of its rows followed by a log of the modifications:
+
+  header	fact_file_header
+  atoms		per atom a fact_atom_record followed by its text
+  atom index	uint64_t[atoms]: offset of each atom
+  atom hash	uint32_t[atom_buckets] heads, uint32_t[atoms] chains
+  cells		int64_t[rows*arity]: (atom id<<1)|1 or small integer<<1
+  columns	per column uint32_t[row_buckets] heads, uint32_t[rows]
+		chains of rows in ascending order
+  column index	uint64_t[arity]: offset of the index for each column
+  distinct	uint64_t[arity]: # distinct keys of each column
+  log		records 'a' (atom), 'r' (add row), 'e' (erase row) and
+		'z' (erase all rows)
+
+Attaching a file maps the snapshot into  memory and only replays the log.
+The snapshot is validated once when it   is attached: all offsets, chains
+and cells must lie within  the  snapshot.   The  snapshot  rows are then
+matched directly against the  cells  of  the   mapped  file  using the
+column indexes of the file and  atoms  are   only  created  if they are
+needed to answer a query.  Facts  that  are   added  are  stored in the
+blocks and appended to the log.  compact_fact_file/1 writes a new snapshot.
+The file is in native byte order and word size.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FACT_INDEX_MIN_ROWS	16	/* Do not index smaller tables */
+#define FACT_INDEX_CHAIN	8	/* Try another column above this */
+#define FACT_COMPACT_MIN	256	/* Min erased rows to compact */
+#define FACT_MAX_ROWS		((size_t)(fact_link)~0 - 1)
+
+#define FACT_FILE_MAGIC		"SWI-FACT" /* 8 chars, not 0-terminated */
+#define FACT_FILE_VERSION	1
+#define FACT_BYTE_ORDER		0x01020304
+#define FACT_ERASED_PAGE	1024	/* Erased generations per page */
+#define FACT_NO_ATOM		((size_t)-1)
+#define FACT_ALIGN(n)		(((n)+7)&~(uint64_t)7)
+
+#define FACT_ATOM_TEXT		0	/* ISO Latin-1 text atom */
+#define FACT_ATOM_WIDE		1	/* UCS text atom */
+#define FACT_ATOM_SYMBOL	2	/* Reserved symbol */
+
+#define CELL_ATOM(id)		((int64_t)(id)*2+1)
+#define CELL_INT(i)		((int64_t)(i)*2)
+#define isCellAtom(c)		((c)&1)
+#define cellAtomId(c)		((size_t)((uint64_t)(c)>>1))
+#define cellInt(c)		((c)>>1)
+
+typedef struct fact_file_header
+{ char		magic[8];		/* FACT_FILE_MAGIC */
+  uint32_t	version;		/* FACT_FILE_VERSION */
+  uint32_t	byte_order;		/* FACT_BYTE_ORDER */
+  uint32_t	word_size;		/* sizeof(word) */
+  uint32_t	arity;			/* Cells per row */
+  uint64_t	rows;			/* # rows */
+  uint64_t	atoms;			/* # atoms */
+  uint64_t	atom_buckets;		/* # buckets of the atom hash */
+  uint64_t	row_buckets;		/* # buckets of the column indexes */
+  uint64_t	atom_index;		/* Offset of the atom index */
+  uint64_t	atom_hash;		/* Offset of the atom hash */
+  uint64_t	cells;			/* Offset of the cells */
+  uint64_t	columns;		/* Offset of the column index */
+  uint64_t	distinct;		/* Offset of the distinct keys */
+  uint64_t	log;			/* Offset of the log */
+} fact_file_header;
+
+typedef struct fact_atom_record
+{ uint32_t	length;			/* Length of the text in bytes */
+  uint32_t	type;			/* FACT_ATOM_* */
+} fact_atom_record;			/* followed by the text */
+
+typedef struct fact_file
+{ atom_t	name;			/* Name of the file */
+  char	       *base;			/* The snapshot */
+  size_t	size;			/* Size of the snapshot */
+  const fact_file_header *header;	/* Header of the snapshot */
+  const int64_t *cells;			/* Cells of the rows */
+  const uint64_t *atom_index;		/* Offset of each atom */
+  const uint32_t *atom_heads;		/* Buckets of the atom hash */
+  const uint32_t *atom_next;		/* Chains of the atom hash */
+  const uint64_t *distinct;		/* # distinct keys per column */
+  const uint32_t **col_heads;		/* Buckets of the column indexes */
+  const uint32_t **col_next;		/* Chains of the column indexes */
+  unsigned int	arity;			/* Cells per row */
+  size_t	rows;			/* # rows in the snapshot */
+  size_t	atom_count;		/* # atoms in the snapshot */
+  size_t	next_atom;		/* Id of the next atom in the log */
+  atom_t       *atoms;			/* Atoms of the snapshot (or 0) */
+  Table		atom_ids;		/* atom_t --> id+1 */
+  gen_t	      **erased;			/* Pages of erased generations */
+  size_t	erased_count;		/* # erased rows of the snapshot */
+  IOSTREAM     *log;			/* Stream to append to the log */
+  uint32_t     *row_map;		/* Log id of the rows we replace */
+  size_t	map_rows;		/* # rows in row_map */
+} fact_file;
+
+#ifdef O_PLMT
+#define LOCK_FACTS(t)	simpleMutexLock(&(t)->lock)
+#define UNLOCK_FACTS(t)	simpleMutexUnlock(&(t)->lock)
+#else
+#define LOCK_FACTS(t)	(void)0
+#define UNLOCK_FACTS(t)	(void)0
+#endif
+
+static foreign_t fact_call(term_t av, int arity, control_t h);
+static void	 switch_fact_file(fact_table *t);
+static void	 free_fact_file(fact_file *f);
+
+
+		 /*******************************
+		 *	       ROWS		*
+		 *******************************/
+
+static inline size_t
+fact_block(size_t row)
+{ return MSB(row/FACT_BLOCK_ROWS+1);
+}
+
+static inline size_t
+fact_block_start(size_t b)
+{ return (size_t)FACT_BLOCK_ROWS*(((size_t)1<<b)-1);
+}
+
+static inline size_t
+fact_block_size(size_t b)
+{ return (size_t)FACT_BLOCK_ROWS<<b;
+}
+
+static inline word *
+fact_row(fact_table *t, size_t row)
+{ size_t i = row - t->mapped;
+  size_t b = fact_block(i);
+
+  return t->blocks[b] + (i-fact_block_start(b))*t->arity;
+}
+
+static inline const int64_t *
+file_row(fact_table *t, size_t row)
+{ return t->file->cells + row*t->arity;
+}
+
+static inline gen_t
+fact_erased(fact_table *t, size_t row)
+{ gen_t *eg;
+
+  if ( row < t->mapped )
+  { fact_file *f = t->file;
+
+    if ( f->erased && (eg=f->erased[row/FACT_ERASED_PAGE]) )
+      return eg[row%FACT_ERASED_PAGE];
+    return 0;
+  } else
+  { size_t i = row - t->mapped;
+    size_t b = fact_block(i);
+
+    eg = t->erased_gen[b];
+
+    return eg ? eg[i-fact_block_start(b)] : 0;
+  }
+}
+
+static inline int
+fact_visible(fact_table *t, size_t row, gen_t gen)
+{ gen_t erased = fact_erased(t, row);
+
+  return erased == 0 || erased > gen;
+}
+
+
+static void
+register_row(fact_table *t, word *row)
+{ unsigned int i;
+
+  for(i=0; i<t->arity; i++)
+  { if ( isAtom(row[i]) )
+      PL_register_atom(row[i]);
+  }
+}
+
+
+static void
+unregister_row(fact_table *t, word *row)
+{ unsigned int i;
+
+  for(i=0; i<t->arity; i++)
+  { if ( isAtom(row[i]) )
+      PL_unregister_atom(row[i]);
+  }
+}
+
+
+		 /*******************************
+		 *	    FILE CELLS		*
+		 *******************************/
+
+/* Atoms are stored in a fact file using their type and the raw text,
+   like the XR_ATOM and XR_BLOB records of .qlf files.  Other blobs
+   cannot be stored.
+*/
+
+static int
+file_atom_type(atom_t a)
+{ Atom ap = atomValue(a);
+
+  if ( ap->type == atomValue(ATOM_true)->type )
+    return FACT_ATOM_TEXT;
+  if ( isUCSAtom(ap) )
+    return FACT_ATOM_WIDE;
+  if ( isReservedSymbol(a) )
+    return FACT_ATOM_SYMBOL;
+
+  return -1;
+}
+
+
+static atom_t
+new_file_atom(int type, const char *s, size_t len)
+{ switch(type)
+  { case FACT_ATOM_TEXT:
+      return lookupAtom(s, len);
+    case FACT_ATOM_WIDE:
+      return lookupUCSAtom((const pl_wchar_t*)s, len/sizeof(pl_wchar_t));
+#ifdef O_RESERVED_SYMBOLS
+    case FACT_ATOM_SYMBOL:
+    { PL_chars_t text;
+
+      text.text.t    = (char*)s;
+      text.length    = len;
+      text.encoding  = ENC_ISO_LATIN_1;
+      text.storage   = PL_CHARS_HEAP;
+      text.canonical = TRUE;
+
+      return textToReservedSymbol(&text);
+    }
+#endif
+    default:
+      return 0;
+  }
+}
+
+
+static inline unsigned int
+atom_text_hash(const char *s, size_t len, int type)
+{ return MurmurHashAligned2(s, len, MURMUR_SEED+type);
+}
+
+
+static inline size_t
+cell_hash(int64_t cell, size_t buckets)
+{ uint64_t k = (uint64_t)cell * 0x9e3779b97f4a7c15ULL;
+
+  return (size_t)(k>>32) & (buckets-1);
+}
+
+
+static inline const fact_atom_record *
+file_atom_record(fact_file *f, size_t id)
+{ return (const fact_atom_record *)(f->base + f->atom_index[id]);
+}
+
+
+/* Get the atom for an atom of the snapshot, creating it on first use.
+   This is called without holding the lock.
+*/
+
+static atom_t
+file_atom(fact_file *f, size_t id)
+{ atom_t a;
+
+  if ( !(a=f->atoms[id]) )
+  { const fact_atom_record *r = file_atom_record(f, id);
+    atom_t new = new_file_atom(r->type, (const char*)(r+1), r->length);
+
+    if ( COMPARE_AND_SWAP(&f->atoms[id], (atom_t)0, new) )
+    { a = new;
+    } else
+    { PL_unregister_atom(new);
+      a = f->atoms[id];
+    }
+  }
+
+  return a;
+}
+
+
+static void
+log_atom(fact_file *f, atom_t a, int type)
+{ Atom ap = atomValue(a);
+  fact_atom_record r;
+
+  r.length = (uint32_t)ap->length;
+  r.type   = type;
+  Sputc('a', f->log);
+  Sfwrite(&r, sizeof(r), 1, f->log);
+  Sfwrite(ap->name, 1, ap->length, f->log);
+}
+
+
+/* Find the id of an atom in the file.  If create is TRUE and the atom
+   is not in the file, it is added to the log.  Returns FACT_NO_ATOM if
+   the atom is not in the file or cannot be stored.  The caller must
+   hold the lock.
+*/
+
+static size_t
+file_atom_id(fact_file *f, atom_t a, int create)
+{ Symbol s;
+  Atom ap;
+  int type;
+  size_t id;
+
+  if ( (s=lookupHTable(f->atom_ids, (void*)a)) )
+    return (size_t)s->value - 1;
+  if ( (type=file_atom_type(a)) < 0 )
+    return FACT_NO_ATOM;
+
+  ap = atomValue(a);
+  if ( f->atom_count )
+  { unsigned int h = atom_text_hash(ap->name, ap->length, type);
+    uint32_t l = f->atom_heads[h & (f->header->atom_buckets-1)];
+
+    for( ; l; l = f->atom_next[l-1] )
+    { const fact_atom_record *r = file_atom_record(f, l-1);
+
+      if ( r->type == (uint32_t)type && r->length == ap->length &&
+	   memcmp(r+1, ap->name, ap->length) == 0 )
+      { id = l-1;
+
+	if ( !f->atoms[id] )
+	{ PL_register_atom(a);
+	  if ( !COMPARE_AND_SWAP(&f->atoms[id], (atom_t)0, a) )
+	    PL_unregister_atom(a);
+	}
+	addHTable(f->atom_ids, (void*)a, (void*)(id+1));
+	return id;
+      }
+    }
+  }
+
+  if ( !create )
+    return FACT_NO_ATOM;
+
+  id = f->next_atom++;
+  log_atom(f, a, type);
+  PL_register_atom(a);
+  addHTable(f->atom_ids, (void*)a, (void*)(id+1));
+
+  return id;
+}
+
+
+static int
+word_cell(fact_file *f, word w, int create, int64_t *cell)
+{ if ( isAtom(w) )
+  { size_t id;
+
+    if ( (id=file_atom_id(f, w, create)) == FACT_NO_ATOM )
+      return FALSE;
+    *cell = CELL_ATOM(id);
+  } else
+  { *cell = CELL_INT(valInt(w));
+  }
+
+  return TRUE;
+}
+
+
+static inline word
+cell_word(fact_file *f, int64_t cell)
+{ if ( isCellAtom(cell) )
+    return file_atom(f, cellAtomId(cell));
+
+  return consInt(cellInt(cell));
+}
+
+
+static void
+row_words(fact_table *t, size_t row, word *data)
+{ if ( row < t->mapped )
+  { const int64_t *cells = file_row(t, row);
+    unsigned int i;
+
+    for(i=0; i<t->arity; i++)
+      data[i] = cell_word(t->file, cells[i]);
+  } else
+  { memcpy(data, fact_row(t, row), t->arity*sizeof(word));
+  }
+}
+
+
+		 /*******************************
+		 *	      INDEXES		*
+		 *******************************/
+
+static inline size_t
+fact_hash(word key, size_t buckets)
+{ word k = key >> LMASK_BITS;
+
+  return (size_t)((key^k) & (buckets-1));
+}
+
+
+/* Indexes only hold the rows in the blocks.  The mapped rows use the
+   indexes of the file.
+*/
+
+static inline fact_link *
+index_next(fact_table *t, fact_index *ci, size_t row)
+{ size_t i = row - t->mapped;
+  size_t b = fact_block(i);
+
+  return &ci->next[b][i-fact_block_start(b)];
+}
+
+
+static void
+index_row(fact_table *t, fact_index *ci, unsigned int col, size_t row)
+{ size_t h = fact_hash(fact_row(t, row)[col], ci->buckets);
+  size_t b = fact_block(row-t->mapped);
+
+  if ( !ci->next[b] )
+    ci->next[b] = allocHeapOrHalt(fact_block_size(b)*sizeof(fact_link));
+  *index_next(t, ci, row) = 0;
+
+  if ( ci->tails[h] )
+  { *index_next(t, ci, ci->tails[h]-1) = (fact_link)(row+1);
+  } else
+  { ci->heads[h] = (fact_link)(row+1);
+    ci->distinct++;
+  }
+  ci->tails[h] = (fact_link)(row+1);
+  ci->entries++;
+}
+
+
+static fact_index *
+new_fact_index(fact_table *t, unsigned int col)
+{ fact_index *ci = allocHeapOrHalt(sizeof(*ci));
+  size_t row;
+
+  memset(ci, 0, sizeof(*ci));
+  for(ci->buckets = 16; ci->buckets < t->rows-t->mapped; ci->buckets *= 2)
+    ;
+  ci->heads = allocHeapOrHalt(ci->buckets*sizeof(fact_link));
+  ci->tails = allocHeapOrHalt(ci->buckets*sizeof(fact_link));
+  memset(ci->heads, 0, ci->buckets*sizeof(fact_link));
+  memset(ci->tails, 0, ci->buckets*sizeof(fact_link));
+
+  for(row=t->mapped; row<t->rows; row++)
+    index_row(t, ci, col, row);
+
+  DEBUG(MSG_JIT, Sdprintf("Indexed column %d of %s: %zd rows, %zd buckets\n",
+			  col+1, predicateName(t->predicate),
+			  ci->entries, ci->buckets));
+
+  return ci;
+}
+
+
+static void
+free_fact_index(fact_index *ci)
+{ size_t b;
+
+  freeHeap(ci->heads, ci->buckets*sizeof(fact_link));
+  freeHeap(ci->tails, ci->buckets*sizeof(fact_link));
+  for(b=0; b<FACT_MAX_BLOCKS; b++)
+  { if ( ci->next[b] )
+      freeHeap(ci->next[b], fact_block_size(b)*sizeof(fact_link));
+  }
+  freeHeap(ci, sizeof(*ci));
+}
+
+
+static void
+free_index_garbage(fact_table *t)
+{ fact_index *ci, *next;
+
+  for(ci=t->garbage; ci; ci=next)
+  { next = ci->garbage;
+    free_fact_index(ci);
+  }
+  t->garbage = NULL;
+}
+
+
+/* Add the new row to all indexes.  An index that becomes too crowded is
+   replaced by a larger one.  Active cursors may still use the old one.
+*/
+
+static void
+index_new_row(fact_table *t, size_t row)
+{ unsigned int col;
+
+  for(col=0; col<t->arity; col++)
+  { fact_index *ci;
+
+    if ( (ci=t->indexes[col]) )
+    { index_row(t, ci, col, row);
+
+      if ( ci->entries > 2*ci->buckets )
+      { fact_index *nci = new_fact_index(t, col);
+
+	MemoryBarrier();
+	t->indexes[col] = nci;
+	if ( t->references )
+	{ ci->garbage = t->garbage;
+	  t->garbage = ci;
+	} else
+	{ free_fact_index(ci);
+	}
+      }
+    }
+  }
+}
+
+
+		 /*******************************
+		 *	      TABLES		*
+		 *******************************/
+
+static fact_table *
+new_fact_table(Definition def)
+{ fact_table *t = allocHeapOrHalt(sizeof(*t));
+  size_t isize;
+
+  memset(t, 0, sizeof(*t));
+  t->predicate = def;
+  t->arity     = def->functor->arity;
+  isize        = t->arity*sizeof(fact_index*);
+  t->indexes   = allocHeapOrHalt(isize);
+  memset(t->indexes, 0, isize);
+#ifdef O_PLMT
+  simpleMutexInit(&t->lock);
+#endif
+
+  return t;
+}
+
+
+static void
+free_fact_indexes(fact_table *t)
+{ unsigned int col;
+
+  for(col=0; col<t->arity; col++)
+  { if ( t->indexes[col] )
+    { free_fact_index(t->indexes[col]);
+      t->indexes[col] = NULL;
+    }
+  }
+  free_index_garbage(t);
+}
+
+
+/* Remove all rows, including the mapped ones.  The caller must hold the
+   lock and there may be no cursors.  The file is not changed.
+*/
+
+static void
+clear_fact_rows(fact_table *t)
+{ size_t row, b;
+
+  for(row=t->mapped; row<t->rows; row++)
+    unregister_row(t, fact_row(t, row));
+
+  for(b=0; b<FACT_MAX_BLOCKS; b++)
+  { if ( t->blocks[b] )
+    { freeHeap(t->blocks[b], fact_block_size(b)*t->arity*sizeof(word));
+      t->blocks[b] = NULL;
+    }
+    if ( t->erased_gen[b] )
+    { freeHeap(t->erased_gen[b], fact_block_size(b)*sizeof(gen_t));
+      t->erased_gen[b] = NULL;
+    }
+  }
+  free_fact_indexes(t);
+
+  t->rows   = 0;
+  t->count  = 0;
+  t->erased = 0;
+  t->mapped = 0;
+}
+
+
+static void
+free_fact_table(fact_table *t)
+{ clear_fact_rows(t);
+  if ( t->log_file && t->log_file != t->file )
+    free_fact_file(t->log_file);
+  if ( t->file )
+    free_fact_file(t->file);
+  freeHeap(t->indexes, t->arity*sizeof(fact_index*));
+#ifdef O_PLMT
+  simpleMutexDelete(&t->lock);
+#endif
+  freeHeap(t, sizeof(*t));
+}
+
+
+/* Add a row after the stored rows.  The caller must hold the lock, must
+   have checked FACT_MAX_ROWS and must publish the row by updating
+   t->count.
+*/
+
+static void
+append_row(fact_table *t, const word *data)
+{ size_t row = t->rows;
+  size_t b = fact_block(row-t->mapped);
+
+  if ( !t->blocks[b] )
+    t->blocks[b] = allocHeapOrHalt(fact_block_size(b)*t->arity*sizeof(word));
+  memcpy(fact_row(t, row), data, t->arity*sizeof(word));
+  register_row(t, fact_row(t, row));
+  t->rows++;
+  index_new_row(t, row);
+}
+
+
+static void
+publish_rows(fact_table *t)
+{ MemoryBarrier();
+  t->count = t->rows;
+}
+
+
+static gen_t *
+alloc_erased(size_t count)
+{ size_t size = count*sizeof(gen_t);
+  gen_t *eg = allocHeapOrHalt(size);
+
+  memset(eg, 0, size);
+  MemoryBarrier();
+
+  return eg;
+}
+
+
+/* Mark a row as erased in generation *genp, allocating the generation if
+   *genp is 0.  Returns FALSE if the row was already erased.  The caller
+   must hold the lock.
+*/
+
+static int
+erase_row(fact_table *t, size_t row, gen_t *genp)
+{ gen_t *eg;
+  size_t i, *erased;
+
+  if ( row < t->mapped )
+  { fact_file *f = t->file;
+    size_t page = row/FACT_ERASED_PAGE;
+
+    if ( !f->erased )
+    { size_t size = (f->rows+FACT_ERASED_PAGE-1)/FACT_ERASED_PAGE*sizeof(gen_t*);
+      gen_t **pages = allocHeapOrHalt(size);
+
+      memset(pages, 0, size);
+      MemoryBarrier();
+      f->erased = pages;
+    }
+    if ( !(eg=f->erased[page]) )
+      f->erased[page] = eg = alloc_erased(FACT_ERASED_PAGE);
+    i = row%FACT_ERASED_PAGE;
+    erased = &f->erased_count;
+  } else
+  { size_t b = fact_block(row-t->mapped);
+
+    if ( !(eg=t->erased_gen[b]) )
+      t->erased_gen[b] = eg = alloc_erased(fact_block_size(b));
+    i = row-t->mapped-fact_block_start(b);
+    erased = &t->erased;
+  }
+  if ( eg[i] )
+    return FALSE;
+
+  if ( !*genp )
+  { PL_LOCK(L_MISC);
+    *genp = ++GD->generation;
+    PL_UNLOCK(L_MISC);
+  }
+  eg[i] = *genp;
+  (*erased)++;
+
+  return TRUE;
+}
+
+
+/* Remove the erased rows.  This may only be called if there are no
+   cursors, i.e., nobody can see the erased rows, and the table is not
+   attached to a file.  The indexes are discarded and recreated on
+   demand.
+*/
+
+static void
+compact_fact_table(fact_table *t)
+{ size_t row, to = 0, b;
+
+  DEBUG(MSG_JIT, Sdprintf("Compacting %s: %zd erased of %zd rows\n",
+			  predicateName(t->predicate), t->erased, t->rows));
+
+  for(row=0; row<t->rows; row++)
+  { word *data = fact_row(t, row);
+
+    if ( fact_erased(t, row) )
+    { unregister_row(t, data);
+    } else
+    { if ( to != row )
+	memcpy(fact_row(t, to), data, t->arity*sizeof(word));
+      to++;
+    }
+  }
+
+  for(b=0; b<FACT_MAX_BLOCKS; b++)
+  { if ( t->erased_gen[b] )
+    { freeHeap(t->erased_gen[b], fact_block_size(b)*sizeof(gen_t));
+      t->erased_gen[b] = NULL;
+    }
+    if ( t->blocks[b] && fact_block_start(b) >= to )
+    { freeHeap(t->blocks[b], fact_block_size(b)*t->arity*sizeof(word));
+      t->blocks[b] = NULL;
+    }
+  }
+  free_fact_indexes(t);
+
+  t->rows   = to;
+  t->count  = to;
+  t->erased = 0;
+}
+
+
+/* Called with the lock held when the last cursor is released or after
+   rows have been erased.  Returns FALSE if the table was abolished and
+   must be freed by the caller after releasing the lock.  If the table
+   is attached to a file, the log refers to rows by position, so erased
+   rows are kept until compact_fact_file/1.
+*/
+
+static int
+clean_fact_table(fact_table *t)
+{ if ( t->references == 0 )
+  { free_index_garbage(t);
+    if ( !t->predicate )
+      return FALSE;
+    if ( t->file != t->log_file )
+      switch_fact_file(t);
+    else if ( !t->file &&
+	      t->erased >= FACT_COMPACT_MIN && t->erased*2 > t->rows )
+      compact_fact_table(t);
+  }
+
+  return TRUE;
+}
+
+
+static void
+unlock_and_clean(fact_table *t)
+{ int keep = clean_fact_table(t);
+
+  UNLOCK_FACTS(t);
+  if ( !keep )
+    free_fact_table(t);
+}
+
+
+		 /*******************************
+		 *	    FACT FILES		*
+		 *******************************/
+
+static int
+fact_file_error(atom_t action, atom_t file, const char *msg)
+{ GET_LD
+  term_t ex;
+
+  if ( !(ex=PL_new_term_ref()) || !PL_put_atom(ex, file) )
+    return FALSE;
+  if ( msg )
+    return PL_error(NULL, 0, msg, ERR_DOMAIN, ATOM_fact_file, ex);
+
+  return PL_error(NULL, 0, MSG_ERRNO, ERR_FILE_OPERATION,
+		  action, ATOM_fact_file, ex);
+}
+
+
+/* Id of a row in the log.  After compact_fact_file/1, the table keeps
+   using the rows of the old snapshot until there are no cursors.  In
+   the mean while row_map translates the rows to the new snapshot.
+*/
+
+static int64_t
+log_row_id(fact_table *t, size_t row)
+{ fact_file *f = t->log_file;
+
+  if ( f->row_map )
+    return row < f->map_rows ? (int64_t)f->row_map[row]
+			     : (int64_t)(f->rows + (row-f->map_rows));
+
+  return row;
+}
+
+
+/* Log adding a row.  The caller must hold the lock and must have
+   verified that all atoms can be stored (see unstorable_atom()).
+*/
+
+static void
+log_row(fact_table *t, const word *data)
+{ fact_file *f = t->log_file;
+  int64_t *cells = alloca(t->arity*sizeof(int64_t));
+  unsigned int i;
+
+  for(i=0; i<t->arity; i++)
+    word_cell(f, data[i], TRUE, &cells[i]);
+  Sputc('r', f->log);
+  Sfwrite(cells, sizeof(int64_t), t->arity, f->log);
+}
+
+
+static int
+erase_logged(fact_table *t, size_t row, gen_t *genp)
+{ if ( !erase_row(t, row, genp) )
+    return FALSE;
+
+  if ( t->log_file )
+  { int64_t id = log_row_id(t, row);
+
+    Sputc('e', t->log_file->log);
+    Sfwrite(&id, sizeof(id), 1, t->log_file->log);
+  }
+
+  return TRUE;
+}
+
+
+/* Flush the log after a modification.  If this fails, *file is set to
+   the file and the caller must raise the error after releasing the
+   lock.
+*/
+
+static int
+flush_log(fact_table *t, atom_t *file)
+{ if ( t->log_file && Sflush(t->log_file->log) < 0 )
+  { *file = t->log_file->name;
+    Sclearerr(t->log_file->log);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static void
+truncate_log(const char *path, int64_t size)
+{
+#ifdef HAVE_FTRUNCATE
+  int fd;
+
+  if ( (fd=open(path, O_WRONLY|O_BINARY)) >= 0 )
+  { if ( ftruncate(fd, size) != 0 )
+      Sdprintf("Could not truncate %s: %s\n", path, OsError());
+    close(fd);
+  }
+#endif
+}
+
+
+/* Replay the log of a fact file.  A record that is incomplete or
+   invalid (e.g., after a crash) and everything after it is removed.
+   Called with the lock held.
+*/
+
+static int
+replay_log(fact_table *t, fact_file *f, const char *path)
+{ IOSTREAM *s;
+  tmp_buffer atoms;
+  int64_t *cells = alloca(t->arity*sizeof(int64_t));
+  word *data = alloca(t->arity*sizeof(word));
+  int64_t end = f->size;
+  gen_t gen = 0;
+  size_t i;
+  int c;
+
+  if ( !(s=Sopen_file(path, "rbr")) )
+    return FALSE;
+  if ( Sseek64(s, end, SIO_SEEK_SET) != 0 )
+  { Sclose(s);
+    return FALSE;
+  }
+
+  initBuffer(&atoms);
+  while( (c=Sgetc(s)) != EOF )
+  { switch(c)
+    { case 'a':
+      { fact_atom_record r;
+	char *text;
+	atom_t a = 0;
+
+	if ( Sfread(&r, sizeof(r), 1, s) != 1 || r.length > 0x10000000 )
+	  goto truncated;
+	text = allocHeapOrHalt(r.length+1);
+	if ( Sfread(text, 1, r.length, s) == r.length )
+	  a = new_file_atom(r.type, text, r.length);
+	freeHeap(text, r.length+1);
+	if ( !a )
+	  goto truncated;
+	addBuffer(&atoms, a, atom_t);
+	end += 1+sizeof(r)+r.length;
+	continue;
+      }
+      case 'r':
+	if ( Sfread(cells, sizeof(int64_t), t->arity, s) != t->arity ||
+	     t->rows >= FACT_MAX_ROWS )
+	  goto truncated;
+	for(i=0; i<t->arity; i++)
+	{ if ( isCellAtom(cells[i]) )
+	  { size_t id = cellAtomId(cells[i]);
+
+	    if ( id < f->atom_count )
+	      data[i] = file_atom(f, id);
+	    else if ( id-f->atom_count < entriesBuffer(&atoms, atom_t) )
+	      data[i] = baseBuffer(&atoms, atom_t)[id-f->atom_count];
+	    else
+	      goto truncated;
+	  } else
+	  { data[i] = consInt(cellInt(cells[i]));
+	    if ( valInt(data[i]) != cellInt(cells[i]) )
+	      goto truncated;
+	  }
+	}
+	append_row(t, data);
+	end += 1+t->arity*sizeof(int64_t);
+	continue;
+      case 'e':
+      { int64_t id;
+
+	if ( Sfread(&id, sizeof(id), 1, s) != 1 ||
+	     id < 0 || (size_t)id >= t->rows )
+	  goto truncated;
+	erase_row(t, (size_t)id, &gen);
+	end += 1+sizeof(id);
+	continue;
+      }
+      case 'z':
+      { size_t row;
+
+	for(row=0; row<t->rows; row++)
+	  erase_row(t, row, &gen);
+	end++;
+	continue;
+      }
+    }
+
+  truncated:
+    DEBUG(MSG_JIT, Sdprintf("%s: truncating log at %lld\n",
+			    path, (long long)end));
+    Sclose(s);
+    s = NULL;
+    truncate_log(path, end);
+    break;
+  }
+  if ( s )
+    Sclose(s);
+
+  for(i=0; i<entriesBuffer(&atoms, atom_t); i++)
+  { atom_t a = baseBuffer(&atoms, atom_t)[i];
+
+    if ( lookupHTable(f->atom_ids, (void*)a) )
+      PL_unregister_atom(a);
+    else
+      addHTable(f->atom_ids, (void*)a, (void*)(f->atom_count+i+1));
+  }
+  f->next_atom = f->atom_count + entriesBuffer(&atoms, atom_t);
+  discardBuffer(&atoms);
+
+  return TRUE;
+}
+
+
+#define isPowerOfTwo(n)		((n) && ((n)&((n)-1)) == 0)
+
+/* Check that the regions described by the header of a fact file follow
+   each other without overlapping and fit in the file.  Multiplications
+   are avoided, so a corrupt header cannot overflow the tests.
+*/
+
+static int
+valid_fact_layout(const fact_file_header *h, unsigned int arity,
+		  uint64_t size)
+{ if ( arity == 0 ||
+       h->log > size ||
+       h->log != h->distinct + arity*sizeof(uint64_t) ||
+       h->distinct != h->columns + arity*sizeof(uint64_t) ||
+       h->atom_index < sizeof(*h) || h->atom_index > h->atom_hash ||
+       h->atom_hash > h->cells || h->cells > h->columns ||
+       h->atom_index%sizeof(uint64_t) != 0 ||
+       h->atom_hash%sizeof(uint32_t) != 0 ||
+       h->cells%sizeof(int64_t) != 0 ||
+       h->columns%sizeof(uint64_t) != 0 )
+    return FALSE;
+
+  if ( !isPowerOfTwo(h->atom_buckets) || !isPowerOfTwo(h->row_buckets) ||
+       h->atoms > UINT32_MAX || h->rows > FACT_MAX_ROWS ||
+       h->atom_buckets > UINT32_MAX || h->row_buckets > UINT32_MAX )
+    return FALSE;
+
+  if ( h->atoms > (h->atom_hash-h->atom_index)/sizeof(uint64_t) ||
+       h->atom_buckets+h->atoms > (h->cells-h->atom_hash)/sizeof(uint32_t) ||
+       h->rows > (h->columns-h->cells)/sizeof(int64_t)/arity )
+    return FALSE;
+
+  return TRUE;
+}
+
+
+static int
+valid_atom_record(const fact_atom_record *r)
+{ switch(r->type)
+  { case FACT_ATOM_TEXT:
+      return TRUE;
+    case FACT_ATOM_WIDE:
+      return r->length%sizeof(pl_wchar_t) == 0;
+#ifdef O_RESERVED_SYMBOLS
+    case FACT_ATOM_SYMBOL:
+      return TRUE;
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+
+/* Check the contents of a mapped snapshot whose layout was checked by
+   valid_fact_layout().  Atom records must lie before the atom index,
+   hash chains must be in range and strictly ordered, so following them
+   terminates, and cells must hold a known atom or a tagged integer.
+*/
+
+static int
+valid_fact_snapshot(const char *base, const fact_file_header *h,
+		    unsigned int arity)
+{ const uint64_t *columns = (const uint64_t*)(base+h->columns);
+  const uint64_t *atom_index = (const uint64_t*)(base+h->atom_index);
+  const uint32_t *atom_heads = (const uint32_t*)(base+h->atom_hash);
+  const int64_t *cells = (const int64_t*)(base+h->cells);
+  uint64_t cells_end = h->cells + h->rows*arity*sizeof(int64_t);
+  uint64_t i;
+  unsigned int col;
+
+  for(i=0; i<h->atoms; i++)
+  { const fact_atom_record *r;
+    uint64_t off = atom_index[i];
+
+    if ( off < sizeof(*h) || off%sizeof(uint32_t) != 0 ||
+	 off > h->atom_index - sizeof(*r) )
+      return FALSE;
+    r = (const fact_atom_record*)(base+off);
+    if ( r->length > h->atom_index - off - sizeof(*r) ||
+	 !valid_atom_record(r) )
+      return FALSE;
+  }
+  for(i=0; i<h->atom_buckets; i++)
+  { if ( atom_heads[i] > h->atoms )
+      return FALSE;
+  }
+  for(i=0; i<h->atoms; i++)		/* chains link to lower ids */
+  { if ( atom_heads[h->atom_buckets+i] > i )
+      return FALSE;
+  }
+
+  for(i=0; i<h->rows*arity; i++)
+  { int64_t c = cells[i];
+
+    if ( isCellAtom(c) ? cellAtomId(c) >= h->atoms
+		       : valInt(consInt(cellInt(c))) != cellInt(c) )
+      return FALSE;
+  }
+
+  for(col=0; col<arity; col++)
+  { const uint32_t *heads, *next;
+
+    if ( columns[col] < cells_end || columns[col] > h->columns ||
+	 columns[col]%sizeof(uint32_t) != 0 ||
+	 h->row_buckets+h->rows > (h->columns-columns[col])/sizeof(uint32_t) )
+      return FALSE;
+    heads = (const uint32_t*)(base+columns[col]);
+    next  = heads + h->row_buckets;
+    for(i=0; i<h->row_buckets; i++)
+    { if ( heads[i] > h->rows )
+	return FALSE;
+    }
+    for(i=0; i<h->rows; i++)		/* chains link to higher rows */
+    { if ( next[i] && (next[i] <= i+1 || next[i] > h->rows) )
+	return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* Map the snapshot of a fact file and open its log for appending.  On
+   failure, *msg describes the problem or is NULL if errno does.
+*/
+
+static fact_file *
+open_fact_file(atom_t name, unsigned int arity, const char **msg)
+{ char tmp[MAXPATHLEN];
+  const char *path = OsPath(stringAtom(name), tmp);
+  fact_file_header h;
+  struct stat buf;
+  fact_file *f;
+  char *base;
+  const uint64_t *columns;
+  unsigned int col;
+  int fd;
+
+  *msg = NULL;
+  if ( (fd=open(path, O_RDONLY|O_BINARY)) < 0 )
+    return NULL;
+  if ( fstat(fd, &buf) != 0 )
+  { close(fd);
+    return NULL;
+  }
+
+  if ( read(fd, &h, sizeof(h)) != sizeof(h) ||
+       memcmp(h.magic, FACT_FILE_MAGIC, sizeof(h.magic)) != 0 )
+    *msg = "not a fact file";
+  else if ( h.version != FACT_FILE_VERSION )
+    *msg = "incompatible fact file version";
+  else if ( h.byte_order != FACT_BYTE_ORDER || h.word_size != sizeof(word) )
+    *msg = "fact file was created on an incompatible platform";
+  else if ( h.arity != arity )
+    *msg = "fact file holds facts of another arity";
+  else if ( !valid_fact_layout(&h, arity, (uint64_t)buf.st_size) )
+    *msg = "fact file is truncated";
+  if ( *msg )
+  { close(fd);
+    return NULL;
+  }
+
+#ifdef O_MAP_FACTS
+  base = mmap(NULL, (size_t)h.log, PROT_READ, MAP_SHARED, fd, 0);
+  if ( base == MAP_FAILED )
+  { close(fd);
+    return NULL;
+  }
+#else
+{ size_t done = 0;
+  ssize_t n;
+
+  if ( !(base = malloc((size_t)h.log)) ||
+       lseek(fd, 0, SEEK_SET) != 0 )
+  { if ( base )
+      free(base);
+    close(fd);
+    return NULL;
+  }
+  while( done < h.log && (n=read(fd, base+done, h.log-done)) > 0 )
+    done += n;
+  if ( done < h.log )
+  { free(base);
+    close(fd);
+    return NULL;
+  }
+}
+#endif
+  close(fd);
+
+  if ( !valid_fact_snapshot(base, &h, arity) )
+  {
+#ifdef O_MAP_FACTS
+    munmap(base, (size_t)h.log);
+#else
+    free(base);
+#endif
+    *msg = "fact file is truncated";
+    return NULL;
+  }
+
+  f = allocHeapOrHalt(sizeof(*f));
+  memset(f, 0, sizeof(*f));
+  f->name       = name;
+  f->base       = base;
+  f->size       = (size_t)h.log;
+  f->header     = (const fact_file_header*)base;
+  f->arity      = arity;
+  f->rows       = (size_t)h.rows;
+  f->atom_count = (size_t)h.atoms;
+  f->next_atom  = f->atom_count;
+  f->cells      = (const int64_t*)(base+h.cells);
+  f->atom_index = (const uint64_t*)(base+h.atom_index);
+  f->atom_heads = (const uint32_t*)(base+h.atom_hash);
+  f->atom_next  = f->atom_heads + h.atom_buckets;
+  f->distinct   = (const uint64_t*)(base+h.distinct);
+  f->col_heads  = allocHeapOrHalt(arity*sizeof(uint32_t*));
+  f->col_next   = allocHeapOrHalt(arity*sizeof(uint32_t*));
+  columns       = (const uint64_t*)(base+h.columns);
+  for(col=0; col<arity; col++)
+  { f->col_heads[col] = (const uint32_t*)(base+columns[col]);
+    f->col_next[col]  = f->col_heads[col] + h.row_buckets;
+  }
+  if ( f->atom_count )
+  { f->atoms = allocHeapOrHalt(f->atom_count*sizeof(atom_t));
+    memset(f->atoms, 0, f->atom_count*sizeof(atom_t));
+  }
+  f->atom_ids = newHTable(16|TABLE_UNLOCKED);
+  PL_register_atom(name);
+
+  if ( !(f->log = Sopen_file(path, "abr")) )
+  { free_fact_file(f);
+    return NULL;
+  }
+
+  return f;
+}
+
+
+static void
+free_fact_file(fact_file *f)
+{ size_t i;
+
+  if ( f->log )
+    Sclose(f->log);
+  for(i=0; i<f->atom_count; i++)
+  { if ( f->atoms[i] )
+      PL_unregister_atom(f->atoms[i]);
+  }
+  for_unlocked_table(f->atom_ids, s,
+		     { if ( (size_t)s->value > f->atom_count )
+			 PL_unregister_atom((atom_t)s->name);
+		     });
+  destroyHTable(f->atom_ids);
+  if ( f->erased )
+  { size_t pages = (f->rows+FACT_ERASED_PAGE-1)/FACT_ERASED_PAGE;
+
+    for(i=0; i<pages; i++)
+    { if ( f->erased[i] )
+	freeHeap(f->erased[i], FACT_ERASED_PAGE*sizeof(gen_t));
+    }
+    freeHeap(f->erased, pages*sizeof(gen_t*));
+  }
+  if ( f->atoms )
+    freeHeap(f->atoms, f->atom_count*sizeof(atom_t));
+  if ( f->row_map )
+    free(f->row_map);
+  freeHeap(f->col_heads, f->arity*sizeof(uint32_t*));
+  freeHeap(f->col_next, f->arity*sizeof(uint32_t*));
+#ifdef O_MAP_FACTS
+  munmap(f->base, f->size);
+#else
+  free(f->base);
+#endif
+  PL_unregister_atom(f->name);
+  freeHeap(f, sizeof(*f));
+}
+
+
+static void
+write_zeros(IOSTREAM *s, size_t n)
+{ while( n-- > 0 )
+    Sputc(0, s);
+}
+
+
+/* Write the rows of t that are not erased as a new snapshot with an
+   empty log.  The snapshot is written to <file>.tmp, which is renamed
+   to <file> on success.  If mapp is not NULL, it is set to an array
+   that maps the rows of t to the rows of the snapshot.  Called with the
+   lock held.  Returns FALSE with errno set on failure.
+*/
+
+static int
+write_fact_file(fact_table *t, atom_t name, uint32_t **mapp)
+{ char tmp[MAXPATHLEN], path[MAXPATHLEN];
+  unsigned int arity = t->arity, col;
+  word *data = alloca(arity*sizeof(word));
+  int64_t *cells = alloca(arity*sizeof(int64_t));
+  uint64_t *columns = alloca(arity*sizeof(uint64_t));
+  uint64_t *distinct = alloca(arity*sizeof(uint64_t));
+  uint32_t **chains = alloca(arity*sizeof(uint32_t*));
+  uint32_t *atom_heads = NULL, *map = NULL;
+  Table atom_ids = newHTable(64|TABLE_UNLOCKED);
+  tmp_buffer atoms;
+  fact_file_header h;
+  size_t row, nrows = 0, natoms, i, colsize;
+  uint64_t off;
+  IOSTREAM *s = NULL;
+  int rc = FALSE, saved_errno;
+
+  initBuffer(&atoms);
+  memset(chains, 0, arity*sizeof(uint32_t*));
+  memset(distinct, 0, arity*sizeof(uint64_t));
+  path[0] = EOS;
+
+  for(row=0; row<t->rows; row++)
+  { if ( fact_erased(t, row) )
+      continue;
+    row_words(t, row, data);
+    for(col=0; col<arity; col++)
+    { if ( isAtom(data[col]) && !lookupHTable(atom_ids, (void*)data[col]) )
+      { addBuffer(&atoms, data[col], atom_t);
+	addHTable(atom_ids, (void*)data[col],
+		  (void*)entriesBuffer(&atoms, atom_t));
+      }
+    }
+    nrows++;
+  }
+  natoms = entriesBuffer(&atoms, atom_t);
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, FACT_FILE_MAGIC, sizeof(h.magic));
+  h.version    = FACT_FILE_VERSION;
+  h.byte_order = FACT_BYTE_ORDER;
+  h.word_size  = sizeof(word);
+  h.arity      = arity;
+  h.rows       = nrows;
+  h.atoms      = natoms;
+  for(h.atom_buckets=16; h.atom_buckets<natoms; h.atom_buckets *= 2)
+    ;
+  for(h.row_buckets=16; h.row_buckets<nrows; h.row_buckets *= 2)
+    ;
+  off = sizeof(h);
+  for(i=0; i<natoms; i++)
+    off += sizeof(fact_atom_record) +
+	   FACT_ALIGN(atomValue(baseBuffer(&atoms, atom_t)[i])->length);
+  h.atom_index = off;
+  h.atom_hash  = h.atom_index + natoms*sizeof(uint64_t);
+  h.cells      = FACT_ALIGN(h.atom_hash +
+			    (h.atom_buckets+natoms)*sizeof(uint32_t));
+  colsize      = FACT_ALIGN((h.row_buckets+nrows)*sizeof(uint32_t));
+  off          = h.cells + nrows*arity*sizeof(int64_t);
+  for(col=0; col<arity; col++)
+    columns[col] = off + col*colsize;
+  h.columns    = off + arity*colsize;
+  h.distinct   = h.columns + arity*sizeof(uint64_t);
+  h.log        = h.distinct + arity*sizeof(uint64_t);
+
+  if ( !(atom_heads = malloc((h.atom_buckets+natoms)*sizeof(uint32_t))) ||
+       (t->rows && mapp && !(map = malloc(t->rows*sizeof(uint32_t)))) )
+    goto out;
+  memset(atom_heads, 0, (h.atom_buckets+natoms)*sizeof(uint32_t));
+  for(i=0; i<natoms; i++)
+  { Atom ap = atomValue(baseBuffer(&atoms, atom_t)[i]);
+    size_t b = atom_text_hash(ap->name, ap->length,
+			      file_atom_type(ap->atom)) & (h.atom_buckets-1);
+
+    atom_heads[h.atom_buckets+i] = atom_heads[b];
+    atom_heads[b] = (uint32_t)(i+1);
+  }
+  for(col=0; col<arity; col++)
+  { size_t size = (2*h.row_buckets+nrows)*sizeof(uint32_t);
+
+    if ( !(chains[col] = malloc(size)) )
+      goto out;
+    memset(chains[col], 0, size);
+  }
+
+  OsPath(stringAtom(name), tmp);
+  if ( strlen(tmp)+5 > sizeof(path) )
+  { errno = ENAMETOOLONG;
+    goto out;
+  }
+  Ssprintf(path, "%s.tmp", tmp);
+  if ( !(s=Sopen_file(path, "wbr")) )
+    goto out;
+
+  Sfwrite(&h, sizeof(h), 1, s);
+  for(i=0; i<natoms; i++)
+  { Atom ap = atomValue(baseBuffer(&atoms, atom_t)[i]);
+    fact_atom_record r;
+
+    r.length = (uint32_t)ap->length;
+    r.type   = file_atom_type(ap->atom);
+    Sfwrite(&r, sizeof(r), 1, s);
+    Sfwrite(ap->name, 1, ap->length, s);
+    write_zeros(s, FACT_ALIGN(ap->length)-ap->length);
+  }
+  off = sizeof(h);
+  for(i=0; i<natoms; i++)
+  { Sfwrite(&off, sizeof(off), 1, s);
+    off += sizeof(fact_atom_record) +
+	   FACT_ALIGN(atomValue(baseBuffer(&atoms, atom_t)[i])->length);
+  }
+  Sfwrite(atom_heads, sizeof(uint32_t), h.atom_buckets+natoms, s);
+  write_zeros(s, h.cells-h.atom_hash-(h.atom_buckets+natoms)*sizeof(uint32_t));
+
+  for(row=0, i=0; row<t->rows; row++)
+  { if ( fact_erased(t, row) )
+    { if ( map )
+	map[row] = (uint32_t)~0;
+      continue;
+    }
+    row_words(t, row, data);
+    for(col=0; col<arity; col++)
+    { if ( isAtom(data[col]) )
+      { Symbol sy = lookupHTable(atom_ids, (void*)data[col]);
+
+	cells[col] = CELL_ATOM((size_t)sy->value-1);
+      } else
+      { cells[col] = CELL_INT(valInt(data[col]));
+      }
+    }
+    Sfwrite(cells, sizeof(int64_t), arity, s);
+
+    for(col=0; col<arity; col++)
+    { uint32_t *heads = chains[col];
+      uint32_t *tails = heads+h.row_buckets;
+      uint32_t *next  = tails+h.row_buckets;
+      size_t b = cell_hash(cells[col], h.row_buckets);
+
+      if ( tails[b] )
+      { next[tails[b]-1] = (uint32_t)(i+1);
+      } else
+      { heads[b] = (uint32_t)(i+1);
+	distinct[col]++;
+      }
+      tails[b] = (uint32_t)(i+1);
+    }
+    if ( map )
+      map[row] = (uint32_t)i;
+    i++;
+  }
+
+  for(col=0; col<arity; col++)
+  { Sfwrite(chains[col], sizeof(uint32_t), h.row_buckets, s);
+    Sfwrite(chains[col]+2*h.row_buckets, sizeof(uint32_t), nrows, s);
+    write_zeros(s, colsize-(h.row_buckets+nrows)*sizeof(uint32_t));
+  }
+  Sfwrite(columns, sizeof(uint64_t), arity, s);
+  Sfwrite(distinct, sizeof(uint64_t), arity, s);
+
+  rc = Sclose(s);
+  s = NULL;
+  if ( rc != 0 )
+  { rc = FALSE;
+    goto out;
+  }
+#ifdef __WINDOWS__
+  remove(tmp);
+#endif
+  rc = (rename(path, tmp) == 0);
+
+out:
+  saved_errno = errno;
+  if ( s )
+    Sclose(s);
+  if ( !rc && path[0] )
+    remove(path);
+  for(col=0; col<arity; col++)
+  { if ( chains[col] )
+      free(chains[col]);
+  }
+  if ( atom_heads )
+    free(atom_heads);
+  if ( rc && mapp )
+  { *mapp = map;
+  } else if ( map )
+  { free(map);
+  }
+  destroyHTable(atom_ids);
+  discardBuffer(&atoms);
+  errno = saved_errno;
+
+  return rc;
+}
+
+
+/* Make f the file of the empty table t.  Called with the lock held if
+   there are no cursors.
+*/
+
+static int
+load_fact_file(fact_table *t, fact_file *f)
+{ char tmp[MAXPATHLEN];
+  int rc;
+
+  t->file     = f;
+  t->log_file = f;
+  t->mapped   = f->rows;
+  t->rows     = f->rows;
+  if ( f->row_map )
+  { free(f->row_map);
+    f->row_map = NULL;
+  }
+  f->map_rows = 0;
+
+  Sflush(f->log);
+  rc = replay_log(t, f, OsPath(stringAtom(f->name), tmp));
+  publish_rows(t);
+
+  DEBUG(MSG_JIT, Sdprintf("Loaded %s: %zd mapped, %zd rows\n",
+			  stringAtom(f->name), t->mapped, t->rows));
+
+  return rc;
+}
+
+
+/* Switch to the new snapshot after compact_fact_file/1 or drop the file
+   after detach_fact_file/1 or a failed compact_fact_file/1.  Called from
+   clean_fact_table() if there are no cursors.
+*/
+
+static void
+switch_fact_file(fact_table *t)
+{ fact_file *old = t->file;
+  fact_file *new = t->log_file;
+  tmp_buffer keep;
+  size_t row, n = 0;
+  word *data;
+
+  initBuffer(&keep);
+  if ( !new )
+  { data = alloca(t->arity*sizeof(word));
+
+    for(row=0; row<t->rows; row++)
+    { if ( !fact_erased(t, row) )
+      { row_words(t, row, data);
+	register_row(t, data);
+	addMultipleBuffer(&keep, data, t->arity, word);
+	n++;
+      }
+    }
+  }
+
+  clear_fact_rows(t);
+  t->file = NULL;
+  if ( old )
+    free_fact_file(old);
+
+  if ( new )
+  { load_fact_file(t, new);
+  } else
+  { data = baseBuffer(&keep, word);
+
+    for(row=0; row<n; row++)
+    { append_row(t, data+row*t->arity);
+      unregister_row(t, data+row*t->arity);
+    }
+    publish_rows(t);
+  }
+  discardBuffer(&keep);
+}
+
+
+		 /*******************************
+		 *	      CURSORS		*
+		 *******************************/
+
+/* A cursor is followed by the keys encoded as cells of the file.
+*/
+
+static inline size_t
+sizeof_cursor_keys(unsigned int arity)
+{ return FACT_ALIGN(offsetof(fact_cursor, keys) + arity*sizeof(word));
+}
+
+static inline size_t
+sizeof_cursor(unsigned int arity)
+{ return sizeof_cursor_keys(arity) + arity*sizeof(int64_t);
+}
+
+static inline int64_t *
+file_keys(fact_cursor *c)
+{ return (int64_t*)((char*)c + sizeof_cursor_keys(c->arity));
+}
+
+
+/* Mapped rows come before the rows in the blocks.  If the chain of the
+   file index or the scan of the mapped rows ends, we continue with the
+   first candidate from the blocks.
+*/
+
+static inline size_t
+next_candidate(fact_cursor *c, size_t row)
+{ fact_table *t = c->table;
+  fact_index *ci;
+
+  if ( row < t->mapped )
+  { if ( c->file_column >= 0 )
+    { uint32_t l = t->file->col_next[c->file_column][row];
+
+      if ( l )
+	return l-1;
+    } else if ( row+1 < t->mapped )
+    { return row+1;
+    }
+
+    return c->heap_row;
+  }
+
+  if ( (ci=c->index) )
+  { fact_link l = *index_next(t, ci, row);
+
+    return l ? l-1 : FACT_NO_ROW;
+  }
+
+  return row+1;
+}
+
+
+static inline int
+match_row(fact_cursor *c, size_t row)
+{ word *data = fact_row(c->table, row);
+  unsigned int i;
+
+  for(i=0; i<c->arity; i++)
+  { if ( c->keys[i] && c->keys[i] != data[i] )
+      return FALSE;
+  }
+
+  return fact_visible(c->table, row, c->generation);
+}
+
+
+static inline int
+match_file_row(fact_cursor *c, size_t row)
+{ const int64_t *cells = file_row(c->table, row);
+  int64_t *keys = file_keys(c);
+  unsigned int i;
+
+  for(i=0; i<c->arity; i++)
+  { if ( c->keys[i] && keys[i] != cells[i] )
+      return FALSE;
+  }
+
+  return fact_visible(c->table, row, c->generation);
+}
+
+
+/* Find the first matching row at or after the candidate row.  Rows and
+   chains are in ascending order, so we can stop at the first row that
+   was not yet published when the cursor was created.
+*/
+
+static size_t
+find_row(fact_cursor *c, size_t row)
+{ while( row != FACT_NO_ROW && row < c->count )
+  { if ( row < c->table->mapped ? match_file_row(c, row)
+				: match_row(c, row) )
+      return row;
+    row = next_candidate(c, row);
+  }
+
+  return FACT_NO_ROW;
+}
+
+
+/* Select the index for the bound columns.  We use the existing index
+   with the most distinct keys.  If there is none or its chains are long
+   we create an index for the next bound column without one.  Indexes
+   only cover the rows in the blocks.  Called with the lock held.
+*/
+
+static void
+select_index(fact_cursor *c)
+{ fact_table *t = c->table;
+  fact_index *best = NULL;
+  unsigned int col, bcol = 0;
+  size_t rows = c->count - t->mapped;
+
+  for(col=0; col<c->arity; col++)
+  { fact_index *ci;
+
+    if ( c->keys[col] && (ci=t->indexes[col]) &&
+	 (!best || ci->distinct > best->distinct) )
+    { best = ci;
+      bcol = col;
+    }
+  }
+
+  if ( rows >= FACT_INDEX_MIN_ROWS &&
+       (!best || rows > best->distinct*FACT_INDEX_CHAIN) )
+  { for(col=0; col<c->arity; col++)
+    { if ( c->keys[col] && !t->indexes[col] )
+      { fact_index *ci = new_fact_index(t, col);
+
+	MemoryBarrier();
+	t->indexes[col] = ci;
+	if ( !best || ci->distinct > best->distinct )
+	{ best = ci;
+	  bcol = col;
+	}
+	break;
+      }
+    }
+  }
+
+  if ( (c->index = best) )
+  { fact_link l = best->heads[fact_hash(c->keys[bcol], best->buckets)];
+
+    c->heap_row = l ? l-1 : FACT_NO_ROW;
+  } else
+  { c->heap_row = t->mapped;
+  }
+}
+
+
+/* Select the index of the file for the bound columns and return the
+   first candidate.  If a key does not appear in the snapshot, no mapped
+   row can match.  This does not create atoms.  Called with the lock
+   held.
+*/
+
+static size_t
+select_file_index(fact_cursor *c)
+{ fact_table *t = c->table;
+  fact_file *f = t->file;
+  int64_t *keys = file_keys(c);
+  unsigned int col;
+  uint32_t l;
+
+  for(col=0; col<c->arity; col++)
+  { if ( !c->keys[col] )
+      continue;
+    if ( !word_cell(f, c->keys[col], FALSE, &keys[col]) ||
+	 (isCellAtom(keys[col]) && cellAtomId(keys[col]) >= f->atom_count) )
+      return c->heap_row;
+    if ( c->file_column < 0 || f->distinct[col] > f->distinct[c->file_column] )
+      c->file_column = col;
+  }
+
+  if ( c->file_column < 0 )
+    return 0;
+
+  l = f->col_heads[c->file_column][cell_hash(keys[c->file_column],
+					     f->header->row_buckets)];
+  return l ? l-1 : c->heap_row;
+}
+
+
+/* Take a snapshot of the table and find the first candidate.  Called
+   with the lock held.
+*/
+
+static void
+start_cursor(fact_cursor *c)
+{ fact_table *t = c->table;
+
+  t->references++;
+  c->count       = t->count;
+  c->generation  = GD->generation;
+  c->file_column = -1;
+  select_index(c);
+  c->row = t->mapped ? select_file_index(c) : c->heap_row;
+}
+
+
+/* Initialise a cursor for the arguments av.  Returns FALSE if no row can
+   match.  Otherwise the cursor is referencing the table and c->row is
+   the first matching row.
+*/
+
+static int
+init_cursor(fact_cursor *c, fact_table *t, term_t av ARG_LD)
+{ Word *unbound = alloca(t->arity*sizeof(Word));
+  unsigned int i, nunbound = 0;
+
+  c->null      = NULL;
+  c->table     = t;
+  c->arity     = t->arity;
+  c->safe      = TRUE;
+  c->allocated = FALSE;
+
+  for(i=0; i<c->arity; i++)
+  { Word p = valTermRef(av+i);
+
+    deRef(p);
+    if ( canBind(*p) )
+    { unsigned int j;
+
+      c->keys[i] = 0;
+      if ( isAttVar(*p) )
+	c->safe = FALSE;
+      for(j=0; j<nunbound; j++)
+      { if ( unbound[j] == p )
+	  c->safe = FALSE;
+      }
+      unbound[nunbound++] = p;
+    } else if ( isConst(*p) )
+    { c->keys[i] = *p;
+    } else
+    { return FALSE;
+    }
+  }
+
+  LOCK_FACTS(t);
+  start_cursor(c);
+  UNLOCK_FACTS(t);
+
+  if ( (c->row = find_row(c, c->row)) == FACT_NO_ROW )
+  { LOCK_FACTS(t);
+    t->references--;
+    unlock_and_clean(t);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static void
+release_cursor(fact_cursor *c)
+{ fact_table *t = c->table;
+
+  LOCK_FACTS(t);
+  t->references--;
+  unlock_and_clean(t);
+
+  if ( c->allocated )
+    freeForeignState(c, sizeof_cursor(c->arity));
+}
+
+
+static fact_cursor *
+save_cursor(fact_cursor *c)
+{ if ( !c->allocated )
+  { size_t size = sizeof_cursor(c->arity);
+    fact_cursor *n = allocForeignState(size);
+
+    memcpy(n, c, size);
+    n->allocated = TRUE;
+    c = n;
+  }
+
+  return c;
+}
+
+
+static int
+unify_row(fact_cursor *c, term_t av, size_t row)
+{ fact_table *t = c->table;
+  unsigned int i;
+
+  if ( row < t->mapped )
+  { const int64_t *cells = file_row(t, row);
+
+    for(i=0; i<c->arity; i++)
+    { if ( !c->keys[i] &&
+	   !_PL_unify_atomic(av+i, cell_word(t->file, cells[i])) )
+	return FALSE;
+    }
+  } else
+  { word *data = fact_row(t, row);
+
+    for(i=0; i<c->arity; i++)
+    { if ( !c->keys[i] && !_PL_unify_atomic(av+i, data[i]) )
+	return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/* Produce the next solution of a cursor.  If retract is TRUE, the rows
+   are erased.  We look ahead for the next matching row to avoid leaving
+   a choicepoint after the last one.
+*/
+
+static foreign_t
+fact_solutions(fact_cursor *c, term_t av, int retract ARG_LD)
+{ fid_t fid = 0;
+
+  if ( (!c->safe || retract) && !(fid = PL_open_foreign_frame()) )
+  { release_cursor(c);
+    return FALSE;
+  }
+
+  while( c->row != FACT_NO_ROW )
+  { size_t row = c->row;
+    int rc = unify_row(c, av, row);
+
+    if ( rc && retract )
+    { fact_table *t = c->table;
+      atom_t failed = 0;
+      gen_t gen = 0;
+
+      LOCK_FACTS(t);
+      if ( (rc = erase_logged(t, row, &gen)) )
+	flush_log(t, &failed);
+      UNLOCK_FACTS(t);
+
+      if ( failed )
+      { PL_close_foreign_frame(fid);
+	release_cursor(c);
+	return fact_file_error(ATOM_write, failed, NULL);
+      }
+    }
+
+    c->row = find_row(c, next_candidate(c, row));
+    if ( rc )
+    { if ( fid )
+	PL_close_foreign_frame(fid);
+      if ( c->row == FACT_NO_ROW )
+      { release_cursor(c);
+	return TRUE;
+      }
+      ForeignRedoPtr(save_cursor(c));
+    }
+    if ( exception_term )
+      break;
+    if ( fid )
+      PL_rewind_foreign_frame(fid);
+  }
+
+  if ( fid )
+    PL_close_foreign_frame(fid);
+  release_cursor(c);
+  return FALSE;
+}
+
+
+static foreign_t
+fact_call(term_t av, int arity, control_t h)
+{ GET_LD
+  fact_cursor *c;
+
+  switch( ForeignControl(h) )
+  { case FRG_FIRST_CALL:
+    { fact_table *t = h->predicate->impl.foreign.closure;
+
+      c = alloca(sizeof_cursor(arity));
+      if ( !init_cursor(c, t, av PASS_LD) )
+	return FALSE;
+      break;
+    }
+    case FRG_REDO:
+      c = ForeignContextPtr(h);
+      break;
+    case FRG_CUTTED:
+      release_cursor(ForeignContextPtr(h));
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  return fact_solutions(c, av, FALSE PASS_LD);
+}
+
+
+		 /*******************************
+		 *	  DATABASE ACCESS	*
+		 *******************************/
+
+static term_t
+head_arguments(term_t head, unsigned int arity ARG_LD)
+{ term_t av = PL_new_term_refs(arity);
+  Module m = NULL;
+  unsigned int i;
+
+  if ( !PL_strip_module(head, &m, head) )
+    return 0;
+  for(i=0; i<arity; i++)
+    _PL_get_arg(i+1, head, av+i);
+
+  return av;
+}
+
+
+/* Return the first atom of the rows that cannot be stored in the file
+   of the table or 0.  Called with the lock held.
+*/
+
+static atom_t
+unstorable_atom(fact_table *t, const word *rows, size_t count)
+{ size_t i;
+
+  if ( t->log_file )
+  { for(i=0; i<count*t->arity; i++)
+    { if ( isAtom(rows[i]) && file_atom_type(rows[i]) < 0 )
+	return rows[i];
+    }
+  }
+
+  return 0;
+}
+
+
+static int
+unstorable_error(atom_t a)
+{ GET_LD
+  term_t ex;
+
+  return ( (ex=PL_new_term_ref()) &&
+	   PL_put_atom(ex, a) &&
+	   PL_error(NULL, 0, "cannot be stored in a fact file",
+		    ERR_TYPE, ATOM_text, ex) );
+}
+
+
+/* Get the row for head :- body.  Raises an exception if this is not a
+   fact with arguments that are atoms or small integers.
+*/
+
+static int
+get_row(Procedure proc, term_t head, term_t body, word *row ARG_LD)
+{ Definition def = proc->definition;
+  atom_t b;
+  Word p;
+  unsigned int i;
+
+  if ( !PL_get_atom(body, &b) || b != ATOM_true )
+    return PL_error(NULL, 0, "compact predicates can only hold facts",
+		    ERR_PERMISSION_PROC, ATOM_modify, ATOM_compact_procedure,
+		    proc);
+
+  p = valTermRef(head);
+  deRef(p);
+  p = argTermP(*p, 0);
+  for(i=0; i<def->functor->arity; i++)
+  { Word a = p+i;
+
+    deRef(a);
+    if ( isConst(*a) )
+    { row[i] = *a;
+    } else
+    { term_t culprit = PL_new_term_ref();
+
+      _PL_get_arg(i+1, head, culprit);
+      if ( canBind(*a) )
+	return PL_error(NULL, 0, NULL, ERR_INSTANTIATION);
+      return PL_error(NULL, 0, NULL, ERR_TYPE,
+		      ATOM_compact_argument, culprit);
+    }
+  }
+
+  return TRUE;
+}
+
+
+int
+assertFactProcedure(Procedure proc, term_t head, term_t body,
+		    int where ARG_LD)
+{ Definition def = proc->definition;
+  fact_table *t = def->impl.foreign.closure;
+  word *row = alloca(t->arity*sizeof(word));
+  atom_t failed = 0;
+
+  if ( where == CL_START )
+    return PL_error(NULL, 0, "compact predicates only support assertz/1",
+		    ERR_PERMISSION_PROC, ATOM_modify, ATOM_compact_procedure,
+		    proc);
+  if ( !get_row(proc, head, body, row PASS_LD) )
+    return FALSE;
+
+  LOCK_FACTS(t);
+  if ( t->rows >= FACT_MAX_ROWS )
+  { UNLOCK_FACTS(t);
+    return PL_error(NULL, 0, "too many facts", ERR_RESOURCE, ATOM_memory);
+  }
+  if ( (failed=unstorable_atom(t, row, 1)) )
+  { UNLOCK_FACTS(t);
+    return unstorable_error(failed);
+  }
+  if ( t->log_file )
+    log_row(t, row);
+  append_row(t, row);
+  publish_rows(t);
+  flush_log(t, &failed);
+  UNLOCK_FACTS(t);
+
+  return failed ? fact_file_error(ATOM_write, failed, NULL) : TRUE;
+}
+
+
+/* getFactRow() and addFactRows() are used by assertz_list/1.  The first
+   adds the row for a clause to a buffer and the latter adds the rows of
+   the buffer to the table at once.
+*/
+
+int
+getFactRow(Procedure proc, term_t head, term_t body,
+	   tmp_buffer *rows ARG_LD)
+{ unsigned int i, arity = proc->definition->functor->arity;
+  word *row = alloca(arity*sizeof(word));
+
+  if ( !get_row(proc, head, body, row PASS_LD) )
+    return FALSE;
+  for(i=0; i<arity; i++)
+    addBuffer(rows, row[i], word);
+
+  return TRUE;
+}
+
+
+int
+addFactRows(Definition def, word *rows, size_t count)
+{ fact_table *t = def->impl.foreign.closure;
+  atom_t failed = 0;
+  size_t i;
+
+  LOCK_FACTS(t);
+  if ( t->rows + count > FACT_MAX_ROWS )
+  { UNLOCK_FACTS(t);
+    return PL_error(NULL, 0, "too many facts", ERR_RESOURCE, ATOM_memory);
+  }
+  if ( (failed=unstorable_atom(t, rows, count)) )
+  { UNLOCK_FACTS(t);
+    return unstorable_error(failed);
+  }
+  for(i=0; i<count; i++)
+  { if ( t->log_file )
+      log_row(t, rows+i*t->arity);
+    append_row(t, rows+i*t->arity);
+  }
+  publish_rows(t);
+  flush_log(t, &failed);
+  UNLOCK_FACTS(t);
+
+  return failed ? fact_file_error(ATOM_write, failed, NULL) : TRUE;
+}
+
+
+/* clause/2 and retract/1.  On the first call def is the predicate.  On
+   backtracking the context holds the cursor.
+*/
+
+static foreign_t
+fact_enum(Definition def, term_t head, term_t body, control_t h,
+	  int retract ARG_LD)
+{ fact_cursor *c;
+  fact_table *t;
+  term_t av;
+
+  switch( ForeignControl(h) )
+  { case FRG_FIRST_CALL:
+      t = def->impl.foreign.closure;
+      c = alloca(sizeof_cursor(t->arity));
+      if ( !(av = head_arguments(head, t->arity PASS_LD)) ||
+	   !PL_unify_atom(body, ATOM_true) ||
+	   !init_cursor(c, t, av PASS_LD) )
+	return FALSE;
+      break;
+    case FRG_REDO:
+      c = ForeignContextPtr(h);
+      if ( !(av = head_arguments(head, c->arity PASS_LD)) ||
+	   !PL_unify_atom(body, ATOM_true) )
+      { release_cursor(c);
+	return FALSE;
+      }
+      break;
+    case FRG_CUTTED:
+      release_cursor(ForeignContextPtr(h));
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  return fact_solutions(c, av, retract PASS_LD);
+}
+
+
+foreign_t
+factsClause(Definition def, term_t head, term_t body, control_t h ARG_LD)
+{ return fact_enum(def, head, body, h, FALSE PASS_LD);
+}
+
+
+foreign_t
+factsRetract(Definition def, term_t head, term_t body, control_t h ARG_LD)
+{ return fact_enum(def, head, body, h, TRUE PASS_LD);
+}
+
+
+/* If all arguments are distinct variables and the table is attached to
+   a file, we log a single record that erases all rows.
+*/
+
+int
+factsRetractAll(Definition def, term_t head ARG_LD)
+{ fact_table *t = def->impl.foreign.closure;
+  fact_cursor *c = alloca(sizeof_cursor(t->arity));
+  term_t av;
+  fid_t fid = 0;
+  gen_t gen = 0;
+  atom_t failed = 0;
+  size_t row;
+  unsigned int i;
+  int all;
+
+  if ( !(av = head_arguments(head, t->arity PASS_LD)) )
+    return FALSE;
+  if ( !init_cursor(c, t, av PASS_LD) )
+    return !exception_term;
+  if ( !c->safe && !(fid = PL_open_foreign_frame()) )
+  { release_cursor(c);
+    return FALSE;
+  }
+
+  for(i=0, all=c->safe; i<c->arity && all; i++)
+  { if ( c->keys[i] )
+      all = FALSE;
+  }
+
+  LOCK_FACTS(t);
+  if ( all && t->log_file )
+  { for(row=0; row<t->count; row++)
+      erase_row(t, row, &gen);
+    Sputc('z', t->log_file->log);
+  } else
+  { for(row = c->row; row != FACT_NO_ROW; row = find_row(c, next_candidate(c, row)))
+    { if ( fid )
+      { int rc = unify_row(c, av, row);
+
+	PL_rewind_foreign_frame(fid);
+	if ( !rc )
+	  continue;
+      }
+      erase_logged(t, row, &gen);
+    }
+  }
+  flush_log(t, &failed);
+  UNLOCK_FACTS(t);
+
+  if ( fid )
+    PL_close_foreign_frame(fid);
+  release_cursor(c);
+
+  return failed ? fact_file_error(ATOM_write, failed, NULL) : TRUE;
+}
+
+
+		 /*******************************
+		 *	    PREDICATES		*
+		 *******************************/
+
+/* Turn an undefined or empty dynamic predicate into a compact one.  The
+   predicate becomes a non-deterministic foreign predicate that matches
+   calls against its fact table.
+*/
+
+int
+setCompactProcedure(Procedure proc, int val)
+{ Definition def = proc->definition;
+
+  if ( !val )
+  { if ( true(def, P_FACTS) )
+      return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		      ATOM_modify, ATOM_compact_procedure, proc);
+    succeed;
+  }
+  if ( true(def, P_FACTS) )
+    succeed;
+
+  if ( def->functor->arity == 0 ||
+       true(def, P_FOREIGN|P_THREAD_LOCAL|P_MULTIFILE) ||
+       def->impl.clauses.first_clause )
+    return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		    ATOM_compact, ATOM_procedure, proc);
+
+  if ( true(def, P_DYNAMIC) && !setDynamicProcedure(proc, FALSE) )
+    return FALSE;
+
+  PL_LOCK(L_PREDICATE);
+  freeCodesDefinition(def, TRUE);
+  def->impl.foreign.function = (Func)fact_call;
+  def->impl.foreign.closure  = new_fact_table(def);
+  set(def, P_FACTS|P_FOREIGN|P_NONDET|P_VARARG);
+  createForeignSupervisor(def, (Func)fact_call);
+  PL_UNLOCK(L_PREDICATE);
+
+  succeed;
+}
+
+
+/* Called from abolishProcedure().  Active cursors keep the table alive
+   until they are released.
+*/
+
+void
+releaseFactsDefinition(Definition def)
+{ fact_table *t = def->impl.foreign.closure;
+
+  if ( t )
+  { def->impl.foreign.closure = NULL;
+    LOCK_FACTS(t);
+    t->predicate = NULL;
+    unlock_and_clean(t);
+  }
+}
+
+
+/* Erase all facts.  Used when the file that defines them is unloaded.
+   Facts that are stored in a fact file are kept.
+*/
+
+void
+removeFactsDefinition(Definition def)
+{ fact_table *t = def->impl.foreign.closure;
+  gen_t gen = 0;
+  size_t row;
+
+  LOCK_FACTS(t);
+  if ( t->log_file )
+  { UNLOCK_FACTS(t);
+    return;
+  }
+  for(row=0; row<t->count; row++)
+    erase_row(t, row, &gen);
+  unlock_and_clean(t);
+}
+
+
+size_t
+countFactsDefinition(Definition def)
+{ fact_table *t = def->impl.foreign.closure;
+
+  return t->count - t->erased - (t->file ? t->file->erased_count : 0);
+}
+
+
+atom_t
+factFileDefinition(Definition def)
+{ fact_table *t = def->impl.foreign.closure;
+
+  return t && t->log_file ? t->log_file->name : 0;
+}
+
+
+		 /*******************************
+		 *	   FILE PREDICATES	*
+		 *******************************/
+
+static int
+get_fact_table(term_t spec, int create, Procedure *procp, fact_table **tp)
+{ Procedure proc;
+
+  if ( !get_procedure(spec, &proc, 0,
+		      GP_NAMEARITY|(create ? GP_DEFINE : GP_FIND)) )
+    return create || PL_exception(0) ? FALSE
+				     : PL_error(NULL, 0, NULL, ERR_EXISTENCE,
+						ATOM_fact_file, spec);
+  if ( create && !setCompactProcedure(proc, TRUE) )
+    return FALSE;
+  if ( false(proc->definition, P_FACTS) )
+    return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_fact_file, spec);
+
+  *procp = proc;
+  *tp = proc->definition->impl.foreign.closure;
+
+  return TRUE;
+}
+
+
+/* attach_fact_file(:PI, +File) attaches the compact predicate PI to
+   File, creating File if it does not exist.  PI must be empty.
+*/
+
+static
+PRED_IMPL("attach_fact_file", 2, attach_fact_file, PL_FA_TRANSPARENT)
+{ Procedure proc;
+  fact_table *t;
+  fact_file *f;
+  const char *msg;
+  char *name;
+  atom_t file;
+  int rc;
+
+  if ( !PL_get_file_name(A2, &name, PL_FILE_ABSOLUTE) ||
+       !get_fact_table(A1, TRUE, &proc, &t) )
+    return FALSE;
+  file = PL_new_atom(name);
+
+  LOCK_FACTS(t);
+  if ( t->log_file )
+  { rc = (t->log_file->name == file);
+    UNLOCK_FACTS(t);
+    PL_unregister_atom(file);
+    return rc ? TRUE : PL_error(NULL, 0, "already attached to a file",
+				ERR_PERMISSION_PROC, ATOM_attach,
+				ATOM_compact_procedure, proc);
+  }
+  if ( t->references || countFactsDefinition(proc->definition) )
+  { UNLOCK_FACTS(t);
+    PL_unregister_atom(file);
+    return PL_error(NULL, 0, "predicate is not empty",
+		    ERR_PERMISSION_PROC, ATOM_attach,
+		    ATOM_compact_procedure, proc);
+  }
+  if ( !ExistsFile(name) && !write_fact_file(t, file, NULL) )
+  { UNLOCK_FACTS(t);
+    rc = fact_file_error(ATOM_create, file, NULL);
+    PL_unregister_atom(file);
+    return rc;
+  }
+  if ( !(f=open_fact_file(file, t->arity, &msg)) )
+  { UNLOCK_FACTS(t);
+    rc = fact_file_error(ATOM_open, file, msg);
+    PL_unregister_atom(file);
+    return rc;
+  }
+  PL_unregister_atom(file);
+
+  clear_fact_rows(t);
+  if ( !(rc=load_fact_file(t, f)) )
+  { clear_fact_rows(t);
+    t->file = t->log_file = NULL;
+  }
+  UNLOCK_FACTS(t);
+
+  if ( !rc )
+  { rc = fact_file_error(ATOM_read, f->name, NULL);
+    free_fact_file(f);
+  }
+
+  return rc;
+}
+
+
+/* detach_fact_file(:PI) removes all facts of PI and detaches it from
+   its file.  The file is not changed.
+*/
+
+static
+PRED_IMPL("detach_fact_file", 1, detach_fact_file, PL_FA_TRANSPARENT)
+{ Procedure proc;
+  fact_table *t;
+  fact_file *f;
+  gen_t gen = 0;
+  size_t row;
+
+  if ( !get_fact_table(A1, FALSE, &proc, &t) )
+    return FALSE;
+
+  LOCK_FACTS(t);
+  if ( !(f=t->log_file) )
+  { UNLOCK_FACTS(t);
+    return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_fact_file, A1);
+  }
+  t->log_file = NULL;
+  if ( f != t->file )
+  { free_fact_file(f);
+  } else
+  { Sclose(f->log);
+    f->log = NULL;
+  }
+  for(row=0; row<t->count; row++)
+    erase_row(t, row, &gen);
+  unlock_and_clean(t);
+
+  return TRUE;
+}
+
+
+/* compact_fact_file(:PI) replaces the snapshot and log of the file of
+   PI by a snapshot of its facts.  The table switches to the new
+   snapshot as soon as there are no cursors.
+*/
+
+static
+PRED_IMPL("compact_fact_file", 1, compact_fact_file, PL_FA_TRANSPARENT)
+{ Procedure proc;
+  fact_table *t;
+  fact_file *old, *f = NULL;
+  const char *msg = NULL;
+  uint32_t *map = NULL;
+  atom_t file;
+  int rc;
+
+  if ( !get_fact_table(A1, FALSE, &proc, &t) )
+    return FALSE;
+
+  LOCK_FACTS(t);
+  if ( !(old=t->log_file) )
+  { UNLOCK_FACTS(t);
+    return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_fact_file, A1);
+  }
+  file = old->name;
+  PL_register_atom(file);
+  if ( !write_fact_file(t, file, &map) )
+  { UNLOCK_FACTS(t);
+    rc = fact_file_error(ATOM_write, file, NULL);
+    PL_unregister_atom(file);
+    return rc;
+  }
+
+  f = open_fact_file(file, t->arity, &msg);
+  if ( old != t->file )
+  { free_fact_file(old);
+  } else
+  { Sclose(old->log);
+    old->log = NULL;
+  }
+  if ( f )
+  { f->row_map  = map;
+    f->map_rows = t->rows;
+  } else if ( map )
+  { free(map);
+  }
+  t->log_file = f;
+  unlock_and_clean(t);
+
+  rc = f ? TRUE : fact_file_error(ATOM_open, file, msg);
+  PL_unregister_atom(file);
+
+  return rc;
+}
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(facts)
+  PRED_DEF("attach_fact_file", 2, attach_fact_file, PL_FA_TRANSPARENT)
+  PRED_DEF("detach_fact_file", 1, detach_fact_file, PL_FA_TRANSPARENT)
+  PRED_DEF("compact_fact_file", 1, compact_fact_file, PL_FA_TRANSPARENT)
+EndPredDefs
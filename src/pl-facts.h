@@ -0,0 +1,122 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PL_FACTS_H
+#define _PL_FACTS_H
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A compact predicate (P_FACTS) stores  its   clauses  as  rows of a fact
+table rather than as compiled clauses.   All arguments of all facts are
+atoms or small integers, so a row  is   simply  an array of arity words.
+Rows are stored in blocks that double in   size and never move, so rows
+may be added while other threads are reading the table.
+
+Row i is visible to a  query  if  it   was  added  before the query was
+started and is not erased or was  erased   in  a  later generation. The
+erased generations are kept in lazily allocated arrays parallel to the
+row blocks (0 means not erased).
+
+Columns are indexed on demand by a   hash table with chains of rows in
+ascending order.  Chains are linked through a `next' array parallel to
+the rows.
+
+If the table is attached to a fact file  (see pl-facts.c), the first
+`mapped' rows are the rows of the file's snapshot.  They are read from
+the mapped file and the blocks only hold the rows added later.  Block
+and index arrays are therefore indexed by row-mapped.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FACT_BLOCK_ROWS		256	/* Rows in block 0 */
+#define FACT_MAX_BLOCKS		32	/* Block b holds FACT_BLOCK_ROWS<<b */
+#define FACT_NO_ROW		((size_t)-1)
+
+typedef unsigned int fact_link;		/* row+1 or 0 (end of chain) */
+
+typedef struct fact_index
+{ size_t		buckets;	/* # hash buckets (power of 2) */
+  size_t		entries;	/* # indexed rows */
+  size_t		distinct;	/* # non-empty buckets */
+  fact_link	       *heads;		/* First row of each bucket */
+  fact_link	       *tails;		/* Last row of each bucket */
+  fact_link	       *next[FACT_MAX_BLOCKS]; /* Next row in the bucket */
+  struct fact_index    *garbage;	/* Next replaced index */
+} fact_index;
+
+typedef struct fact_table
+{ Definition		predicate;	/* Predicate (NULL: abolished) */
+  unsigned int		arity;		/* Words per row */
+  unsigned int		references;	/* # active cursors */
+  size_t		count;		/* # published rows */
+  size_t		rows;		/* # stored rows (>= count) */
+  size_t		erased;		/* # erased rows in the blocks */
+  size_t		mapped;		/* # rows in file */
+  struct fact_file     *file;		/* File holding the mapped rows */
+  struct fact_file     *log_file;	/* File that logs modifications */
+  word		       *blocks[FACT_MAX_BLOCKS]; /* Row data */
+  gen_t		       *erased_gen[FACT_MAX_BLOCKS]; /* Erased generations */
+  fact_index	      **indexes;	/* Per column index or NULL */
+  fact_index	       *garbage;	/* Replaced indexes */
+#ifdef O_PLMT
+  simpleMutex		lock;		/* Lock for modifications */
+#endif
+} fact_table;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A fact_cursor enumerates the rows matching a head.  Its first field is
+always NULL, which distinguishes it from  the choice states of clause/2
+and retract/1 that start with a clause reference or definition.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct fact_cursor
+{ void		       *null;		/* Always NULL */
+  fact_table	       *table;		/* Table we enumerate */
+  fact_index	       *index;		/* Index used or NULL (scan) */
+  size_t		row;		/* Current candidate row */
+  size_t		heap_row;	/* First candidate after the mapped rows */
+  size_t		count;		/* # rows visible to us */
+  gen_t			generation;	/* Generation of the query */
+  unsigned int		arity;		/* # keys */
+  int			file_column;	/* File index used or -1 (scan) */
+  int			safe;		/* Unifying a candidate cannot fail */
+  int			allocated;	/* Cursor is a foreign state */
+  word			keys[1];	/* Required value or 0 per column */
+					/* followed by the file keys */
+} fact_cursor;
+
+#define isFactCursor(p) (*(void**)(p) == NULL)
+
+COMMON(int)	setCompactProcedure(Procedure proc, int val);
+COMMON(void)	releaseFactsDefinition(Definition def);
+COMMON(void)	removeFactsDefinition(Definition def);
+COMMON(size_t)	countFactsDefinition(Definition def);
+COMMON(atom_t)	factFileDefinition(Definition def);
+COMMON(int)	assertFactProcedure(Procedure proc, term_t head, term_t body,
+				    int where ARG_LD);
+COMMON(int)	getFactRow(Procedure proc, term_t head, term_t body,
+			   tmp_buffer *rows ARG_LD);
+COMMON(int)	addFactRows(Definition def, word *rows, size_t count);
+COMMON(foreign_t) factsClause(Definition def, term_t head, term_t body,
+			      control_t h ARG_LD);
+COMMON(foreign_t) factsRetract(Definition def, term_t head, term_t body,
+			       control_t h ARG_LD);
+COMMON(int)	factsRetractAll(Definition def, term_t head ARG_LD);
+
+#endif /*_PL_FACTS_H*/
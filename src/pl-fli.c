@@ -3597,6 +3597,20 @@ PL_predicate_info(predicate_t pred, atom_t *name, int *arity, module_t *m)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PL_assertz_list() adds a list of clauses to  the  end of their dynamic
+predicates as assertz_list/1. If module is NULL, unqualified clauses are
+added to the context module.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+PL_assertz_list(term_t clauses, module_t module)
+{ GET_LD
+
+  return assert_clause_list(clauses, module PASS_LD);
+}
+
+
 		 /*******************************
 		 *	       CALLING		*
 		 *******************************/
@@ -3837,7 +3851,7 @@ bindForeign(Module m, const char *name, int arity, Func f, int flags)
 
   if ( def->impl.any )
     PL_linger(def->impl.any);
-  def->impl.function = f;
+  def->impl.foreign.function = f;
   def->flags &= ~(P_DYNAMIC|P_THREAD_LOCAL|P_TRANSPARENT|P_NONDET|P_VARARG);
   def->flags |= (P_FOREIGN|TRACE_ME);
 
@@ -139,11 +139,14 @@ COMMON(int)		compileClause(Clause *cp, Word head, Word body,
 				      term_t warnings ARG_LD);
 COMMON(Clause)		assert_term(term_t term, int where, atom_t owner,
 				    SourceLoc loc ARG_LD);
+COMMON(int)		assert_clause_list(term_t list, Module module ARG_LD);
 COMMON(void)		forAtomsInClause(Clause clause, void (func)(atom_t a));
 COMMON(Code)		stepDynPC(Code PC, const code_info *ci);
 COMMON(bool)		decompileHead(Clause clause, term_t head);
 COMMON(Code)		skipArgs(Code PC, int skip);
 COMMON(int)		argKey(Code PC, int skip, word *key);
+COMMON(int)		argKeyDeep(Code PC, int skip, const index_path *path,
+				   word *key);
 COMMON(int)		arg1Key(Code PC, word *key);
 COMMON(bool)		decompile(Clause clause, term_t term, term_t bindings);
 COMMON(word)		pl_nth_clause(term_t p, term_t n, term_t ref,
@@ -170,11 +173,14 @@ COMMON(word)		parseSaveProgramOptions(term_t args,
 
 /* pl-index.c */
 COMMON(word)		getIndexOfTerm(term_t t);
+COMMON(word)		indexOfIndirect(const word *data, size_t wsize);
 COMMON(ClauseRef)	firstClause(Word argv, LocalFrame fr, Definition def,
 				    ClauseChoice next ARG_LD);
 COMMON(ClauseRef)	nextClause(ClauseChoice chp, Word argv, LocalFrame fr,
 				   Definition def);
 COMMON(void)		addClauseToIndexes(Definition def, Clause cl, int where);
+COMMON(void)		addClausesToIndexes(Definition def, ClauseRef cref,
+					    size_t count);
 COMMON(void)		delClauseFromIndex(Definition def, Clause cl);
 COMMON(void)		cleanClauseIndexes(Definition def);
 COMMON(void)		clearTriedIndexes(Definition def);
@@ -298,6 +304,7 @@ COMMON(word)		check_foreign(void);	/* DEBUG(CHK_SECURE...) stuff */
 COMMON(void)		markAtomsOnStacks(PL_local_data_t *ld);
 COMMON(void)		markPredicatesInEnvironments(PL_local_data_t *ld);
 COMMON(QueryFrame)	queryOfFrame(LocalFrame fr);
+COMMON(void)		cleanupParallelMark(void);
 #if defined(O_DEBUG) || defined(SECURE_GC) || defined(O_MAINTENANCE)
 word			checkStacks(void *vm_state);
 COMMON(bool)		scan_global(int marked);
@@ -458,6 +465,9 @@ COMMON(foreign_t)	pl_current_predicate1(term_t spec, control_t ctx);
 COMMON(void)		clear_meta_declaration(Definition def);
 COMMON(ClauseRef)	assertProcedure(Procedure proc, Clause clause,
 					int where ARG_LD);
+COMMON(void)		assertClausesProcedure(Definition def,
+					       ClauseRef first, ClauseRef last,
+					       size_t count, size_t rules);
 COMMON(bool)		abolishProcedure(Procedure proc, Module module);
 COMMON(bool)		retractClauseDefinition(Definition def, Clause clause);
 COMMON(void)		freeClause(Clause c);
@@ -543,6 +553,7 @@ COMMON(bool)		unifyKey(term_t key, word val);
 COMMON(int)		getKeyEx(term_t key, word *k ARG_LD);
 COMMON(word)		pl_term_complexity(term_t t, term_t mx, term_t count);
 COMMON(void)		markAtomsRecord(Record record);
+COMMON(void)		freeFastTerms(void *ft);
 
 /* pl-rl.c */
 COMMON(void)		install_rl(void);
@@ -623,6 +634,8 @@ COMMON(const char *)	atom_summary(atom_t name, unsigned int maxlen);
 
 /* pl-wic.c */
 COMMON(bool)		loadWicFromStream(IOSTREAM *fd);
+COMMON(bool)		loadStateFromStream(IOSTREAM *fd);
+COMMON(void)		loadLazyDefinition(Definition def);
 COMMON(bool)		compileFileList(IOSTREAM *out, int argc, char **argv);
 COMMON(void)		qlfCleanup(void);
 
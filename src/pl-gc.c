@@ -249,6 +249,7 @@ static int		check_marked(const char *s);
 #define local_frames	   (LD->gc._local_frames)
 #define choice_count	   (LD->gc._choice_count)
 #define start_map	   (LD->gc._start_map)
+#define young_base	   (LD->gc._young_base)
 #if O_DEBUG
 #define trailtops_marked   (LD->gc._trailtops_marked)
 #define mark_base	   (LD->gc._mark_base)
@@ -591,6 +592,379 @@ unmark_stacks(PL_local_data_t *ld, LocalFrame fr, Choice ch,
 }
 
 
+		/********************************
+		*       PARALLEL MARKING        *
+		*********************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Parallel marking of large global stacks. If the Prolog flag
+gc_mark_threads is non-zero and the global   stack  holds more than
+PAR_MARK_MIN_GLOBAL cells, mark_variable() does not use pointer reversal
+but a depth-first traversal using an  explicit   agenda  of cells to
+visit.  A cell is marked using an atomic OR and the thread that sets the
+mark processes the cell.
+
+If a thread's agenda grows while the shared  pool is empty and helpers
+are idle, it moves the oldest part of its agenda into the pool, where the
+helper threads pick it up.  mark_variable() returns after the pool is
+empty and all helpers are idle. This   preserves  the order in which the
+roots are marked, which matters for early reset (see early_reset_vars()).
+
+Only one engine can use the helpers  at   a  time; other engines doing GC
+concurrently use the sequential algorithm.  Only  marking is parallel.
+Compaction is sequential as the relocation   chains  must be processed in
+address order.
+
+The helpers are created on first use.   If   the  flag is lowered, the
+next GC stops and joins the  surplus   helpers.  cleanupParallelMark()
+stops all of them from PL_cleanup().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(O_PLMT) && !defined(__WINDOWS__) && !O_DEBUG
+#define O_PARALLEL_MARK 1
+#endif
+
+#ifdef O_PARALLEL_MARK
+#define MARK_CHUNK_SIZE	    1024	/* Max cells in a shared chunk */
+#define MARK_AGENDA_SIZE    (4*MARK_CHUNK_SIZE)
+#define PAR_MARK_MIN_GLOBAL (1024*1024)	/* Min global stack usage (cells) */
+#define MAX_MARK_HELPERS    64		/* Max value for gc_mark_threads */
+
+typedef struct mark_chunk
+{ struct mark_chunk *next;		/* next in pool */
+  size_t	size;			/* # cells in chunk */
+  Word		cells[MARK_CHUNK_SIZE];
+} mark_chunk;
+
+typedef struct mark_agenda
+{ Word	       *top;			/* top of agenda */
+  intptr_t	marked;			/* # cells marked */
+  intptr_t	relocations;		/* # cells that need relocation */
+  Word		cells[MARK_AGENDA_SIZE];
+} mark_agenda;
+
+static struct
+{ pthread_mutex_t mutex;		/* guards this structure */
+  pthread_cond_t  work;			/* signalled on new chunks */
+  pthread_cond_t  idle;			/* signalled on helper state change */
+  int		  helpers;		/* # created helper threads */
+  int		  max;			/* Helpers with id >= max exit */
+  int		  busy;			/* # helpers marking */
+  int		  in_use;		/* Helpers are used by an engine */
+  PL_local_data_t *ld;			/* Engine being collected */
+  mark_chunk	 *chunks;		/* shared agenda */
+  mark_chunk	 *free_chunks;		/* recycled chunks */
+  intptr_t	  marked;		/* # cells marked by helpers */
+  intptr_t	  relocations;		/* # relocations found by helpers */
+  pthread_t	  tids[MAX_MARK_HELPERS]; /* Helper threads */
+} par_mark =
+{ PTHREAD_MUTEX_INITIALIZER,
+  PTHREAD_COND_INITIALIZER,
+  PTHREAD_COND_INITIALIZER
+};
+
+
+static void
+spill_agenda(mark_agenda *a)
+{ size_t count = a->top - a->cells;
+  mark_chunk *c;
+
+  if ( count > 2*MARK_CHUNK_SIZE )
+    count = MARK_CHUNK_SIZE;
+  else
+    count /= 2;
+
+  pthread_mutex_lock(&par_mark.mutex);
+  if ( (c=par_mark.free_chunks) )
+    par_mark.free_chunks = c->next;
+  else
+    c = allocHeapOrHalt(sizeof(*c));
+  c->size = count;			/* oldest cells: biggest subtrees */
+  memcpy(c->cells, a->cells, count*sizeof(Word));
+  memmove(a->cells, a->cells+count, (a->top-a->cells-count)*sizeof(Word));
+  a->top -= count;
+  c->next = par_mark.chunks;
+  par_mark.chunks = c;
+  pthread_cond_broadcast(&par_mark.work);
+  pthread_cond_signal(&par_mark.idle);
+  pthread_mutex_unlock(&par_mark.mutex);
+}
+
+
+static inline void
+push_agenda(mark_agenda *a, Word p)
+{ if ( unlikely(a->top == &a->cells[MARK_AGENDA_SIZE]) )
+    spill_agenda(a);
+  *a->top++ = p;
+}
+
+
+/* take_chunk() moves a chunk from the pool to the agenda and must be
+   called with par_mark.mutex locked.
+*/
+
+static void
+take_chunk(mark_agenda *a)
+{ mark_chunk *c = par_mark.chunks;
+
+  par_mark.chunks = c->next;
+  memcpy(a->top, c->cells, c->size*sizeof(Word));
+  a->top += c->size;
+  c->next = par_mark.free_chunks;
+  par_mark.free_chunks = c;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+drain_agenda() processes the agenda until it is empty. The cases and the
+counting follow mark_variable(). Note  that   get_value()  is  needed
+because valPtr2() does not remove the GC bits.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+drain_agenda(mark_agenda *a ARG_LD)
+{ while( a->top > a->cells )
+  { Word p = *--a->top;
+    word old = ATOMIC_OR(p, MARK_MASK);
+    word val = old & VALUE_MASK;
+
+    if ( (old & MARK_MASK) )
+      continue;
+    a->marked++;
+
+    switch(tag(val))
+    { case TAG_REFERENCE:
+      { Word v = unRef(val);
+
+	if ( v < young_base )
+	  break;
+	a->relocations++;
+	push_agenda(a, v);
+	break;
+      }
+#ifdef O_ATTVAR
+      case TAG_ATTVAR:
+      { Word v = valPtr2(val, STG_GLOBAL);
+
+	if ( v < young_base )
+	  break;
+	a->relocations++;
+	push_agenda(a, v);
+	break;
+      }
+#endif
+      case TAG_COMPOUND:
+      { Word f = valPtr2(val, STG_GLOBAL);
+	int arity;
+
+	if ( f < young_base )
+	  break;
+	a->relocations++;
+	old = ATOMIC_OR(f, MARK_MASK);
+	if ( (old & MARK_MASK) )
+	  break;
+	a->marked++;
+	for(arity = arityFunctor(old), f++; arity > 0; arity--, f++)
+	  push_agenda(a, f);
+	break;
+      }
+      case TAG_INTEGER:
+	if ( storage(val) == STG_INLINE )
+	  break;
+      /*FALLTHROUGH*/
+      case TAG_STRING:
+      case TAG_FLOAT:
+      { Word h = valPtr2(val, STG_GLOBAL);
+
+	if ( h < young_base )
+	  break;
+	a->relocations++;
+	old = ATOMIC_OR(h, MARK_MASK);
+	if ( !(old & MARK_MASK) )
+	  a->marked += 1 + offset_cell(h);
+	break;
+      }
+    }
+
+    if ( a->top - a->cells > 64 &&
+	 !par_mark.chunks && par_mark.busy < par_mark.helpers )
+      spill_agenda(a);			/* feed idle helpers */
+  }
+}
+
+
+static void *
+mark_helper(void *closure)
+{ int id = (int)(intptr_t)closure;
+  mark_agenda *a = allocHeapOrHalt(sizeof(*a));
+  sigset_t set;
+
+  sigfillset(&set);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  pthread_mutex_lock(&par_mark.mutex);
+  for(;;)
+  { while( !par_mark.chunks && id < par_mark.max )
+      pthread_cond_wait(&par_mark.work, &par_mark.mutex);
+    if ( id >= par_mark.max )
+      break;
+
+    par_mark.busy++;
+    a->top = a->cells;
+    a->marked = a->relocations = 0;
+    take_chunk(a);
+    pthread_mutex_unlock(&par_mark.mutex);
+
+    drain_agenda(a, par_mark.ld);
+
+    pthread_mutex_lock(&par_mark.mutex);
+    par_mark.marked      += a->marked;
+    par_mark.relocations += a->relocations;
+    par_mark.busy--;
+    pthread_cond_signal(&par_mark.idle);
+  }
+  pthread_mutex_unlock(&par_mark.mutex);
+  freeHeap(a, sizeof(*a));
+
+  return NULL;
+}
+
+
+/* stop_mark_helpers() stops and joins the helpers with id >= keep.  It
+   must be called with par_mark.mutex locked while the helpers are not
+   in use.  The mutex is released while joining.
+*/
+
+static void
+stop_mark_helpers(int keep)
+{ int i, n = par_mark.helpers;
+
+  par_mark.in_use = TRUE;		/* keep other engines out */
+  par_mark.max = keep;
+  pthread_cond_broadcast(&par_mark.work);
+  pthread_mutex_unlock(&par_mark.mutex);
+  for(i=keep; i<n; i++)
+    pthread_join(par_mark.tids[i], NULL);
+  pthread_mutex_lock(&par_mark.mutex);
+  par_mark.helpers = keep;
+  par_mark.in_use = FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+enter_parallel_mark() decides whether the   current GC uses parallel
+marking and, if so, claims the helpers and creates them if needed. It
+also stops surplus helpers if gc_mark_threads was lowered.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+enter_parallel_mark(ARG1_LD)
+{ int wanted = GD->gc.mark_threads;
+
+  if ( wanted < 0 )
+    wanted = 0;
+  else if ( wanted > MAX_MARK_HELPERS )
+    wanted = MAX_MARK_HELPERS;
+
+  if ( par_mark.helpers <= wanted &&
+       (wanted == 0 || gTop - gBase < PAR_MARK_MIN_GLOBAL) )
+    return FALSE;
+
+  pthread_mutex_lock(&par_mark.mutex);
+  if ( par_mark.in_use )
+  { pthread_mutex_unlock(&par_mark.mutex);
+    return FALSE;
+  }
+  if ( par_mark.helpers > wanted )
+    stop_mark_helpers(wanted);
+  if ( wanted == 0 || gTop - gBase < PAR_MARK_MIN_GLOBAL )
+  { pthread_mutex_unlock(&par_mark.mutex);
+    return FALSE;
+  }
+  par_mark.max = wanted;
+  while( par_mark.helpers < wanted )
+  { if ( pthread_create(&par_mark.tids[par_mark.helpers], NULL, mark_helper,
+			(void*)(intptr_t)par_mark.helpers) != 0 )
+      break;
+    par_mark.helpers++;
+  }
+  if ( par_mark.helpers == 0 )
+  { pthread_mutex_unlock(&par_mark.mutex);
+    return FALSE;
+  }
+  par_mark.in_use = TRUE;
+  par_mark.ld = LD;
+  pthread_mutex_unlock(&par_mark.mutex);
+
+  return TRUE;
+}
+
+
+static void
+leave_parallel_mark(ARG1_LD)
+{ pthread_mutex_lock(&par_mark.mutex);
+  assert(!par_mark.chunks && par_mark.busy == 0);
+  par_mark.in_use = FALSE;
+  par_mark.ld = NULL;
+  pthread_mutex_unlock(&par_mark.mutex);
+}
+
+
+static void
+mark_variable_parallel(Word start ARG_LD)
+{ mark_agenda *a = alloca(sizeof(*a));
+
+  a->top = a->cells;
+  a->marked = a->relocations = 0;
+  if ( onStackArea(local, start) )
+  { markLocal(start);
+    total_marked--;			/* do not count local stack cell */
+  }
+  push_agenda(a, start);
+
+  for(;;)
+  { drain_agenda(a PASS_LD);
+
+    pthread_mutex_lock(&par_mark.mutex);
+    while( !par_mark.chunks && par_mark.busy > 0 )
+      pthread_cond_wait(&par_mark.idle, &par_mark.mutex);
+    if ( par_mark.chunks )
+    { take_chunk(a);
+      pthread_mutex_unlock(&par_mark.mutex);
+      continue;
+    }
+    total_marked     += a->marked + par_mark.marked;
+    needs_relocation += a->relocations + par_mark.relocations;
+    par_mark.marked = par_mark.relocations = 0;
+    pthread_mutex_unlock(&par_mark.mutex);
+    break;
+  }
+}
+
+#endif /*O_PARALLEL_MARK*/
+
+/* cleanupParallelMark() stops the marking helpers and releases the
+   recycled chunks.  Called from PL_cleanup().
+*/
+
+void
+cleanupParallelMark(void)
+{
+#ifdef O_PARALLEL_MARK
+  mark_chunk *c;
+
+  pthread_mutex_lock(&par_mark.mutex);
+  if ( par_mark.helpers > 0 )
+    stop_mark_helpers(0);
+  while( (c=par_mark.free_chunks) )
+  { par_mark.free_chunks = c->next;
+    freeHeap(c, sizeof(*c));
+  }
+  pthread_mutex_unlock(&par_mark.mutex);
+#endif
+}
+
+
 		/********************************
 		*            MARKING            *
 		*********************************/
@@ -637,6 +1011,12 @@ mark_variable(Word start ARG_LD)
 
   if ( is_marked(start) )
     sysError("Attempt to mark twice");
+#ifdef O_PARALLEL_MARK
+  if ( LD->gc.parallel_mark )
+  { mark_variable_parallel(start PASS_LD);
+    return;
+  }
+#endif
 
   if ( onStackArea(local, start) )
   { markLocal(start);
@@ -656,6 +1036,8 @@ forward:				/* Go into the tree */
   { case TAG_REFERENCE:
     { next = unRef(val);		/* address pointing to */
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( next < young_base )		/* old generation */
+	BACKWARD;
       needsRelocation(current);
       if ( is_first(next) )		/* ref to choice point. we will */
         BACKWARD;			/* get there some day anyway */
@@ -671,6 +1053,8 @@ forward:				/* Go into the tree */
     { DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       next = valPtr2(val, STG_GLOBAL);
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( next < young_base )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )
 	BACKWARD;			/* term has already been marked */
@@ -689,6 +1073,8 @@ forward:				/* Go into the tree */
       DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       next = valPtr2(val, STG_GLOBAL);
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( next < young_base )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )
 	BACKWARD;			/* term has already been marked */
@@ -720,6 +1106,8 @@ forward:				/* Go into the tree */
 
       DEBUG(CHK_SECURE, assert(storage(val) == STG_GLOBAL));
       DEBUG(CHK_SECURE, assert(onStack(global, next)));
+      if ( next < young_base )
+	BACKWARD;
       needsRelocation(current);
       if ( is_marked(next) )		/* can be referenced from multiple */
         BACKWARD;			/* places */
@@ -1292,7 +1680,7 @@ early_reset_vars(mark *m, Word top, GCTrailEntry te ARG_LD)
 
 	assert(onGlobal(gp));
 	assert(!is_first(gp));
-	if ( !is_marked(gp) )
+	if ( gp >= young_base && !is_marked(gp) )
 	{ DEBUG(MSG_GC_ASSIGNMENTS_MARK,
 		char b1[64]; char b2[64]; char b3[64];
 		Sdprintf("Marking assignment at %s (%s --> %s)\n",
@@ -2093,6 +2481,157 @@ mark_stacks(vm_state *vmstate)
 }
 
 
+		 /*******************************
+		 *	   GENERATIONS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+If the Prolog flag gc_generational is true, GC   may collect only the
+data created after the previous GC:  the   young  generation above
+young_base.  All data below young_base is  considered alive: it is not
+marked, not moved and pointers into it are not relocated.
+
+Young data can be reachable through   old cells that were modified after
+the previous GC.  To record these, the  previous GC sets LD->gen_bar
+to gTop, which raises LD->mark_bar  (see   DiscardMark())  such that
+every assignment to an old cell is trailed. The old cells on the trail
+are thus the _remembered set_.  mark_old_roots() marks them before all
+other roots, so early reset never resets   an  old cell. Backtracking
+below LD->gen_bar lowers it (see do_undo()).  nb_setarg/3 and friends do
+not trail; if they modify an old cell they set LD->gen_bar to gBase, which
+forces the next GC to be a full one.
+
+After each GC, all surviving data is old.  If GC was called while the VM
+was filling the arguments of a new term,   the  remaining arguments are
+written without trailing.  remember_pending() records  these cells and
+the next GC uses them as additional roots.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+mark_old_root(Word p ARG_LD)
+{ if ( p < young_base && !is_marked(p) )
+  { DEBUG(MSG_GC_MARK_VAR, Sdprintf("Old root at %p\n", p));
+    mark_variable(p PASS_LD);
+    total_marked--;			/* not in the collected area */
+    if ( !pushSegStack(&LD->gc.old_roots, p, Word) )
+      outOfCore();
+  }
+}
+
+
+static void
+mark_old_roots(ARG1_LD)
+{ GCTrailEntry te;
+  size_t offset;
+
+  LD->gc.old_roots.unit_size = sizeof(Word);
+
+  for(te = (GCTrailEntry)tBase; te < (GCTrailEntry)tTop; te++)
+  { if ( ttag(te->address) == TAG_TRAILVAL ||
+	 storage(te->address) != STG_GLOBAL )
+      continue;
+    mark_old_root(val_ptr(te->address) PASS_LD);
+  }
+
+  while( popSegStack(&LD->gc.pending, &offset, size_t) )
+    mark_old_root(gBase+offset PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Record the arguments that are still to be filled by the VM. ARGP and the
+addresses on the argument stack point  into   terms  under construction.
+The term's functor is the first functor cell   below  the pointer as the
+preceeding arguments cannot hold a functor.   We store offsets such that
+stack shifts do not affect the recorded cells.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+remember_args(Word argp ARG_LD)
+{ Word f, end;
+
+  if ( !onGlobal(argp) || argp >= gTop )
+    return;
+  for(f = argp-1; tagex(*f) != (TAG_ATOM|STG_GLOBAL); f--)
+    ;
+  end = f+1+arityFunctor(*f);
+
+  for( ; argp < end; argp++ )
+  { size_t offset = argp-gBase;
+
+    if ( !pushSegStack(&LD->gc.pending, offset, size_t) )
+      outOfCore();
+  }
+}
+
+
+static void
+remember_pending(vm_state *state ARG_LD)
+{ LD->gc.pending.unit_size = sizeof(size_t);
+
+  if ( state->save_argp )
+  { Word *ap;
+
+    remember_args(LD->query->registers.argp PASS_LD);
+    for(ap=aBase; ap<aTop; ap++)
+      remember_args((Word)((word)*ap & ~UWRITE) PASS_LD);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Unmark the old roots and insert those that point to young data into the
+relocation chains.  This must be done before the cell below young_base
+is marked as sentinel for the downward scans.  See collect_phase().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+sweep_old_roots(ARG1_LD)
+{ Word p;
+
+  while( popSegStack(&LD->gc.old_roots, &p, Word) )
+  { unmark(p);
+    if ( isGlobalRef(get_value(p)) )
+    { check_relocation(p);
+      into_relocation_chain(p, STG_GLOBAL PASS_LD);
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Decide on the area to collect. We do a full collection if generational
+GC is disabled, was invalidated, on an   explicit  request or if the old
+generation has grown by the same factor   that  triggers GC on the whole
+stack since the last full collection.   We also do a full collection
+if the global stack is more than half   way its limit, because old data
+may have become garbage, and  while  recovering   from  an  overflow or
+unwinding an exception.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static Word
+collection_base(ARG1_LD)
+{ Word bar = LD->gen_bar;
+
+#if O_DEBUG
+  if ( DEBUGGING(CHK_SECURE) )		/* the checks assume a full GC */
+    return gBase;
+#endif
+  if ( truePrologFlag(PLFLAG_GC_GENERATIONAL) &&
+       !LD->outofstack && !LD->exception.processing &&
+       bar > gBase && bar <= gTop )
+  { Stack s = (Stack)&LD->stacks.global;
+    size_t old = (char*)bar - (char*)gBase;
+
+    if ( old <= s->factor*LD->gc.old_gced_size + s->small &&
+	 usedStackP(s) <= limitStackP(s)/2 )
+      return bar;
+  }
+
+  return gBase;
+}
+
+
 #if O_DEBUG
 static int
 cmp_address(const void *vp1, const void *vp2)
@@ -2109,9 +2648,22 @@ mark_phase(vm_state *state)
 { GET_LD
   total_marked = 0;
 
+#ifdef O_PARALLEL_MARK
+  LD->gc.parallel_mark = enter_parallel_mark(PASS_LD1);
+#endif
+  if ( young_base > gBase )
+    mark_old_roots(PASS_LD1);
+  else
+    clearSegStack(&LD->gc.pending);
   DEBUG(CHK_SECURE, check_marked("Before mark_term_refs()"));
   mark_term_refs();
   mark_stacks(state);
+#ifdef O_PARALLEL_MARK
+  if ( LD->gc.parallel_mark )
+  { leave_parallel_mark(PASS_LD1);
+    LD->gc.parallel_mark = FALSE;
+  }
+#endif
 
   DEBUG(CHK_SECURE,
 	{ if ( !scan_global(TRUE) )
@@ -2196,6 +2748,8 @@ into_relocation_chain(Word current, int stg ARG_LD)
   word val = get_value(current);
 
   head = valPtr(val);			/* FIRST/MASK already gone */
+  if ( head < young_base && storage(val) == STG_GLOBAL )
+    return;				/* old generation does not move */
   set_value(current, get_value(head));
   set_value(head, consPtr(current, stg|tag(val)));
 
@@ -2447,6 +3001,10 @@ sweep_global_mark(Word *m ARG_LD)
 
   DEBUG(CHK_SECURE, assert(onStack(local, m)));
   gm = *m;
+  if ( gm < young_base )		/* in old generation */
+  { *m = (Word)consPtr(gm, STG_GLOBAL);	/* see unsweep_mark() */
+    return;
+  }
   if ( is_marked_or_first(gm-1) )
     goto done;				/* quit common easy case */
 
@@ -2596,7 +3154,9 @@ sweep_trail(void)
 
   for( ; te >= (GCTrailEntry)tBase; te-- )
   { if ( te->address )
-    {
+    { if ( val_ptr(te->address) < young_base &&
+	   storage(te->address) == STG_GLOBAL )
+	continue;			/* old generation */
 #ifdef O_DESTRUCTIVE_ASSIGNMENT
       if ( ttag(te->address) == TAG_TRAILVAL )
       { needsRelocation(&te->address);
@@ -2642,6 +3202,31 @@ sweep_frame(LocalFrame fr, int slots ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+(*) If GC is called without a PC  (e.g.,  while unwinding an exception),
+the environment only marks  the  arguments,  but   a  choicepoint on the
+same frame may have marked other variables.  As the sweep of the
+choicepoint stops at this frame, we must sweep these variables here.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+sweep_marked_slots(LocalFrame fr, int from ARG_LD)
+{ int slots = fr->clause->value.clause->prolog_vars - from;
+  Word sp = argFrameP(fr, from);
+
+  for( ; slots > 0; slots--, sp++ )
+  { if ( is_marked(sp) )
+    { unmark(sp);
+      if ( isGlobalRef(get_value(sp)) )
+      { processLocal(sp);
+	check_relocation(sp);
+	into_relocation_chain(sp, STG_LOCAL PASS_LD);
+      }
+    }
+  }
+}
+
+
 static QueryFrame
 sweep_environments(LocalFrame fr, Code PC)
 { GET_LD
@@ -2663,6 +3248,8 @@ sweep_environments(LocalFrame fr, Code PC)
 		   slots, levelFrame(fr), predicateName(fr->predicate)));
 
     sweep_frame(fr, slots PASS_LD);
+    if ( !PC && fr->clause && false(fr->predicate, P_FOREIGN) )
+      sweep_marked_slots(fr, slots PASS_LD);	/* (*) */
 
     if ( fr->parent )
     { PC = fr->programPointer;
@@ -2795,7 +3382,7 @@ is_downward_ref(Word p ARG_LD)
 
       DEBUG(CHK_SECURE, assert(d >= gBase));
 
-      return d < p;
+      return d < p && d >= young_base;
     }
   }
 
@@ -2904,7 +3491,7 @@ downskip_combine_garbage(Word current, Word dest ARG_LD)
     }
   }
 
-  return make_gc_hole(gBase, top_gc);
+  return make_gc_hole(young_base, top_gc);
 }
 
 
@@ -2912,7 +3499,7 @@ static void
 compact_global(void)
 { GET_LD
   Word dest, current;
-  Word base = gBase, top;
+  Word base = young_base, top;
 #if O_DEBUG
   Word *v = mark_top;
 #endif
@@ -2984,7 +3571,7 @@ compact_global(void)
 
   dest = base;
   top = gTop;
-  for(current = gBase; current < top; )
+  for(current = base; current < top; )
   { if ( is_marked(current) )
     { intptr_t l, n;
 
@@ -3023,9 +3610,9 @@ compact_global(void)
     }
   }
 
-  if ( dest != gBase + total_marked )
-    sysError("Mismatch in up phase: dest = %p, gBase+total_marked = %p\n",
-	     dest, gBase + total_marked );
+  if ( dest != base + total_marked )
+    sysError("Mismatch in up phase: dest = %p, base+total_marked = %p\n",
+	     dest, base + total_marked );
 
   DEBUG(CHK_SECURE,
 	{ Word p = dest;		/* clear top of stack */
@@ -3043,6 +3630,10 @@ collect_phase(vm_state *state, Word *saved_bar_at)
 
   DEBUG(CHK_SECURE, check_marked("Start collect"));
 
+  if ( young_base > gBase )
+  { sweep_old_roots(PASS_LD1);
+    ldomark(young_base-1);		/* stop downward scans */
+  }
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Sweeping foreign references\n"));
   sweep_foreign();
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Sweeping trail stack\n"));
@@ -3055,6 +3646,8 @@ collect_phase(vm_state *state, Word *saved_bar_at)
   }
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Compacting global stack\n"));
   compact_global();
+  if ( young_base > gBase )
+    unmark(young_base-1);
 
   unsweep_foreign(PASS_LD1);
   unsweep_stacks(state PASS_LD);
@@ -3809,6 +4402,148 @@ gcEnsureSpace(vm_state *state ARG_LD)
 }
 
 
+		 /*******************************
+		 *	     GC EVENTS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Each thread keeps the last GC_EVENT_RING collections in a ring buffer,
+which  is  made  available  to  Prolog  using  prolog_gc_events/1  and
+passed to the hook installed with PL_gc_hook().   The hook is called by
+the thread that did the collection after  GC   has  completed.  It must
+not call Prolog.
+
+We also maintain the average cost (wall time per   byte  of the global
+stack processed).  If the flag gc_max_pause   is  set, set_pause_gap()
+uses this to hide the part of the free global stack that we cannot
+collect within the budget by lowering  gMax.  If the budget cannot be
+met anyway, we leave the normal policy alone.  Running into this limit
+releases the gap and collects  (see   ensureGlobalSpace()  and
+makeMoreStackSpace()).  As the pause of  a   full  collection  also
+depends on the amount of live data, this works best in combination with
+gc_generational.  The gap is released before GC  or resizing the stacks
+and must never be visible outside the global stack.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+release_pause_gap(Stack s)
+{ if ( s->pause_gap )
+  { s->max = addPointer(s->max, s->pause_gap);
+    s->pause_gap = 0;
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
+static void
+set_pause_gap(ARG1_LD)
+{ Stack s = (Stack)&LD->stacks.global;
+
+  release_pause_gap(s);
+  if ( GD->gc.max_pause > 0.0 && LD->gc.pause_cost > 0.0 )
+  { double budget = GD->gc.max_pause/LD->gc.pause_cost;
+    size_t room = roomStackP(s);
+
+    if ( !truePrologFlag(PLFLAG_GC_GENERATIONAL) )
+      budget -= (double)usedStackP(s);	/* the next GC processes all */
+    if ( budget > (double)s->small && (double)room > budget )
+    { s->pause_gap = (room - (size_t)budget) & ~(sizeof(word)-1);
+      s->max = addPointer(s->max, -(ssize_t)s->pause_gap);
+    }
+  }
+}
+
+
+static void
+add_gc_event(pl_gc_event *ev, size_t collected ARG_LD)
+{ PL_gc_hook_t hook;
+
+  LD->gc.events[LD->gc.event_count++ % GC_EVENT_RING] = *ev;
+
+  if ( collected > 0 )
+  { double cost = ev->pause/(double)collected;
+
+    if ( LD->gc.pause_cost > 0.0 )
+      LD->gc.pause_cost = (LD->gc.pause_cost + cost)/2.0;
+    else
+      LD->gc.pause_cost = cost;
+  }
+
+  if ( (hook = GD->gc.hook) )
+    (*hook)(ev);
+}
+
+
+static atom_t
+gc_reason_atom(int reason)
+{ switch(reason)
+  { case PL_GC_EXPLICIT:  return ATOM_explicit;
+    case PL_GC_SPACE:	  return ATOM_space;
+    case PL_GC_EXCEPTION: return ATOM_exception;
+    default:		  return ATOM_policy;
+  }
+}
+
+
+static int
+unify_gc_event(term_t t, const pl_gc_event *ev)
+{ return PL_unify_term(t,
+		       PL_FUNCTOR_CHARS, "gc", 8,
+			 PL_FLOAT, ev->start,
+			 PL_FLOAT, ev->pause,
+			 PL_ATOM, gc_reason_atom(ev->reason),
+			 PL_ATOM, ev->minor ? ATOM_minor : ATOM_full,
+			 PL_INT64, (int64_t)ev->marked,
+			 PL_INT64, (int64_t)ev->reclaimed,
+			 PL_FUNCTOR_CHARS, "stacks", 3,
+			   PL_INT64, (int64_t)ev->local[0],
+			   PL_INT64, (int64_t)ev->global[0],
+			   PL_INT64, (int64_t)ev->trail[0],
+			 PL_FUNCTOR_CHARS, "stacks", 3,
+			   PL_INT64, (int64_t)ev->local[1],
+			   PL_INT64, (int64_t)ev->global[1],
+			   PL_INT64, (int64_t)ev->trail[1]);
+}
+
+
+/** prolog_gc_events(-Events) is det.
+
+Events is a list of gc/8 terms describing the most recent garbage
+collections of the calling thread, oldest first.
+*/
+
+static
+PRED_IMPL("prolog_gc_events", 1, prolog_gc_events, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  unsigned int count = LD->gc.event_count;
+  unsigned int i = (count > GC_EVENT_RING ? count - GC_EVENT_RING : 0);
+
+  for(; i < count; i++)
+  { pl_gc_event ev = LD->gc.events[i % GC_EVENT_RING];
+
+    if ( !PL_unify_list(tail, head, tail) ||
+	 !unify_gc_event(head, &ev) )
+      return FALSE;
+  }
+
+  return PL_unify_nil(tail);
+}
+
+
+PL_gc_hook_t
+PL_gc_hook(PL_gc_hook_t new)
+{ PL_gc_hook_t old = GD->gc.hook;
+  GD->gc.hook = new;
+
+  return old;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 garbageCollect()  returns  one  of  TRUE    (ok),   FALSE  (blocked)  or
 LOCAL_OVERFLOW if the local stack  cannot accomodate the term-references
@@ -3845,6 +4580,8 @@ garbageCollect(void)
   int rc;
   fid_t gvars, astack, attvars;
   Word *saved_bar_at;
+  pl_gc_event ev;
+  size_t collected;
 #ifdef O_PROFILE
   struct call_node *prof_node = NULL;
 #endif
@@ -3852,9 +4589,18 @@ garbageCollect(void)
   END_PROF();
   START_PROF(P_GC, "P_GC");
 
+  ev.reason = LD->gc.reason;
+  LD->gc.reason = PL_GC_POLICY;
+
   if ( gc_status.blocked || !truePrologFlag(PLFLAG_GC) )
     return FALSE;
 
+  release_pause_gap((Stack)&LD->stacks.global);
+  ev.start     = WallTime();
+  ev.local[0]  = usedStack(local);
+  ev.global[0] = usedStack(global);
+  ev.trail[0]  = usedStack(trail);
+
 #ifdef O_MAINTENANCE
   save_backtrace("GC");
 #endif
@@ -3919,6 +4665,9 @@ garbageCollect(void)
   marks_swept	    = 0;
   marks_unswept	    = 0;
   LD->gc.marked_attvars = FALSE;
+  young_base	    = collection_base(PASS_LD1);
+  if ( LD->gen_bar )
+    LD->gen_bar = young_base;		/* see DiscardMark() */
 
   setVar(*gTop);	/* always one space; see initPrologStacks() */
   tTop->address = 0;	/* gMax-- and tMax-- */
@@ -3931,10 +4680,16 @@ garbageCollect(void)
   tag_trail(PASS_LD1);
   mark_phase(&state);
   tgar = trailcells_deleted * sizeof(struct trail_entry);
-  ggar = (gTop - gBase - total_marked) * sizeof(word);
+  ggar = (gTop - young_base - total_marked) * sizeof(word);
   gc_status.global_gained += ggar;
   gc_status.trail_gained  += tgar;
   gc_status.collections++;
+  if ( young_base > gBase )
+    gc_status.minor_collections++;
+  ev.minor     = (young_base > gBase);
+  ev.marked    = total_marked * sizeof(word);
+  ev.reclaimed = ggar + tgar;
+  collected    = (char*)gTop - (char*)young_base;
 
   DEBUG(MSG_GC_PROGRESS, Sdprintf("Compacting trail\n"));
   compact_trail();
@@ -3948,6 +4703,15 @@ garbageCollect(void)
   restore_attvars(attvars, PASS_LD1);
 
   assert(LD->mark_bar <= gTop);
+  if ( young_base == gBase )
+    LD->gc.old_gced_size = usedStack(global);
+  young_base = gBase;
+  if ( truePrologFlag(PLFLAG_GC_GENERATIONAL) )
+  { LD->gen_bar = gTop;			/* all data is old now */
+    LD->mark_bar = gTop;
+    remember_pending(&state PASS_LD);
+  } else
+    LD->gen_bar = NULL;
 
   DEBUG(CHK_SECURE,
 	{ assert(trailtops_marked == 0);
@@ -4008,12 +4772,19 @@ garbageCollect(void)
 
   shiftTightStacks();
 
+  ev.pause     = WallTime() - ev.start;
+  ev.local[1]  = usedStack(local);
+  ev.global[1] = usedStack(global);
+  ev.trail[1]  = usedStack(trail);
+  add_gc_event(&ev, collected PASS_LD);
+  set_pause_gap(PASS_LD1);
+
   return TRUE;
 }
 
 word
 pl_garbage_collect(term_t d)
-{
+{ GET_LD
 #if O_DEBUG
   int ol = GD->debug_level;
   int nl;
@@ -4024,6 +4795,9 @@ pl_garbage_collect(term_t d)
     GD->debug_level = nl;
   }
 #endif
+  if ( LD->gen_bar )
+    LD->gen_bar = gBase;		/* request a full collection */
+  LD->gc.reason = PL_GC_EXPLICIT;
   garbageCollect();
 #if O_DEBUG
   GD->debug_level = ol;
@@ -4078,10 +4852,21 @@ makeMoreStackSpace(int overflow, int flags)
   if ( LD->exception.processing && s && enableSpareStack(s) )
       return TRUE;
 
-  if ( LD->gc.inferences != LD->statistics.inferences &&
-       (flags & ALLOW_GC) &&
-       garbageCollect() )
+  if ( overflow == GLOBAL_OVERFLOW && release_pause_gap(s) )
+  { if ( (flags & ALLOW_GC) &&		/* see set_pause_gap() */
+	 LD->gc.inferences != LD->statistics.inferences )
+      garbageCollect();
+    else
+      PL_raise(SIG_GC);
     return TRUE;
+  }
+
+  if ( LD->gc.inferences != LD->statistics.inferences &&
+       (flags & ALLOW_GC) )
+  { LD->gc.reason = PL_GC_SPACE;
+    if ( garbageCollect() )
+      return TRUE;
+  }
 
   if ( (flags & ALLOW_SHIFT) )
   { size_t l=0, g=0, t=0;
@@ -4140,12 +4925,24 @@ ensureGlobalSpace(size_t cells, int flags)
       return TRUE;
   }
 
+  if ( release_pause_gap((Stack)&LD->stacks.global) )
+  { if ( (flags & ALLOW_GC) &&		/* see set_pause_gap() */
+	 LD->gc.inferences != LD->statistics.inferences )
+      garbageCollect();
+    else
+      PL_raise(SIG_GC);
+
+    if ( gTop+cells <= gMax && tTop+BIND_TRAIL_SPACE <= tMax )
+      return TRUE;
+  }
+
   if ( flags )
   { size_t gmin;
     size_t tmin;
 
     if ( (flags & ALLOW_GC) && considerGarbageCollect(NULL) )
-    { garbageCollect();
+    { LD->gc.reason = PL_GC_SPACE;
+      garbageCollect();
 
       if ( gTop+cells <= gMax && tTop+BIND_TRAIL_SPACE <= tMax )
 	return TRUE;
@@ -4198,7 +4995,8 @@ ensureTrailSpace(size_t cells)
   }
 
   if ( considerGarbageCollect(NULL) )
-  { garbageCollect();
+  { LD->gc.reason = PL_GC_SPACE;
+    garbageCollect();
 
     if ( tTop+cells <= tMax )
       return TRUE;
@@ -4463,6 +5261,9 @@ update_gvars(intptr_t gs)
   if ( LD->frozen_bar )
   { update_pointer(&LD->frozen_bar, gs);
   }
+  if ( LD->gen_bar )
+  { update_pointer(&LD->gen_bar, gs);
+  }
   if ( LD->attvar.attvars )
   { update_pointer(&LD->attvar.attvars, gs);
   }
@@ -4930,6 +5731,7 @@ growStacks(size_t l, size_t g, size_t t)
   save_backtrace("SHIFT");
 #endif
 
+  release_pause_gap((Stack)&LD->stacks.global);
   sl = include_spare_stack(&LD->stacks.local,  &l);
   sg = include_spare_stack(&LD->stacks.global, &g);
   st = include_spare_stack(&LD->stacks.trail,  &t);
@@ -5213,4 +6015,5 @@ BeginPredDefs(gc)
 #ifdef GC_COUNTING
   PRED_DEF("gc_statistics", 1, gc_statistics, 0)
 #endif
+  PRED_DEF("prolog_gc_events", 1, prolog_gc_events, 0)
 EndPredDefs
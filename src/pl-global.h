@@ -158,8 +158,7 @@ struct PL_global_data
   struct
   { size_t	highest;		/* Highest atom index */
     atom_array	array;
-    unsigned int buckets;		/* # buckets in char * --> atom */
-    Atom *	table;			/* hash-table */
+    AtomTable	table;			/* hash-table */
     Atom	builtin_array;		/* Builtin atoms */
     int		lookups;		/* # atom lookups */
     int		cmps;			/* # string compares for lookup */
@@ -173,18 +172,26 @@ struct PL_global_data
     int64_t	collected;		/* # collected atoms */
     size_t	unregistered;		/* # candidate GC atoms */
     double	gc_time;		/* Time spent on atom-gc */
+    size_t	sweep_slice;		/* # atoms swept per slice (0: all) */
+    int64_t	slices;			/* # sweep slices */
+    size_t	max_slice_gained;	/* Max # atoms reclaimed in a slice */
+    double	pause_time;		/* Time AGC blocked other threads */
+    double	max_pause;		/* Longest single such block */
     PL_agc_hook_t gc_hook;		/* Current hook */
 #endif
     atom_t     *for_code[256];		/* code --> one-char-atom */
     PL_blob_t  *types;			/* registered atom types */
   } atoms;
 
-#ifdef O_PLMT
   struct
-  { int		active;			/* #GC active */
+  { PL_gc_hook_t hook;			/* PL_gc_hook() */
+    double	max_pause;		/* Flag gc_max_pause */
+#ifdef O_PLMT
+    int		active;			/* #GC active */
     int		agc_waiting;		/* AGC is waiting for us */
-  } gc;
+    int		mark_threads;		/* Flag gc_mark_threads */
 #endif
+  } gc;
 
   struct
   { Table	breakpoints;		/* Breakpoint table */
@@ -339,6 +346,7 @@ struct PL_local_data
 #ifdef O_GVAR
   Word		frozen_bar;		/* Frozen part of the global stack */
 #endif
+  Word		gen_bar;		/* Bottom of young global data */
   pl_stacks_t   stacks;			/* Prolog runtime stacks */
   uintptr_t	bases[STG_MASK+1];	/* area base addresses */
   int		alerted;		/* Special mode. See updateAlerted() */
@@ -421,6 +429,14 @@ struct PL_local_data
   } gvar;
 #endif
 
+  struct
+  { struct trie *variant_table;		/* Variant --> answer table */
+    struct tbl_table *stack;		/* Tables being evaluated */
+    struct tbl_table *incomplete;	/* Evaluated, but not complete */
+    size_t	dfn;			/* Evaluation order counter */
+    int64_t	new_answers;		/* # answers added */
+  } tabling;
+
   struct
   { int64_t	inferences;		/* inferences in this thread */
     uintptr_t	last_cputime;		/* milliseconds last CPU time */
@@ -467,6 +483,7 @@ struct PL_local_data
   struct
   { intptr_t	generator;		/* See PL_atom_generator() */
     atom_t	unregistering;		/* See PL_unregister_atom() */
+    unsigned int lookup_seq;		/* Odd: in lock-free lookupBlob() */
   } atoms;
 
   struct
@@ -583,6 +600,7 @@ struct PL_local_data
     struct _thread_sig   *sig_tail;	/* Tail of signal queue */
     struct _at_exit_goal *exit_goals;	/* thread_at_exit/1 goals */
     DefinitionChain local_definitions;	/* P_THREAD_LOCAL predicates */
+    int		task_worker;		/* 1+index in the task pool or 0 */
   } thread;
 #endif
 
@@ -613,6 +631,15 @@ struct PL_local_data
     int			marked_attvars;	/* do not GC attvars */
 #endif
     int active;				/* GC is running in this thread */
+    int parallel_mark;			/* Marking uses helper threads */
+    Word _young_base;			/* Bottom of the collected area */
+    size_t old_gced_size;		/* Global cells after last full GC */
+    segstack old_roots;			/* Old cells marked as roots */
+    segstack pending;			/* Untrailed VM writes to old cells */
+    int reason;				/* PL_GC_* for the next GC */
+    double pause_cost;			/* Seconds per byte collected */
+    unsigned int event_count;		/* # events added to the ring */
+    pl_gc_event events[GC_EVENT_RING];	/* Most recent collections */
 					/* These must be at the end to be */
 					/* able to define O_DEBUG in only */
 					/* some modules */
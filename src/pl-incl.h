@@ -452,6 +452,7 @@ them.  Descriptions:
 #define MAXSYMBOLLEN		256	/* max size of foreign symbols */
 #define OP_MAXPRIORITY		1200	/* maximum operator priority */
 #define SMALLSTACK		32 * 1024 /* GC policy */
+#define GC_EVENT_RING		64	  /* Per-thread GC events kept */
 
 #define LOCAL_MARGIN ((size_t)argFrameP((LocalFrame)NULL, MAXARITY) + \
 		      sizeof(struct choice))
@@ -811,6 +812,8 @@ with one operation, it turns out to be faster as well.
 
 /* Flags on predicates (packed in unsigned int */
 
+#define P_FACTS			(0x00000001) /* Compact fact table (pl-facts.c) */
+#define P_LAZY			(0x00000002) /* Clauses not yet loaded (pl-wic.c) */
 #define P_QUASI_QUOTATION_SYNTAX	(0x00000004) /* <![Type[Quasi Quote]]> */
 #define P_NON_TERMINAL		(0x00000008) /* Grammar rule (Name//Arity) */
 #define P_SHRUNKPOW2		(0x00000010) /* See reconsider_index() */
@@ -841,9 +844,10 @@ with one operation, it turns out to be faster as well.
 #define TRACE_FAIL		(0x20000000) /* Trace fail */
 #define FILE_ASSIGNED		(0x40000000) /* Is assigned to a file */
 #define P_REDEFINED		(0x80000000) /* Overrules a definition */
-#define PROC_DEFINED		(P_DYNAMIC|P_FOREIGN|P_MULTIFILE|P_DISCONTIGUOUS)
+#define PROC_DEFINED		(P_DYNAMIC|P_FOREIGN|P_MULTIFILE|P_DISCONTIGUOUS|\
+				 P_FACTS|P_LAZY)
 
-/* Flags on clauses (packed in unsigned flags : 8) */
+/* Flags on clauses (packed in unsigned flags : 9) */
 
 #define CL_ERASED		(0x0001) /* clause was erased */
 #define UNIT_CLAUSE		(0x0002) /* Clause has no body */
@@ -854,6 +858,7 @@ with one operation, it turns out to be faster as well.
 #define DBREF_ERASED_CLAUSE	(0x0040) /* Deleted while referenced */
 #define CL_BODY_CONTEXT		(0x0080) /* Module context of body is different */
 					 /* from predicate */
+#define CL_SHARED		(0x0100) /* In the shared code area (pl-wic.c) */
 
 /* Flags on module.  Most of these flags are copied to the read context
    in pl-read.c.
@@ -1083,9 +1088,16 @@ typedef struct atom_array
 { Atom *blocks[8*sizeof(void*)];
 } atom_array;
 
+typedef struct atom_table
+{ unsigned int	buckets;	/* # buckets in char * --> atom */
+  Atom	       *table;		/* the hash-table */
+  struct atom_table *prev;	/* replaced tables (see rehashAtoms()) */
+} atom_table, *AtomTable;
+
 
 #ifdef O_ATOMGC
 #define ATOM_MARKED_REFERENCE ((unsigned int)1 << (INTBITSIZE-1))
+#define ATOM_DESTROY_REFERENCE ((unsigned int)1 << (INTBITSIZE-2))
 #ifdef O_DEBUG_ATOMGC
 #define PL_register_atom(a) \
 	_PL_debug_register_atom(a, __FILE__, __LINE__, __PRETTY_FUNCTION__)
@@ -1142,8 +1154,8 @@ struct clause
 #endif /*O_LOGICAL_UPDATE*/
   unsigned int		variables;	/* # of variables for frame */
   unsigned int		prolog_vars;	/* # real Prolog variables */
-  unsigned		flags : 8;	/* Flag field holding: */
-  unsigned		line_no : 24;	/* Source line-number */
+  unsigned		flags : 9;	/* Flag field holding: */
+  unsigned		line_no : 23;	/* Source line-number */
   unsigned short	source_no;	/* Index of source-file */
   unsigned short	owner_no;	/* Index of owning source-file */
   code			code_size;	/* size of ->codes */
@@ -1231,7 +1243,16 @@ struct clause_bucket
   unsigned int	dirty;			/* # of garbage clauses */
 };
 
-#define MAX_MULTI_INDEX 1
+#define MAX_MULTI_INDEX 4		/* Max arguments in a combined index */
+#define MAX_DEEP_INDEX	4		/* Max nesting for sub-term indexes */
+#define MAX_DEEP_FUNCTORS 4		/* Max functors in a deep_summary */
+#define MAX_DEEP_TRIED	64		/* Max deep_tried records per pred */
+
+typedef struct index_path
+{ unsigned short depth;			/* # nested levels (0: argument) */
+  unsigned short position[MAX_DEEP_INDEX]; /* 1-based arg in compound */
+  functor_t	 functor[MAX_DEEP_INDEX]; /* compound at each level */
+} index_path;
 
 struct clause_index
 { unsigned int	 buckets;		/* # entries */
@@ -1240,6 +1261,7 @@ struct clause_index
   unsigned int	 resize_below;		/* consider resize < #clauses */
   unsigned int	 dirty;			/* # chains that are dirty */
   unsigned short args[MAX_MULTI_INDEX];	/* Indexed arguments */
+  index_path	 path;			/* Sub-term of args[0] (deep index) */
   unsigned	 is_list : 1;		/* Index with lists */
   float		 speedup;		/* Estimated speedup */
   struct bit_vector *tried_better;	/* We tried to access for better hash */
@@ -1252,6 +1274,25 @@ typedef struct clause_index_list
   struct clause_index_list *next;
 } clause_index_list, *ClauseIndexList;
 
+typedef struct deep_summary
+{ int		 count;			/* # functors, -1: unknown */
+  functor_t	 functors[MAX_DEEP_FUNCTORS]; /* compounds in clause heads */
+} deep_summary;
+
+typedef struct deep_tried
+{ struct deep_tried *next;		/* next in chain */
+  unsigned short arg;			/* argument holding the compound */
+  index_path	 path;			/* path to the compound */
+  struct bit_vector *tried;		/* non-indexable sub-arguments */
+  deep_summary	 sub[1];		/* compounds at each sub-argument */
+} deep_tried, *DeepTried;
+
+typedef struct deep_info
+{ DeepTried	 tried;			/* chain of assessed compounds */
+  unsigned int	 count;			/* # records in the chain */
+  deep_summary	 args[1];		/* compounds at each argument */
+} deep_info, *DeepInfo;
+
 #define MAX_BLOCKS 20			/* allows for 2M threads */
 
 typedef struct local_definitions
@@ -1272,7 +1313,10 @@ struct definition
   union
   { void *	any;			/* has some value */
     clause_list	clauses;		/* (Indexed) list of clauses */
-    Func	function;		/* function pointer of procedure */
+    struct
+    { Func	function;		/* function pointer of procedure */
+      void     *closure;		/* P_FACTS: the fact table */
+    } foreign;
     LocalDefinitions local;		/* P_THREAD_LOCAL predicates */
   } impl;
 #ifdef O_PLMT
@@ -1280,6 +1324,7 @@ struct definition
 #endif
   ClauseIndexList old_clause_indexes;	/* Outdated hash indexes */
   struct bit_vector *tried_index;	/* Arguments on which we tried to index */
+  DeepInfo	deep_info;		/* Sub-terms on which we tried to index */
   meta_mask	meta_info;		/* meta-predicate info */
   int		references;		/* reference count */
   unsigned int  flags;			/* booleans (P_*) */
@@ -1572,6 +1617,8 @@ struct gc_trail_entry
 			     tTop = tt; \
 			     gTop = (LD->frozen_bar > (b).globaltop ? \
 			             LD->frozen_bar : (b).globaltop); \
+			     if ( gTop < LD->gen_bar ) \
+			       LD->gen_bar = gTop; \
 			    } while(0)
 #endif /*O_DESTRUCTIVE_ASSIGNMENT*/
 
@@ -1585,6 +1632,8 @@ struct gc_trail_entry
 			   } while(0)
 #define DiscardMark(b)	do { LD->mark_bar = (LD->frozen_bar > (b).saved_bar ? \
 					     LD->frozen_bar : (b).saved_bar); \
+			     if ( LD->gen_bar > LD->mark_bar ) \
+			       LD->mark_bar = LD->gen_bar; \
 			   } while(0)
 #define NOT_A_MARK	(TrailEntry)(~(word)0)
 #define NoMark(b)	do { (b).trailtop = NOT_A_MARK; \
@@ -1750,6 +1799,7 @@ this to enlarge the runtime stacks.  Otherwise use the stack-shifter.
 	  size_t	small;		/* Do not GC below this size */	    \
 	  size_t	spare;		/* Current reserved area */	    \
 	  size_t	def_spare;	/* Desired reserved area */	    \
+	  size_t	pause_gap;	/* Hidden for gc_max_pause */	    \
 	  size_t	min_free;	/* Free left when trimming */	    \
 	  bool		gc;		/* Can be GC'ed? */		    \
 	  int		factor;		/* How eager we are */		    \
@@ -1953,6 +2003,7 @@ typedef struct
 { int		blocked;		/* GC is blocked now */
   bool		active;			/* Currently running? */
   long		collections;		/* # garbage collections */
+  long		minor_collections;	/* # young generation collections */
   int64_t	global_gained;		/* global stack bytes collected */
   int64_t	trail_gained;		/* trail stack bytes collected */
   int64_t	global_left;		/* global stack bytes left after GC */
@@ -2100,6 +2151,7 @@ typedef struct debuginfo
 #define PLFLAG_WARN_OVERRIDE_IMPLICIT_IMPORT 0x200000 /* Warn overriding weak symbols */
 #define PLFLAG_QUASI_QUOTES	    0x400000 /* Support quasi quotes */
 #define PLFLAG_DOT_IN_ATOM	    0x800000 /* Allow atoms a.b.c */
+#define PLFLAG_GC_GENERATIONAL	    0x1000000 /* Collect young data only */
 
 typedef struct
 { unsigned int flags;		/* Fast access to some boolean Prolog flags */
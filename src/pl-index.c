@@ -28,14 +28,22 @@ typedef struct hash_hints
 { unsigned int	buckets;		/* # buckets to use */
   float		speedup;		/* Expected speedup */
   unsigned	list : 1;		/* Use a list per key */
+  unsigned short args[MAX_MULTI_INDEX];	/* Argument(s) to index */
+  index_path	path;			/* Sub-term of the argument */
 } hash_hints;
 
 static int		bestHash(Word av, Definition def,
 				 float minbest, struct bit_vector *tried,
 				 hash_hints *hints);
-static ClauseIndex	hashDefinition(Definition def, int arg, hash_hints *h);
+static ClauseIndex	hashDefinition(Definition def, hash_hints *h);
 static void		replaceIndex(Definition def,
 				     ClauseIndex old, ClauseIndex ci);
+static void		clearDeepTried(Definition def);
+static void		freeDeepTried(Definition def);
+static DeepInfo		getDeepInfo(Definition def);
+static int		deepFunctorInClauses(Definition def, deep_summary *s,
+					     functor_t f, int arg,
+					     const index_path *path);
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -68,25 +76,53 @@ hashIndex(word key, int buckets)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+indexOfIndirect() computes the key for strings and big integers from the
+wsize data words that follow the header of the indirect.  As these may
+share a long common prefix we hash the entire content.  Strings are
+padded with zero bytes, so equal strings have equal data words.
+
+NOTE: this is also used by argKey() in pl-comp.c for H_STRING and H_MPZ.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+word
+indexOfIndirect(const word *data, size_t wsize)
+{ word key = MurmurHashAligned2(data, wsize*sizeof(word), MURMUR_SEED);
+
+  if ( !key )
+    key++;
+
+  return key;
+}
+
+
 static inline word
 indexOfWord(word w ARG_LD)
 { for(;;)
   { switch(tag(w))
     { case TAG_VAR:
       case TAG_ATTVAR:
-      case TAG_STRING:
 	return 0L;
+      case TAG_STRING:
+      { Word p = addressIndirect(w);
+
+	return indexOfIndirect(p+1, wsizeofInd(*p));
+      }
       case TAG_INTEGER:
 	if ( storage(w) != STG_INLINE )
-	{ Word p = valIndirectP(w);
+	{ Word p = addressIndirect(w);
+	  size_t n = wsizeofInd(*p);
 	  word key;
 
+	  if ( n != WORDS_PER_INT64 )	/* MPZ number */
+	    return indexOfIndirect(p+1, n);
+
 #if SIZEOF_VOIDP == 4
           DEBUG(9, Sdprintf("Index for " INT64_FORMAT " = 0x%x\n",
-			    valBignum(w), p[0]^p[1]));
-	  key = p[0]^p[1];
+			    valBignum(w), p[1]^p[2]));
+	  key = p[1]^p[2];
 #else
-	  key = p[0];
+	  key = p[1];
 #endif
 	  if ( !key )
 	    key++;
@@ -239,9 +275,87 @@ nextClauseFromBucket(ClauseChoice chp, gen_t generation, int is_list)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+deepIndexOfWord() walks path  from  the  term   w  and  returns  the key
+of the sub-term at the end. It returns  0 if the goal does not have this
+path, i.e., a deep index cannot be used for this goal.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static word
+deepIndexOfWord(word w, const index_path *path ARG_LD)
+{ int i;
+
+  for(i=0; i<path->depth; i++)
+  { while ( isRef(w) )
+      w = *unRef(w);
+    if ( !isTerm(w) || functorTerm(w) != path->functor[i] )
+      return 0;
+    w = argTermP(w, 0)[path->position[i]-1];
+  }
+
+  return indexOfWord(w PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Multi-argument (composite) indexes combine the keys of their arguments.
+The combination is the sum of  the  mixed   keys  and  thus  does not
+depend on the order in which  the   arguments  are  visited, which is
+exploited by bestMultiHash(). The argument  number   is  mixed in to
+distinguish e.g. p(a,b) from p(b,a).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if SIZEOF_VOIDP == 8
+#define MULTI_KEY_MIX 0x9e3779b97f4a7c15
+#else
+#define MULTI_KEY_MIX 0x9e3779b9
+#endif
+
+static inline word
+multiKeyPart(word key, int arg)
+{ key = (key+(word)arg) * (word)MULTI_KEY_MIX;
+
+  return key ^ (key >> (sizeof(word)*4));
+}
+
+
+static inline word
+multiKey(word sum)
+{ return sum ? sum : 1;
+}
+
+
+static word
+multiIndexOfWords(ClauseIndex ci, Word argv ARG_LD)
+{ word sum = 0;
+  int i;
+
+  for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+  { word k;
+
+    if ( !(k=indexOfWord(argv[ci->args[i]-1] PASS_LD)) )
+      return 0;
+    sum += multiKeyPart(k, ci->args[i]);
+  }
+
+  return multiKey(sum);
+}
+
+
 static inline word
 indexKeyFromArgv(ClauseIndex ci, Word argv ARG_LD)
-{ return indexOfWord(argv[ci->args[0]-1] PASS_LD);
+{ if ( likely(ci->path.depth == 0) )
+  { if ( likely(ci->args[1] == 0) )
+      return indexOfWord(argv[ci->args[0]-1] PASS_LD);
+    return multiIndexOfWords(ci, argv PASS_LD);
+  } else
+    return deepIndexOfWord(argv[ci->args[0]-1], &ci->path PASS_LD);
+}
+
+
+static inline int
+is_poor_index(unsigned int clauses, float speedup)
+{ return clauses > 10 && clauses/speedup > 10;
 }
 
 
@@ -285,18 +399,24 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
     if ( best_index )
     { int hi;
 
-      if ( def->impl.clauses.number_of_clauses > 10 &&
-	   def->impl.clauses.number_of_clauses/best_index->speedup > 10 )
+      if ( is_poor_index(def->impl.clauses.number_of_clauses,
+			 best_index->speedup) )
       { DEBUG(MSG_JIT,
 	      Sdprintf("Poor index in arg %d of %s (try to find better)\n",
 		       best_index->args[0], predicateName(def)));
 
 	if ( !best_index->tried_better )
-	{ best_index->tried_better = new_bitvector(def->functor->arity);
+	{ /* bits [arity..2*arity] are for deep and multi-argument */
+	  /* indexes (see bestHash()) */
+	  best_index->tried_better = new_bitvector(def->functor->arity*2+1);
 
 	  for(ci=def->impl.clauses.clause_indexes; ci; ci=ci->next)
-	  { if ( indexKeyFromArgv(ci, argv PASS_LD) )
-	      set_bit(best_index->tried_better, ci->args[0]-1);
+	  { if ( ci->path.depth == 0 && indexKeyFromArgv(ci, argv PASS_LD) )
+	    { int i;
+
+	      for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+		set_bit(best_index->tried_better, ci->args[i]-1);
+	    }
 	  }
 	}
 
@@ -305,7 +425,7 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 			    &hints)) >= 0 )
 	{ DEBUG(MSG_JIT, Sdprintf("Found better at arg %d\n", best+1));
 
-	  if ( (ci=hashDefinition(def, best+1, &hints)) )
+	  if ( (ci=hashDefinition(def, &hints)) )
 	  { chp->key = indexKeyFromArgv(ci, argv PASS_LD);
 	    assert(chp->key);
 	    best_index = ci;
@@ -330,7 +450,7 @@ firstClause(Word argv, LocalFrame fr, Definition def, ClauseChoice chp ARG_LD)
 
 
   if ( (best=bestHash(argv, def, 0.0, NULL, &hints)) >= 0 )
-  { if ( (ci=hashDefinition(def, best+1, &hints)) )
+  { if ( (ci=hashDefinition(def, &hints)) )
     { int hi;
 
       chp->key = indexKeyFromArgv(ci, argv PASS_LD);
@@ -385,7 +505,7 @@ nextClause(ClauseChoice chp, Word argv, LocalFrame fr, Definition def)
 		 *******************************/
 
 static ClauseIndex
-newClauseIndexTable(int arg, hash_hints *hints)
+newClauseIndexTable(hash_hints *hints)
 { ClauseIndex ci = allocHeapOrHalt(sizeof(struct clause_index));
   unsigned int m = 4;
   size_t bytes;
@@ -396,7 +516,8 @@ newClauseIndexTable(int arg, hash_hints *hints)
   bytes = sizeof(struct clause_bucket) * hints->buckets;
 
   memset(ci, 0, sizeof(*ci));
-  ci->args[0] = arg;
+  memcpy(ci->args, hints->args, sizeof(ci->args));
+  ci->path    = hints->path;
   ci->buckets = hints->buckets;
   ci->is_list = hints->list;
   ci->speedup = hints->speedup;
@@ -446,6 +567,8 @@ unallocClauseIndexTableEntries(ClauseIndex ci)
 void
 unallocClauseIndexTable(ClauseIndex ci)
 { unallocClauseIndexTableEntries(ci);
+  if ( ci->tried_better )
+    free_bitvector(ci->tried_better);
   freeHeap(ci, sizeof(struct clause_index));
 }
 
@@ -841,6 +964,7 @@ unallocOldClauseIndexes(Definition def)
 
     if ( def->tried_index )
       clear_bitvector(def->tried_index);
+    clearDeepTried(def);
   }
 }
 
@@ -868,6 +992,7 @@ unallocClauseIndexes(Definition def)
   unallocOldClauseIndexes(def);
   if ( def->tried_index )
     free_bitvector(def->tried_index);
+  freeDeepTried(def);
 }
 
 
@@ -877,6 +1002,7 @@ clearTriedIndexes(Definition def)
 
   if ( (v=def->tried_index) )
     clear_bitvector(v);
+  clearDeepTried(def);
 }
 
 
@@ -907,6 +1033,7 @@ reconsider_index(Definition def)
       { clear(def, P_SHRUNKPOW2);
       } else
       { clear_bitvector(tried);
+	clearDeepTried(def);
       }
     }
   }
@@ -977,12 +1104,44 @@ deleteActiveClauseFromBucket(ClauseBucket cb, word key)
 }
 
 
-static inline word
-indexKeyFromClause(ClauseIndex ci, Clause cl)
-{ word key;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+indexKeyFromClause() finds the key of cl   for  ci. It returns FALSE if
+the clause is not  part  of  the  index.   This  is  the  case  for deep
+indexes if the clause holds a  different   term  on the path to the
+indexed sub-term.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  argKey(cl->codes, ci->args[0]-1, &key);
-  return key;
+static int
+multiKeyFromClause(ClauseIndex ci, Clause cl, word *key)
+{ word sum = 0;
+  int i;
+
+  for(i=0; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+  { word k;
+
+    if ( !argKey(cl->codes, ci->args[i]-1, &k) )
+    { *key = 0;
+      return TRUE;
+    }
+    sum += multiKeyPart(k, ci->args[i]);
+  }
+
+  *key = multiKey(sum);
+  return TRUE;
+}
+
+
+static inline int
+indexKeyFromClause(ClauseIndex ci, Clause cl, word *key)
+{ if ( likely(ci->path.depth == 0) )
+  { if ( likely(ci->args[1] == 0) )
+    { argKey(cl->codes, ci->args[0]-1, key);
+      return TRUE;
+    }
+    return multiKeyFromClause(ci, cl, key);
+  }
+
+  return argKeyDeep(cl->codes, ci->args[0]-1, &ci->path, key);
 }
 
 
@@ -1001,7 +1160,10 @@ bucket.
 
 static void
 deleteActiveClauseFromIndex(ClauseIndex ci, Clause cl)
-{ word key = indexKeyFromClause(ci, cl);
+{ word key;
+
+  if ( !indexKeyFromClause(ci, cl, &key) )
+    return;
 
   if ( key == 0 )			/* not indexed */
   { int i;
@@ -1076,7 +1238,10 @@ indexed. This is needed for resizing the index.
 static void
 addClauseToIndex(ClauseIndex ci, Clause cl, int where)
 { ClauseBucket ch = ci->entries;
-  word key = indexKeyFromClause(ci, cl);
+  word key;
+
+  if ( !indexKeyFromClause(ci, cl, &key) )
+    return;
 
   if ( key == 0 )			/* a non-indexable field */
   { int n = ci->buckets;
@@ -1116,6 +1281,35 @@ addClauseToIndexes(Definition def, Clause cl, int where)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+addClausesToIndexes() is called by assertClausesProcedure() after
+appending count clauses, starting at cref,  with the definition locked.
+If the new clauses make up  a  large   part  of  the predicate, updating
+the indexes one  clause  at  a  time  is   more  expensive  than  simply
+rebuilding them.  We  therefore  delete  the   indexes  and  clear  the
+tried-index administration, such that the next call creates new indexes
+for the arguments it instantiates.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+addClausesToIndexes(Definition def, ClauseRef cref, size_t count)
+{ if ( count*2 >= def->impl.clauses.number_of_clauses )
+  { ClauseIndex ci, next;
+
+    for(ci=def->impl.clauses.clause_indexes; ci; ci=next)
+    { next = ci->next;
+      replaceIndex(def, ci, NULL);
+    }
+    clearTriedIndexes(def);
+  } else
+  { for(; cref; cref=cref->next)
+      addClauseToIndexes(def, cref->value.clause, CL_END);
+  }
+
+  DEBUG(CHK_SECURE, checkDefinition(def));
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Called from unlinkClause(), which is called for retracting a clause from
 a dynamic predicate which is not  referenced   and  has  few clauses. In
@@ -1130,7 +1324,10 @@ delClauseFromIndex(Definition def, Clause cl)
 
   for(ci=def->impl.clauses.clause_indexes; ci; ci=ci->next)
   { ClauseBucket ch = ci->entries;
-    word key = indexKeyFromClause(ci, cl);
+    word key;
+
+    if ( !indexKeyFromClause(ci, cl, &key) )
+      continue;
 
     if ( key == 0 )			/* a non-indexable field */
     { int n = ci->buckets;
@@ -1146,26 +1343,51 @@ delClauseFromIndex(Definition def, Clause cl)
 }
 
 
+static int
+same_path(const index_path *p1, const index_path *p2)
+{ int i;
+
+  if ( p1->depth != p2->depth )
+    return FALSE;
+  for(i=0; i<p1->depth; i++)
+  { if ( p1->position[i] != p2->position[i] ||
+	 p1->functor[i]  != p2->functor[i] )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static inline int
+same_index(ClauseIndex ci, const hash_hints *hints)
+{ return ( memcmp(ci->args, hints->args, sizeof(ci->args)) == 0 &&
+	   same_path(&ci->path, &hints->path) );
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-Create a hash-index on def for  arg.  It   is  ok  to do so unlocked for
-static predicates, but if another thread  did   the  job, we discard our
-result. For dynamic  or  multifile  predicates,   we  need  to  keep the
+Create a hash-index on def for hints->args or, if hints->path is not
+empty, on a sub-term of the argument (see bestDeepHash()). It is ok to
+do so unlocked for static predicates, but if another thread did the job,
+we discard our result. For dynamic  or  multifile  predicates,   we  need  to  keep the
 predicate locked while building the  hash-table   because  we  will miss
 clauses that are added while building.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 static ClauseIndex
-hashDefinition(Definition def, int arg, hash_hints *hints)
+hashDefinition(Definition def, hash_hints *hints)
 { ClauseRef cref;
   ClauseIndex ci, old;
   ClauseIndex *cip;
   int dyn_or_multi;
 
-  DEBUG(MSG_JIT, Sdprintf("hashDefinition(%s, %d, %d) (%s)\n",
-			  predicateName(def), arg, hints->buckets,
+  DEBUG(MSG_JIT, Sdprintf("hashDefinition(%s, %d/%d, %d) (%s)\n",
+			  predicateName(def), hints->args[0], hints->path.depth,
+			  hints->buckets,
 			  hints->list ? "lists" : "clauses"));
 
-  ci = newClauseIndexTable(arg, hints);
+  ci = newClauseIndexTable(hints);
 
   if ( (dyn_or_multi=true(def, P_DYNAMIC|P_MULTIFILE)) )
     LOCKDEF(def);
@@ -1179,7 +1401,7 @@ hashDefinition(Definition def, int arg, hash_hints *hints)
   if ( !dyn_or_multi )
     LOCKDEF(def);
   for(old=def->impl.clauses.clause_indexes; old; old=old->next)
-  { if ( old->args[0] == arg )
+  { if ( same_index(old, hints) )
       break;
   }
 
@@ -1187,7 +1409,7 @@ hashDefinition(Definition def, int arg, hash_hints *hints)
   { ClauseIndex conc;
 
     for(conc=def->impl.clauses.clause_indexes; conc; conc=conc->next)
-    { if ( conc->args[0] == arg )
+    { if ( same_index(conc, hints) )
       { UNLOCKDEF(def);
 	unallocClauseIndexTable(ci);
 	return conc;
@@ -1272,6 +1494,7 @@ typedef struct hash_assessment
   size_t	size;			/* keys in array */
   size_t	var_count;		/* # non-indexable cases */
   size_t	funct_count;		/* # functor cases */
+  size_t	clause_count;		/* # clauses on deep index path */
   float		stdev;			/* Standard deviation */
   float		speedup;		/* Expected speedup */
   int		list;			/* Put lists in the buckets */
@@ -1418,6 +1641,31 @@ expected speedup is
 #define ASSESS_BUFSIZE 10
 #define MIN_SPEEDUP 1.5
 
+static hash_assessment *
+alloc_assessment(hash_assessment *buf, hash_assessment **assessments,
+		 int *allocated, int count)
+{ if ( count >= *allocated )
+  { size_t newbytes = sizeof(**assessments)*2*(*allocated);
+
+    if ( *assessments == buf )
+    { *assessments = malloc(newbytes);
+      memcpy(*assessments, buf, sizeof(*buf)*ASSESS_BUFSIZE);
+    } else
+    { *assessments = realloc(*assessments, newbytes);
+    }
+    *allocated *= 2;
+  }
+
+  return &(*assessments)[count];
+}
+
+
+static int	bestMultiHash(Definition def, const int *args, int count,
+			      float *minbest, hash_hints *hints);
+static int	bestDeepHash(Definition def, int arg, word w,
+			     index_path *path, float *minbest,
+			     hash_hints *hints ARG_LD);
+
 static int
 bestHash(Word av, Definition def,
 	 float minbest, struct bit_vector *tried,
@@ -1430,6 +1678,7 @@ bestHash(Word av, Definition def,
   int assess_allocated = ASSESS_BUFSIZE;
   int assess_count = 0;
   int clause_count = 0;
+  int arity = (int)def->functor->arity;
   hash_assessment *a;
   hash_assessment *best = NULL;		/* argument */
   int best_arg = -1;
@@ -1438,31 +1687,21 @@ bestHash(Word av, Definition def,
     def->tried_index = new_bitvector(def->functor->arity);
 
 					/* Step 1: allocate assessments */
-  for(i=0; i<(int)def->functor->arity; i++)
+  for(i=0; i<arity; i++)
   { word k;
 
     if ( !true_bit(def->tried_index, i) &&	/* non-indexable */
 	 !(tried && true_bit(tried, i)) &&	/* already tried, not better */
 	 (k=indexOfWord(av[i] PASS_LD)) )
-    { if ( assess_count	>= assess_allocated )
-      { size_t newbytes = sizeof(*assessments)*2*assess_allocated;
-
-	if ( assessments == assess_buf )
-	{ assessments = malloc(newbytes);
-	  memcpy(assessments, assess_buf, sizeof(assess_buf));
-	} else
-	{ assessments = realloc(assessments, newbytes);
-	}
-	assess_allocated *= 2;
-      }
-      a = &assessments[assess_count++];
+    { a = alloc_assessment(assess_buf, &assessments, &assess_allocated,
+			   assess_count++);
       memset(a, 0, sizeof(*a));
       a->arg = i;
     }
   }
 
   if ( assess_count == 0 )
-    return -1;				/* no luck */
+    goto deep;				/* no luck on the arguments */
 
 					/* Step 2: assess */
   for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
@@ -1518,15 +1757,533 @@ bestHash(Word av, Definition def,
     hints->buckets = (unsigned int)best->size;
     hints->speedup = best->speedup;
     hints->list    = best->list;
+    memset(hints->args, 0, sizeof(hints->args));
+    hints->args[0] = best_arg+1;
+    hints->path.depth = 0;
   }
 
   if ( assessments != assess_buf )
     free(assessments);
 
+					/* Step 4: combine arguments */
+  if ( (best_arg < 0 ||
+	is_poor_index(def->impl.clauses.number_of_clauses, minbest)) &&
+       !(tried && true_bit(tried, 2*arity)) )
+  { int margs[MAX_MULTI_INDEX];
+    int mcount = 0;
+
+    for(i=0; i<arity && mcount < MAX_MULTI_INDEX; i++)
+    { if ( !true_bit(def->tried_index, i) &&
+	   indexOfWord(av[i] PASS_LD) )
+	margs[mcount++] = i;
+    }
+
+    if ( mcount >= 2 )
+    { int mbest;
+
+      if ( (mbest=bestMultiHash(def, margs, mcount, &minbest, hints)) >= 0 )
+	best_arg = mbest;
+      else if ( tried )
+	set_bit(tried, 2*arity);
+    }
+  }
+
+deep:					/* Step 5: try sub-terms */
+  if ( best_arg < 0 ||
+       is_poor_index(def->impl.clauses.number_of_clauses, minbest) )
+  { for(i=0; i<arity; i++)
+    { word w = av[i];
+
+      while ( isRef(w) )
+	w = *unRef(w);
+      if ( isTerm(w) && arityTerm(w) > 0 &&
+	   !(tried && true_bit(tried, arity+i)) )
+      { DeepInfo di = getDeepInfo(def);
+	index_path path;
+
+	path.depth = 0;
+	if ( !deepFunctorInClauses(def, &di->args[i], functorTerm(w),
+				   i, &path) )
+	  continue;			/* no clause has this compound */
+	if ( bestDeepHash(def, i, w, &path, &minbest, hints PASS_LD) )
+	  best_arg = i;
+	else if ( tried )
+	  set_bit(tried, arity+i);
+      }
+    }
+  }
+
   return best_arg;
 }
 
 
+		 /*******************************
+		 *   MULTI-ARGUMENT INDEXES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bestMultiHash() is called by  bestHash()  if   no  single  argument
+provides a good index while  the  goal   has  multiple  instantiated
+arguments. This is typical for  triple(S,P,O)  called   with  S  and P
+instantiated, where S and P have a skewed distribution. It assesses all
+combinations of at least two of  the   given  (0-based)  arguments in a
+single pass over the clauses. As the  combined   key  is  the sum of the
+mixed argument keys, the key for each combination is easily computed
+from the keys of the individual arguments.
+
+A combination must be better than  MIN_SPEEDUP   times  the  best so far
+to be selected, which makes us prefer  single argument indexes and, for
+combinations, indexes on fewer arguments.  Returns the first argument of
+the selected combination or -1.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MULTI_COMBINATIONS (1<<MAX_MULTI_INDEX)
+
+static int
+popcount_mask(unsigned int mask)
+{ int c;
+
+  for(c=0; mask; mask &= mask-1)
+    c++;
+
+  return c;
+}
+
+
+static int
+bestMultiHash(Definition def, const int *args, int count,
+	      float *minbest, hash_hints *hints)
+{ hash_assessment assessments[MULTI_COMBINATIONS];
+  unsigned int combinations = 1<<count;
+  unsigned int mask, best_mask = 0;
+  size_t clause_count = 0;
+  ClauseRef cref;
+  int n;
+
+  memset(assessments, 0, sizeof(assessments));
+
+  for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+  { Clause cl = cref->value.clause;
+    word parts[MAX_MULTI_INDEX];
+    unsigned int vars = 0;
+    int i;
+
+    if ( true(cl, CL_ERASED) )
+      continue;
+
+    for(i=0; i<count; i++)
+    { word k;
+
+      if ( argKey(cl->codes, args[i], &k) )
+	parts[i] = multiKeyPart(k, args[i]+1);
+      else
+	vars |= 1<<i;
+    }
+
+    for(mask=3; mask<combinations; mask++)
+    { hash_assessment *a = &assessments[mask];
+
+      if ( popcount_mask(mask) < 2 )
+	continue;
+      if ( (mask & vars) )
+      { a->var_count++;
+      } else
+      { word sum = 0;
+
+	for(i=0; i<count; i++)
+	{ if ( (mask & (1<<i)) )
+	    sum += parts[i];
+	}
+	assessAddKey(a, multiKey(sum));
+      }
+    }
+
+    clause_count++;
+  }
+
+  for(n=2; n<=count; n++)		/* fewest arguments first */
+  { for(mask=3; mask<combinations; mask++)
+    { hash_assessment *a = &assessments[mask];
+
+      if ( popcount_mask(mask) != n )
+	continue;
+      if ( assess_remove_duplicates(a, clause_count) )
+      { DEBUG(MSG_JIT,
+	      Sdprintf("Assess argument combination 0x%x of %s: "
+		       "speedup %f, stdev=%f\n",
+		       mask, predicateName(def), a->speedup, a->stdev));
+
+	if ( a->speedup > *minbest*MIN_SPEEDUP )
+	{ *minbest = a->speedup;
+	  best_mask = mask;
+	}
+      }
+    }
+  }
+
+  if ( best_mask )
+  { hash_assessment *a = &assessments[best_mask];
+    int i, j;
+
+    hints->buckets = (unsigned int)a->size;
+    hints->speedup = a->speedup;
+    hints->list    = a->list;
+    memset(hints->args, 0, sizeof(hints->args));
+    for(i=0, j=0; i<count; i++)
+    { if ( (best_mask & (1<<i)) )
+	hints->args[j++] = args[i]+1;
+    }
+    hints->path.depth = 0;
+  }
+
+  for(mask=0; mask<combinations; mask++)
+  { if ( assessments[mask].keys )
+      free(assessments[mask].keys);
+  }
+
+  return best_mask ? hints->args[0]-1 : -1;
+}
+
+
+		 /*******************************
+		 *	    DEEP INDEXES	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Deep indexes hash on a sub-term of  an   argument.  For example, if all
+clauses of edge/3 have the shape  edge(node(Id,Type),...), the first
+argument is useless for indexing, but a hash   on Id may be highly
+selective. bestDeepHash() is called by bestHash()  if there is no good
+index on any of the arguments and   the  goal has a compound argument.
+It assesses the arguments of this compound and,   if none of them is
+good enough, recurses into compound  sub-terms   up  to  MAX_DEEP_INDEX
+levels.
+
+The speedup of a deep index  is   expressed  relative to all clauses of
+the predicate. Clauses that have a different  term on the path are not
+part of the index (see argKeyDeep()).
+
+A goal only leads to a deep index   if the clause heads hold its compound
+at the same place.  For each argument  and   each  argument of a compound
+that we assessed, a deep_summary holds  the (at most MAX_DEEP_FUNCTORS)
+functors of the compounds found there  in   the  clause  heads. It is
+computed by a single pass over the   clauses. Goals with another compound
+are rejected in constant time, so calling  a predicate with many distinct
+compounds does not create records nor scan the clauses.
+
+The deep_tried chain records for  each   compound  on  a  path that the
+clauses hold the arguments that cannot be  indexed, such that we do not
+repeat the assessment.  As  records  are   only  created  for compounds
+that appear in the summaries, their number   is  bounded by the shape of
+the clause heads and, to be safe,   by  MAX_DEEP_TRIED. The chain is
+walked without locking and is therefore   only freed by
+unallocClauseIndexes(). Resetting the tried information clears the bit
+vectors and invalidates the summaries.  The   summaries  and bits are
+updated without locking.  A reader that sees   a partial update merely
+makes a different indexing decision.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define isFunctorKey(k)	(tagex(k) == (TAG_ATOM|STG_GLOBAL))
+
+static void
+init_summaries(deep_summary *s, int count)
+{ for(; count > 0; count--, s++)
+    s->count = -1;
+}
+
+
+static DeepInfo
+getDeepInfo(Definition def)
+{ DeepInfo di;
+
+  if ( !(di=def->deep_info) )
+  { int arity = def->functor->arity;
+    size_t size = offsetof(deep_info, args) + arity*sizeof(deep_summary);
+
+    di = allocHeapOrHalt(size);
+    memset(di, 0, size);
+    init_summaries(di->args, arity);
+
+    LOCKDEF(def);
+    if ( def->deep_info )
+    { UNLOCKDEF(def);
+      freeHeap(di, size);
+      return def->deep_info;
+    }
+    MemoryBarrier();
+    def->deep_info = di;
+    UNLOCKDEF(def);
+  }
+
+  return di;
+}
+
+
+/* deepFunctorInClauses() is true if a clause  holds a compound f at
+   the place that is reached from argument arg (0-based) using path. The
+   summary s for this place is computed if it is not known.
+*/
+
+static int
+deepFunctorInClauses(Definition def, deep_summary *s, functor_t f,
+		     int arg, const index_path *path)
+{ int i, count;
+
+  if ( s->count < 0 )
+  { ClauseRef cref;
+    functor_t functors[MAX_DEEP_FUNCTORS];
+
+    count = 0;
+    for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+    { Clause cl = cref->value.clause;
+      word k;
+
+      if ( true(cl, CL_ERASED) ||
+	   !argKeyDeep(cl->codes, arg, path, &k) ||
+	   !isFunctorKey(k) )
+	continue;
+      for(i=0; i<count; i++)
+      { if ( functors[i] == k )
+	  break;
+      }
+      if ( i == count )
+      { if ( count == MAX_DEEP_FUNCTORS )
+	{ count++;			/* too many: no deep index here */
+	  break;
+	}
+	functors[count++] = k;
+      }
+    }
+
+    if ( count <= MAX_DEEP_FUNCTORS )
+      memcpy(s->functors, functors, count*sizeof(functor_t));
+    MemoryBarrier();
+    s->count = count;
+  }
+
+  count = s->count;
+  for(i=0; i<count && i<MAX_DEEP_FUNCTORS; i++)
+  { if ( s->functors[i] == f )
+      return count <= MAX_DEEP_FUNCTORS;
+  }
+
+  return FALSE;
+}
+
+
+static DeepTried
+lookupDeepTried(Definition def, DeepInfo di, int arg, const index_path *path)
+{ DeepTried dt;
+  int arity = arityFunctor(path->functor[path->depth-1]);
+  size_t size = offsetof(deep_tried, sub) + arity*sizeof(deep_summary);
+
+  for(dt=di->tried; dt; dt=dt->next)
+  { if ( dt->arg == arg && same_path(&dt->path, path) )
+      return dt;
+  }
+  if ( di->count >= MAX_DEEP_TRIED )
+    return NULL;
+
+  dt = allocHeapOrHalt(size);
+  memset(dt, 0, size);
+  dt->arg   = arg;
+  dt->path  = *path;
+  dt->tried = new_bitvector(arity);
+  init_summaries(dt->sub, arity);
+
+  LOCKDEF(def);
+  { DeepTried conc;
+
+    for(conc=di->tried; conc; conc=conc->next)
+    { if ( conc->arg == arg && same_path(&conc->path, path) )
+	break;
+    }
+    if ( conc || di->count >= MAX_DEEP_TRIED )
+    { UNLOCKDEF(def);
+      free_bitvector(dt->tried);
+      freeHeap(dt, size);
+      return conc;
+    }
+  }
+  dt->next = di->tried;
+  MemoryBarrier();
+  di->tried = dt;
+  di->count++;
+  UNLOCKDEF(def);
+
+  return dt;
+}
+
+
+static void
+clearDeepTried(Definition def)
+{ DeepInfo di;
+
+  if ( (di=def->deep_info) )
+  { DeepTried dt;
+
+    init_summaries(di->args, def->functor->arity);
+    for(dt=di->tried; dt; dt=dt->next)
+    { clear_bitvector(dt->tried);
+      init_summaries(dt->sub,
+		     arityFunctor(dt->path.functor[dt->path.depth-1]));
+    }
+  }
+}
+
+
+static void
+freeDeepTried(Definition def)
+{ DeepInfo di;
+
+  if ( (di=def->deep_info) )
+  { DeepTried dt, next;
+
+    for(dt=di->tried; dt; dt=next)
+    { int arity = arityFunctor(dt->path.functor[dt->path.depth-1]);
+
+      next = dt->next;
+      free_bitvector(dt->tried);
+      freeHeap(dt, offsetof(deep_tried, sub) + arity*sizeof(deep_summary));
+    }
+    freeHeap(di, offsetof(deep_info, args) +
+		 def->functor->arity*sizeof(deep_summary));
+    def->deep_info = NULL;
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bestDeepHash() assesses the arguments of the  compound w, which is found
+in argument arg (0-based) of the goal at path.  If it finds an index that
+is better than *minbest, it updates *minbest and hints and returns TRUE.
+The caller verified using deepFunctorInClauses()  that the clauses hold
+the functor of w at this place.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+bestDeepHash(Definition def, int arg, word w, index_path *path,
+	     float *minbest, hash_hints *hints ARG_LD)
+{ functor_t f = functorTerm(w);
+  int arity = (int)arityFunctor(f);
+  Word args = argTermP(w, 0);
+  int depth = path->depth;
+  hash_assessment assess_buf[ASSESS_BUFSIZE];
+  hash_assessment *assessments = assess_buf;
+  int assess_allocated = ASSESS_BUFSIZE;
+  int assess_count = 0;
+  size_t clause_count = 0;
+  hash_assessment *a;
+  DeepTried dt;
+  int found = FALSE;
+  int i, j;
+
+  if ( depth >= MAX_DEEP_INDEX )
+    return FALSE;
+
+  path->functor[depth]  = f;
+  path->position[depth] = 0;
+  path->depth           = depth+1;
+  if ( !(dt = lookupDeepTried(def, def->deep_info, arg, path)) )
+  { path->depth = depth;
+    return FALSE;
+  }
+
+  for(j=0; j<arity; j++)
+  { if ( !true_bit(dt->tried, j) &&
+	 indexOfWord(args[j] PASS_LD) )
+    { a = alloc_assessment(assess_buf, &assessments, &assess_allocated,
+			   assess_count++);
+      memset(a, 0, sizeof(*a));
+      a->arg = j;
+    }
+  }
+
+  if ( assess_count > 0 )
+  { ClauseRef cref;
+
+    for(cref=def->impl.clauses.first_clause; cref; cref=cref->next)
+    { Clause cl = cref->value.clause;
+
+      if ( true(cl, CL_ERASED) )
+	continue;
+
+      for(i=0, a=assessments; i<assess_count; i++, a++)
+      { word k;
+
+	path->position[depth] = a->arg+1;
+	if ( argKeyDeep(cl->codes, arg, path, &k) )
+	{ a->clause_count++;
+	  if ( k )
+	    assessAddKey(a, k);
+	  else
+	    a->var_count++;
+	}
+      }
+
+      clause_count++;
+    }
+
+    for(i=0, a=assessments; i<assess_count; i++, a++)
+    { if ( assess_remove_duplicates(a, a->clause_count) )
+      { float speedup = a->speedup *
+			(float)clause_count/(float)a->clause_count;
+
+	DEBUG(MSG_JIT,
+	      Sdprintf("Assess arg %d of %s, depth %d, position %d: "
+		       "speedup %f, stdev=%f\n",
+		       arg+1, predicateName(def), depth+1, a->arg+1,
+		       speedup, a->stdev));
+
+	if ( speedup > *minbest )
+	{ *minbest		= speedup;
+	  path->position[depth] = a->arg+1;
+	  hints->buckets	= (unsigned int)a->size;
+	  hints->speedup	= speedup;
+	  hints->list		= a->list;
+	  memset(hints->args, 0, sizeof(hints->args));
+	  hints->args[0]	= arg+1;
+	  hints->path		= *path;
+	  found = TRUE;
+	}
+      } else
+      { set_bit(dt->tried, a->arg);
+      }
+
+      if ( a->keys )
+	free(a->keys);
+    }
+
+    if ( assessments != assess_buf )
+      free(assessments);
+  }
+
+  if ( (!found ||
+	is_poor_index(def->impl.clauses.number_of_clauses, *minbest)) &&
+       depth+1 < MAX_DEEP_INDEX )
+  { for(j=0; j<arity; j++)
+    { word a2 = args[j];
+
+      while ( isRef(a2) )
+	a2 = *unRef(a2);
+      if ( isTerm(a2) && arityTerm(a2) > 0 )
+      { index_path sub = *path;
+
+	sub.position[depth] = j+1;
+	if ( deepFunctorInClauses(def, &dt->sub[j], functorTerm(a2),
+				  arg, &sub) &&
+	     bestDeepHash(def, arg, a2, &sub, minbest, hints PASS_LD) )
+	  found = TRUE;
+      }
+    }
+  }
+
+  path->depth = depth;
+
+  return found;
+}
+
+
 		 /*******************************
 		 *  PREDICATE PROPERTY SUPPORT	*
 		 *******************************/
@@ -1535,17 +2292,66 @@ bestHash(Word av, Definition def,
 Index info is
 
 	Arg - hash(Buckets, Speedup, IsList)
+
+For deep indexes, Arg is a list [Arg, Pos1, ...] that describes the path
+to the indexed sub-term. For multi-argument indexes, Arg is a term
+Arg1+Arg2+...
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static int
+unify_index_arg(term_t t, ClauseIndex ci)
+{ GET_LD
+
+  if ( ci->path.depth == 0 )
+  { term_t a, n;
+    int i;
+
+    if ( ci->args[1] == 0 )
+      return PL_unify_integer(t, ci->args[0]);
+
+    if ( !(a=PL_new_term_ref()) ||
+	 !(n=PL_new_term_ref()) ||
+	 !PL_put_integer(a, ci->args[0]) )
+      return FALSE;
+    for(i=1; i<MAX_MULTI_INDEX && ci->args[i]; i++)
+    { if ( !PL_put_integer(n, ci->args[i]) ||
+	   !PL_cons_functor(a, FUNCTOR_plus2, a, n) )
+	return FALSE;
+    }
+
+    return PL_unify(t, a);
+  } else
+  { term_t tail = PL_copy_term_ref(t);
+    term_t head = PL_new_term_ref();
+    int i;
+
+    if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_integer(head, ci->args[0]) )
+      return FALSE;
+    for(i=0; i<ci->path.depth; i++)
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !PL_unify_integer(head, ci->path.position[i]) )
+	return FALSE;
+    }
+
+    return PL_unify_nil(tail);
+  }
+}
+
+
 static int
 unify_clause_index(term_t t, ClauseIndex ci)
-{ return PL_unify_term(t,
-		       PL_FUNCTOR, FUNCTOR_minus2,
-			 PL_INT, (int)ci->args[0],
-			 PL_FUNCTOR_CHARS, "hash", 3,
-			   PL_INT, (int)ci->buckets,
-			   PL_DOUBLE, (double)ci->speedup,
-		           PL_BOOL, ci->is_list);
+{ GET_LD
+  term_t arg = PL_new_term_ref();
+
+  return ( unify_index_arg(arg, ci) &&
+	   PL_unify_term(t,
+			 PL_FUNCTOR, FUNCTOR_minus2,
+			   PL_TERM, arg,
+			   PL_FUNCTOR_CHARS, "hash", 3,
+			     PL_INT, (int)ci->buckets,
+			     PL_DOUBLE, (double)ci->speedup,
+			     PL_BOOL, ci->is_list) );
 }
 
 bool
@@ -578,6 +578,10 @@ parseCommandLineOptions(int argc0, char **argv, int *compile)
 #endif
       } else if ( (optval=is_longopt(s, "traditional")) )
       { setTraditional();
+      } else if ( is_longopt(s, "lazy-load") )
+      { GD->options.lazy_load = TRUE;
+      } else if ( is_longopt(s, "shared-code") )
+      { GD->options.shared_code = TRUE;
       }
 
       continue;				/* don't handle --long=value */
@@ -876,12 +880,10 @@ PL_initialise(int argc, char **argv)
 
     if ( statefd )
     { GD->bootsession = TRUE;
-      if ( !loadWicFromStream(statefd) )
+      if ( !loadStateFromStream(statefd) )
       { fail;
       }
       GD->bootsession = FALSE;
-
-      Sclose(statefd);
     } else
     { fatalError("Resource database \"%s\" does not contain a saved state",
 		 rcpath);
@@ -941,6 +943,8 @@ usage()
     "    --nodebug        Omit generation of debug info\n",
     "    --quiet          Quiet operation (also -q)\n",
     "    --traditional    Disable extensions of version 7\n",
+    "    --lazy-load      Load predicates of the state on first use\n",
+    "    --shared-code    Keep code of the state in pages shared with forks\n",
     "    --home=DIR       Use DIR as SWI-Prolog home\n",
     "    --pldoc[=port]   Start PlDoc server [at port]\n",
 #ifdef __WINDOWS__
@@ -1247,7 +1251,8 @@ emergency:
 #endif
 
   if ( reclaim_memory )
-  { freeStacks(PASS_LD1);
+  { cleanupParallelMark();
+    freeStacks(PASS_LD1);
     cleanupLocalDefinitions(LD);
     freePrologLocalData(LD);
     cleanupSourceFiles();
@@ -59,6 +59,8 @@ typedef struct
   char *	saveclass;		/* Type of saved state */
   bool		silent;			/* -q: quiet operation */
   bool		traditional;		/* --traditional: no version 7 exts */
+  bool		lazy_load;		/* --lazy-load: load clauses on demand */
+  bool		shared_code;		/* --shared-code: see pl-wic.c */
 #ifdef __WINDOWS__
   bool		win_app;		/* --win_app: be Windows application */
 #endif
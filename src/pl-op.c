@@ -663,6 +663,7 @@ static const opdef operators[] = {
   OP(ATOM_multifile,		 OP_FX,	 1150),	/* multifile */
   OP(ATOM_meta_predicate,	 OP_FX,	 1150),	/* meta_predicate */
   OP(ATOM_public,		 OP_FX,	 1150),	/* public */
+  OP(ATOM_table,		 OP_FX,	 1150),	/* table */
   OP(ATOM_xor,			 OP_YFX, 400),	/* xor */
 
   OP(NULL_ATOM,			 0,	 0)
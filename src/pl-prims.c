@@ -2203,6 +2203,8 @@ setarg(term_t n, term_t term, term_t value, int flags)
     a = valTermRef(term);		/* duplicate may shift stacks */
     deRef(a);
     a = argTermP(*a, argn-1);
+    if ( a < LD->gen_bar )		/* untrailed old-to-young pointer */
+      LD->gen_bar = gBase;		/* next GC must be a full one */
   }
 					/* this is unify(), but the */
 					/* assignment must *not* be trailed */
@@ -4953,6 +4955,8 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
     v->value.f = gc_status.time;
   } else if (key == ATOM_collections)
     v->value.i = gc_status.collections;
+  else if (key == ATOM_minor_collections)
+    v->value.i = gc_status.minor_collections;
   else if (key == ATOM_collected)
     v->value.i = gc_status.trail_gained + gc_status.global_gained;
 #ifdef HAVE_BOEHM_GC
@@ -4970,6 +4974,17 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
   { v->type = V_FLOAT;
     v->value.f = GD->atoms.gc_time;
   }
+  else if (key == ATOM_agc_slices)
+    v->value.i = GD->atoms.slices;
+  else if (key == ATOM_agc_max_slice_gained)
+    v->value.i = GD->atoms.max_slice_gained;
+  else if (key == ATOM_agc_pause_time)
+  { v->type = V_FLOAT;
+    v->value.f = GD->atoms.pause_time;
+  } else if (key == ATOM_agc_max_pause)
+  { v->type = V_FLOAT;
+    v->value.f = GD->atoms.max_pause;
+  }
 #endif
   else if (key == ATOM_global_shifts)
     v->value.i = LD->shift_status.global_shifts;
@@ -5159,6 +5174,8 @@ static const optdef optdefs[] =
   { "class",		CMDOPT_STRING,  &GD->options.saveclass },
   { "search_paths",	CMDOPT_LIST,	&GD->options.search_paths },
   { "pldoc_server",	CMDOPT_STRING,	&GD->options.pldoc_server },
+  { "lazy_load",	CMDOPT_BOOL,	&GD->options.lazy_load },
+  { "shared_code",	CMDOPT_BOOL,	&GD->options.shared_code },
 #ifdef __WINDOWS__
   { "win_app",		CMDOPT_BOOL,	&GD->options.win_app },
 #endif
@@ -5229,7 +5246,18 @@ set_pl_option(const char *name, const char *value)
   for( ; d->name; d++ )
   { if ( streq(name, d->name) )
     { switch(d->type)
-      { case CMDOPT_SIZE_T:
+      { case CMDOPT_BOOL:
+	{ bool *val = d->address;
+
+	  if ( streq(value, "true") )
+	    *val = TRUE;
+	  else if ( streq(value, "false") )
+	    *val = FALSE;
+	  else
+	    fail;
+	  succeed;
+	}
+	case CMDOPT_SIZE_T:
 	{ size_t *val = d->address;
 	  number n;
 	  unsigned char *q;
@@ -24,6 +24,7 @@
 /*#define O_DEBUG 1*/
 #include "pl-incl.h"
 #include "pl-dbref.h"
+#include "pl-facts.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 General  handling  of  procedures:  creation;  adding/removing  clauses;
@@ -266,7 +267,10 @@ isCurrentProcedure(functor_t f, Module m)
 
 ClauseRef
 hasClausesDefinition(Definition def)
-{ if ( def->impl.clauses.first_clause )
+{ if ( true(def, P_LAZY) )
+    loadLazyDefinition(def);
+
+  if ( def->impl.clauses.first_clause )
   { if ( def->impl.clauses.erased_clauses == 0 )
     { return def->impl.clauses.first_clause;
     } else
@@ -961,6 +965,9 @@ assertProcedure(Procedure proc, Clause clause, int where ARG_LD)
   word key;
   ClauseRef cref;
 
+  if ( true(def, P_LAZY) )		/* first add the clauses of the state */
+    loadLazyDefinition(def);
+
   argKey(clause->codes, 0, &key);
   cref = newClauseRef(clause, key);
 
@@ -1004,6 +1011,33 @@ assertProcedure(Procedure proc, Clause clause, int where ARG_LD)
   return cref;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+assertClausesProcedure() appends the chain of  count clause references
+from first to last to the dynamic predicate def using a single lock. It
+is used by assertz_list/1, which compiles  the clauses before and makes
+them visible afterwards by setting their generation. Unlike
+assertProcedure(), it thus does not touch the generation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+assertClausesProcedure(Definition def, ClauseRef first, ClauseRef last,
+		       size_t count, size_t rules)
+{ LOCKDEF(def);
+  if ( !def->impl.clauses.last_clause )
+  { def->impl.clauses.first_clause = first;
+  } else
+  { def->impl.clauses.last_clause->next = first;
+  }
+  def->impl.clauses.last_clause = last;
+
+  def->impl.clauses.number_of_clauses += (unsigned int)count;
+  def->impl.clauses.number_of_rules   += (unsigned int)rules;
+  GD->statistics.clauses += count;
+
+  addClausesToIndexes(def, first, count);
+  UNLOCKDEF(def);
+}
+
 /*  Abolish a procedure.  Referenced  clauses  are   unlinked  and left
     dangling in the dark until the procedure referencing it deletes it.
 
@@ -1020,6 +1054,8 @@ abolishProcedure(Procedure proc, Module module)
 
   DEBUG(MSG_PROC, Sdprintf("abolishProcedure(%s)\n", predicateName(def)));
 
+  if ( true(def, P_LAZY) )
+    loadLazyDefinition(def);
   startCritical;
   LOCKDEF(def);
   if ( def->module != module )		/* imported predicate; remove link */
@@ -1032,7 +1068,9 @@ abolishProcedure(Procedure proc, Module module)
     proc->definition         = ndef;
     resetProcedure(proc, TRUE);
   } else if ( true(def, P_FOREIGN) )	/* foreign: make normal */
-  { def->impl.clauses.first_clause = def->impl.clauses.last_clause = NULL;
+  { if ( true(def, P_FACTS) )
+      releaseFactsDefinition(def);
+    def->impl.clauses.first_clause = def->impl.clauses.last_clause = NULL;
     resetProcedure(proc, TRUE);
   } else if ( true(def, P_THREAD_LOCAL) )
   { UNLOCKDEF(def);
@@ -1086,7 +1124,7 @@ removeClausesProcedure(Procedure proc, int sfindex, int fromfile)
   int deleted = 0;
 
 #ifdef O_LOGICAL_UPDATE
-  GD->generation++;
+  ATOMIC_INC(&GD->generation);
 #endif
 
   if ( true(def, P_THREAD_LOCAL) )
@@ -1227,7 +1265,8 @@ void
 unallocClause(Clause c)
 { GD->statistics.codes -= c->code_size;
   GD->statistics.clauses--;
-  PL_free(c);
+  if ( false(c, CL_SHARED) )		/* memory is part of the code area */
+    PL_free(c);
 }
 
 
@@ -2053,6 +2092,19 @@ PRED_IMPL("retract", 1, retract,
   retract_context *ctx;
   ClauseRef cref;
 
+  if ( CTX_CNTRL != FRG_FIRST_CALL && isFactCursor(CTX_PTR) )
+  { Module m = NULL;
+    term_t cl = PL_new_term_ref();
+    term_t head = PL_new_term_ref();
+    term_t body = PL_new_term_ref();
+
+    if ( CTX_CNTRL == FRG_REDO &&
+	 ( !PL_strip_module_ex(term, &m, cl) ||
+	   !get_head_and_body_clause(cl, head, body, NULL PASS_LD) ) )
+      return FALSE;				/* cannot happen */
+    return factsRetract(NULL, head, body, PL__ctx PASS_LD);
+  }
+
   if ( CTX_CNTRL == FRG_CUTTED )
   { ctx = CTX_PTR;
 
@@ -2096,6 +2148,8 @@ PRED_IMPL("retract", 1, retract,
 
       def = getProcDefinition(proc);
 
+      if ( true(def, P_FACTS) )
+	return factsRetract(def, head, body, PL__ctx PASS_LD);
       if ( true(def, P_FOREIGN) )
 	return PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
       if ( false(def, P_DYNAMIC) )
@@ -2226,6 +2280,8 @@ pl_retractall(term_t head)
     fail;
 
   def = getProcDefinition(proc);
+  if ( true(def, P_FACTS) )
+    return factsRetractAll(def, thehead PASS_LD);
   if ( true(def, P_FOREIGN) )
     return PL_error(NULL, 0, NULL, ERR_MODIFY_STATIC_PROC, proc);
   if ( false(def, P_DYNAMIC) )
@@ -2383,6 +2439,7 @@ static const patt_mask patt_masks[] =
   { ATOM_public,	   P_PUBLIC },
   { ATOM_non_terminal,	   P_NON_TERMINAL },
   { ATOM_quasi_quotation_syntax, P_QUASI_QUOTATION_SYNTAX },
+  { ATOM_compact,	   P_FACTS },
   { (atom_t)0,		   0 }
 };
 
@@ -2421,6 +2478,11 @@ pl_get_predicate_attribute(term_t pred,
   if ( !PL_get_atom(what, &key) )
     return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_atom, what);
 
+  if ( true(def, P_LAZY) &&		/* properties that need the clauses */
+       ( key == ATOM_line_count || key == ATOM_file ||
+	 key == ATOM_number_of_clauses || key == ATOM_number_of_rules ) )
+    loadLazyDefinition(def);
+
   if ( key == ATOM_imported )
   { if ( module == def->module )
       fail;
@@ -2462,19 +2524,32 @@ pl_get_predicate_attribute(term_t pred,
 
     return FALSE;
   } else if ( key == ATOM_foreign )
-  { return PL_unify_integer(value, true(def, P_FOREIGN) ? 1 : 0);
+  { return PL_unify_integer(value,
+			    true(def, P_FOREIGN) && false(def, P_FACTS) ? 1 : 0);
+  } else if ( key == ATOM_dynamic && true(def, P_FACTS) )
+  { return PL_unify_integer(value, 1);
   } else if ( key == ATOM_references )
   { return PL_unify_integer(value, def->references);
   } else if ( key == ATOM_number_of_clauses )
-  { if ( def->flags & P_FOREIGN )
+  { if ( true(def, P_FACTS) )
+      return PL_unify_int64(value, countFactsDefinition(def));
+    if ( def->flags & P_FOREIGN )
       fail;
 
     def = getProcDefinition(proc);
     if ( def->impl.clauses.number_of_clauses == 0 && false(def, P_DYNAMIC) )
       fail;
     return PL_unify_integer(value, def->impl.clauses.number_of_clauses);
+  } else if ( key == ATOM_fact_file )
+  { atom_t file;
+
+    if ( false(def, P_FACTS) || !(file = factFileDefinition(def)) )
+      fail;
+    return PL_unify_atom(value, file);
   } else if ( key == ATOM_number_of_rules )
-  { if ( def->flags & P_FOREIGN )
+  { if ( true(def, P_FACTS) )
+      return PL_unify_integer(value, 0);
+    if ( def->flags & P_FOREIGN )
       fail;
 
     def = getProcDefinition(proc);
@@ -2539,6 +2614,15 @@ int
 setDynamicProcedure(Procedure proc, bool isdyn)
 { Definition def = proc->definition;
 
+  if ( true(def, P_FACTS) )		/* compact: dynamic, see pl-facts.c */
+  { if ( isdyn )
+      succeed;
+    return PL_error(NULL, 0, NULL, ERR_PERMISSION_PROC,
+		    ATOM_modify, ATOM_compact_procedure, proc);
+  }
+  if ( true(def, P_LAZY) )
+    loadLazyDefinition(def);
+
   LOCK();
   if ( (isdyn && true(def, P_DYNAMIC)) ||
        (!isdyn && false(def, P_DYNAMIC)) )
@@ -2599,6 +2683,9 @@ set_thread_local_procedure(Procedure proc, bool val)
 #ifdef O_PLMT
   Definition def = proc->definition;
 
+  if ( true(def, P_LAZY) )
+    loadLazyDefinition(def);
+
   LOCK();
   if ( (val && true(def, P_THREAD_LOCAL)) ||
        (!val && false(def, P_THREAD_LOCAL)) )
@@ -2668,6 +2755,8 @@ pl_set_predicate_attribute(term_t pred,
 
   if ( att == P_DYNAMIC )
   { rc = setDynamicProcedure(proc, val);
+  } else if ( att == P_FACTS )
+  { rc = setCompactProcedure(proc, val);
   } else if ( att == P_THREAD_LOCAL )
   { rc = set_thread_local_procedure(proc, val);
   } else
@@ -2897,6 +2986,8 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
   if ( !isDefinedProcedure(from) )
     trapUndefined(getProcDefinition(from) PASS_LD);
   def = getProcDefinition(from);
+  if ( true(def, P_LAZY) )
+    loadLazyDefinition(def);
   generation = GD->generation;		/* take a consistent snapshot */
 
   if ( true(def, P_FOREIGN) )
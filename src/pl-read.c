@@ -24,6 +24,7 @@
 /*#define O_DEBUG 1*/
 #include "pl-incl.h"
 #include <math.h>
+#include <float.h>
 #include "os/pl-ctype.h"
 #include "os/pl-utf8.h"
 #include "os/pl-dtoa.h"
@@ -824,6 +825,138 @@ addToBuffer(int c, ReadData _PL_rd)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Most of the input of raw_read2() consists of runs  of  ASCII  layout,
+comment text, identifier characters, digits and  quoted  text.  If  each
+ASCII byte in the stream is a character that is represented by the  same
+byte in UTF-8, we take such runs directly  from  the  stream  buffer  and
+update the stream position once for the whole run.  A run stops  at  the
+end of the stream buffer, at non-ASCII bytes and at \r, which  may  be
+part of a DOS newline.  The character based reader handles these.
+
+Runs that replace getchr() may only be used if there is  no  character
+conversion table.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RUN_ID		1			/* identifier continuation */
+#define RUN_DIGIT	2			/* decimal digits */
+#define RUN_BLANK	3			/* layout */
+#define RUN_COMMENT	4			/* text of a % comment */
+#define RUN_QUOTED	5			/* unescaped text in quotes */
+
+static inline int
+run_stream(IOSTREAM *s)
+{ if ( s->tee || s->bufp >= s->limitp )
+    return FALSE;
+
+  switch(s->encoding)
+  { case ENC_OCTET:
+    case ENC_ASCII:
+    case ENC_ISO_LATIN_1:
+    case ENC_UTF8:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+#define getchr_run() \
+	(!_PL_rd->char_conversion_table && run_stream(rb.stream))
+
+static inline const unsigned char *
+scan_run(IOSTREAM *s, int kind, int q)
+{ const unsigned char *p = (const unsigned char *)s->bufp;
+  const unsigned char *e = (const unsigned char *)s->limitp;
+
+  switch(kind)
+  { case RUN_ID:
+      while( p < e && *p < 0x80 && _PL_char_types[*p] >= UC )
+	p++;
+      break;
+    case RUN_DIGIT:
+      while( p < e && *p >= '0' && *p <= '9' )
+	p++;
+      break;
+    case RUN_BLANK:
+      while( p < e && *p < 0x80 && _PL_char_types[*p] == SP &&
+	     *p != '\r' && *p != EOS )
+	p++;
+      break;
+    case RUN_COMMENT:
+      while( p < e && *p < 0x80 && *p != '\n' && *p != '\r' )
+	p++;
+      break;
+    case RUN_QUOTED:
+      while( p < e && *p < 0x80 && *p != q && *p != '\\' && *p != '\r' )
+	p++;
+      break;
+    default:
+      assert(0);
+  }
+
+  return p;
+}
+
+
+static void
+skip_run(IOSTREAM *s, const unsigned char *e)
+{ const unsigned char *p = (const unsigned char *)s->bufp;
+  IOPOS *pos;
+
+  if ( (pos=s->position) )
+  { pos->byteno += e-p;
+    pos->charno += e-p;
+
+    for( ; p < e; p++ )
+    { switch(*p)
+      { case '\n':
+	  pos->lineno++;
+	  pos->linepos = 0;
+	  s->flags &= ~SIO_NOLINEPOS;
+	  break;
+	case '\t':
+	  pos->linepos |= 7;
+	  pos->linepos++;
+	  break;
+	case '\b':
+	  if ( pos->linepos > 0 )
+	    pos->linepos--;
+	  break;
+	default:
+	  pos->linepos++;
+      }
+    }
+  }
+
+  s->bufp = (char *)e;
+}
+
+
+/* Take a run from the stream.  If blank is TRUE, the run is added to
+   the read buffer as spaces to preserve the positions.
+*/
+
+static void
+add_run(int kind, int q, int blank, ReadData _PL_rd)
+{ IOSTREAM *s = rb.stream;
+  const unsigned char *e = scan_run(s, kind, q);
+  const unsigned char *p = (const unsigned char *)s->bufp;
+  size_t n = e-p;
+
+  while( (size_t)(rb.end-rb.here) < n )
+  { addByteToBuffer(blank ? ' ' : *p++, _PL_rd);
+    n--;
+  }
+  if ( blank )
+    memset(rb.here, ' ', n);
+  else
+    memcpy(rb.here, p, n);
+  rb.here += n;
+
+  skip_run(s, e);
+}
+
+
 static void
 setCurrentSourceLocation(ReadData _PL_rd ARG_LD)
 { atom_t a;
@@ -909,6 +1042,8 @@ raw_read_quoted(int q, ReadData _PL_rd)
     pos = NULL;
 
   addToBuffer(q, _PL_rd);
+  if ( run_stream(rb.stream) )
+    add_run(RUN_QUOTED, q, FALSE, _PL_rd);
   while((c=getchrq()) != EOF && c != q)
   {
   next:
@@ -973,6 +1108,8 @@ raw_read_quoted(int q, ReadData _PL_rd)
       }
     }
     addToBuffer(c, _PL_rd);
+    if ( run_stream(rb.stream) )
+      add_run(RUN_QUOTED, q, FALSE, _PL_rd);
   }
 
 out:
@@ -1013,6 +1150,8 @@ static int
 raw_read_identifier(int c, ReadData _PL_rd)
 { do
   { addToBuffer(c, _PL_rd);
+    if ( getchr_run() )
+      add_run(RUN_ID, 0, FALSE, _PL_rd);
     c = getchr();
   } while( c != EOF && PlIdContW(c) );
 
@@ -1232,8 +1371,16 @@ raw_read2(ReadData _PL_rd ARG_LD)
 		  }
 		  discardBuffer(cbuf);
 		} else
-		{ while((c=getchr()) != EOF && c != '\n')
-		  { if ( something_read )		/* record positions */
+		{ for(;;)
+		  { if ( getchr_run() )
+		    { if ( something_read )
+			add_run(RUN_COMMENT, 0, TRUE, _PL_rd);
+		      else
+			skip_run(rb.stream, scan_run(rb.stream, RUN_COMMENT, 0));
+		    }
+		    if ( (c=getchr()) == EOF || c == '\n' )
+		      break;
+		    if ( something_read )		/* record positions */
 		      addToBuffer(' ', _PL_rd);
 		  }
 		}
@@ -1341,6 +1488,12 @@ raw_read2(ReadData _PL_rd ARG_LD)
 			  addToBuffer(c ? c : ' ', _PL_rd);
 			else
 			  ensure_space(c);
+			if ( getchr_run() )
+			{ if ( something_read )
+			    add_run(RUN_BLANK, 0, FALSE, _PL_rd);
+			  else
+			    skip_run(rb.stream, scan_run(rb.stream, RUN_BLANK, 0));
+			}
 			c = getchr();
 		      } while( c != EOF && PlBlankW(c) );
 		      goto handle_c;
@@ -1359,6 +1512,12 @@ raw_read2(ReadData _PL_rd ARG_LD)
 		      set_start_line;
 		      c = raw_read_identifier(c, _PL_rd);
 		      goto handle_c;
+		    case DI:
+		      addToBuffer(c, _PL_rd);
+		      set_start_line;
+		      if ( getchr_run() )
+			add_run(RUN_DIGIT, 0, FALSE, _PL_rd);
+		      break;
 		    default:
 #ifdef O_QUASIQUOTATIONS		/* detect || from {|Syntax||Quotation|} */
 		      if ( c == '|' &&
@@ -1891,6 +2050,45 @@ skip_digit_separator(cucharp *sp, int base, int *grouped)
 }
 
 
+/* digits8() converts 8 decimal digits using SWAR (SIMD within a
+   register): the digits are combined pairwise into 4 2-digit numbers,
+   2 4-digit numbers and finally one 8-digit number.  The word is built
+   using shifts to be independent from the byte order.
+*/
+
+static inline uint64_t
+digits8(cucharp s)
+{ uint64_t v = ( (uint64_t)s[0]       | (uint64_t)s[1] <<  8 |
+		 (uint64_t)s[2] << 16 | (uint64_t)s[3] << 24 |
+		 (uint64_t)s[4] << 32 | (uint64_t)s[5] << 40 |
+		 (uint64_t)s[6] << 48 | (uint64_t)s[7] << 56 );
+
+  v -= 0x3030303030303030ULL;
+  v = (v*10    + (v >>  8)) & 0x00ff00ff00ff00ffULL;
+  v = (v*100   + (v >> 16)) & 0x0000ffff0000ffffULL;
+  v = (v*10000 + (v >> 32)) & 0x00000000ffffffffULL;
+
+  return v;
+}
+
+
+/* scan_digits() converts the run of at most 18 digits from s to e.
+   Such a run cannot overflow a 64-bit integer.
+*/
+
+static uint64_t
+scan_digits(cucharp s, cucharp e)
+{ uint64_t v = 0;
+
+  for( ; e-s >= 8; s += 8 )
+    v = v*100000000 + digits8(s);
+  for( ; s < e; s++ )
+    v = v*10 + (*s - '0');
+
+  return v;
+}
+
+
 static strnumstat
 scan_decimal(cucharp *sp, int negative, Number n, int *grouped)
 { int64_t maxi = PLMAXINT/10;
@@ -1899,6 +2097,7 @@ scan_decimal(cucharp *sp, int negative, Number n, int *grouped)
   int minlastdigit = PLMININT % 10;
   int64_t t = 0;
   cucharp s = *sp;
+  cucharp e;
   int c = *s;
 
   if ( !isDigit(c) )
@@ -1906,6 +2105,15 @@ scan_decimal(cucharp *sp, int negative, Number n, int *grouped)
 
   *grouped = FALSE;
 
+  for(e=s+1; isDigit(*e); e++)		/* fast path for short runs */
+    ;
+  if ( e-s <= 18 )
+  { t = (int64_t)scan_digits(s, e);
+    if ( negative )
+      t = -t;
+    s = e;
+  }
+
   do
   { for(c = *s; isDigit(c); c = *++s)
     { if (    (  negative && ( (t < mini) || (t == mini && '0' - c < minlastdigit) ))
@@ -2341,10 +2549,76 @@ get_quasi_quotation(term_t t, unsigned char **here, unsigned char *ein,
 #endif /*O_QUASIQUOTATIONS*/
 
 
+/* fast_float() converts the float with the digits s to e that does not
+   have digit separators, e.g., 12.5e3, using one multiplication or
+   division if the digits fit in the 53-bit mantissa and the power of
+   10 is exact.  The result is correctly rounded.  See W.D. Clinger,
+   "How to Read Floating Point Numbers Accurately", PLDI 1990.  Returns
+   FALSE if the number is too long or its exponent too large, in which
+   case the caller uses strtod().
+*/
+
+static int
+fast_float(cucharp s, cucharp e, int negative, double *f)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  uint64_t m = 0;
+  int digits = 0;
+  int exp10 = 0;
+  double v;
+
+  for( ; s < e && *s == '0'; s++ )	/* leading zeros */
+    ;
+  for( ; s < e && isDigit(*s); s++, digits++ )
+    m = m*10 + (*s - '0');
+  if ( s < e && *s == '.' )
+  { for(s++; s < e && isDigit(*s); s++, digits++, exp10--)
+    { if ( m == 0 && *s == '0' )
+	digits--;			/* leading zeros of 0.00xyz */
+      else
+	m = m*10 + (*s - '0');
+    }
+  }
+  if ( digits > 19 || m > ((uint64_t)1<<53) )
+    return FALSE;
+  if ( s < e )				/* exponent */
+  { int eneg = FALSE;
+    int ev = 0;
+
+    s++;
+    if ( isSign(*s) )
+      eneg = (*s++ == '-');
+    for( ; s < e; s++ )
+    { if ( ev > 1000 )
+	return FALSE;
+      ev = ev*10 + (*s - '0');
+    }
+    exp10 += eneg ? -ev : ev;
+  }
+
+  v = (double)m;
+  if ( m == 0 || exp10 == 0 )
+    ;
+  else if ( exp10 > 0 && exp10 <= MAX_EXACT_POW10 )
+    v *= exact_pow10[exp10];
+  else if ( exp10 < 0 && exp10 >= -MAX_EXACT_POW10 )
+    v /= exact_pow10[-exp10];
+  else
+    return FALSE;
+
+  *f = negative ? -v : v;
+  return TRUE;
+#else
+  return FALSE;				/* extended precision intermediates */
+#endif
+}
+
+
 strnumstat
 str_number(cucharp in, ucharp *end, Number value, int escape)
 { int negative = FALSE;
   cucharp start = in;
+  cucharp digits;
   strnumstat rc;
   int grouped;
 
@@ -2400,6 +2674,7 @@ str_number(cucharp in, ucharp *end, Number value, int escape)
     }
   }
 
+  digits = in;
   if ( (rc=scan_decimal(&in, negative, value, &grouped)) != NUM_OK )
     return rc;				/* too large? */
   if ( grouped )
@@ -2446,6 +2721,11 @@ str_number(cucharp in, ucharp *end, Number value, int escape)
   if ( value->type == V_FLOAT )
   { char *e;
 
+    if ( fast_float(digits, in, negative, &value->value.f) )
+    { *end = (ucharp)in;
+      return NUM_OK;
+    }
+
     errno = 0;
     value->value.f = strtod((char*)start, &e);
     if ( e != (char*)in && !(*in == '.' && (char*)in+1 == e) )
@@ -190,6 +190,14 @@ unallocRecordList(RecordList rl)
 
 #define dataRecord(r) ((char *)addPointer(r, SIZERECORD(r->flags)))
 
+typedef struct fast_terms
+{ Table	   out_atoms;			/* atom --> index+1 (fast_write/2) */
+  size_t   out_count;			/* # atoms in out_atoms */
+  atom_t  *in_atoms;			/* index --> atom (fast_read/2) */
+  size_t   in_count;			/* # atoms in in_atoms */
+  size_t   in_size;			/* allocated size of in_atoms */
+} fast_terms;
+
 typedef struct
 { tmp_buffer code;			/* code buffer */
   tmp_buffer vars;			/* variable pointers */
@@ -197,6 +205,7 @@ typedef struct
   uint	     nvars;			/* # variables */
   int	     external;			/* Allow for external storage */
   int	     lock;			/* lock compiled atoms */
+  fast_terms *ft;			/* Atom table of a fast term stream */
 } compile_info, *CompileInfo;
 
 #define	PL_TYPE_VARIABLE	(1)	/* variable */
@@ -217,6 +226,13 @@ typedef struct
 #define PL_REC_ALLOCVAR		(15)	/* Allocate a variable on global */
 #define PL_REC_CYCLE		(16)	/* cyclic reference */
 #define PL_REC_MPZ		(17)	/* GMP integer */
+#define PL_TYPE_EXT_ATOM_REF	(18)	/* Atom from the fast term table */
+#define PL_TYPE_EXT_COMPOUND_REF (19)	/* Functor with name from the table */
+#define PL_TYPE_EXT_WCOMPOUND	(20)	/* External (inlined) wide functor */
+
+static size_t	fastAtomIndex(fast_terms *ft, atom_t a);
+static void	addFastOutAtom(fast_terms *ft, atom_t a);
+static void	addFastInAtom(fast_terms *ft, atom_t a);
 
 static inline void
 addUnalignedBuf(TmpBuffer b, void *ptr, size_t bytes)
@@ -358,14 +374,24 @@ addAtom(CompileInfo info, atom_t a)
 { if ( a == ATOM_nil )
   { addOpCode(info, PL_TYPE_NIL);
   } else if ( info->external )
-  { Atom ap = atomValue(a);
+  { Atom ap;
+    size_t i;
+
+    if ( info->ft && (i=fastAtomIndex(info->ft, a)) )
+    { addOpCode(info, PL_TYPE_EXT_ATOM_REF);
+      addSizeInt(info, i-1);
+      return;
+    }
 
+    ap = atomValue(a);
     if ( isUCSAtom(ap) )
       addOpCode(info, PL_TYPE_EXT_WATOM);
     else
       addOpCode(info, PL_TYPE_EXT_ATOM);
 
     addAtomValue(info, ap);
+    if ( info->ft )
+      addFastOutAtom(info->ft, a);
   } else
   { addOpCode(info, PL_TYPE_ATOM);
     addWord(info, a);
@@ -382,10 +408,24 @@ addFunctor(CompileInfo info, functor_t f)
   } else
   { if ( info->external )
     { FunctorDef fd = valueFunctor(f);
+      size_t i;
 
-      addOpCode(info, PL_TYPE_EXT_COMPOUND);
-      addSizeInt(info, fd->arity);
-      addAtomValue(info, atomValue(fd->name));
+      if ( info->ft && (i=fastAtomIndex(info->ft, fd->name)) )
+      { addOpCode(info, PL_TYPE_EXT_COMPOUND_REF);
+	addSizeInt(info, fd->arity);
+	addSizeInt(info, i-1);
+      } else
+      { Atom ap = atomValue(fd->name);
+
+	if ( isUCSAtom(ap) )
+	  addOpCode(info, PL_TYPE_EXT_WCOMPOUND);
+	else
+	  addOpCode(info, PL_TYPE_EXT_COMPOUND);
+	addSizeInt(info, fd->arity);
+	addAtomValue(info, ap);
+	if ( info->ft )
+	  addFastOutAtom(info->ft, fd->name);
+      }
     } else
     { addOpCode(info, PL_TYPE_COMPOUND);
       addWord(info, f);
@@ -627,6 +667,7 @@ compileTermToHeap__LD(term_t t,
   info.nvars = 0;
   info.external = (flags & R_EXTERNAL);
   info.lock = !(info.external || (flags&R_NOLOCK));
+  info.ft = NULL;
 
   initTermAgenda(&agenda, 1, valTermRef(t));
   compile_term_to_heap(&agenda, &info PASS_LD);
@@ -704,6 +745,7 @@ PL_record_external(term_t t, size_t *len)
   initBuffer(&info.code);
   info.external = TRUE;
   info.lock = FALSE;
+  info.ft = NULL;
 
   if ( isInteger(*p) )			/* integer-only record */
   { int64_t v;
@@ -779,6 +821,7 @@ typedef struct
 					/* for se_record() */
   uint		nvars;			/* Variables seen */
   TmpBuffer	avars;			/* Values stored for attvars */
+  fast_terms   *ft;			/* Atom table of a fast term stream */
 } copy_info, *CopyInfo;
 
 
@@ -981,12 +1024,22 @@ copy_record(Word p, CopyInfo b ARG_LD)
       }
       case PL_TYPE_EXT_ATOM:
       { fetchAtom(b, p);
-	PL_unregister_atom(*p);
+	if ( b->ft )
+	  addFastInAtom(b->ft, *p);	/* table keeps the reference */
+	else
+	  PL_unregister_atom(*p);
 	continue;
       }
       case PL_TYPE_EXT_WATOM:
       { fetchAtomW(b, p);
-	PL_unregister_atom(*p);
+	if ( b->ft )
+	  addFastInAtom(b->ft, *p);
+	else
+	  PL_unregister_atom(*p);
+	continue;
+      }
+      case PL_TYPE_EXT_ATOM_REF:
+      { *p = b->ft->in_atoms[fetchSizeInt(b)];
 	continue;
       }
       case PL_TYPE_TAGGED_INTEGER:
@@ -1073,13 +1126,24 @@ copy_record(Word p, CopyInfo b ARG_LD)
 	}
 	continue;
       case PL_TYPE_EXT_COMPOUND:
+      case PL_TYPE_EXT_WCOMPOUND:
       { atom_t name;
 
 	arity = (int)fetchSizeInt(b);
-	fetchAtom(b, &name);
+	if ( tag == PL_TYPE_EXT_COMPOUND )
+	  fetchAtom(b, &name);
+	else
+	  fetchAtomW(b, &name);
+	if ( b->ft )
+	  addFastInAtom(b->ft, name);
 	fdef = lookupFunctorDef(name, arity);
 	goto compound;
       }
+      case PL_TYPE_EXT_COMPOUND_REF:
+      { arity = (int)fetchSizeInt(b);
+	fdef = lookupFunctorDef(b->ft->in_atoms[fetchSizeInt(b)], arity);
+	goto compound;
+      }
     }
       case PL_TYPE_CONS:
       { *p = consPtr(b->gstore, TAG_COMPOUND|STG_GLOBAL);
@@ -1120,6 +1184,7 @@ copyRecordToGlobal(term_t copy, Record r, int flags ARG_LD)
   }
   b.base = b.data = dataRecord(r);
   b.gbase = b.gstore = gTop;
+  b.ft = NULL;
   gTop += r->gsize;
 
   INITCOPYVARS(b, r->nvars);
@@ -1231,6 +1296,7 @@ scanAtomsRecord(CopyInfo b, void (*func)(atom_t a))
 	continue;
       }
       case PL_TYPE_EXT_COMPOUND:
+      case PL_TYPE_EXT_WCOMPOUND:
       { intptr_t arity = fetchSizeInt(b);
 
 	skipAtom(b);
@@ -1325,6 +1391,7 @@ PL_recorded_external(const char *rec, term_t t)
   uchar m;
 
   b.base = b.data = rec;
+  b.ft = NULL;
   fetchBuf(&b, &m, uchar);
 
   if ( !REC_COMPAT(m) )
@@ -1397,6 +1464,513 @@ PL_erase_external(char *rec)
 }
 
 
+		 /*******************************
+		 *	     FAST TERMS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Fast terms are external records that  are   written  to  and read from a
+binary stream by fast_write/2 and fast_read/2. Each term is written as
+
+	<term> ::= FT_MAGIC <flags> <size> <gsize> [<nvars>] <code>
+
+<flags> holds the version, the word size  and REC_GROUND if the term has
+no variables. <size> is the size of <code>  in bytes, <gsize> the number
+of cells the term needs on the global   stack  and <nvars> the number of
+variables, all encoded as in  addUintBuffer().   <code>  is the external
+record code as produced by PL_record_external(),   except that atoms and
+functor names are written only  once  per   stream.  Both the writer and
+the reader number them in the order   in  which they appear in the stream
+and   later   occurrences   use    PL_TYPE_EXT_ATOM_REF   or
+PL_TYPE_EXT_COMPOUND_REF with this number. This  implies that the terms
+of a stream must be read in the  order   in  which they were written. The
+tables live in the stream context (see   streamFastTerms()) and are freed
+if the stream is closed.
+
+fast_read/2 decodes the code directly from   the  stream buffer if it is
+completely inside the buffer. Otherwise it is   first copied. The code is
+checked by validFastTerm() before it is decoded.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FT_MAGIC	0xf7		/* First byte of a fast term */
+#define FT_VERSION	0x01		/* Version id */
+
+#define FT_HDR		(REC_SZ|(FT_VERSION<<REC_VSHIFT))
+#define FT_COMPAT(m)	(((m)&(REC_VMASK|REC_SZMASK)) == FT_HDR)
+
+static void
+freeFastAtomSymbol(Symbol s)
+{ PL_unregister_atom((atom_t)s->name);
+}
+
+
+static fast_terms *
+getFastTerms(IOSTREAM *s)
+{ void **ptr = streamFastTerms(s);
+
+  if ( !*ptr )
+  { fast_terms *ft = allocHeapOrHalt(sizeof(*ft));
+
+    memset(ft, 0, sizeof(*ft));
+    *ptr = ft;
+  }
+
+  return *ptr;
+}
+
+
+void
+freeFastTerms(void *ptr)
+{ fast_terms *ft = ptr;
+  size_t i;
+
+  if ( ft->out_atoms )
+    destroyHTable(ft->out_atoms);
+  for(i=0; i<ft->in_count; i++)
+    PL_unregister_atom(ft->in_atoms[i]);
+  if ( ft->in_atoms )
+    freeHeap(ft->in_atoms, ft->in_size*sizeof(atom_t));
+  freeHeap(ft, sizeof(*ft));
+}
+
+
+static size_t
+fastAtomIndex(fast_terms *ft, atom_t a)
+{ Symbol s;
+
+  if ( ft->out_atoms && (s=lookupHTable(ft->out_atoms, (void*)a)) )
+    return (size_t)s->value;
+
+  return 0;
+}
+
+
+static void
+addFastOutAtom(fast_terms *ft, atom_t a)
+{ if ( !ft->out_atoms )
+  { ft->out_atoms = newHTable(64);
+    ft->out_atoms->free_symbol = freeFastAtomSymbol;
+  }
+
+  PL_register_atom(a);
+  addHTable(ft->out_atoms, (void*)a, (void*)++ft->out_count);
+}
+
+
+static void
+addFastInAtom(fast_terms *ft, atom_t a)
+{ if ( ft->in_count == ft->in_size )
+  { size_t size = (ft->in_size ? ft->in_size*2 : 64);
+    atom_t *atoms = allocHeapOrHalt(size*sizeof(atom_t));
+
+    if ( ft->in_atoms )
+    { memcpy(atoms, ft->in_atoms, ft->in_count*sizeof(atom_t));
+      freeHeap(ft->in_atoms, ft->in_size*sizeof(atom_t));
+    }
+    ft->in_atoms = atoms;
+    ft->in_size  = size;
+  }
+
+  ft->in_atoms[ft->in_count++] = a;
+}
+
+
+/* compileFastTerm() compiles t into info->code and the header into hdr.
+   The caller must discard both buffers.
+*/
+
+static void
+compileFastTerm(term_t t, fast_terms *ft, compile_info *info, tmp_buffer *hdr
+		ARG_LD)
+{ term_agenda agenda;
+  int first = FT_HDR;
+
+  init_cycle(PASS_LD1);
+  initBuffer(&info->code);
+  initBuffer(&info->vars);
+  info->size = 0;
+  info->nvars = 0;
+  info->external = TRUE;
+  info->lock = FALSE;
+  info->ft = ft;
+
+  initTermAgenda(&agenda, 1, valTermRef(t));
+  compile_term_to_heap(&agenda, info PASS_LD);
+  clearTermAgenda(&agenda);
+  if ( info->nvars == 0 )
+    first |= REC_GROUND;
+  restoreVars(info);
+  unvisit(PASS_LD1);
+
+  initBuffer(hdr);
+  addBuffer(hdr, FT_MAGIC, uchar);
+  addBuffer(hdr, first, uchar);
+  addUintBuffer((Buffer)hdr, sizeOfBuffer(&info->code));
+  addUintBuffer((Buffer)hdr, info->size);
+  if ( info->nvars > 0 )
+    addUintBuffer((Buffer)hdr, info->nvars);
+}
+
+
+static int
+getUintStream(IOSTREAM *s, size_t *val)
+{ size_t r = 0;
+  int c;
+
+  do
+  { if ( (c=Sgetc(s)) == EOF )
+      return FALSE;
+    r = (r<<7)|(c&0x7f);
+  } while( (c&0x80) );
+
+  *val = r;
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+validFastTerm() checks the code of a fast term before copy_record() runs
+it. The code comes from a file and  copy_record() trusts its input, so a
+corrupt or misaligned term could make it   write  outside the space that
+was reserved on the global stack or   index  outside the variable and atom
+tables. The code must be exactly scode bytes, must create exactly gsize
+cells, its variables must be below nvars and  its atom references below
+the number of atoms in the  table.   Cycles  must  point at an earlier
+compound. The atom table itself is not modified.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct
+{ const unsigned char *here;		/* current location */
+  const unsigned char *end;		/* end of the code */
+} ft_scan;
+
+static int
+scanFastUint(ft_scan *sc, size_t *val)
+{ size_t r = 0;
+  int c;
+
+  do
+  { if ( sc->here >= sc->end || r > (UINT_MAX>>7) )
+      return FALSE;
+    c = *sc->here++;
+    r = (r<<7)|(c&0x7f);
+  } while( (c&0x80) );
+
+  *val = r;
+  return TRUE;
+}
+
+
+static int
+scanFastBytes(ft_scan *sc, size_t len)
+{ if ( (size_t)(sc->end - sc->here) < len )
+    return FALSE;
+  sc->here += len;
+  return TRUE;
+}
+
+
+static int
+scanFastInt64(ft_scan *sc)
+{ size_t bytes;
+
+  if ( sc->here >= sc->end )
+    return FALSE;
+  bytes = *sc->here++;
+
+  return bytes >= 1 && bytes <= sizeof(int64_t) && scanFastBytes(sc, bytes);
+}
+
+
+static int
+isFastCompound(tmp_buffer *compounds, size_t offset)
+{ size_t *base = baseBuffer(compounds, size_t);
+  size_t lo = 0;
+  size_t hi = entriesBuffer(compounds, size_t);
+
+  while( lo < hi )
+  { size_t m = (lo+hi)/2;
+
+    if ( base[m] == offset )
+      return TRUE;
+    if ( base[m] < offset )
+      lo = m+1;
+    else
+      hi = m;
+  }
+
+  return FALSE;
+}
+
+
+static int
+validFastTerm(const char *data, size_t scode, size_t gsize, size_t nvars,
+	      fast_terms *ft)
+{ ft_scan sc;
+  tmp_buffer compounds;			/* offsets of compounds (for cycles) */
+  size_t natoms = ft->in_count;
+  size_t cells = 0;
+  size_t work = 0;
+  size_t n, arity;
+  int rc = FALSE;
+
+  sc.here = (const unsigned char *)data;
+  sc.end  = sc.here + scode;
+  initBuffer(&compounds);
+
+#define NEED_CELLS(c) \
+	do { if ( gsize - cells < (c) ) goto out; cells += (c); } while(0)
+
+  do
+  { int tag;
+
+    if ( sc.here >= sc.end )
+      goto out;
+
+    switch( (tag = *sc.here++) )
+    { case PL_TYPE_VARIABLE:
+	if ( !scanFastUint(&sc, &n) || n >= nvars )
+	  goto out;
+	continue;
+      case PL_REC_ALLOCVAR:
+	NEED_CELLS(1);
+	work++;
+	continue;
+#ifdef O_ATTVAR
+      case PL_TYPE_ATTVAR:
+	if ( !scanFastUint(&sc, &n) || n >= nvars )
+	  goto out;
+	NEED_CELLS(3);
+	work++;
+	continue;
+#endif
+      case PL_TYPE_NIL:
+	continue;
+      case PL_TYPE_EXT_ATOM:
+	if ( !scanFastUint(&sc, &n) || !scanFastBytes(&sc, n) )
+	  goto out;
+	natoms++;
+	continue;
+      case PL_TYPE_EXT_WATOM:
+	if ( !scanFastUint(&sc, &n) || n%sizeof(pl_wchar_t) != 0 ||
+	     !scanFastBytes(&sc, n) )
+	  goto out;
+	natoms++;
+	continue;
+      case PL_TYPE_EXT_ATOM_REF:
+	if ( !scanFastUint(&sc, &n) || n >= natoms )
+	  goto out;
+	continue;
+      case PL_TYPE_TAGGED_INTEGER:
+	if ( !scanFastInt64(&sc) )
+	  goto out;
+	continue;
+      case PL_TYPE_INTEGER:
+	if ( !scanFastInt64(&sc) )
+	  goto out;
+	NEED_CELLS(WORDS_PER_PLINT+2);
+	continue;
+#ifdef O_GMP
+      case PL_REC_MPZ:
+      { int64_t size;			/* see loadMPZFromCharp() */
+	size_t limpsize, wsize;
+
+	if ( (size_t)(sc.end - sc.here) < 4 )
+	  goto out;
+	size = (int32_t)(((uint32_t)sc.here[0]<<24) |
+			 ((uint32_t)sc.here[1]<<16) |
+			 ((uint32_t)sc.here[2]<<8) |
+			 (uint32_t)sc.here[3]);
+	sc.here += 4;
+	if ( size < 0 )
+	  size = -size;
+	if ( !scanFastBytes(&sc, (size_t)size) )
+	  goto out;
+	limpsize = (size+sizeof(mp_limb_t)-1)/sizeof(mp_limb_t);
+	wsize = (limpsize*sizeof(mp_limb_t)+sizeof(word)-1)/sizeof(word);
+	NEED_CELLS(wsize+3);
+	continue;
+      }
+#endif
+      case PL_TYPE_EXT_FLOAT:
+	if ( !scanFastBytes(&sc, sizeof(double)) )
+	  goto out;
+	NEED_CELLS(WORDS_PER_DOUBLE+2);
+	continue;
+      case PL_TYPE_STRING:
+	if ( !scanFastUint(&sc, &n) || !scanFastBytes(&sc, n) )
+	  goto out;
+	NEED_CELLS((n+sizeof(word))/sizeof(word) + 2);
+	continue;
+#ifdef O_CYCLIC
+      case PL_REC_CYCLE:
+	if ( !scanFastUint(&sc, &n) || !isFastCompound(&compounds, n) )
+	  goto out;
+	continue;
+#endif
+      case PL_TYPE_EXT_COMPOUND:
+      case PL_TYPE_EXT_WCOMPOUND:
+	if ( !scanFastUint(&sc, &arity) ||
+	     !scanFastUint(&sc, &n) ||
+	     (tag == PL_TYPE_EXT_WCOMPOUND && n%sizeof(pl_wchar_t) != 0) ||
+	     !scanFastBytes(&sc, n) )
+	  goto out;
+	natoms++;
+	goto compound;
+      case PL_TYPE_EXT_COMPOUND_REF:
+	if ( !scanFastUint(&sc, &arity) ||
+	     !scanFastUint(&sc, &n) || n >= natoms )
+	  goto out;
+      compound:
+	if ( arity > INT_MAX )
+	  goto out;
+	addBuffer(&compounds, cells, size_t);
+	NEED_CELLS(arity+1);
+	work += arity;
+	continue;
+      case PL_TYPE_CONS:
+	addBuffer(&compounds, cells, size_t);
+	NEED_CELLS(3);
+	work += 2;
+	continue;
+      default:
+	goto out;
+    }
+  } while ( work-- );
+
+#undef NEED_CELLS
+
+  rc = ( sc.here == sc.end && cells == gsize );
+
+out:
+  discardBuffer(&compounds);
+  return rc;
+}
+
+
+static void
+skipFastTerm(IOSTREAM *s, size_t scode)
+{ s->bufp += scode;
+  if ( s->position )
+  { s->position->byteno += scode;
+    s->position->charno += scode;
+  }
+}
+
+
+static int
+fastReadTerm(IOSTREAM *s, term_t t ARG_LD)
+{ copy_info b;
+  tmp_buffer buf;
+  size_t scode, gsize, nvars = 0;
+  const char *data;
+  int direct;
+  term_t copy;
+  int c, m, rc;
+
+  if ( (c=Sgetc(s)) == EOF )
+    return Sferror(s) ? FALSE : PL_unify_atom(t, ATOM_end_of_file);
+  if ( c != FT_MAGIC || (m=Sgetc(s)) == EOF || !FT_COMPAT(m) ||
+       !getUintStream(s, &scode) || !getUintStream(s, &gsize) ||
+       (!(m&REC_GROUND) && !getUintStream(s, &nvars)) )
+    return Sferror(s) ? FALSE : PL_syntax_error("illegal_fast_term", s);
+
+  initBuffer(&buf);
+  if ( (size_t)(s->limitp - s->bufp) >= scode )
+  { data = s->bufp;
+    direct = TRUE;
+  } else
+  { while( (size_t)sizeOfBuffer(&buf) < scode )
+    { size_t chunk = scode - sizeOfBuffer(&buf);
+					/* scode is not trusted: grow as */
+      if ( chunk > 4096 )		/* the data actually arrives */
+	chunk = 4096;
+      if ( !growBuffer((Buffer)&buf, chunk) )
+	outOfCore();
+      if ( Sfread(topBuffer(&buf, char), 1, chunk, s) != chunk )
+      { discardBuffer(&buf);
+	return Sferror(s) ? FALSE : PL_syntax_error("illegal_fast_term", s);
+      }
+      buf.top += chunk;
+    }
+    data = baseBuffer(&buf, char);
+    direct = FALSE;
+  }
+
+  if ( nvars > scode ||
+       !validFastTerm(data, scode, gsize, nvars, getFastTerms(s)) )
+  { if ( direct )
+      skipFastTerm(s, scode);
+    discardBuffer(&buf);
+    return PL_syntax_error("illegal_fast_term", s);
+  }
+
+  if ( !(copy = PL_new_term_ref()) )
+  { discardBuffer(&buf);
+    return FALSE;
+  }
+  if ( !hasGlobalSpace(gsize) &&
+       (rc=ensureGlobalSpace(gsize, ALLOW_GC)) != TRUE )
+  { discardBuffer(&buf);
+    return raiseStackOverflow(rc);
+  }
+
+  b.base = b.data = data;
+  b.gbase = b.gstore = gTop;
+  b.ft = getFastTerms(s);
+  gTop += gsize;
+
+  INITCOPYVARS(b, nvars);
+  rc = copy_record(valTermRef(copy), &b PASS_LD);
+  FREECOPYVARS(b, nvars);
+
+  if ( direct )
+    skipFastTerm(s, scode);
+  discardBuffer(&buf);
+
+  if ( rc != TRUE )
+    return raiseStackOverflow(rc);
+  assert(b.gstore == gTop);
+
+  return PL_unify(t, copy);
+}
+
+
+static
+PRED_IMPL("$fast_write", 2, fast_write, 0)
+{ PRED_LD
+  IOSTREAM *s;
+  compile_info info;
+  tmp_buffer hdr;
+
+  if ( !getBinaryOutputStream(A1, &s) )
+    return FALSE;
+
+  compileFastTerm(A2, getFastTerms(s), &info, &hdr PASS_LD);
+  Sfwrite(baseBuffer(&hdr, char), 1, sizeOfBuffer(&hdr), s);
+  Sfwrite(baseBuffer(&info.code, char), 1, sizeOfBuffer(&info.code), s);
+  discardBuffer(&hdr);
+  discardBuffer(&info.code);
+
+  return streamStatus(s);
+}
+
+
+static
+PRED_IMPL("$fast_read", 2, fast_read, 0)
+{ PRED_LD
+  IOSTREAM *s;
+  int rc;
+
+  if ( !getBinaryInputStream(A1, &s) )
+    return FALSE;
+
+  rc = fastReadTerm(s, A2 PASS_LD);
+
+  return streamStatus(s) && rc;
+}
+
+
 		/********************************
 		*       PROLOG CONNECTION       *
 		*********************************/
@@ -1818,4 +2392,6 @@ BeginPredDefs(rec)
   PRED_DEF("erase", 1, erase, 0)
   PRED_DEF("instance", 2, instance, 0)
   PRED_DEF("current_key", 1, current_key, PL_FA_NONDETERMINISTIC)
+  PRED_DEF("$fast_write", 2, fast_write, 0)
+  PRED_DEF("$fast_read", 2, fast_read, 0)
 EndPredDefs
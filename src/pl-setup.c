@@ -27,6 +27,7 @@
 #include "pl-incl.h"
 #include "os/pl-cstack.h"
 #include "pl-dbref.h"
+#include "pl-tabling.h"
 #include <sys/stat.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -1197,6 +1198,8 @@ emptyStacks(void)
   emptyStack((Stack)&LD->stacks.argument);
 
   LD->mark_bar          = gTop;
+  LD->gen_bar           = NULL;
+  clearSegStack(&LD->gc.pending);
   if ( lTop && gTop )
   { int i;
 
@@ -1299,6 +1302,7 @@ freeStacks(ARG1_LD)
 		 stack_free(gBase); gBase = NULL; lBase = NULL; }
   if ( tBase ) { stack_free(tBase); tBase = NULL; }
   if ( aBase ) { stack_free(aBase); aBase = NULL; }
+  clearSegStack(&LD->gc.pending);
 }
 
 
@@ -1508,6 +1512,7 @@ freePrologLocalData(PL_local_data_t *ld)
   }
 
   freeVarDefs(ld);
+  clearThreadTablingData(ld);
 
 #ifdef O_GVAR
   if ( ld->gvar.nb_vars )
@@ -1583,7 +1588,8 @@ PRED_IMPL("$set_prolog_stack", 4, set_prolog_stack, 0)
 	   PL_get_size_ex(value, &newlimit) )
       { if ( newlimit < (size_t)sizeStackP(stack)+stack->min_free )
 	{ if ( stack->gc )
-	  { garbageCollect();
+	  { LD->gc.reason = PL_GC_SPACE;
+	    garbageCollect();
 	    trimStacks(TRUE PASS_LD);
 	  }
 
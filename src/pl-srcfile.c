@@ -23,6 +23,7 @@
 /*#define O_DEBUG 1*/
 #include "pl-incl.h"
 #include "pl-dbref.h"
+#include "pl-facts.h"
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Source administration. The core object is  SourceFile, which keeps track
@@ -571,6 +572,12 @@ unloadFile(SourceFile sf)
   delayEvents();
 
   LOCKSRCFILE(sf);
+  for(cell = sf->procedures; cell; cell = cell->next)
+  { Definition def = ((Procedure)cell->value)->definition;
+
+    if ( true(def, P_LAZY) )		/* cannot load with L_PREDICATE */
+      loadLazyDefinition(def);
+  }
   PL_LOCK(L_PREDICATE);
   PL_LOCK(L_THREAD);
   PL_LOCK(L_STOPTHEWORLD);
@@ -600,7 +607,10 @@ unloadFile(SourceFile sf)
 				       true(def, P_MULTIFILE) ? sf->index : 0,
 				       TRUE);
     } else
+    { if ( true(def, P_FACTS) && false(def, P_MULTIFILE) )
+	removeFactsDefinition(def);	/* rows do not record their file */
       deleted = 0;
+    }
 
     DEBUG(MSG_UNLOAD,
 	  if ( false(def, P_MULTIFILE) && def->impl.clauses.number_of_clauses )
@@ -822,7 +832,11 @@ PRED_IMPL("$clause_from_source", 4, clause_from_source, 0)
     Definition def = proc->definition;
 
     if ( def && false(def, P_FOREIGN) )
-    { ClauseRef cref = def->impl.clauses.first_clause;
+    { ClauseRef cref;
+
+      if ( true(def, P_LAZY) )
+	loadLazyDefinition(def);
+      cref = def->impl.clauses.first_clause;
 
       for( ; cref; cref = cref->next )
       { Clause cl = cref->value.clause;
@@ -0,0 +1,527 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*#define O_DEBUG 1*/
+#include "pl-incl.h"
+#include "pl-trie.h"
+#include "pl-tabling.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Tabling support.  This module provides the answer tables that are used
+by boot/tabling.pl to implement the table/1 directive.  Tables are local
+to a thread.
+
+Each variant of a tabled call has a table holding its answers as a trie
+and as a list in the order in which they were found.  The evaluation is
+based on linear tabling: rather than suspending a call to a table that
+is being evaluated (a consumer), the consumer proceeds with the answers
+found so far and the evaluation of the table iterates until no more new
+answers are found.
+
+Completion is detected per strongly connected component (SCC).  Each
+evaluated table gets a depth-first number (dfn) when it is pushed on
+LD->tabling.stack.  `low` is the lowest dfn of any incomplete table
+consumed while evaluating the table.  If, after reaching the fixpoint,
+low == dfn, the table is the leader of its SCC and the leader as well as
+all tables evaluated on its behalf are complete.  Otherwise the table
+becomes incomplete and its low is propagated to its caller.  Incomplete
+tables are evaluated again when called after new answers have been
+added, which replaces the resumption of suspended consumers.
+
+The Prolog interface is
+
+  - '$tbl_variant_table'(+Variant, -Table, -Status)
+    Find or create the table for Variant.  Status is one of `complete`,
+    `consume` (use the answers sofar) or `evaluate`.  If `evaluate`, the
+    table has been pushed and the caller must run the fixpoint using
+    '$tbl_add_answer'/2 and '$tbl_fixpoint'/2 or '$tbl_abandon'/1.
+  - '$tbl_answer'(+Table, ?Answer)
+    Enumerate the answers of Table, including answers that are added
+    while enumerating.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum tbl_status
+{ TBL_FRESH = 0,			/* Never evaluated */
+  TBL_ACTIVE,				/* On the evaluation stack */
+  TBL_INCOMPLETE,			/* Evaluated, but SCC is open */
+  TBL_COMPLETE				/* All answers are known */
+} tbl_status;
+
+typedef struct tbl_table
+{ atom_t	symbol;			/* Blob handle */
+  tbl_status	status;			/* Evaluation status */
+  trie	       *answers;		/* Variant answer trie */
+  trie_node   **answer_list;		/* Answers in order */
+  size_t	answer_count;		/* # answers */
+  size_t	answer_size;		/* Allocated size of answer_list */
+  size_t	dfn;			/* Evaluation order number */
+  size_t	low;			/* Lowest dfn of consumed tables */
+  int64_t	eval_answers;		/* new_answers after last evaluation */
+  unsigned int	consumed : 1;		/* Consumed an incomplete table */
+  unsigned int	in_incomplete : 1;	/* Member of LD->tabling.incomplete */
+  struct tbl_table *next_active;	/* Next in LD->tabling.stack */
+  struct tbl_table *next_incomplete;	/* Next in LD->tabling.incomplete */
+} tbl_table;
+
+
+		 /*******************************
+		 *	     TABLE BLOB		*
+		 *******************************/
+
+static int
+write_table(IOSTREAM *s, atom_t symbol, int flags)
+{ tbl_table **tp = PL_blob_data(symbol, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<table>(%p)", *tp);
+  return TRUE;
+}
+
+
+static void
+acquire_table(atom_t symbol)
+{ tbl_table **tp = PL_blob_data(symbol, NULL, NULL);
+
+  (*tp)->symbol = symbol;
+}
+
+
+static int
+release_table(atom_t symbol)
+{ tbl_table **tp = PL_blob_data(symbol, NULL, NULL);
+  tbl_table *t = *tp;
+
+  trie_destroy(t->answers);
+  if ( t->answer_list )
+    freeHeap(t->answer_list, t->answer_size*sizeof(trie_node*));
+  freeHeap(t, sizeof(*t));
+
+  return TRUE;
+}
+
+
+static PL_blob_t table_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "table",
+  release_table,
+  NULL,
+  write_table,
+  acquire_table
+};
+
+
+static tbl_table *
+new_table(void)
+{ tbl_table *t = allocHeapOrHalt(sizeof(*t));
+  int new;
+
+  memset(t, 0, sizeof(*t));
+  t->answers = trie_create();
+  lookupBlob((const char *)&t, sizeof(t), &table_blob, &new);
+
+  return t;
+}
+
+
+static int
+get_table(term_t t, tbl_table **tp)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &table_blob )
+  { *tp = *(tbl_table**)data;
+    return TRUE;
+  }
+
+  *tp = NULL;
+  return PL_type_error("table", t);
+}
+
+
+static void
+release_variant_value(trie *vt, void *value)
+{ tbl_table *t = value;
+  (void)vt;
+
+  PL_unregister_atom(t->symbol);
+}
+
+
+static void
+reset_table(tbl_table *t)
+{ trie_empty(t->answers);
+  t->answer_count = 0;
+  t->status       = TBL_FRESH;
+  t->consumed     = FALSE;
+}
+
+
+static int
+add_answer(tbl_table *t, trie_node *node ARG_LD)
+{ if ( t->answer_count == t->answer_size )
+  { size_t size = t->answer_size ? t->answer_size*2 : 16;
+    trie_node **list = allocHeapOrHalt(size*sizeof(trie_node*));
+
+    if ( t->answer_list )
+    { memcpy(list, t->answer_list, t->answer_count*sizeof(trie_node*));
+      freeHeap(t->answer_list, t->answer_size*sizeof(trie_node*));
+    }
+    t->answer_list = list;
+    t->answer_size = size;
+  }
+
+  t->answer_list[t->answer_count++] = node;
+  LD->tabling.new_answers++;
+
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	     SCC HANDLING	*
+		 *******************************/
+
+static void
+push_table(tbl_table *t ARG_LD)
+{ t->status      = TBL_ACTIVE;
+  t->dfn	 = t->low = ++LD->tabling.dfn;
+  t->consumed    = FALSE;
+  t->next_active = LD->tabling.stack;
+  LD->tabling.stack = t;
+}
+
+
+static void
+consume_table(size_t low ARG_LD)
+{ tbl_table *top;
+
+  if ( (top=LD->tabling.stack) )
+  { top->consumed = TRUE;
+    if ( low < top->low )
+      top->low = low;
+  }
+}
+
+
+static void
+unlink_incomplete(tbl_table *t ARG_LD)
+{ tbl_table **tp;
+
+  for(tp = &LD->tabling.incomplete; *tp; tp = &(*tp)->next_incomplete)
+  { if ( *tp == t )
+    { *tp = t->next_incomplete;
+      t->next_incomplete = NULL;
+      t->in_incomplete = FALSE;
+      return;
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Finish the evaluation of the table on top of the stack.  If it is the
+leader of its SCC, all incomplete tables evaluated after it are part of
+the SCC and thus complete.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+pop_table(tbl_table *t ARG_LD)
+{ assert(LD->tabling.stack == t);
+  LD->tabling.stack = t->next_active;
+  t->next_active = NULL;
+
+  if ( t->low == t->dfn )
+  { tbl_table **tp = &LD->tabling.incomplete;
+
+    while( *tp )
+    { tbl_table *m = *tp;
+
+      if ( m == t || m->dfn >= t->dfn )
+      { *tp = m->next_incomplete;
+	m->next_incomplete = NULL;
+	m->in_incomplete = FALSE;
+	m->status = TBL_COMPLETE;
+      } else
+      { tp = &m->next_incomplete;
+      }
+    }
+    t->status = TBL_COMPLETE;
+  } else
+  { t->status = TBL_INCOMPLETE;
+    t->eval_answers = LD->tabling.new_answers;
+    if ( !t->in_incomplete )
+    { t->next_incomplete = LD->tabling.incomplete;
+      LD->tabling.incomplete = t;
+      t->in_incomplete = TRUE;
+    }
+    consume_table(t->low PASS_LD);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Called if the evaluation of `t` raised an exception.  The tables
+evaluated on behalf of `t` are reset, such that they are evaluated again
+when called.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+abandon_table(tbl_table *t ARG_LD)
+{ tbl_table **tp;
+
+  while( LD->tabling.stack && LD->tabling.stack->dfn >= t->dfn )
+  { tbl_table *a = LD->tabling.stack;
+
+    LD->tabling.stack = a->next_active;
+    a->next_active = NULL;
+    if ( a->in_incomplete )
+      unlink_incomplete(a PASS_LD);
+    reset_table(a);
+  }
+
+  tp = &LD->tabling.incomplete;
+  while( *tp )
+  { tbl_table *m = *tp;
+
+    if ( m->dfn >= t->dfn )
+    { *tp = m->next_incomplete;
+      m->next_incomplete = NULL;
+      m->in_incomplete = FALSE;
+      reset_table(m);
+    } else
+    { tp = &m->next_incomplete;
+    }
+  }
+}
+
+
+void
+clearThreadTablingData(PL_local_data_t *ld)
+{ trie *vt;
+
+  ld->tabling.stack = NULL;
+  ld->tabling.incomplete = NULL;
+  if ( (vt=ld->tabling.variant_table) )
+  { ld->tabling.variant_table = NULL;
+    trie_destroy(vt);
+  }
+}
+
+
+		 /*******************************
+		 *	  PROLOG BINDING	*
+		 *******************************/
+
+static
+PRED_IMPL("$tbl_variant_table", 3, tbl_variant_table, 0)
+{ PRED_LD
+  trie *vt;
+  trie_node *node;
+  tbl_table *t;
+  atom_t status;
+  int rc;
+
+  if ( !PL_is_acyclic(A1) )
+    return trie_error(TRIE_E_CYCLIC, A1);
+
+  if ( !(vt=LD->tabling.variant_table) )
+  { vt = LD->tabling.variant_table = trie_create();
+    vt->release_value = release_variant_value;
+  }
+
+  if ( (rc=trie_lookup(vt, &node, valTermRef(A1), TRUE PASS_LD)) != TRUE )
+    return trie_error(rc, A1);
+
+  if ( !(t=node->value) )
+  { t = new_table();
+    node->value = t;
+    vt->value_count++;
+  }
+
+  switch(t->status)
+  { case TBL_COMPLETE:
+      status = ATOM_complete;
+      break;
+    case TBL_ACTIVE:
+      consume_table(t->dfn PASS_LD);
+      status = ATOM_consume;
+      break;
+    case TBL_INCOMPLETE:
+      if ( t->eval_answers == LD->tabling.new_answers )
+      { consume_table(t->low PASS_LD);
+	status = ATOM_consume;
+	break;
+      }
+      /*FALLTHROUGH*/
+    case TBL_FRESH:
+    default:
+      push_table(t PASS_LD);
+      status = ATOM_evaluate;
+  }
+
+  return ( PL_unify_atom(A2, t->symbol) &&
+	   PL_unify_atom(A3, status) );
+}
+
+
+static
+PRED_IMPL("$tbl_add_answer", 2, tbl_add_answer, 0)
+{ PRED_LD
+  tbl_table *t;
+  trie_node *node;
+  int rc;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+  if ( !PL_is_acyclic(A2) )
+    return trie_error(TRIE_E_CYCLIC, A2);
+
+  if ( (rc=trie_lookup(t->answers, &node, valTermRef(A2), TRUE PASS_LD)) != TRUE )
+    return trie_error(rc, A2);
+
+  if ( !node->value )
+  { node->value = (void*)t;
+    t->answers->value_count++;
+    return add_answer(t, node PASS_LD);
+  }
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$tbl_answer", 2, tbl_answer, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  tbl_table *t;
+  size_t i;
+  fid_t fid;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+      i = 0;
+      break;
+    case FRG_REDO:
+      i = CTX_INT;
+      break;
+    case FRG_CUTTED:
+    default:
+      return TRUE;
+  }
+
+  if ( !get_table(A1, &t) ||
+       !(fid = PL_open_foreign_frame()) )
+    return FALSE;
+
+  for(; i < t->answer_count; i++)
+  { if ( unify_trie_term(t->answer_list[i], A2 PASS_LD) )
+    { PL_close_foreign_frame(fid);
+      if ( i+1 == t->answer_count && t->status == TBL_COMPLETE )
+	return TRUE;
+      ForeignRedoInt(i+1);
+    }
+    if ( PL_exception(0) )
+      break;
+    PL_rewind_foreign_frame(fid);
+  }
+
+  PL_close_foreign_frame(fid);
+  return FALSE;
+}
+
+
+static
+PRED_IMPL("$tbl_new_answers", 1, tbl_new_answers, 0)
+{ PRED_LD
+
+  return PL_unify_int64(A1, LD->tabling.new_answers);
+}
+
+
+/** '$tbl_fixpoint'(+Table, +NewAnswers0) is semidet.
+ *
+ * True if the evaluation of Table has reached its fixpoint.  This is
+ * the case if no incomplete table was consumed or no answers were
+ * added since NewAnswers0.  If true, the table is popped.
+ */
+
+static
+PRED_IMPL("$tbl_fixpoint", 2, tbl_fixpoint, 0)
+{ PRED_LD
+  tbl_table *t;
+  int64_t count;
+
+  if ( !get_table(A1, &t) ||
+       !PL_get_int64_ex(A2, &count) )
+    return FALSE;
+
+  if ( t->consumed && count != LD->tabling.new_answers )
+    return FALSE;
+
+  pop_table(t PASS_LD);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("$tbl_abandon", 1, tbl_abandon, 0)
+{ PRED_LD
+  tbl_table *t;
+
+  if ( !get_table(A1, &t) )
+    return FALSE;
+
+  abandon_table(t PASS_LD);
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("abolish_all_tables", 0, abolish_all_tables, 0)
+{ PRED_LD
+
+  if ( LD->tabling.stack || LD->tabling.incomplete )
+  { term_t ex;
+
+    return ( (ex=PL_new_term_ref()) &&
+	     PL_put_atom(ex, ATOM_all) &&
+	     PL_error(NULL, 0, "tables are being evaluated",
+		      ERR_PERMISSION, ATOM_abolish, ATOM_table, ex) );
+  }
+
+  clearThreadTablingData(LD);
+  return TRUE;
+}
+
+
+		 /*******************************
+		 *	      REGISTER		*
+		 *******************************/
+
+BeginPredDefs(tabling)
+  PRED_DEF("$tbl_variant_table", 3, tbl_variant_table, 0)
+  PRED_DEF("$tbl_add_answer",    2, tbl_add_answer,    0)
+  PRED_DEF("$tbl_answer",	 2, tbl_answer,	       PL_FA_NONDETERMINISTIC)
+  PRED_DEF("$tbl_new_answers",   1, tbl_new_answers,   0)
+  PRED_DEF("$tbl_fixpoint",	 2, tbl_fixpoint,      0)
+  PRED_DEF("$tbl_abandon",	 1, tbl_abandon,       0)
+  PRED_DEF("abolish_all_tables", 0, abolish_all_tables, 0)
+EndPredDefs
@@ -404,6 +404,9 @@ static void	set_system_thread_id(PL_thread_info_t *info);
 static int	unify_queue(term_t t, message_queue *q);
 static int	get_message_queue_unlocked__LD(term_t t, message_queue **queue ARG_LD);
 static int	get_message_queue__LD(term_t t, message_queue **queue ARG_LD);
+static int	get_message_queue_pinned__LD(term_t t, message_queue **queue ARG_LD);
+static int	lock_pinned_message_queue(message_queue *queue);
+static void	unpin_message_queue(message_queue *queue);
 static void	release_message_queue(message_queue *queue);
 static void	initMessageQueues(void);
 static pl_mutex *mutexCreate(atom_t name);
@@ -2408,6 +2411,7 @@ typedef enum
 #define MSG_WAIT_INTR		(-1)
 #define MSG_WAIT_TIMEOUT	(-2)
 #define MSG_WAIT_DESTROYED	(-3)
+#define MSG_RING_EMPTY		(-4)
 
 static int dispatch_cond_wait(message_queue *queue,
 			      queue_wait_type wait,
@@ -2611,6 +2615,239 @@ free_thread_message(thread_message *msg)
 }
 
 
+static void
+lock_message_queue(message_queue *queue)
+{ if ( !simpleMutexTryLock(&queue->mutex) )
+  { ATOMIC_INC(&queue->contention);
+    simpleMutexLock(&queue->mutex);
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+append_message() adds msgp to the tail of  the list and signal_waiters()
+wakes up threads waiting in get_message().   Both  require the caller to
+hold the queue-mutex.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+append_message(message_queue *queue, thread_message *msgp)
+{ msgp->next = NULL;
+  msgp->sequence_id = ++queue->sequence_next;
+  if ( !queue->head )
+  { queue->head = queue->tail = msgp;
+  } else
+  { queue->tail->next = msgp;
+    queue->tail = msgp;
+  }
+  queue->size++;
+}
+
+
+static void
+signal_waiters(message_queue *queue)
+{ if ( queue->waiting )
+  { if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
+    { DEBUG(MSG_THREAD,
+	    Sdprintf("%d of %d non-var waiters; broadcasting\n",
+		     queue->waiting - queue->waiting_var,
+		     queue->waiting));
+      cv_broadcast(&queue->cond_var);
+    } else
+    { DEBUG(MSG_THREAD, Sdprintf("%d var waiters; signalling\n", queue->waiting));
+      cv_signal(&queue->cond_var);
+    }
+  } else
+  { DEBUG(MSG_THREAD, Sdprintf("No waiters\n"));
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Lock-free fast path. Unbounded queues have a ring of MSG_RING_SIZE slots
+that producers and consumers access without   holding the queue mutex.
+This is the bounded MPMC queue of Dmitry   Vyukov: the slot for position
+P is free for writing if its sequence  is   P  and holds a message if its
+sequence is P+1. The ring only handles the common cases:
+
+  - thread_send_message/2 pushes into the ring if the list is empty.
+    Otherwise, or if the ring is full, it uses queue_message().
+  - thread_get_message/1,2,3 with an unbound message pops from the
+    ring if the list is empty.  Selective receive uses get_message().
+  - Code that holds the queue mutex first moves the ring to the tail
+    of the list using drain_ring().  As a sender only uses the ring if
+    the list is empty, messages from one sender stay in order.
+
+A sender that pushed into the ring must  wake up waiting readers. These
+increment queue->waiting under the mutex and   check the ring before they
+wait, while the sender checks  queue->waiting   after  the push. Both are
+separated by a memory barrier, so at least one of them sees the other.
+
+A popped message remains in its slot until  it has been copied to the
+stack, such that markAtomsMessageQueue() marks its atoms. The popper sees
+queue->agc_scanning after clearing the  slot   and  then  waits for the
+scan to complete before it frees the message.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+ring_push(message_queue *queue, thread_message *msgp)
+{ message_slot *ring = queue->ring;
+  size_t pos = queue->enqueue_pos;
+
+  for(;;)
+  { message_slot *slot = &ring[pos & (MSG_RING_SIZE-1)];
+    intptr_t dif = (intptr_t)slot->sequence - (intptr_t)pos;
+
+    if ( dif == 0 )
+    { if ( COMPARE_AND_SWAP(&queue->enqueue_pos, pos, pos+1) )
+      { slot->message = msgp;
+	MemoryBarrier();
+	slot->sequence = pos+1;
+	return TRUE;
+      }
+      ATOMIC_INC(&queue->contention);
+    } else if ( dif < 0 )
+    { return FALSE;			/* full */
+    }
+
+    pos = queue->enqueue_pos;
+  }
+}
+
+
+static message_slot *
+ring_claim(message_queue *queue, size_t *posp)
+{ message_slot *ring = queue->ring;
+  size_t pos = queue->dequeue_pos;
+
+  for(;;)
+  { message_slot *slot = &ring[pos & (MSG_RING_SIZE-1)];
+    intptr_t dif = (intptr_t)slot->sequence - (intptr_t)(pos+1);
+
+    if ( dif == 0 )
+    { if ( COMPARE_AND_SWAP(&queue->dequeue_pos, pos, pos+1) )
+      { *posp = pos;
+	return slot;
+      }
+      ATOMIC_INC(&queue->contention);
+    } else if ( dif < 0 )
+    { return NULL;			/* empty */
+    }
+
+    pos = queue->dequeue_pos;
+  }
+}
+
+
+static void
+ring_release(message_slot *slot, size_t pos)
+{ MemoryBarrier();
+  slot->sequence = pos+MSG_RING_SIZE;
+}
+
+
+static int
+ring_is_empty(message_queue *queue)
+{ size_t pos = queue->dequeue_pos;
+
+  return queue->ring[pos & (MSG_RING_SIZE-1)].sequence != pos+1;
+}
+
+
+static long
+ring_size(message_queue *queue)
+{ return queue->ring ? (long)(queue->enqueue_pos - queue->dequeue_pos) : 0;
+}
+
+
+/* drain_ring() moves all messages from the ring to the list.  The caller
+   must hold the queue-mutex.
+*/
+
+static void
+drain_ring(message_queue *queue)
+{ message_slot *slot;
+  size_t pos;
+
+  if ( !queue->ring || ring_is_empty(queue) )
+    return;
+
+  simpleMutexLock(&queue->gc_mutex);
+  while( (slot=ring_claim(queue, &pos)) )
+  { append_message(queue, slot->message);
+    slot->message = NULL;
+    ring_release(slot, pos);
+  }
+  simpleMutexUnlock(&queue->gc_mutex);
+}
+
+
+static int
+send_message_fast(message_queue *queue, thread_message *msgp)
+{ if ( !queue->ring || queue->head || !ring_push(queue, msgp) )
+    return FALSE;
+
+  MemoryBarrier();
+  if ( queue->waiting )
+  { lock_message_queue(queue);
+    signal_waiters(queue);
+    simpleMutexUnlock(&queue->mutex);
+  }
+
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+get_message_fast() pops the oldest message into  the unbound term msg. It
+returns MSG_RING_EMPTY if the caller must use get_message(). If there is
+no space to copy the message, it is moved to the list.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+get_message_fast(message_queue *queue, term_t msg ARG_LD)
+{ message_slot *slot;
+  thread_message *msgp;
+  size_t pos;
+  term_t tmp;
+
+  if ( !queue->ring || queue->head || !(slot=ring_claim(queue, &pos)) )
+    return MSG_RING_EMPTY;
+
+  msgp = slot->message;
+  if ( !(tmp = PL_new_term_ref()) ||
+       !PL_recorded(msgp->message, tmp) ||
+       !PL_unify(msg, tmp) )
+  { simpleMutexLock(&queue->mutex);
+    simpleMutexLock(&queue->gc_mutex);
+    append_message(queue, msgp);
+    slot->message = NULL;
+    ring_release(slot, pos);
+    simpleMutexUnlock(&queue->gc_mutex);
+    signal_waiters(queue);
+    simpleMutexUnlock(&queue->mutex);
+
+    if ( exception_term )
+      return FALSE;
+    return raiseStackOverflow(GLOBAL_OVERFLOW);
+  }
+
+  slot->message = NULL;
+  MemoryBarrier();
+  if ( queue->agc_scanning )		/* wait for markAtomsMessageQueue() */
+  { simpleMutexLock(&queue->gc_mutex);
+    simpleMutexUnlock(&queue->gc_mutex);
+  }
+  ring_release(slot, pos);
+
+  if ( GD->atoms.gc_active )
+    markAtomsRecord(msgp->message);
+  free_thread_message(msgp);
+
+  return TRUE;
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 queue_message() adds a message to a message queue.  The caller must hold
 the queue-mutex.
@@ -2649,29 +2886,9 @@ queue_message(message_queue *queue, thread_message *msgp, struct timespec *deadl
     queue->wait_for_drain--;
   }
 
-  msgp->sequence_id = ++queue->sequence_next;
-  if ( !queue->head )
-  { queue->head = queue->tail = msgp;
-  } else
-  { queue->tail->next = msgp;
-    queue->tail = msgp;
-  }
-  queue->size++;
-
-  if ( queue->waiting )
-  { if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
-    { DEBUG(MSG_THREAD,
-	    Sdprintf("%d of %d non-var waiters; broadcasting\n",
-		     queue->waiting - queue->waiting_var,
-		     queue->waiting));
-      cv_broadcast(&queue->cond_var);
-    } else
-    { DEBUG(MSG_THREAD, Sdprintf("%d var waiters; signalling\n", queue->waiting));
-      cv_signal(&queue->cond_var);
-    }
-  } else
-  { DEBUG(MSG_THREAD, Sdprintf("No waiters\n"));
-  }
+  drain_ring(queue);			/* keep messages in order */
+  append_message(queue, msgp);
+  signal_waiters(queue);
 
   return TRUE;
 }
@@ -2867,6 +3084,9 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
     if ( queue->destroyed )
       return MSG_WAIT_DESTROYED;
 
+    drain_ring(queue);
+    msgp = queue->head;
+
     DEBUG(MSG_QUEUE,
 	  if ( queue->size > 0 )
 	    Sdprintf("%d: scanning queue (size=%ld)\n",
@@ -2935,6 +3155,14 @@ get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
 
     queue->waiting++;
     queue->waiting_var += isvar;
+    if ( queue->ring )
+    { MemoryBarrier();			/* see send_message_fast() */
+      if ( !ring_is_empty(queue) )
+      { queue->waiting--;
+	queue->waiting_var -= isvar;
+	continue;
+      }
+    }
     DEBUG(MSG_QUEUE_WAIT, Sdprintf("%d: waiting on queue\n", PL_thread_self()));
     switch ( dispatch_cond_wait(queue, QUEUE_WAIT_READ, deadline) )
     { case EINTR:
@@ -2979,7 +3207,7 @@ peek_message(message_queue *queue, term_t msg ARG_LD)
   word key = getIndexOfTerm(msg);
   fid_t fid = PL_open_foreign_frame();
 
-  msgp = queue->head;
+  drain_ring(queue);
 
   for( msgp = queue->head; msgp; msgp = msgp->next )
   { if ( key && msgp->key && key != msgp->key )
@@ -3000,6 +3228,116 @@ peek_message(message_queue *queue, term_t msg ARG_LD)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Batch transfer for thread_send_messages/2 and thread_get_messages/3. Both
+must be called with queue->mutex locked.
+
+queue_messages() appends the chain *msgs, removing the messages from the
+chain as they are queued. Bounded queues  may  have  to wait for space,
+so we add the messages one by one  and   the  caller  can resume after a
+signal.
+
+get_messages() waits for the first message using get_message() and then
+takes up to max-1 more messages  that  are   already  in  the queue. If
+there is no space to copy a message we   stop, leaving it in the queue,
+and return the messages collected so far.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+queue_messages(message_queue *queue, thread_message **msgs ARG_LD)
+{ thread_message *msgp;
+  int count = 0;
+
+  if ( queue->max_size > 0 )
+  { while( (msgp = *msgs) )
+    { thread_message *next = msgp->next;
+      int rc;
+
+      if ( (rc=queue_message(queue, msgp, NULL PASS_LD)) != TRUE )
+	return rc;
+      *msgs = next;
+    }
+
+    return TRUE;
+  }
+
+  drain_ring(queue);
+  while( (msgp = *msgs) )
+  { *msgs = msgp->next;
+    append_message(queue, msgp);
+    count++;
+  }
+
+  if ( count > 1 && queue->waiting > 1 )
+    cv_broadcast(&queue->cond_var);
+  else
+    signal_waiters(queue);
+
+  return TRUE;
+}
+
+
+static int
+take_message(message_queue *queue, term_t msg ARG_LD)
+{ thread_message *msgp = queue->head;
+  term_t tmp;
+
+  if ( !(tmp = PL_new_term_ref()) ||
+       !PL_recorded(msgp->message, tmp) ||
+       !PL_unify(msg, tmp) )
+    return FALSE;
+
+  if ( GD->atoms.gc_active )
+    markAtomsRecord(msgp->message);
+
+  simpleMutexLock(&queue->gc_mutex);	/* see get_message() */
+  if ( !(queue->head = msgp->next) )
+    queue->tail = NULL;
+  simpleMutexUnlock(&queue->gc_mutex);
+
+  free_thread_message(msgp);
+  queue->size--;
+
+  return TRUE;
+}
+
+
+static int
+get_messages(message_queue *queue, term_t list, long max,
+	     struct timespec *deadline ARG_LD)
+{ term_t tail = PL_copy_term_ref(list);
+  term_t head = PL_new_term_ref();
+  long count = 1;
+  int rc;
+
+  if ( !PL_unify_list(tail, head, tail) )
+    return FALSE;
+  if ( (rc=get_message(queue, head, deadline PASS_LD)) != TRUE )
+    return rc;
+
+  drain_ring(queue);
+  while ( (max <= 0 || count < max) && queue->head )
+  { fid_t fid;
+
+    if ( !(fid = PL_open_foreign_frame()) )
+      break;
+    if ( !PL_unify_list(tail, head, tail) ||
+	 !take_message(queue, head PASS_LD) )
+    { PL_discard_foreign_frame(fid);
+      PL_clear_exception();
+      break;
+    }
+    PL_close_foreign_frame(fid);
+    count++;
+  }
+
+  if ( count > 1 && queue->wait_for_drain )
+    cv_broadcast(&queue->drain_var);
+
+  return PL_unify_nil(tail);
+}
+
+
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Deletes the contents of the message-queue as well as the queue itself.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
@@ -3021,6 +3359,16 @@ destroy_message_queue(message_queue *queue)
     freeRecord(msgp->message);
     freeHeap(msgp, sizeof(*msgp));
   }
+  if ( queue->ring )
+  { int i;
+
+    for(i=0; i<MSG_RING_SIZE; i++)
+    { if ( queue->ring[i].message )
+	free_thread_message(queue->ring[i].message);
+    }
+    freeHeap(queue->ring, MSG_RING_SIZE*sizeof(message_slot));
+    queue->ring = NULL;
+  }
 
   simpleMutexDelete(&queue->gc_mutex);
   cv_destroy(&queue->cond_var);
@@ -3051,8 +3399,8 @@ destroy_thread_message_queue(message_queue *q)
 	cv_broadcast(&q->cond_var);
       if ( q->wait_for_drain )
 	cv_broadcast(&q->drain_var);
-    } else
-      done = TRUE;
+    } else if ( !(q->users & ~MQ_DELETED) )
+      done = TRUE;			/* no lock-free users */
     simpleMutexUnlock(&q->mutex);
   }
 
@@ -3068,7 +3416,16 @@ init_message_queue(message_queue *queue, long max_size)
   cv_init(&queue->cond_var, NULL);
   queue->max_size = max_size;
   if ( queue->max_size > 0 )
-    cv_init(&queue->drain_var, NULL);
+  { cv_init(&queue->drain_var, NULL);
+  } else
+  { int i;
+
+    queue->ring = allocHeapOrHalt(MSG_RING_SIZE*sizeof(message_slot));
+    for(i=0; i<MSG_RING_SIZE; i++)
+    { queue->ring[i].sequence = i;
+      queue->ring[i].message  = NULL;
+    }
+  }
   queue->initialized = TRUE;
 }
 
@@ -3157,11 +3514,20 @@ thread_send_message__LD(term_t queue, term_t msgterm, struct timespec *deadline
     return PL_no_memory();
 
   for(;;)
-  { if ( !get_message_queue__LD(queue, &q PASS_LD) )
+  { if ( !get_message_queue_pinned__LD(queue, &q PASS_LD) )
     { free_thread_message(msg);
       return FALSE;
     }
 
+    if ( send_message_fast(q, msg) )
+    { unpin_message_queue(q);
+      return TRUE;
+    }
+    if ( !lock_pinned_message_queue(q) )
+    { free_thread_message(msg);
+      return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, queue);
+    }
+
     rc = queue_message(q, msg, deadline PASS_LD);
     release_message_queue(q);
 
@@ -3209,15 +3575,95 @@ PRED_IMPL("thread_send_message", 3, thread_send_message, 0)
 
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_send_messages(+Queue, +ListOfTerms)
+    Send all terms of a list to Queue.  The terms are compiled before
+    locking the queue and sent to an unbounded queue under a single lock.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+free_thread_messages(thread_message *msgp)
+{ thread_message *next;
+
+  for( ; msgp; msgp = next )
+  { next = msgp->next;
+    free_thread_message(msgp);
+  }
+}
+
+
+static
+PRED_IMPL("thread_send_messages", 2, thread_send_messages, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  thread_message *first = NULL;
+  thread_message *last = NULL;
+  message_queue *q;
+  int rc;
+
+  if ( lengthList(A2, TRUE) < 0 )
+    return FALSE;
+
+  while( PL_get_list(tail, head, tail) )
+  { thread_message *msgp;
+
+    if ( !(msgp = create_thread_message(head PASS_LD)) )
+    { free_thread_messages(first);
+      return PL_no_memory();
+    }
+    if ( last )
+      last->next = msgp;
+    else
+      first = msgp;
+    last = msgp;
+  }
+
+  for(;;)
+  { if ( !get_message_queue__LD(A1, &q PASS_LD) )
+    { free_thread_messages(first);
+      return FALSE;
+    }
+
+    rc = queue_messages(q, &first PASS_LD);
+    release_message_queue(q);
+
+    switch(rc)
+    { case MSG_WAIT_INTR:
+      { if ( PL_handle_signals() >= 0 )
+	  continue;
+	rc = FALSE;
+	break;
+      }
+      case MSG_WAIT_DESTROYED:
+      { rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, A1);
+	break;
+      }
+    }
+
+    break;
+  }
+
+  free_thread_messages(first);		/* not sent due to an error */
+  return rc;
+}
+
+
 static
 PRED_IMPL("thread_get_message", 1, thread_get_message, PL_FA_ISO)
 { PRED_LD
   int rc;
 
   for(;;)
-  { simpleMutexLock(&LD->thread.messages.mutex);
-    rc = get_message(&LD->thread.messages, A1, NULL PASS_LD);
-    simpleMutexUnlock(&LD->thread.messages.mutex);
+  { message_queue *q = &LD->thread.messages;
+
+    if ( PL_is_variable(A1) &&
+	 (rc=get_message_fast(q, A1 PASS_LD)) != MSG_RING_EMPTY )
+      return rc;
+
+    lock_message_queue(q);
+    rc = get_message(q, A1, NULL PASS_LD);
+    simpleMutexUnlock(&q->mutex);
 
     if ( rc == MSG_WAIT_INTR )
     { if ( PL_handle_signals() >= 0 )
@@ -3237,7 +3683,7 @@ PRED_IMPL("thread_peek_message", 1, thread_peek_message_1, PL_FA_ISO)
 { PRED_LD
   int rc;
 
-  simpleMutexLock(&LD->thread.messages.mutex);
+  lock_message_queue(&LD->thread.messages);
   rc = peek_message(&LD->thread.messages, A1 PASS_LD);
   simpleMutexUnlock(&LD->thread.messages.mutex);
 
@@ -3460,7 +3906,7 @@ get_message_queue__LD(term_t t, message_queue **queue ARG_LD)
   { mqref *ref = data;
 
     q = ref->queue;
-    simpleMutexLock(&q->mutex);
+    lock_message_queue(q);
     if ( !q->destroyed )
     { *queue = q;
       return TRUE;
@@ -3474,7 +3920,7 @@ get_message_queue__LD(term_t t, message_queue **queue ARG_LD)
   if ( rc )
   { message_queue *q = *queue;
 
-    simpleMutexLock(&q->mutex);
+    lock_message_queue(q);
     if ( q->destroyed )
     { rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, t);
       simpleMutexUnlock(&q->mutex);
@@ -3486,8 +3932,106 @@ get_message_queue__LD(term_t t, message_queue **queue ARG_LD)
 }
 
 
-/* Release a message queue, deleting it if it is no longer needed
-*/
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The lock-free fast path uses a queue  without holding its mutex. Such a
+user pins the queue by incrementing   queue->users. Deleting a destroyed
+queue sets MQ_DELETED in queue->users; if  there   are  users left, the
+last one to unpin deletes the queue.  Named   and  thread queues are
+resolved and pinned while holding L_THREAD,  which serialises pinning
+with setting MQ_DELETED.  Anonymous queues   are  safe because the blob
+that references them is kept alive by the caller.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+delete_message_queue(message_queue *queue)
+{ destroy_message_queue(queue);
+  if ( !queue->anonymous )
+    PL_free(queue);
+}
+
+
+static int
+pin_message_queue(message_queue *queue)
+{ for(;;)
+  { unsigned int users = queue->users;
+
+    if ( (users & MQ_DELETED) )
+      return FALSE;
+    if ( COMPARE_AND_SWAP(&queue->users, users, users+1) )
+      break;
+  }
+
+  if ( queue->destroyed )
+  { unpin_message_queue(queue);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+static void
+unpin_message_queue(message_queue *queue)
+{ if ( ATOMIC_DEC(&queue->users) == MQ_DELETED )
+    delete_message_queue(queue);
+}
+
+
+/* Get a message queue and pin it
+*/
+
+static int
+get_message_queue_pinned__LD(term_t t, message_queue **queue ARG_LD)
+{ message_queue *q;
+  PL_blob_t *type;
+  void *data;
+  int rc;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &message_queue_blob )
+  { mqref *ref = data;
+
+    q = ref->queue;
+    rc = pin_message_queue(q);
+  } else
+  { LOCK();
+    if ( !get_message_queue_unlocked__LD(t, &q PASS_LD) )
+    { UNLOCK();
+      return FALSE;
+    }
+    rc = pin_message_queue(q);
+    UNLOCK();
+  }
+
+  if ( rc )
+  { *queue = q;
+    return TRUE;
+  }
+
+  return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, t);
+}
+
+
+/* Turn a pinned queue into a locked one.  Fails if the queue was
+   destroyed.  A queue is only marked MQ_DELETED after it is destroyed,
+   so we cannot delete it while holding the mutex.
+*/
+
+static int
+lock_pinned_message_queue(message_queue *queue)
+{ lock_message_queue(queue);
+  if ( queue->destroyed )
+  { simpleMutexUnlock(&queue->mutex);
+    unpin_message_queue(queue);
+    return FALSE;
+  }
+  unpin_message_queue(queue);
+
+  return TRUE;
+}
+
+
+/* Release a message queue, deleting it if it is no longer needed
+*/
 
 static void
 release_message_queue(message_queue *queue)
@@ -3498,9 +4042,16 @@ release_message_queue(message_queue *queue)
   simpleMutexUnlock(&queue->mutex);
 
   if ( del )
-  { destroy_message_queue(queue);
+  { unsigned int users;
+
+    if ( !queue->anonymous )
+      LOCK();
+    users = ATOMIC_OR(&queue->users, MQ_DELETED);
     if ( !queue->anonymous )
-      PL_free(queue);
+      UNLOCK();
+
+    if ( users == 0 )
+      delete_message_queue(queue);
   }
 }
 
@@ -3597,7 +4148,7 @@ message_queue_alias_property(message_queue *q, term_t prop ARG_LD)
 
 static int			/* message_queue_property(Queue, size(Size)) */
 message_queue_size_property(message_queue *q, term_t prop ARG_LD)
-{ return PL_unify_integer(prop, q->size);
+{ return PL_unify_integer(prop, q->size + ring_size(q));
 }
 
 
@@ -3610,10 +4161,17 @@ message_queue_max_size_property(message_queue *q, term_t prop ARG_LD)
 }
 
 
+static int		/* message_queue_property(Queue, contention(Count)) */
+message_queue_contention_property(message_queue *q, term_t prop ARG_LD)
+{ return PL_unify_int64(prop, q->contention);
+}
+
+
 static const tprop qprop_list [] =
 { { FUNCTOR_alias1,	    message_queue_alias_property },
   { FUNCTOR_size1,	    message_queue_size_property },
   { FUNCTOR_max_size1,	    message_queue_max_size_property },
+  { FUNCTOR_contention1,    message_queue_contention_property },
   { 0,			    NULL }
 };
 
@@ -3641,221 +4199,908 @@ advance_qstate(qprop_enum *state)
     if ( (s = advanceTableEnum(state->e)) )
     { state->q = s->value;
 
-      succeed;
+      succeed;
+    }
+  }
+
+  fail;
+}
+
+
+static void
+free_qstate(qprop_enum *state)
+{ if ( state->e )
+    freeTableEnum(state->e);
+
+  freeForeignState(state, sizeof(*state));
+}
+
+
+static
+PRED_IMPL("message_queue_property", 2, message_property, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  term_t queue = A1;
+  term_t property = A2;
+  qprop_enum statebuf;
+  qprop_enum *state;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+    { memset(&statebuf, 0, sizeof(statebuf));
+      state = &statebuf;
+
+      if ( PL_is_variable(queue) )
+      { if ( !queueTable )
+	  return FALSE;
+
+	switch( get_prop_def(property, ATOM_message_queue_property,
+			     qprop_list, &state->p) )
+	{ case 1:
+	    state->e = newTableEnum(queueTable);
+	    goto enumerate;
+	  case 0:
+	    state->e = newTableEnum(queueTable);
+	    state->p = qprop_list;
+	    state->enum_properties = TRUE;
+	    goto enumerate;
+	  case -1:
+	    fail;
+	}
+      } else if ( get_message_queue__LD(queue, &state->q PASS_LD) )
+      { release_message_queue(state->q); /* FIXME: we need some form of locking! */
+
+	switch( get_prop_def(property, ATOM_message_queue_property,
+			     qprop_list, &state->p) )
+	{ case 1:
+	    goto enumerate;
+	  case 0:
+	    state->p = qprop_list;
+	    state->enum_properties = TRUE;
+	    goto enumerate;
+	  case -1:
+	    fail;
+	}
+      } else
+      { fail;
+      }
+    }
+    case FRG_REDO:
+      state = CTX_PTR;
+      break;
+    case FRG_CUTTED:
+      state = CTX_PTR;
+      free_qstate(state);
+      succeed;
+    default:
+      assert(0);
+      fail;
+  }
+
+enumerate:
+  if ( !state->q )			/* first time, enumerating queues */
+  { Symbol s;
+
+    assert(state->e);
+    if ( (s=advanceTableEnum(state->e)) )
+    { state->q = s->value;
+    } else
+    { freeTableEnum(state->e);
+      assert(state == &statebuf);
+      fail;
+    }
+  }
+
+
+  { term_t a1 = PL_new_term_ref();
+
+    if ( !state->enum_properties )
+      _PL_get_arg(1, property, a1);
+
+    for(;;)
+    { if ( (*state->p->function)(state->q, a1 PASS_LD) )
+      { if ( state->enum_properties )
+	{ if ( !PL_unify_term(property,
+			      PL_FUNCTOR, state->p->functor,
+			        PL_TERM, a1) )
+	    goto error;
+	}
+	if ( state->e )
+	{ if ( !unify_queue(queue, state->q) )
+	    goto error;
+	}
+
+	if ( advance_qstate(state) )
+	{ if ( state == &statebuf )
+	  { qprop_enum *copy = allocForeignState(sizeof(*copy));
+
+	    *copy = *state;
+	    state = copy;
+	  }
+
+	  ForeignRedoPtr(state);
+	}
+
+	if ( state != &statebuf )
+	  free_qstate(state);
+        else if ( state->e )
+          freeTableEnum(state->e);
+	succeed;
+      }
+
+      if ( !advance_qstate(state) )
+      { error:
+	if ( state != &statebuf )
+	  free_qstate(state);
+        else if ( state->e )
+          freeTableEnum(state->e);
+	fail;
+      }
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_get_message(+Queue, -Message)
+thread_get_message(-Message)
+    Get a message from a message queue. If the queue is not provided get
+    a message from the queue implicitly associated to the thread.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+thread_get_message__LD(term_t queue, term_t msg, struct timespec *deadline ARG_LD)
+{ int rc;
+
+  for(;;)
+  { message_queue *q;
+
+    if ( !get_message_queue_pinned__LD(queue, &q PASS_LD) )
+      return FALSE;
+
+    if ( PL_is_variable(msg) &&
+	 (rc=get_message_fast(q, msg PASS_LD)) != MSG_RING_EMPTY )
+    { unpin_message_queue(q);
+      return rc;
+    }
+    if ( !lock_pinned_message_queue(q) )
+      return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, queue);
+
+    rc = get_message(q, msg, deadline PASS_LD);
+    release_message_queue(q);
+
+    switch(rc)
+    { case MSG_WAIT_INTR:
+	if ( PL_handle_signals() >= 0 )
+	  continue;
+	rc = FALSE;
+	break;
+      case MSG_WAIT_DESTROYED:
+	rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, queue);
+        break;
+      case MSG_WAIT_TIMEOUT:
+	rc = FALSE;
+        break;
+      default:
+	;
+    }
+
+    break;
+  }
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("thread_get_message", 2, thread_get_message, 0)
+{ PRED_LD
+
+  return thread_get_message__LD(A1, A2, NULL PASS_LD);
+}
+
+
+static
+PRED_IMPL("thread_get_message", 3, thread_get_message, 0)
+{ PRED_LD
+  struct timespec deadline;
+  struct timespec *dlop=NULL;
+
+  return process_deadline_options(A3,&deadline,&dlop)
+    &&   thread_get_message__LD(A1, A2, dlop PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_get_messages(+Queue, -List, +Options)
+    Wait for a message and get all messages   that are in the queue, up
+    to the max(Count) option.  Accepts the  timeout and deadline options
+    of thread_get_message/3.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static const opt_spec thread_get_messages_options[] =
+{ { ATOM_max,		OPT_NATLONG },
+  { NULL_ATOM,		0 }
+};
+
+static
+PRED_IMPL("thread_get_messages", 3, thread_get_messages, 0)
+{ PRED_LD
+  struct timespec deadline;
+  struct timespec *dlop=NULL;
+  long max = -1;
+  int rc;
+
+  if ( !process_deadline_options(A3, &deadline, &dlop) ||
+       !scan_options(A3, 0,
+		     ATOM_thread_get_message_option, thread_get_messages_options,
+		     &max) )
+    return FALSE;
+  if ( max == 0 )
+  { term_t t;
+
+    return ( (t=PL_new_term_ref()) &&
+	     PL_put_integer(t, max) &&
+	     PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_not_less_than_one, t) );
+  }
+
+  for(;;)
+  { message_queue *q;
+    term_t list = PL_new_term_ref();
+
+    if ( !get_message_queue__LD(A1, &q PASS_LD) )
+      return FALSE;
+
+    rc = get_messages(q, list, max, dlop PASS_LD);
+    release_message_queue(q);
+
+    switch(rc)
+    { case MSG_WAIT_INTR:
+	if ( PL_handle_signals() >= 0 )
+	  continue;
+	rc = FALSE;
+	break;
+      case MSG_WAIT_DESTROYED:
+	rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, A1);
+        break;
+      case MSG_WAIT_TIMEOUT:
+	rc = FALSE;
+        break;
+      case TRUE:
+	rc = PL_unify(A2, list);
+	break;
+      default:
+	;
+    }
+
+    break;
+  }
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("thread_peek_message", 2, thread_peek_message_2, 0)
+{ PRED_LD
+  message_queue *q;
+  int rc;
+
+  if ( !get_message_queue__LD(A1, &q PASS_LD) )
+    fail;
+
+  rc = peek_message(q, A2 PASS_LD);
+  release_message_queue(q);
+  return rc;
+}
+
+
+		 /*******************************
+		 *	      TASK POOL		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The task pool is a set of persistent  worker threads that run the goals
+of '$task_pool_run'/2, which is used  by concurrent/3 and friends from
+library(thread). It is created the first time it is used and has as many
+workers as the value of the cpu_count flag.
+
+Each worker owns a deque of tasks. A worker takes tasks from the tail of
+its own deque and, if it is empty,  steals   from  the head of the other
+deques. A thread that is not a  worker distributes the tasks of a batch
+round-robin over the deques. A worker that calls '$task_pool_run'/2
+pushes the tasks to its own deque.  While waiting for the batch, the
+submitter runs the tasks of this batch that  have not yet started. This
+avoids deadlocks on nested use and  guarantees progress if no worker is
+alive.  The submitter only runs tasks  of   its  own batch, such that
+other goals never see its thread state.
+
+After each task, a worker removes  the   clauses  of its thread-local
+predicates and its global variables, such  that   a  task  starts as if
+it runs in a new thread.
+
+The batch collects the answers, i.e.,   records  of the instantiated
+goals, and the first failure or exception, after which the tasks of the
+batch that have not yet started are skipped. Running tasks are not
+interrupted.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef __WINDOWS__
+typedef win32_cond_t task_cond;
+#else
+typedef pthread_cond_t task_cond;
+#endif
+
+#define TASK_RUNNING	0		/* task_batch.status */
+#define TASK_FAILED	1
+#define TASK_ERROR	2
+#define TASK_ABANDONED	3
+
+typedef struct task_batch
+{ simpleMutex	mutex;			/* Guards the fields below */
+  task_cond	cond;			/* Signalled on completion */
+  size_t	pending;		/* # tasks not completed */
+  int		status;			/* TASK_* */
+  int		waiting;		/* # threads waiting on cond */
+  record_t	error;			/* Exception of TASK_ERROR */
+  size_t	count;			/* # tasks */
+  record_t     *answers;		/* Instantiated goals */
+  unsigned int	references;		/* Submitter + # tasks */
+} task_batch;
+
+typedef struct task
+{ record_t	goal;			/* Goal to run */
+  task_batch   *batch;			/* Batch we belong to */
+  size_t	index;			/* Index in batch->answers */
+} task;
+
+typedef struct task_deque
+{ simpleMutex	mutex;			/* Guards the deque */
+  task	      **tasks;			/* Circular buffer */
+  size_t	head;			/* Index of the oldest task */
+  size_t volatile count;		/* # tasks in the deque */
+  size_t	size;			/* Allocated size of tasks */
+} task_deque;
+
+typedef struct task_pool
+{ simpleMutex	mutex;			/* Guards waiting for tasks */
+  task_cond	cond;			/* Signalled on new tasks */
+  int		size;			/* # deques */
+  int		idle;			/* # workers waiting on cond */
+  size_t volatile queued;		/* # tasks in the deques */
+  unsigned int	next;			/* Round-robin distribution */
+  task_deque   *deques;			/* Deque for each worker */
+} task_pool;
+
+static task_pool *taskPool;
+
+
+/* Wait for at most 250 msec on cv, which must be signalled holding
+   mutex.  Returns EINTR if the thread has pending signals.
+*/
+
+static int
+task_cond_wait(task_cond *cv, simpleMutex *mutex)
+{ GET_LD
+  struct timespec deadline;
+
+  get_current_timespec(&deadline);
+  deadline.tv_nsec += 250000000;
+  carry_timespec_nanos(&deadline);
+#ifdef __WINDOWS__
+  win32_cond_wait(cv, mutex, &deadline);
+#else
+  pthread_cond_timedwait(cv, mutex, &deadline);
+#endif
+
+  return is_signalled(LD) ? EINTR : 0;
+}
+
+
+static void
+deque_push(task_deque *dq, task *t)
+{ simpleMutexLock(&dq->mutex);
+  if ( dq->count == dq->size )
+  { size_t newsize = (dq->size ? dq->size*2 : 64);
+    task **new = allocHeapOrHalt(newsize*sizeof(task*));
+    size_t i;
+
+    for(i=0; i<dq->count; i++)
+      new[i] = dq->tasks[(dq->head+i)%dq->size];
+    if ( dq->tasks )
+      freeHeap(dq->tasks, dq->size*sizeof(task*));
+    dq->tasks = new;
+    dq->head  = 0;
+    dq->size  = newsize;
+  }
+  dq->tasks[(dq->head+dq->count)%dq->size] = t;
+  dq->count++;
+  simpleMutexUnlock(&dq->mutex);
+}
+
+
+static task *				/* owner: newest task */
+deque_pop(task_deque *dq)
+{ task *t = NULL;
+
+  if ( dq->count )
+  { simpleMutexLock(&dq->mutex);
+    if ( dq->count )
+    { dq->count--;
+      t = dq->tasks[(dq->head+dq->count)%dq->size];
+    }
+    simpleMutexUnlock(&dq->mutex);
+  }
+
+  return t;
+}
+
+
+static task *				/* thief: oldest task */
+deque_steal(task_deque *dq)
+{ task *t = NULL;
+
+  if ( dq->count )
+  { simpleMutexLock(&dq->mutex);
+    if ( dq->count )
+    { t = dq->tasks[dq->head];
+      dq->head = (dq->head+1)%dq->size;
+      dq->count--;
+    }
+    simpleMutexUnlock(&dq->mutex);
+  }
+
+  return t;
+}
+
+
+/* Remove the oldest task of batch b from dq.  The tasks before it move
+   one place towards the tail.
+*/
+
+static task *
+deque_take_batch(task_deque *dq, task_batch *b)
+{ task *t = NULL;
+
+  if ( dq->count )
+  { size_t i;
+
+    simpleMutexLock(&dq->mutex);
+    for(i=0; i<dq->count; i++)
+    { if ( dq->tasks[(dq->head+i)%dq->size]->batch == b )
+	break;
+    }
+    if ( i < dq->count )
+    { t = dq->tasks[(dq->head+i)%dq->size];
+      for(; i>0; i--)
+	dq->tasks[(dq->head+i)%dq->size] = dq->tasks[(dq->head+i-1)%dq->size];
+      dq->head = (dq->head+1)%dq->size;
+      dq->count--;
+    }
+    simpleMutexUnlock(&dq->mutex);
+  }
+
+  return t;
+}
+
+
+static task *
+take_task(task_pool *pool, int self)
+{ task *t = NULL;
+  int i;
+
+  if ( !(t=deque_pop(&pool->deques[self])) )
+  { for(i=1; i<pool->size; i++)
+    { if ( (t=deque_steal(&pool->deques[(self+i)%pool->size])) )
+	break;
+    }
+  }
+
+  if ( t )
+    ATOMIC_DEC(&pool->queued);
+
+  return t;
+}
+
+
+static task *
+take_batch_task(task_pool *pool, task_batch *b)
+{ task *t = NULL;
+  int i;
+
+  for(i=0; i<pool->size; i++)
+  { if ( (t=deque_take_batch(&pool->deques[i], b)) )
+    { ATOMIC_DEC(&pool->queued);
+      break;
     }
   }
 
-  fail;
+  return t;
 }
 
 
 static void
-free_qstate(qprop_enum *state)
-{ if ( state->e )
-    freeTableEnum(state->e);
+release_task_batch(task_batch *b)
+{ if ( ATOMIC_DEC(&b->references) == 0 )
+  { size_t i;
 
-  freeForeignState(state, sizeof(*state));
+    for(i=0; i<b->count; i++)
+    { if ( b->answers[i] )
+	freeRecord(b->answers[i]);
+    }
+    if ( b->error )
+      freeRecord(b->error);
+    freeHeap(b->answers, b->count*sizeof(record_t));
+    cv_destroy(&b->cond);
+    simpleMutexDelete(&b->mutex);
+    freeHeap(b, sizeof(*b));
+  }
 }
 
 
-static
-PRED_IMPL("message_queue_property", 2, message_property, PL_FA_NONDETERMINISTIC)
-{ PRED_LD
-  term_t queue = A1;
-  term_t property = A2;
-  qprop_enum statebuf;
-  qprop_enum *state;
+static void
+task_done(task_batch *b, size_t index, int status,
+	  record_t answer, record_t error)
+{ simpleMutexLock(&b->mutex);
+  b->answers[index] = answer;
+  if ( status != TASK_RUNNING && b->status == TASK_RUNNING )
+  { b->status = status;
+    b->error  = error;
+    error = 0;
+  }
+  b->pending--;
+  if ( b->waiting && (b->pending == 0 || b->status != TASK_RUNNING) )
+    cv_broadcast(&b->cond);
+  simpleMutexUnlock(&b->mutex);
 
-  switch( CTX_CNTRL )
-  { case FRG_FIRST_CALL:
-    { memset(&statebuf, 0, sizeof(statebuf));
-      state = &statebuf;
+  if ( error )
+    freeRecord(error);
+  release_task_batch(b);
+}
 
-      if ( PL_is_variable(queue) )
-      { if ( !queueTable )
-	  return FALSE;
 
-	switch( get_prop_def(property, ATOM_message_queue_property,
-			     qprop_list, &state->p) )
-	{ case 1:
-	    state->e = newTableEnum(queueTable);
-	    goto enumerate;
-	  case 0:
-	    state->e = newTableEnum(queueTable);
-	    state->p = qprop_list;
-	    state->enum_properties = TRUE;
-	    goto enumerate;
-	  case -1:
-	    fail;
-	}
-      } else if ( get_message_queue__LD(queue, &state->q PASS_LD) )
-      { release_message_queue(state->q); /* FIXME: we need some form of locking! */
+/* Remove the clauses of the thread-local predicates and the global
+   variables of a worker.
+*/
 
-	switch( get_prop_def(property, ATOM_message_queue_property,
-			     qprop_list, &state->p) )
-	{ case 1:
-	    goto enumerate;
-	  case 0:
-	    state->p = qprop_list;
-	    state->enum_properties = TRUE;
-	    goto enumerate;
-	  case -1:
-	    fail;
-	}
-      } else
-      { fail;
-      }
+static void
+reset_task_worker(ARG1_LD)
+{ DefinitionChain ch;
+
+  for(ch=LD->thread.local_definitions; ch; ch=ch->next)
+  { Definition def = getProcDefinition__LD(ch->definition PASS_LD);
+    ClauseRef cref, next;
+
+    for(cref=def->impl.clauses.first_clause; cref; cref=next)
+    { next = cref->next;
+      retractClauseDefinition(def, cref->value.clause);
     }
-    case FRG_REDO:
-      state = CTX_PTR;
-      break;
-    case FRG_CUTTED:
-      state = CTX_PTR;
-      free_qstate(state);
-      succeed;
-    default:
-      assert(0);
-      fail;
   }
 
-enumerate:
-  if ( !state->q )			/* first time, enumerating queues */
-  { Symbol s;
+  destroyGlobalVars();
+}
 
-    assert(state->e);
-    if ( (s=advanceTableEnum(state->e)) )
-    { state->q = s->value;
+
+/* Run a task.  If reset is TRUE, the thread state is reset after the
+   goal.  This is done before discarding the frame, such that the
+   global stack used by global variables is reclaimed.
+*/
+
+static void
+run_task(task *t, int reset ARG_LD)
+{ static predicate_t pred = NULL;
+  task_batch *b = t->batch;
+  int status = TASK_RUNNING;
+  record_t answer = 0, error = 0;
+
+  if ( !pred )
+    pred = PL_predicate("call", 1, "system");
+
+  if ( b->status == TASK_RUNNING )
+  { fid_t fid = PL_open_foreign_frame();
+    term_t goal = PL_new_term_ref();
+    qid_t qid;
+
+    if ( goal && !PL_recorded(t->goal, goal) )
+    { raiseStackOverflow(GLOBAL_OVERFLOW);
+      goal = 0;
+    }
+
+    if ( goal && (qid=PL_open_query(NULL, PL_Q_CATCH_EXCEPTION, pred, goal)) )
+    { term_t ex;
+
+      if ( PL_next_solution(qid) )
+      { if ( !(answer = compileTermToHeap(goal, 0)) )
+	  status = TASK_FAILED;
+      } else if ( (ex=PL_exception(qid)) )
+      { if ( (error = compileTermToHeap(ex, 0)) )
+	  status = TASK_ERROR;
+	else
+	  status = TASK_FAILED;
+      } else
+      { status = TASK_FAILED;
+      }
+      PL_cut_query(qid);
+    } else if ( exception_term &&
+		(error = compileTermToHeap(exception_term, 0)) )
+    { status = TASK_ERROR;
     } else
-    { freeTableEnum(state->e);
-      assert(state == &statebuf);
-      fail;
+    { status = TASK_FAILED;
     }
+
+    PL_clear_exception();
+    if ( reset )
+      reset_task_worker(PASS_LD1);
+    PL_discard_foreign_frame(fid);
   }
 
+  task_done(b, t->index, status, answer, error);
+  freeRecord(t->goal);
+  freeHeap(t, sizeof(*t));
+}
 
-  { term_t a1 = PL_new_term_ref();
 
-    if ( !state->enum_properties )
-      _PL_get_arg(1, property, a1);
+static int
+start_task_worker(int index)
+{ GET_LD
+  term_t av;
+  int rc;
 
-    for(;;)
-    { if ( (*state->p->function)(state->q, a1 PASS_LD) )
-      { if ( state->enum_properties )
-	{ if ( !PL_unify_term(property,
-			      PL_FUNCTOR, state->p->functor,
-			        PL_TERM, a1) )
-	    goto error;
-	}
-	if ( state->e )
-	{ if ( !unify_queue(queue, state->q) )
-	    goto error;
-	}
+  rc = ( (av=PL_new_term_refs(3)) &&
+	 PL_unify_term(av+0,
+		       PL_FUNCTOR, FUNCTOR_colon2,
+			 PL_ATOM, ATOM_system,
+			 PL_FUNCTOR_CHARS, "$task_worker", 1,
+			   PL_INT, index) &&
+	 PL_unify_term(av+2,
+		       PL_FUNCTOR, FUNCTOR_dot2,
+			 PL_FUNCTOR, FUNCTOR_detached1,
+			   PL_ATOM, ATOM_true,
+			 PL_ATOM, ATOM_nil) &&
+	 pl_thread_create(av+0, av+1, av+2) );
+
+  if ( av )
+    PL_reset_term_refs(av);
 
-	if ( advance_qstate(state) )
-	{ if ( state == &statebuf )
-	  { qprop_enum *copy = allocForeignState(sizeof(*copy));
+  return rc;
+}
 
-	    *copy = *state;
-	    state = copy;
-	  }
 
-	  ForeignRedoPtr(state);
-	}
+/* The workers are started after releasing L_THREAD as thread creation
+   needs this mutex.  If no worker can be started the submitters run the
+   tasks themselves (see wait_task_batch()).
+*/
 
-	if ( state != &statebuf )
-	  free_qstate(state);
-        else if ( state->e )
-          freeTableEnum(state->e);
-	succeed;
-      }
+static task_pool *
+get_task_pool(void)
+{ task_pool *pool;
+  int created = FALSE;
 
-      if ( !advance_qstate(state) )
-      { error:
-	if ( state != &statebuf )
-	  free_qstate(state);
-        else if ( state->e )
-          freeTableEnum(state->e);
-	fail;
+  if ( (pool=taskPool) )
+    return pool;
+
+  LOCK();
+  if ( !(pool=taskPool) )
+  { int64_t cpus;
+    int i, size;
+
+    if ( PL_current_prolog_flag(ATOM_cpu_count, PL_INTEGER, &cpus) &&
+	 cpus > 0 )
+      size = (int)cpus;
+    else
+      size = 1;
+
+    pool = allocHeapOrHalt(sizeof(*pool));
+    memset(pool, 0, sizeof(*pool));
+    simpleMutexInit(&pool->mutex);
+    cv_init(&pool->cond, NULL);
+    pool->deques = allocHeapOrHalt(size*sizeof(task_deque));
+    memset(pool->deques, 0, size*sizeof(task_deque));
+    for(i=0; i<size; i++)
+      simpleMutexInit(&pool->deques[i].mutex);
+    pool->size = size;
+
+    taskPool = pool;
+    created = TRUE;
+  }
+  UNLOCK();
+
+  if ( created )
+  { int i;
+
+    for(i=0; i<pool->size; i++)
+    { if ( !start_task_worker(i) )
+      { PL_clear_exception();
+	break;
       }
     }
   }
+
+  return pool;
 }
 
 
-/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-thread_get_message(+Queue, -Message)
-thread_get_message(-Message)
-    Get a message from a message queue. If the queue is not provided get
-    a message from the queue implicitly associated to the thread.
-- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+static void
+wakeup_task_workers(task_pool *pool)
+{ simpleMutexLock(&pool->mutex);
+  if ( pool->idle )
+    cv_broadcast(&pool->cond);
+  simpleMutexUnlock(&pool->mutex);
+}
+
+
+/* Wait for a batch to complete, running the tasks of the batch that
+   are not yet taken by a worker.  Returns FALSE if a signal raised an
+   exception.
+*/
 
 static int
-thread_get_message__LD(term_t queue, term_t msg, struct timespec *deadline ARG_LD)
-{ int rc;
+wait_task_batch(task_pool *pool, task_batch *b ARG_LD)
+{ for(;;)
+  { task *t;
+    int done, rc = 0;
+
+    if ( b->status == TASK_RUNNING &&
+	 (t=take_batch_task(pool, b)) )
+    { run_task(t, FALSE PASS_LD);
+      continue;
+    }
 
-  for(;;)
-  { message_queue *q;
+    simpleMutexLock(&b->mutex);
+    if ( !(done = (b->pending == 0 || b->status != TASK_RUNNING)) )
+    { b->waiting++;
+      rc = task_cond_wait(&b->cond, &b->mutex);
+      b->waiting--;
+      done = (b->pending == 0 || b->status != TASK_RUNNING);
+    }
+    simpleMutexUnlock(&b->mutex);
 
-    if ( !get_message_queue__LD(queue, &q PASS_LD) )
+    if ( done )
+      return TRUE;
+    if ( rc == EINTR && PL_handle_signals() < 0 )
+    { simpleMutexLock(&b->mutex);
+      if ( b->status == TASK_RUNNING )
+	b->status = TASK_ABANDONED;
+      simpleMutexUnlock(&b->mutex);
       return FALSE;
+    }
+  }
+}
 
-    rc = get_message(q, msg, deadline PASS_LD);
-    release_message_queue(q);
 
-    switch(rc)
-    { case MSG_WAIT_INTR:
-	if ( PL_handle_signals() >= 0 )
-	  continue;
-	rc = FALSE;
-	break;
-      case MSG_WAIT_DESTROYED:
-	rc = PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, queue);
-        break;
-      case MSG_WAIT_TIMEOUT:
-	rc = FALSE;
-        break;
-      default:
-	;
-    }
+static int
+unify_task_answers(task_batch *b, term_t answers ARG_LD)
+{ term_t tail = PL_copy_term_ref(answers);
+  term_t head = PL_new_term_ref();
+  term_t tmp  = PL_new_term_ref();
+  size_t i;
 
-    break;
+  for(i=0; i<b->count; i++)
+  { if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_recorded(b->answers[i], tmp) ||
+	 !PL_unify(head, tmp) )
+      return FALSE;
   }
 
-  return rc;
+  return PL_unify_nil(tail);
 }
 
 
+/** '$task_pool_run'(+Goals:list, -Answers:list) is semidet.
+
+Run Goals on the task pool.  Answers is unified with the list of
+instantiated goals.  Fails if a goal fails and re-throws the exception
+if a goal raises an exception.  Goals are called as once/1.
+*/
+
 static
-PRED_IMPL("thread_get_message", 2, thread_get_message, 0)
+PRED_IMPL("$task_pool_run", 2, task_pool_run, 0)
 { PRED_LD
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  task_pool *pool;
+  task_batch *b;
+  intptr_t len;
+  int self, rc;
+  size_t i;
 
-  return thread_get_message__LD(A1, A2, NULL PASS_LD);
+  if ( (len=lengthList(A1, TRUE)) < 0 )
+    return FALSE;
+  if ( len == 0 )
+    return PL_unify_nil(A2);
+  pool = get_task_pool();
+
+  b = allocHeapOrHalt(sizeof(*b));
+  memset(b, 0, sizeof(*b));
+  simpleMutexInit(&b->mutex);
+  cv_init(&b->cond, NULL);
+  b->count      = len;
+  b->pending    = len;
+  b->references = (unsigned int)len+1;
+  b->answers    = allocHeapOrHalt(len*sizeof(record_t));
+  memset(b->answers, 0, len*sizeof(record_t));
+
+  ATOMIC_ADD(&pool->queued, len);
+  self = LD->thread.task_worker-1;
+  for(i=0; PL_get_list(tail, head, tail); i++)
+  { task *t = allocHeapOrHalt(sizeof(*t));
+
+    t->goal  = compileTermToHeap(head, 0);
+    t->batch = b;
+    t->index = i;
+    if ( self >= 0 )
+      deque_push(&pool->deques[self], t);
+    else
+      deque_push(&pool->deques[ATOMIC_INC(&pool->next)%pool->size], t);
+  }
+  wakeup_task_workers(pool);
+
+  if ( (rc=wait_task_batch(pool, b PASS_LD)) )
+  { switch(b->status)
+    { case TASK_RUNNING:
+	rc = unify_task_answers(b, A2 PASS_LD);
+	break;
+      case TASK_FAILED:
+	rc = FALSE;
+	break;
+      case TASK_ERROR:
+      { term_t ex;
+
+	rc = ( (ex=PL_new_term_ref()) &&
+	       PL_recorded(b->error, ex) &&
+	       PL_raise_exception(ex) );
+	break;
+      }
+    }
+  }
+  release_task_batch(b);
+
+  return rc;
 }
 
 
 static
-PRED_IMPL("thread_get_message", 3, thread_get_message, 0)
+PRED_IMPL("$task_pool_size", 1, task_pool_size, 0)
 { PRED_LD
-  struct timespec deadline;
-  struct timespec *dlop=NULL;
+  task_pool *pool;
 
-  return process_deadline_options(A3,&deadline,&dlop)
-    &&   thread_get_message__LD(A1, A2, dlop PASS_LD);
+  pool = get_task_pool();
+
+  return PL_unify_integer(A1, pool->size);
 }
 
 
 static
-PRED_IMPL("thread_peek_message", 2, thread_peek_message_2, 0)
+PRED_IMPL("$task_worker", 1, task_worker, 0)
 { PRED_LD
-  message_queue *q;
-  int rc;
+  task_pool *pool;
+  int self;
 
-  if ( !get_message_queue__LD(A1, &q PASS_LD) )
-    fail;
+  if ( !PL_get_integer_ex(A1, &self) )
+    return FALSE;
 
-  rc = peek_message(q, A2 PASS_LD);
-  release_message_queue(q);
-  return rc;
+  pool = taskPool;
+  LD->thread.task_worker = self+1;
+
+  for(;;)
+  { task *t;
+    int rc = 0;
+
+    if ( (t=take_task(pool, self)) )
+    { run_task(t, TRUE PASS_LD);
+      continue;
+    }
+
+    simpleMutexLock(&pool->mutex);
+    if ( pool->queued == 0 )
+    { pool->idle++;
+      rc = task_cond_wait(&pool->cond, &pool->mutex);
+      pool->idle--;
+    }
+    simpleMutexUnlock(&pool->mutex);
+
+    if ( rc == EINTR && PL_handle_signals() < 0 )
+      return FALSE;
+  }
 }
 
 
@@ -5793,9 +7038,20 @@ markAtomsMessageQueue(message_queue *queue)
 { thread_message *msg;
 
   simpleMutexLock(&queue->gc_mutex);
+  if ( queue->ring )			/* see get_message_fast() */
+  { int i;
+
+    queue->agc_scanning = TRUE;
+    MemoryBarrier();
+    for(i=0; i<MSG_RING_SIZE; i++)
+    { if ( (msg=queue->ring[i].message) )
+	markAtomsRecord(msg->message);
+    }
+  }
   for(msg=queue->head; msg; msg=msg->next)
   { markAtomsRecord(msg->message);
   }
+  queue->agc_scanning = FALSE;
   simpleMutexUnlock(&queue->gc_mutex);
 }
 
@@ -5820,6 +7076,41 @@ markAtomsMessageQueues(void)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+waitAtomTableReaders() waits until all threads that were scanning the
+atom table without holding L_ATOM  when   we  were  called have left the
+table. A thread is scanning if  its   LD->atoms.lookup_seq  is odd. Such
+scans are short and never block, so we simply spin.  Called from AGC,
+which has L_THREAD locked.
+
+The barrier pairs with the  one   in  lookupBlobNoLock():  the unlinked
+atoms and replaced table must be visible   to  a reader before we sample
+its sequence number. Otherwise a reader we  consider outside may start a
+scan that still finds the old structures.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+waitAtomTableReaders(void)
+{ int i;
+
+  MemoryBarrier();
+  for(i=1; i<=thread_highest_id; i++)
+  { PL_thread_info_t *info = GD->thread.threads[i];
+    PL_local_data_t *ld;
+
+    if ( info && (ld=info->thread_data) )
+    { volatile unsigned int *seqp = &ld->atoms.lookup_seq;
+      unsigned int seq = *seqp;
+
+      if ( (seq & 1) )
+      { while( *seqp == seq )
+	  MemoryBarrier();
+      }
+    }
+  }
+}
+
+
 		 /*******************************
 		 *	    PREDICATES		*
 		 *******************************/
@@ -6113,11 +7404,16 @@ BeginPredDefs(thread)
   PRED_DEF("message_queue_property", 2, message_property, PL_FA_NONDETERMINISTIC|PL_FA_ISO)
   PRED_DEF("thread_send_message", 2, thread_send_message, PL_FA_ISO)
   PRED_DEF("thread_send_message", 3, thread_send_message, 0)
+  PRED_DEF("thread_send_messages", 2, thread_send_messages, 0)
   PRED_DEF("thread_get_message", 1, thread_get_message, PL_FA_ISO)
   PRED_DEF("thread_get_message", 2, thread_get_message, PL_FA_ISO)
   PRED_DEF("thread_get_message", 3, thread_get_message, PL_FA_ISO)
+  PRED_DEF("thread_get_messages", 3, thread_get_messages, 0)
   PRED_DEF("thread_peek_message", 1, thread_peek_message_1, PL_FA_ISO)
   PRED_DEF("thread_peek_message", 2, thread_peek_message_2, PL_FA_ISO)
+  PRED_DEF("$task_pool_run", 2, task_pool_run, 0)
+  PRED_DEF("$task_pool_size", 1, task_pool_size, 0)
+  PRED_DEF("$task_worker", 1, task_worker, 0)
   PRED_DEF("message_queue_destroy", 1, message_queue_destroy, PL_FA_ISO)
   PRED_DEF("thread_setconcurrency", 2, thread_setconcurrency, 0)
 
@@ -102,6 +102,14 @@ typedef struct _PL_thread_info_t
 #define QTYPE_THREAD	0
 #define QTYPE_QUEUE	1
 
+#define MSG_RING_SIZE	256		/* Lock-free slots (power of 2) */
+#define MQ_DELETED	0x80000000U	/* Flag in message_queue.users */
+
+typedef struct message_slot
+{ size_t volatile      sequence;	/* Slot sequence number */
+  struct thread_message * volatile message; /* Message in the slot */
+} message_slot;
+
 typedef struct message_queue
 { simpleMutex	       mutex;		/* Message queue mutex */
 #ifdef __WINDOWS__
@@ -124,6 +132,12 @@ typedef struct message_queue
   unsigned	initialized : 1;	/* Queue is initialised */
   unsigned	destroyed : 1;		/* Thread is being destroyed */
   unsigned	type : 2;		/* QTYPE_* */
+  message_slot	      *ring;		/* Lock-free fast path or NULL */
+  size_t volatile      enqueue_pos;	/* Next ring position to write */
+  size_t volatile      dequeue_pos;	/* Next ring position to read */
+  unsigned int volatile users;		/* # lock-free users (+MQ_DELETED) */
+  int volatile	       agc_scanning;	/* AGC is scanning the ring */
+  uint64_t	       contention;	/* # contended lock/ring operations */
 #ifdef O_ATOMGC
   simpleMutex          gc_mutex;	/* Atom GC scanning sychronization */
 #endif
@@ -362,6 +376,7 @@ COMMON(void)	forThreadLocalDataUnsuspended(void (*func)(struct PL_local_data *),
 COMMON(void)	resumeThreads(void);
 COMMON(void)	markAtomsMessageQueues(void);
 COMMON(void)	markAtomsThreadMessageQueue(PL_local_data_t *ld);
+COMMON(void)	waitAtomTableReaders(void);
 
 #define PL_THREAD_SUSPEND_AFTER_WORK	0x1 /* forThreadLocalData() */
 
@@ -0,0 +1,1151 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*#define O_DEBUG 1*/
+#include "pl-incl.h"
+#include "pl-trie.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Variant tries.  See pl-trie.h for the representation.  This module only
+provides the C API; the tables of pl-tabling.c are built on top of it.
+
+Variables are numbered while walking the term by temporarily overwriting
+the variable cell with its key.  As no Prolog code is executed during the
+walk and the cells are restored before returning this is invisible to
+the rest of the system.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TRIE_VAR_KEY(n)	(((word)((n)+1)<<LMASK_BITS)|TAG_VAR)
+#define TRIE_VAR_NUM(k)	((size_t)((k)>>LMASK_BITS)-1)
+#define IS_TRIE_VAR(k)	(tag(k) == TAG_VAR)
+
+typedef struct trie_agenda
+{ Word		arg;			/* Next argument */
+  size_t	left;			/* # arguments left */
+} trie_agenda;
+
+
+		 /*******************************
+		 *	       NODES		*
+		 *******************************/
+
+static trie_node *
+new_trie_node(trie *t, trie_node *parent, word key, Word indirect)
+{ trie_node *n = allocHeapOrHalt(sizeof(*n));
+
+  memset(n, 0, sizeof(*n));
+  n->key    = key;
+  n->parent = parent;
+
+  if ( indirect )
+  { size_t wsize = wsizeofInd(*indirect)+1;
+
+    n->indirect = allocHeapOrHalt(wsize*sizeof(word));
+    memcpy(n->indirect, indirect, wsize*sizeof(word));
+    t->size += wsize*sizeof(word);
+  }
+  t->node_count++;
+  t->size += sizeof(*n);
+
+  return n;
+}
+
+
+static void
+free_trie_node(trie *t, trie_node *n)
+{ if ( n->value )
+  { if ( t->release_value )
+      (*t->release_value)(t, n->value);
+    t->value_count--;
+  }
+  if ( n->hash )
+    destroyHTable(n->hash);
+  if ( n->indirect )
+  { size_t wsize = wsizeofInd(*n->indirect)+1;
+
+    freeHeap(n->indirect, wsize*sizeof(word));
+    t->size -= wsize*sizeof(word);
+  }
+  freeHeap(n, sizeof(*n));
+  t->node_count--;
+  t->size -= sizeof(*n);
+}
+
+
+static int
+equal_indirect_data(Word stored, Word p)
+{ if ( *stored == *p )
+  { size_t n = wsizeofInd(*p);
+
+    return memcmp(stored+1, p+1, n*sizeof(word)) == 0;
+  }
+
+  return FALSE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Indirect data is hashed on its content.  The key is tagged as the
+original data on global storage, which makes it distinct from all direct
+keys.  Different data may hash to the same key and therefore we always
+compare the content and fall back to a linear scan if the hash table
+returns the wrong node.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static word
+indirect_key(Word p)
+{ size_t n = wsizeofInd(*p);
+  unsigned int h = MurmurHashAligned2(p+1, n*sizeof(word), MURMUR_SEED);
+
+  return ((word)h<<LMASK_BITS)|tag(*p)|STG_GLOBAL;
+}
+
+
+static trie_node *
+find_child(trie_node *n, word key, Word indirect)
+{ trie_node *c;
+
+  if ( n->hash )
+  { Symbol s;
+
+    if ( (s=lookupHTable(n->hash, (void*)key)) )
+    { c = s->value;
+      if ( !indirect || equal_indirect_data(c->indirect, indirect) )
+	return c;
+    } else
+      return NULL;
+  }
+
+  for(c=n->children; c; c=c->sibling)
+  { if ( c->key == key &&
+	 (!indirect || equal_indirect_data(c->indirect, indirect)) )
+      return c;
+  }
+
+  return NULL;
+}
+
+
+static trie_node *
+add_child(trie *t, trie_node *n, word key, Word indirect)
+{ trie_node *c = new_trie_node(t, n, key, indirect);
+
+  c->sibling  = n->children;
+  n->children = c;
+  n->child_count++;
+
+  if ( n->hash )
+  { if ( !lookupHTable(n->hash, (void*)key) )
+      addHTable(n->hash, (void*)key, c);
+  } else if ( n->child_count > TRIE_HASH_THRESHOLD )
+  { trie_node *e;
+
+    n->hash = newHTable(32|TABLE_UNLOCKED);
+    for(e=c; e; e=e->sibling)
+    { if ( !lookupHTable(n->hash, (void*)e->key) )
+	addHTable(n->hash, (void*)e->key, e);
+    }
+  }
+
+  return c;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Remove `c` from the children of `n`.  If `c` is in the hash table, it is
+replaced by a sibling with the same (indirect) key, if any.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+unlink_child(trie_node *n, trie_node *c)
+{ trie_node **cp;
+
+  for(cp = &n->children; *cp; cp = &(*cp)->sibling)
+  { if ( *cp == c )
+    { *cp = c->sibling;
+      n->child_count--;
+      break;
+    }
+  }
+
+  if ( n->hash )
+  { Symbol s = lookupHTable(n->hash, (void*)c->key);
+
+    if ( s && s->value == c )
+    { trie_node *e;
+
+      deleteHTable(n->hash, (void*)c->key);
+      for(e=n->children; e; e=e->sibling)
+      { if ( e->key == c->key )
+	{ addHTable(n->hash, (void*)e->key, e);
+	  break;
+	}
+      }
+    }
+  }
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Remove `n` if it has neither a value nor children, as well as all its
+ancestors that become empty this way.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+prune_node(trie *t, trie_node *n)
+{ while( n->parent && !n->children && !n->value )
+  { trie_node *p = n->parent;
+
+    unlink_child(p, n);
+    free_trie_node(t, n);
+    n = p;
+  }
+}
+
+
+		 /*******************************
+		 *	      TRIES		*
+		 *******************************/
+
+trie *
+trie_create(void)
+{ trie *t = allocHeapOrHalt(sizeof(*t));
+
+  memset(t, 0, sizeof(*t));
+  t->magic = TRIE_MAGIC;
+#ifdef O_PLMT
+  simpleMutexInit(&t->lock);
+#endif
+
+  return t;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trie_empty() removes all nodes from the trie.  Terms may be long lists,
+so we cannot use recursion.  Instead we always descend into the first
+child and, if we find a node without children, we unlink it from its
+parent and continue with the parent.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+trie_empty(trie *t)
+{ trie_node *root = &t->root;
+  trie_node *n = root;
+
+  for(;;)
+  { trie_node *c;
+
+    if ( (c=n->children) )
+    { n = c;
+      continue;
+    }
+    if ( n == root )
+      break;
+
+    c = n;
+    n = n->parent;
+    n->children = c->sibling;
+    free_trie_node(t, c);
+  }
+
+  if ( root->hash )
+  { destroyHTable(root->hash);
+    root->hash = NULL;
+  }
+  root->child_count = 0;
+}
+
+
+void
+trie_destroy(trie *t)
+{ trie_empty(t);
+#ifdef O_PLMT
+  simpleMutexDelete(&t->lock);
+#endif
+  freeHeap(t, sizeof(*t));
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trie_delete() removes the value from `node`.  If `prune` is TRUE, the
+node and its ancestors that no longer lead to a value are removed.  This
+must be FALSE while the trie is being enumerated, in which case the
+caller must call trie_prune() after the enumeration is completed.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+trie_delete(trie *t, trie_node *node, int prune)
+{ if ( node->value )
+  { if ( t->release_value )
+      (*t->release_value)(t, node->value);
+    node->value = NULL;
+    t->value_count--;
+  }
+
+  if ( prune )
+    prune_node(t, node);
+}
+
+
+		 /*******************************
+		 *	     ENUMERATION	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The values are enumerated in depth-first order by walking from one leaf
+to the next.  This requires no state except for the current node, but
+nodes may not be removed during the enumeration.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static trie_node *
+first_leaf(trie_node *n)
+{ while( n->children )
+    n = n->children;
+
+  return n;
+}
+
+
+static trie_node *
+next_leaf(trie_node *n)
+{ for(;;)
+  { if ( !n->parent )
+      return NULL;
+    if ( n->sibling )
+      return first_leaf(n->sibling);
+    n = n->parent;
+  }
+}
+
+
+trie_node *
+trie_first_value(trie *t)
+{ trie_node *n;
+
+  if ( !t->root.children )
+    return NULL;
+
+  n = first_leaf(t->root.children);
+  if ( !n->value )
+    n = trie_next_value(n);
+
+  return n;
+}
+
+
+trie_node *
+trie_next_value(trie_node *n)
+{ do
+  { n = next_leaf(n);
+  } while( n && !n->value );
+
+  return n;
+}
+
+
+void
+trie_prune(trie *t)
+{ trie_node *n;
+
+  if ( !t->root.children )
+    return;
+
+  for(n = first_leaf(t->root.children); n; )
+  { trie_node *next = next_leaf(n);
+
+    if ( !n->value )
+      prune_node(t, n);
+    n = next;
+  }
+  t->prune_pending = 0;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trie_lookup() finds the node for the variant of the term at `k`.  If
+`add` is TRUE, missing nodes are created.  Returns TRUE if the node was
+found or created, FALSE if it does not exist and `add` is FALSE, or one
+of TRIE_E_* if the term cannot be represented.  The caller must ensure
+the term is acyclic.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+trie_lookup(trie *t, trie_node **nodep, Word k, int add ARG_LD)
+{ trie_node *node = &t->root;
+  tmp_buffer agenda;
+  tmp_buffer vars;
+  trie_agenda a = {k, 1};
+  size_t nvars = 0;
+  int rc = TRUE;
+
+  initBuffer(&agenda);
+  initBuffer(&vars);
+
+  while( node )
+  { Word p;
+    word w, key;
+    Word indirect = NULL;
+
+    if ( a.left == 0 )
+    { if ( isEmptyBuffer(&agenda) )
+	break;
+      agenda.top -= sizeof(trie_agenda);
+      a = *(trie_agenda*)agenda.top;
+      continue;
+    }
+    p = a.arg++;
+    a.left--;
+
+    deRef(p);
+    w = *p;
+
+    switch(tag(w))
+    { case TAG_VAR:
+	if ( w == 0 )
+	{ *p = TRIE_VAR_KEY(nvars++);
+	  addBuffer(&vars, p, Word);
+	}
+	key = *p;
+	break;
+      case TAG_ATTVAR:
+	rc = TRIE_E_ATTVAR;
+	node = NULL;
+	continue;
+      case TAG_COMPOUND:
+      { Functor f = valueTerm(w);
+
+	key = f->definition;
+	if ( a.left > 0 )
+	  addBuffer(&agenda, a, trie_agenda);
+	a.arg  = f->arguments;
+	a.left = arityFunctor(key);
+	break;
+      }
+      default:
+	if ( isIndirect(w) )
+	{ indirect = addressIndirect(w);
+	  key = indirect_key(indirect);
+	} else
+	{ key = w;
+	}
+    }
+
+    { trie_node *c;
+
+      if ( !(c=find_child(node, key, indirect)) )
+      { if ( add )
+	  c = add_child(t, node, key, indirect);
+	else
+	  rc = FALSE;
+      }
+      node = c;
+    }
+  }
+
+  { Word *vp = baseBuffer(&vars, Word);
+    Word *ep = topBuffer(&vars, Word);
+
+    for(; vp < ep; vp++)
+      setVar(**vp);
+  }
+  discardBuffer(&vars);
+  discardBuffer(&agenda);
+
+  if ( rc == TRUE )
+    *nodep = node;
+
+  return rc;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+unify_trie_term() rebuilds the term that ends at `node` on the global
+stack and unifies it with `term`.  We first collect the path to the root
+to compute the required space, such that the term can be created without
+further stack checks.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+unify_trie_term(trie_node *node, term_t term ARG_LD)
+{ tmp_buffer path;
+  tmp_buffer holes;
+  tmp_buffer vars;
+  trie_node **pp, **ep;
+  size_t cells = 0;
+  term_t result;
+  Word gp;
+  int rc;
+
+  initBuffer(&path);
+  for(; node->parent; node = node->parent)
+  { addBuffer(&path, node, trie_node*);
+
+    if ( node->indirect )
+      cells += wsizeofInd(*node->indirect)+2;
+    else if ( !IS_TRIE_VAR(node->key) && tag(node->key) == TAG_ATOM &&
+	      storage(node->key) == STG_GLOBAL )
+      cells += arityFunctor(node->key)+1;
+  }
+
+  if ( !(result = PL_new_term_ref()) )
+  { discardBuffer(&path);
+    return FALSE;
+  }
+  if ( !hasGlobalSpace(cells) )
+  { if ( (rc=ensureGlobalSpace(cells, ALLOW_GC)) != TRUE )
+    { discardBuffer(&path);
+      return raiseStackOverflow(rc);
+    }
+  }
+
+  gp = gTop;
+  gTop += cells;
+
+  initBuffer(&holes);
+  initBuffer(&vars);
+  addBuffer(&holes, valTermRef(result), Word);
+
+  pp = baseBuffer(&path, trie_node*);
+  ep = topBuffer(&path, trie_node*);
+  while( ep-- > pp )
+  { trie_node *n = *ep;
+    word key = n->key;
+    Word h;
+
+    holes.top -= sizeof(Word);
+    h = *(Word*)holes.top;
+
+    if ( n->indirect )
+    { size_t wsize = wsizeofInd(*n->indirect);
+
+      memcpy(gp, n->indirect, (wsize+1)*sizeof(word));
+      gp[wsize+1] = gp[0];
+      *h = consPtr(gp, tag(gp[0])|STG_GLOBAL);
+      gp += wsize+2;
+    } else if ( IS_TRIE_VAR(key) )
+    { size_t vn = TRIE_VAR_NUM(key);
+
+      if ( vn < entriesBuffer(&vars, Word) )
+      { *h = makeRefG(baseBuffer(&vars, Word)[vn]);
+      } else
+      { setVar(*h);
+	if ( h != valTermRef(result) )
+	  addBuffer(&vars, h, Word);
+      }
+    } else if ( tag(key) == TAG_ATOM && storage(key) == STG_GLOBAL )
+    { size_t arity = arityFunctor(key);
+      Word a;
+
+      *gp = key;
+      *h = consPtr(gp, TAG_COMPOUND|STG_GLOBAL);
+      for(a=gp+arity; a > gp; a--)
+	addBuffer(&holes, a, Word);
+      gp += arity+1;
+    } else
+    { *h = key;
+    }
+  }
+
+  discardBuffer(&vars);
+  discardBuffer(&holes);
+  discardBuffer(&path);
+
+  return PL_unify(term, result);
+}
+
+
+int
+trie_error(int rc, term_t culprit)
+{ switch(rc)
+  { case TRIE_E_ATTVAR:
+      return PL_error(NULL, 0, NULL, ERR_TYPE,
+		      ATOM_free_of_attvar, culprit);
+    case TRIE_E_CYCLIC:
+      return PL_error(NULL, 0, NULL, ERR_TYPE,
+		      ATOM_acyclic_term, culprit);
+    default:
+      return FALSE;
+  }
+}
+
+
+		 /*******************************
+		 *	     TRIE BLOB		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Tries created from Prolog are blobs that may be shared between threads
+and are therefore protected by a mutex.  A value is either an atom or a
+small integer, stored as its tagged word, or a record holding an
+arbitrary term.  As records are aligned the two are distinguished by
+the tag bits.  trie_destroy/1 empties the trie, while the trie itself
+is reclaimed by AGC.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+#define LOCK_TRIE(t)	simpleMutexLock(&(t)->lock)
+#define UNLOCK_TRIE(t)	simpleMutexUnlock(&(t)->lock)
+#else
+#define LOCK_TRIE(t)	(void)0
+#define UNLOCK_TRIE(t)	(void)0
+#endif
+
+#define IS_INLINE_VALUE(v) (((uintptr_t)(v) & TAG_MASK) != 0)
+
+static int
+write_trie(IOSTREAM *s, atom_t symbol, int flags)
+{ trie **tp = PL_blob_data(symbol, NULL, NULL);
+  (void)flags;
+
+  Sfprintf(s, "<trie>(%p)", *tp);
+  return TRUE;
+}
+
+
+static void
+acquire_trie(atom_t symbol)
+{ trie **tp = PL_blob_data(symbol, NULL, NULL);
+
+  (*tp)->symbol = symbol;
+}
+
+
+static int
+release_trie(atom_t symbol)
+{ trie **tp = PL_blob_data(symbol, NULL, NULL);
+
+  trie_destroy(*tp);
+
+  return TRUE;
+}
+
+
+static PL_blob_t trie_blob =
+{ PL_BLOB_MAGIC,
+  PL_BLOB_UNIQUE,
+  "trie",
+  release_trie,
+  NULL,
+  write_trie,
+  acquire_trie
+};
+
+
+static void
+release_prolog_value(trie *t, void *value)
+{ if ( IS_INLINE_VALUE(value) )
+  { word w = (word)value;
+
+    if ( isAtom(w) )
+      PL_unregister_atom(w);
+  } else
+  { Record r = value;
+
+    t->size -= r->size;
+    freeRecord(r);
+  }
+}
+
+
+static trie *
+trie_from_blob(term_t t)
+{ void *data;
+  PL_blob_t *type;
+
+  if ( PL_get_blob(t, &data, NULL, &type) && type == &trie_blob )
+    return *(trie**)data;
+
+  return NULL;
+}
+
+
+static int
+get_trie(term_t t, trie **tp)
+{ trie *trie;
+
+  if ( (trie=trie_from_blob(t)) )
+  { if ( trie->magic == TRIE_MAGIC )
+    { *tp = trie;
+      return TRUE;
+    }
+
+    *tp = NULL;
+    return PL_existence_error("trie", t);
+  }
+
+  *tp = NULL;
+  return PL_type_error("trie", t);
+}
+
+
+static int
+get_trie_key(term_t key ARG_LD)
+{ if ( !PL_is_acyclic(key) )
+    return trie_error(TRIE_E_CYCLIC, key);
+
+  return TRUE;
+}
+
+
+static void *
+get_trie_value(term_t value ARG_LD)
+{ Word p = valTermRef(value);
+
+  deRef(p);
+  if ( isAtom(*p) || isTaggedInt(*p) )
+  { if ( isAtom(*p) )
+      PL_register_atom(*p);
+    return (void*)*p;
+  }
+
+  return compileTermToHeap(value, 0);
+}
+
+
+static void
+add_value_size(trie *t, void *value)
+{ if ( !IS_INLINE_VALUE(value) )
+    t->size += ((Record)value)->size;
+}
+
+
+static int
+unify_value(term_t t, void *value ARG_LD)
+{ if ( IS_INLINE_VALUE(value) )
+  { return _PL_unify_atomic(t, (word)value);
+  } else
+  { term_t t2;
+
+    return ( (t2=PL_new_term_ref()) &&
+	     copyRecordToGlobal(t2, value, ALLOW_GC PASS_LD) == TRUE &&
+	     PL_unify(t, t2) );
+  }
+}
+
+
+static void
+release_trie_enum(trie *t)
+{ if ( --t->references == 0 )
+  { if ( t->magic == TRIE_CMAGIC )
+      trie_empty(t);
+    else if ( t->prune_pending )
+      trie_prune(t);
+  }
+}
+
+
+static
+PRED_IMPL("trie_new", 1, trie_new, 0)
+{ PRED_LD
+  trie *t = trie_create();
+  int new, rc;
+  atom_t symbol;
+
+  t->release_value = release_prolog_value;
+  symbol = lookupBlob((const char *)&t, sizeof(t), &trie_blob, &new);
+  rc = PL_unify_atom(A1, symbol);
+  PL_unregister_atom(symbol);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("trie_destroy", 1, trie_destroy, 0)
+{ trie *t;
+
+  if ( !get_trie(A1, &t) )
+    return FALSE;
+
+  LOCK_TRIE(t);
+  t->magic = TRIE_CMAGIC;
+  if ( t->references == 0 )
+    trie_empty(t);
+  UNLOCK_TRIE(t);
+
+  return TRUE;
+}
+
+
+static
+PRED_IMPL("is_trie", 1, is_trie, 0)
+{ trie *t;
+
+  return (t=trie_from_blob(A1)) && t->magic == TRIE_MAGIC;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trie_insert(+Trie, +Key, +Value) fails if Key is already in the trie,
+while trie_update/3 replaces its value.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+trie_insert(term_t Trie, term_t Key, term_t Value, int update ARG_LD)
+{ trie *t;
+  trie_node *node;
+  void *value;
+  int rc;
+
+  if ( !get_trie(Trie, &t) || !get_trie_key(Key PASS_LD) )
+    return FALSE;
+  if ( Value )
+  { if ( !(value = get_trie_value(Value PASS_LD)) )
+      return FALSE;
+  } else
+  { value = (void*)ATOM_true;
+  }
+
+  LOCK_TRIE(t);
+  if ( t->magic != TRIE_MAGIC )
+  { rc = PL_existence_error("trie", Trie);
+  } else if ( (rc=trie_lookup(t, &node, valTermRef(Key), TRUE PASS_LD)) == TRUE )
+  { if ( node->value )
+    { if ( update )
+      { release_prolog_value(t, node->value);
+	node->value = value;
+	add_value_size(t, value);
+	value = NULL;
+      } else
+	rc = FALSE;
+    } else
+    { node->value = value;
+      add_value_size(t, value);
+      t->value_count++;
+      value = NULL;
+    }
+  } else
+  { rc = trie_error(rc, Key);
+  }
+  UNLOCK_TRIE(t);
+
+  if ( value )
+  { if ( IS_INLINE_VALUE(value) )
+    { if ( isAtom((word)value) )
+	PL_unregister_atom((word)value);
+    } else
+      freeRecord(value);
+  }
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("trie_insert", 3, trie_insert, 0)
+{ PRED_LD
+
+  return trie_insert(A1, A2, A3, FALSE PASS_LD);
+}
+
+
+static
+PRED_IMPL("trie_insert", 2, trie_insert, 0)
+{ PRED_LD
+
+  return trie_insert(A1, A2, 0, FALSE PASS_LD);
+}
+
+
+static
+PRED_IMPL("trie_update", 3, trie_update, 0)
+{ PRED_LD
+
+  return trie_insert(A1, A2, A3, TRUE PASS_LD);
+}
+
+
+static
+PRED_IMPL("trie_lookup", 3, trie_lookup, 0)
+{ PRED_LD
+  trie *t;
+  trie_node *node;
+  int rc;
+
+  if ( !get_trie(A1, &t) || !get_trie_key(A2 PASS_LD) )
+    return FALSE;
+
+  LOCK_TRIE(t);
+  if ( (rc=trie_lookup(t, &node, valTermRef(A2), FALSE PASS_LD)) == TRUE )
+  { if ( node->value )
+      rc = unify_value(A3, node->value PASS_LD);
+    else
+      rc = FALSE;
+  } else if ( rc != FALSE )
+  { rc = trie_error(rc, A2);
+  }
+  UNLOCK_TRIE(t);
+
+  return rc;
+}
+
+
+static
+PRED_IMPL("trie_delete", 3, trie_delete, 0)
+{ PRED_LD
+  trie *t;
+  trie_node *node;
+  int rc;
+
+  if ( !get_trie(A1, &t) || !get_trie_key(A2 PASS_LD) )
+    return FALSE;
+
+  LOCK_TRIE(t);
+  if ( (rc=trie_lookup(t, &node, valTermRef(A2), FALSE PASS_LD)) == TRUE )
+  { if ( node->value && unify_value(A3, node->value PASS_LD) )
+    { if ( t->references > 0 )
+      { trie_delete(t, node, FALSE);
+	t->prune_pending++;
+      } else
+      { trie_delete(t, node, TRUE);
+      }
+    } else
+    { rc = FALSE;
+    }
+  } else if ( rc != FALSE )
+  { rc = trie_error(rc, A2);
+  }
+  UNLOCK_TRIE(t);
+
+  return rc;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+trie_gen(+Trie, ?Key, -Value) enumerates the keys that unify with Key.
+If Key is ground this is a lookup.  Otherwise we walk over all values.
+While enumerating, the trie's reference count is raised such that
+trie_delete/3 does not remove nodes and the trie's atom is locked such
+that AGC cannot reclaim the trie if the enumeration is cut.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct trie_gen_state
+{ trie	       *trie;			/* Trie we are enumerating */
+  trie_node    *node;			/* Next candidate */
+} trie_gen_state;
+
+
+static void
+free_trie_gen_state(trie_gen_state *state)
+{ trie *t = state->trie;
+
+  LOCK_TRIE(t);
+  release_trie_enum(t);
+  UNLOCK_TRIE(t);
+  PL_unregister_atom(t->symbol);
+  freeForeignState(state, sizeof(*state));
+}
+
+
+static foreign_t
+trie_gen(term_t Trie, term_t Key, term_t Value, control_t h ARG_LD)
+{ trie_gen_state *state;
+  trie *t;
+  trie_node *n;
+  fid_t fid;
+
+  switch( ForeignControl(h) )
+  { case FRG_FIRST_CALL:
+      if ( !get_trie(Trie, &t) )
+	return FALSE;
+      if ( PL_is_ground(Key) )
+      { int rc;
+
+	if ( !get_trie_key(Key PASS_LD) )
+	  return FALSE;
+	LOCK_TRIE(t);
+	if ( (rc=trie_lookup(t, &n, valTermRef(Key), FALSE PASS_LD)) == TRUE )
+	  rc = ( n->value &&
+		 (!Value || unify_value(Value, n->value PASS_LD)) );
+	else if ( rc != FALSE )
+	  rc = trie_error(rc, Key);
+	UNLOCK_TRIE(t);
+
+	return rc;
+      }
+      LOCK_TRIE(t);
+      if ( !(n = trie_first_value(t)) )
+      { UNLOCK_TRIE(t);
+	return FALSE;
+      }
+      t->references++;
+      UNLOCK_TRIE(t);
+      PL_register_atom(t->symbol);
+      state = allocForeignState(sizeof(*state));
+      state->trie = t;
+      state->node = n;
+      break;
+    case FRG_REDO:
+      state = ForeignContextPtr(h);
+      break;
+    case FRG_CUTTED:
+      state = ForeignContextPtr(h);
+      free_trie_gen_state(state);
+      return TRUE;
+    default:
+      assert(0);
+      return FALSE;
+  }
+
+  t = state->trie;
+  if ( !(fid = PL_open_foreign_frame()) )
+  { free_trie_gen_state(state);
+    return FALSE;
+  }
+
+  LOCK_TRIE(t);
+  n = ( t->magic == TRIE_MAGIC ? state->node : NULL );
+  for(; n; n = trie_next_value(n))
+  { if ( unify_trie_term(n, Key PASS_LD) &&
+	 (!Value || unify_value(Value, n->value PASS_LD)) )
+    { trie_node *next = trie_next_value(n);
+
+      UNLOCK_TRIE(t);
+      PL_close_foreign_frame(fid);
+      if ( !next )
+      { free_trie_gen_state(state);
+	return TRUE;
+      }
+      state->node = next;
+      ForeignRedoPtr(state);
+    }
+    if ( PL_exception(0) )
+      break;
+    PL_rewind_foreign_frame(fid);
+  }
+  UNLOCK_TRIE(t);
+
+  PL_close_foreign_frame(fid);
+  free_trie_gen_state(state);
+
+  return FALSE;
+}
+
+
+static
+PRED_IMPL("trie_gen", 3, trie_gen, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+
+  return trie_gen(A1, A2, A3, PL__ctx PASS_LD);
+}
+
+
+static
+PRED_IMPL("trie_gen", 2, trie_gen, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+
+  return trie_gen(A1, A2, 0, PL__ctx PASS_LD);
+}
+
+
+/** trie_property(+Trie, ?Property) is nondet.
+ *
+ * Properties are node_count(Count), value_count(Count) and size(Bytes),
+ * the memory used by the nodes and values of the trie.
+ */
+
+static const atom_t trie_properties[] =
+{ ATOM_node_count, ATOM_value_count, ATOM_size, 0
+};
+
+static
+PRED_IMPL("trie_property", 2, trie_property, PL_FA_NONDETERMINISTIC)
+{ PRED_LD
+  trie *t;
+  int i, enumerate;
+
+  switch( CTX_CNTRL )
+  { case FRG_FIRST_CALL:
+    { atom_t name;
+      int arity;
+
+      i = 0;
+      if ( PL_get_name_arity(A2, &name, &arity) )
+      { if ( arity != 1 )
+	  return FALSE;
+	for(; trie_properties[i]; i++)
+	{ if ( trie_properties[i] == name )
+	    break;
+	}
+	if ( !trie_properties[i] )
+	  return FALSE;
+	enumerate = FALSE;
+      } else if ( PL_is_variable(A2) )
+      { enumerate = TRUE;
+      } else
+      { return PL_type_error("trie_property", A2);
+      }
+      break;
+    }
+    case FRG_REDO:
+      i = (int)CTX_INT;
+      enumerate = TRUE;
+      break;
+    case FRG_CUTTED:
+    default:
+      return TRUE;
+  }
+
+  if ( !get_trie(A1, &t) )
+    return FALSE;
+
+  for(; trie_properties[i]; i++)
+  { size_t value;
+
+    switch(i)
+    { case 0: value = t->node_count; break;
+      case 1: value = t->value_count; break;
+      default: value = sizeof(*t) + t->size; break;
+    }
+
+    if ( PL_unify_term(A2,
+		       PL_FUNCTOR, PL_new_functor(trie_properties[i], 1),
+		         PL_INT64, (int64_t)value) )
+    { if ( enumerate && trie_properties[i+1] )
+	ForeignRedoInt(i+1);
+      return TRUE;
+    }
+    if ( !enumerate )
+      break;
+  }
+
+  return FALSE;
+}
+
+
+		 /*******************************
+		 *	      REGISTER		*
+		 *******************************/
+
+BeginPredDefs(trie)
+  PRED_DEF("trie_new",	    1, trie_new,      0)
+  PRED_DEF("trie_destroy",  1, trie_destroy,  0)
+  PRED_DEF("is_trie",	    1, is_trie,       0)
+  PRED_DEF("trie_insert",   2, trie_insert,   0)
+  PRED_DEF("trie_insert",   3, trie_insert,   0)
+  PRED_DEF("trie_update",   3, trie_update,   0)
+  PRED_DEF("trie_lookup",   3, trie_lookup,   0)
+  PRED_DEF("trie_delete",   3, trie_delete,   0)
+  PRED_DEF("trie_gen",	    2, trie_gen,      PL_FA_NONDETERMINISTIC)
+  PRED_DEF("trie_gen",	    3, trie_gen,      PL_FA_NONDETERMINISTIC)
+  PRED_DEF("trie_property", 2, trie_property, PL_FA_NONDETERMINISTIC)
+EndPredDefs
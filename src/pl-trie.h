@@ -0,0 +1,81 @@
+/*  Part of SWI-Prolog
+
+    Author:        SWI-Prolog contributors
+    WWW:           http://www.swi-prolog.org
+    Copyright (C): 2026, SWI-Prolog contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PL_TRIE_H
+#define _PL_TRIE_H
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A trie maps terms modulo variant to a value.  A term is stored as the
+sequence of its nodes in prefix order.  Each node is represented by a
+key: the atom, small integer or functor of the node, a numbered variable
+(numbered by first occurrence) or a copy of indirect data (floats,
+strings and big integers).  Because the arities are part of the keys,
+no term is a prefix of another and thus the values are all at the
+leaves of the trie.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TRIE_HASH_THRESHOLD	8	/* Hash children above this count */
+
+typedef struct trie_node
+{ word			key;		/* Key of this node */
+  Word			indirect;	/* Copy of indirect data */
+  struct trie_node     *parent;		/* Parent node */
+  struct trie_node     *sibling;	/* Next child of parent */
+  struct trie_node     *children;	/* First child */
+  Table			hash;		/* key --> child (many children) */
+  unsigned int		child_count;	/* # children */
+  void		       *value;		/* Value (leafs only) */
+} trie_node;
+
+#define TRIE_MAGIC	0x4bcbcf87	/* Valid trie */
+#define TRIE_CMAGIC	0x4bcbcf88	/* Destroyed trie */
+
+typedef struct trie
+{ atom_t		symbol;		/* Blob handle (Prolog tries) */
+  unsigned int		magic;		/* TRIE_MAGIC */
+  unsigned int		references;	/* # active enumerations */
+  trie_node		root;		/* The root node */
+  size_t		node_count;	/* # nodes (excluding the root) */
+  size_t		value_count;	/* # stored terms */
+  size_t		size;		/* Allocated bytes for nodes/values */
+  unsigned int		prune_pending;	/* Deleted during enumeration */
+  void		      (*release_value)(struct trie *t, void *value);
+#ifdef O_PLMT
+  simpleMutex		lock;		/* Lock for Prolog tries */
+#endif
+} trie;
+
+#define TRIE_E_ATTVAR	  (-10)		/* Cannot store attributed vars */
+#define TRIE_E_CYCLIC	  (-11)		/* Cannot store cyclic terms */
+
+COMMON(trie *)	trie_create(void);
+COMMON(void)	trie_destroy(trie *t);
+COMMON(void)	trie_empty(trie *t);
+COMMON(int)	trie_lookup(trie *t, trie_node **nodep, Word k,
+			    int add ARG_LD);
+COMMON(void)	trie_delete(trie *t, trie_node *node, int prune);
+COMMON(void)	trie_prune(trie *t);
+COMMON(trie_node *) trie_first_value(trie *t);
+COMMON(trie_node *) trie_next_value(trie_node *n);
+COMMON(int)	unify_trie_term(trie_node *node, term_t term ARG_LD);
+COMMON(int)	trie_error(int rc, term_t culprit);
+
+#endif /*_PL_TRIE_H*/
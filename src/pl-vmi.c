@@ -2539,6 +2539,7 @@ END_SHAREDVARS
 S_VIRGIN: Fresh, unused predicate. Any new   predicate  is created using
 this supervisor (see resetProcedure()). The task of this is to
 
+	* Load the clauses of a lazily loaded predicate (see pl-wic.c).
 	* Resolve the definition (i.e. auto-import or auto-load if
 	not defined).
 	* Check the indexing opportunities and install the proper
@@ -2548,6 +2549,8 @@ this supervisor (see resetProcedure()). The task of this is to
 VMI(S_VIRGIN, 0, 0, ())
 { lTop = (LocalFrame)argFrameP(FR, FR->predicate->functor->arity);
   SAVE_REGISTERS(qid);
+  if ( true(DEF, P_LAZY) )
+    loadLazyDefinition(DEF);
   DEF = getProcDefinedDefinition(DEF PASS_LD);
   LOAD_REGISTERS(qid);
 
@@ -4354,7 +4357,9 @@ b_throw:
 
     resumeAfterException(false(QF, PL_Q_PASS_EXCEPTION), outofstack);
     if ( PL_pending(SIG_GC) )
+    { LD->gc.reason = PL_GC_EXCEPTION;
       garbageCollect();
+    }
     QF = QueryFromQid(qid);		/* may be shifted: recompute */
 
     assert(LD->exception.throw_environment == &throw_env);
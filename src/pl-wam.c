@@ -522,7 +522,7 @@ static void
 discardForeignFrame(LocalFrame fr ARG_LD)
 { Definition def = fr->predicate;
   int argc       = def->functor->arity;
-  Func function  = def->impl.function;
+  Func function  = def->impl.foreign.function;
   struct foreign_context context;
   fid_t fid;
 
@@ -1252,6 +1252,8 @@ __do_undo(mark *m ARG_LD)
   { reclaim_attvars(m->globaltop PASS_LD);
     gTop = m->globaltop;
   }
+  if ( gTop < LD->gen_bar )		/* backtracked into old data */
+    LD->gen_bar = gTop;
 }
 
 
@@ -1551,7 +1553,8 @@ exceptionUnwindGC(Stack outofstack)
     outofstack->gced_size = 0;
     LD->trim_stack_requested = TRUE;
     if ( considerGarbageCollect(outofstack) )
-    { garbageCollect();
+    { LD->gc.reason = PL_GC_EXCEPTION;
+      garbageCollect();
       if ( roomStackP(outofstack) < outofstack->def_spare )
 	enableSpareStack(outofstack);
     }
@@ -31,6 +31,12 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
 
 #ifdef O_DEBUG
 #define Qgetc(s) Sgetc(s)
@@ -229,6 +235,8 @@ typedef struct wic_state
 
   int	     load_nesting;		/* Nesting level of loadPart() */
   qlf_state *load_state;		/* current load-state */
+  int	     lazy;			/* Load clauses on first use */
+  int	     shared_code;		/* Clauses in the shared code area */
 
   xr_table *XR;				/* external references */
 
@@ -243,6 +251,9 @@ static int	getInt(IOSTREAM *);
 static double	getFloat(IOSTREAM *);
 static bool	loadWicFd(wic_state *state);
 static bool	loadPredicate(wic_state *state, int skip ARG_LD);
+static bool	loadClauses(wic_state *state, Procedure proc, int how ARG_LD);
+static int	lazyPredicate(wic_state *state, Procedure proc);
+static void	freeLazySymbol(Symbol s);
 static bool	loadImport(wic_state *state, int skip ARG_LD);
 static void	saveXRBlobType(wic_state *state, PL_blob_t *type);
 static void	putString(const char *, size_t len, IOSTREAM *);
@@ -260,6 +271,11 @@ static atom_t	qlfFixSourcePath(wic_state *state, const char *raw);
 static int	pushPathTranslation(wic_state *state, const char *loadname, int flags);
 static void	popPathTranslation(wic_state *state);
 
+#define LOAD_CLAUSES	0		/* Load the clauses */
+#define LOAD_SKIP	1		/* Read and discard the clauses */
+#define LOAD_SCAN	2		/* Only define the XR entries */
+#define LOAD_LAZY	3		/* Load previously scanned clauses */
+
 #undef LD
 #define LD LOCAL_LD
 
@@ -940,7 +956,8 @@ loadWicFd(wic_state *state)
     switch( c )
     { case EOF:
       case 'T':				/* trailer */
-	popPathTranslation(state);
+	if ( !state->lazy )		/* lazy loading needs the paths */
+	  popPathTranslation(state);
 	succeed;
       case 'W':
 	{ char *name = store_string(getString(fd, NULL) );
@@ -1059,12 +1076,9 @@ loadPredicateFlags(wic_state *state, Definition def, int skip)
 
 static bool
 loadPredicate(wic_state *state, int skip ARG_LD)
-{ IOSTREAM *fd = state->wicFd;
-  Procedure proc;
+{ Procedure proc;
   Definition def;
-  Clause clause;
   functor_t f = (functor_t) loadXR(state);
-  SourceFile csf = NULL;
 
   proc = lookupProcedureToDefine(f, LD->modules.source);
   DEBUG(MSG_QLF_PREDICATE, Sdprintf("Loading %s%s",
@@ -1085,6 +1099,115 @@ loadPredicate(wic_state *state, int skip ARG_LD)
   }
   loadPredicateFlags(state, def, skip);
 
+  if ( !skip && state->lazy && lazyPredicate(state, proc) )
+    return loadClauses(state, proc, LOAD_SCAN PASS_LD);
+
+  return loadClauses(state, proc, skip ? LOAD_SKIP : LOAD_CLAUSES PASS_LD);
+}
+
+
+typedef struct lazy_clauses
+{ Procedure	procedure;		/* Predicate to load */
+  int64_t	offset;			/* Offset of the clauses in the state */
+  int		xr_id;			/* XR id before the clauses */
+  gen_t		generation;		/* Generation at scan time */
+} lazy_clauses;
+
+static struct
+{ wic_state *state;			/* State we load clauses from */
+  Table	     predicates;		/* Definition --> lazy_clauses */
+  Clause     scratch;			/* Buffer for LOAD_SCAN */
+  size_t     scratch_size;		/* Allocated size of scratch */
+#ifdef O_PLMT
+  recursiveMutex mutex;			/* Serialize loading */
+#endif
+} lazy;
+
+#ifdef O_PLMT
+#define LOCK_LAZY()   recursiveMutexLock(&lazy.mutex)
+#define UNLOCK_LAZY() recursiveMutexUnlock(&lazy.mutex)
+#else
+#define LOCK_LAZY()
+#define UNLOCK_LAZY()
+#endif
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+With --shared-code, the clauses of the saved  state are allocated in the
+code area rather than using malloc(). The  code area consists of chunks
+of whole pages that are used for  nothing   else.  The clauses of the
+state are never modified after  loading,  so   if  a  process forks its
+workers after loading the state, the pages   of  the code area are not
+touched by the workers and remain   shared between all processes. Clauses
+in the malloc() heap share their pages with   data  that is modified and
+are copied on the first write to any of them.
+
+The VM code contains the addresses of atoms, functors, procedures and,
+if threaded code is used, of the  VM instructions. It can therefore not
+be mapped from the state file itself.
+
+Clauses in the code area are  flagged   CL_SHARED.  Their memory is not
+reclaimed if they are erased.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define CODE_CHUNK_SIZE (1024*1024)
+
+typedef struct code_chunk
+{ struct code_chunk *previous;		/* Previous chunk */
+  char	       *top;			/* Free space */
+  char	       *max;			/* End of the chunk */
+} code_chunk;
+
+static code_chunk *code_area;		/* Current chunk */
+
+static Clause
+allocSharedClause(size_t size)
+{ code_chunk *c = code_area;
+  void *p;
+
+  size = ROUND(size, sizeof(double));
+  if ( !c || c->top+size > c->max )
+  { size_t csize = ROUND(sizeof(*c), sizeof(double)) + size;
+
+    if ( csize < CODE_CHUNK_SIZE )
+      csize = CODE_CHUNK_SIZE;
+#ifdef HAVE_MMAP
+    c = mmap(NULL, csize, PROT_READ|PROT_WRITE,
+	     MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if ( c == MAP_FAILED )
+      return NULL;
+#else
+    if ( !(c = malloc(csize)) )
+      return NULL;
+#endif
+    c->previous = code_area;
+    c->top      = (char*)c + ROUND(sizeof(*c), sizeof(double));
+    c->max      = (char*)c + csize;
+    code_area   = c;
+  }
+
+  p = c->top;
+  c->top += size;
+
+  return p;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+loadClauses() loads the clauses of proc up to the closing 'X'. If how is
+LOAD_SKIP the clauses are discarded and if it  is LOAD_SCAN they are only
+decoded into a scratch buffer. Scanning is needed to define the XR table
+entries that appear inside the clauses, but does not allocate the clause
+and does not register its atoms. LOAD_LAZY loads clauses that have been
+scanned before. See loadLazyDefinition().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static bool
+loadClauses(wic_state *state, Procedure proc, int how ARG_LD)
+{ IOSTREAM *fd = state->wicFd;
+  Clause clause;
+  SourceFile csf = NULL;
+
   for(;;)
   { switch(Sgetc(fd) )
     { case 'X':
@@ -1095,9 +1218,26 @@ loadPredicate(wic_state *state, int skip ARG_LD)
       { Code bp, ep;
 	int ncodes = getInt(fd);
 	int has_dicts = 0;
+	int shared = FALSE;
 
 	DEBUG(MSG_QLF_PREDICATE, Sdprintf("."));
-	clause = (Clause) PL_malloc_atomic(sizeofClause(ncodes));
+	if ( how == LOAD_SCAN )
+	{ size_t size = sizeofClause(ncodes);
+
+	  if ( size > lazy.scratch_size )
+	  { if ( lazy.scratch )
+	      PL_free(lazy.scratch);
+	    lazy.scratch = PL_malloc_atomic(size);
+	    lazy.scratch_size = size;
+	  }
+	  clause = lazy.scratch;
+	} else if ( !state->shared_code ||
+		    !(clause = allocSharedClause(sizeofClause(ncodes))) )
+	{ clause = (Clause) PL_malloc_atomic(sizeofClause(ncodes));
+	  shared = FALSE;
+	} else
+	{ shared = TRUE;
+	}
 	clause->code_size = (unsigned int) ncodes;
 	clause->line_no = (unsigned short) getInt(fd);
 
@@ -1108,19 +1248,22 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 
 	  clause->owner_no = ono;
 	  clause->source_no = sno;
-	  if ( of && of != csf )
+	  if ( of && of != csf && how != LOAD_LAZY )
 	  { addProcedureSourceFile(sf, proc);
 	    csf = of;
 	  }
 	}
 
 	clearFlags(clause);
+	if ( shared )
+	  set(clause, CL_SHARED);
 	clause->prolog_vars = (unsigned short) getInt(fd);
 	clause->variables   = (unsigned short) getInt(fd);
 	if ( getLong(fd) == 0 )		/* 0: fact */
 	  set(clause, UNIT_CLAUSE);
 	clause->procedure = proc;
-	GD->statistics.codes += clause->code_size;
+	if ( how != LOAD_SCAN )
+	  GD->statistics.codes += clause->code_size;
 
 	bp = clause->codes;
 	ep = bp + clause->code_size;
@@ -1165,7 +1308,7 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	      }
 	      case CA1_DATA:
 	      { word w = loadXR(state);
-		if ( isAtom(w) )
+		if ( isAtom(w) && how != LOAD_SCAN )
 		  PL_register_atom(w);
 		*bp++ = w;
 		break;
@@ -1248,9 +1391,9 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	  }
 	}
 
-	if ( skip )
+	if ( how == LOAD_SKIP )
 	{ freeClause(clause);
-	} else
+	} else if ( how != LOAD_SCAN )
 	{ if ( has_dicts )
 	  { if ( !resortDictsInClause(clause) )
 	    { outOfCore();
@@ -1265,6 +1408,172 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 }
 
 
+		 /*******************************
+		 *	   LAZY LOADING		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+With --lazy-load, the clauses of the static predicates in the initial
+saved state are not loaded at startup.  loadPredicate() only scans them
+to define the XR entries they contain and remembers where they start
+and the XR id at that point.  loadLazyDefinition() loads the clauses
+the first time the predicate is called (see S_VIRGIN) or its clauses
+are needed otherwise.  Re-reading the XR definitions inside the clauses
+reuses the same ids and yields the same objects.
+
+This requires keeping the state open together with its XR table and path
+translation.  The state lives in the resource archive, which is memory
+mapped if possible, so this is cheap.  Predicates that are dynamic,
+thread-local, multifile or already have clauses are loaded normally.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+lazyPredicate(wic_state *state, Procedure proc)
+{ Definition def = proc->definition;
+  lazy_clauses *lc;
+  int64_t offset;
+
+  if ( def->impl.any ||
+       true(def, P_LAZY|P_DYNAMIC|P_THREAD_LOCAL|P_MULTIFILE|P_FOREIGN) ||
+       (offset = Stell64(state->wicFd)) < 0 )
+    return FALSE;
+
+  if ( !lazy.predicates )
+  { lazy.predicates = newHTable(1024);
+    lazy.predicates->free_symbol = freeLazySymbol;
+  }
+
+  lc = allocHeapOrHalt(sizeof(*lc));
+  lc->procedure  = proc;
+  lc->offset     = offset;
+  lc->xr_id      = state->XR->id;
+  lc->generation = GD->generation;
+  addHTable(lazy.predicates, def, lc);
+  set(def, P_LAZY);
+
+  return TRUE;
+}
+
+
+static void
+freeLazySymbol(Symbol s)
+{ freeHeap(s->value, sizeof(lazy_clauses));
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Load the clauses of a lazy  predicate.   This  may  happen while we are
+still loading the state, so we  restore   the  position  and XR id when
+done. The clauses get the generation of  the scan, so they are visible
+to the frame that triggered loading them.   P_LAZY is only cleared after
+the clauses have been added such that other threads wait for them. The  caller   may  not hold L_PREDICATE as
+assertProcedure() needs it.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+void
+loadLazyDefinition(Definition def)
+{ GET_LD
+  Symbol s;
+  ClauseRef cref;
+
+  LOCK_LAZY();
+  if ( true(def, P_LAZY) && lazy.predicates &&
+       (s = lookupHTable(lazy.predicates, def)) )
+  { lazy_clauses *lc = s->value;
+    wic_state *state = lazy.state;
+    IOSTREAM *fd = state->wicFd;
+    int64_t here = Stell64(fd);
+    int xr_id = state->XR->id;
+
+    deleteSymbolHTable(lazy.predicates, s); /* avoid recursion */
+    DEBUG(MSG_QLF_PREDICATE,
+	  Sdprintf("Lazy loading %s\n", predicateName(def)));
+    if ( Sseek64(fd, lc->offset, SIO_SEEK_SET) != 0 )
+      fatalError("Cannot load %s from the saved state", predicateName(def));
+
+    state->XR->id = lc->xr_id;
+    loadClauses(state, lc->procedure, LOAD_LAZY PASS_LD);
+    state->XR->id = xr_id;
+    Sseek64(fd, here, SIO_SEEK_SET);
+#ifdef O_LOGICAL_UPDATE			/* visible to running frames */
+    for(cref = def->impl.clauses.first_clause; cref; cref = cref->next)
+      cref->value.clause->generation.created = lc->generation;
+#endif
+
+    clear(def, P_LAZY);
+    freeHeap(lc, sizeof(*lc));
+  }
+  UNLOCK_LAZY();
+}
+
+
+static void
+cleanupLazyLoading(void)
+{ wic_state *state;
+
+  LOCK_LAZY();
+  if ( (state = lazy.state) )
+  { lazy.state = NULL;
+    if ( lazy.predicates )
+    { destroyHTable(lazy.predicates);
+      lazy.predicates = NULL;
+    }
+    while( state->load_state )
+      popPathTranslation(state);
+    popXrIdTable(state);
+    Sclose(state->wicFd);
+    freeHeap(state, sizeof(*state));
+  }
+  UNLOCK_LAZY();
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Load the initial saved state from fd and  close fd. If lazy loading is
+enabled and some predicates are  loaded   lazily,  fd is kept open until
+cleanupLazyLoading().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+bool
+loadStateFromStream(IOSTREAM *fd)
+{ wic_state *state;
+  bool rval;
+
+  state = allocHeapOrHalt(sizeof(*state));
+  memset(state, 0, sizeof(*state));
+  state->wicFd       = fd;
+  state->shared_code = GD->options.shared_code;
+
+  if ( !GD->options.lazy_load )
+  { pushXrIdTable(state);
+    rval = loadWicFd(state);
+    popXrIdTable(state);
+    freeHeap(state, sizeof(*state));
+    Sclose(fd);
+    return rval;
+  }
+
+#ifdef O_PLMT
+  recursiveMutexInit(&lazy.mutex);
+#endif
+  state->lazy = TRUE;
+  lazy.state  = state;
+
+  pushXrIdTable(state);
+  rval = loadWicFd(state);
+
+  if ( lazy.scratch )
+  { PL_free(lazy.scratch);
+    lazy.scratch = NULL;
+    lazy.scratch_size = 0;
+  }
+  if ( !lazy.predicates || !rval )
+    cleanupLazyLoading();
+
+  return rval;
+}
+
+
 static bool
 runInitialization(SourceFile sf)
 { int rc = FALSE;
@@ -3288,6 +3597,8 @@ qlfCleanup(void)
     LD->qlf.getstr_buffer_size = 0;
     free(buf);
   }
+
+  cleanupLazyLoading();
 }
 
 		 /*******************************
@@ -313,14 +313,7 @@ Putc(int c, IOSTREAM *s)
 
 static bool
 PutString(const char *str, IOSTREAM *s)
-{ const unsigned char *q = (const unsigned char *)str;
-
-  for( ; *q != EOS; q++ )
-  { if ( Sputcode(*q, s) == EOF )
-      return FALSE;
-  }
-
-  return TRUE;
+{ return Sfputsn(str, strlen(str), s) == EOF ? FALSE : TRUE;
 }
 
 
@@ -344,15 +337,7 @@ PutBar(write_options *options)
 
 static bool
 PutStringN(const char *str, size_t length, IOSTREAM *s)
-{ size_t i;
-  const unsigned char *q = (const unsigned char *)str;
-
-  for(i=0; i<length; i++, q++)
-  { if ( Sputcode(*q, s) == EOF )
-      return FALSE;
-  }
-
-  return TRUE;
+{ return Sfputsn(str, length, s) == EOF ? FALSE : TRUE;
 }
 
 
@@ -528,15 +513,31 @@ putQuoted(int c, int quote, int flags, IOSTREAM *stream)
 
 
 
+/* writeQuoted() emits the runs of printable ASCII characters that need
+   no escape using PutStringN().
+*/
+
 static bool
 writeQuoted(IOSTREAM *stream, const char *text, size_t len, int quote,
 	    write_options *options)
 { const unsigned char *s = (const unsigned char *)text;
+  const unsigned char *e = s+len;
 
   TRY(Putc(quote, stream));
 
-  while(len-- > 0)
-  { TRY(putQuoted(*s++, quote, options->flags, stream));
+  while(s < e)
+  { const unsigned char *r;
+
+    for(r=s; r<e && *r >= ' ' && *r < 0x7f; r++)
+    { if ( *r == quote || *r == '\\' )
+	break;
+    }
+    if ( r > s )
+    { TRY(PutStringN((const char *)s, r-s, stream));
+      s = r;
+    } else
+    { TRY(putQuoted(*s++, quote, options->flags, stream));
+    }
   }
 
   return Putc(quote, stream);
@@ -770,6 +771,15 @@ writeString(term_t t, write_options *options)
 
   PL_get_text(t, &txt, CVT_STRING);
 
+  if ( txt.encoding == ENC_ISO_LATIN_1 )
+  { if ( true(options, PL_WRT_QUOTED) )
+      return writeQuoted(options->out, txt.text.t, txt.length,
+			 true(options, PL_WRT_BACKQUOTED_STRING) ? '`' : '"',
+			 options);
+    else
+      return PutStringN(txt.text.t, txt.length, options->out);
+  }
+
   if ( true(options, PL_WRT_QUOTED) )
   { int quote;
     unsigned int i;
@@ -818,11 +828,10 @@ to clean this up a bit. The 5 cases   as  such are real: there is no way
 around these.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-char *
-format_float(double f, char *buf)
-{ char *end, *o=buf;
-  int decpt, sign;
-  char *s = dtoa(f, 0, 30, &decpt, &sign, &end);
+static char *
+format_float_digits(const char *s, const char *end, int decpt, int sign,
+		    char *buf)
+{ char *o = buf;
 
   DEBUG(2, Sdprintf("decpt=%d, sign=%d, len = %d, '%s'\n",
 		    decpt, sign, end-s, s));
@@ -882,12 +891,86 @@ format_float(double f, char *buf)
     }
   }
 
-  freedtoa(s);
-
   return buf;
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+short_float_digits() avoids dtoa() for  floats   that  are the nearest
+double of a decimal number with  at   most  15 significant digits, such
+as 0.1 or 23.45. We look for the   smallest  k such that f*10^k is an
+integer m below 10^15 and m/10^k  is   f  again. Both 10^k and m are
+exact, so the division is  correctly   rounded  and the decimal m*10^-k
+reads back as f. As any decimal of at most 15 (DBL_DIG) digits survives
+the round trip through a double, there is no shorter decimal that reads
+as f and the result is the same as the shortest representation returned
+by dtoa() in mode 0.  Other floats, e.g., 0.1+0.2, fail after at most 23
+multiplications.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+short_float_digits(double f, char *digits, char **end, int *decpt)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  int k;
+
+  if ( !(f > 0.0 && f < 1e15) )
+    return FALSE;
+
+  for(k=0; k<=MAX_EXACT_POW10; k++)
+  { double m = f*exact_pow10[k];
+
+    if ( m >= 1e15 )
+      return FALSE;
+    if ( m == floor(m) && m >= 1.0 && m/exact_pow10[k] == f )
+    { char tmp[20];
+      char *e = tmp+sizeof(tmp);
+      int64_t i = (int64_t)m;
+      int n;
+
+      do
+      { *--e = (char)('0' + i%10);
+	i /= 10;
+      } while(i);
+      n = (int)(tmp+sizeof(tmp)-e);
+      *decpt = n-k;
+      while( n > 1 && e[n-1] == '0' )
+	n--;
+      memcpy(digits, e, n);
+      *end = digits+n;
+      **end = EOS;
+
+      return TRUE;
+    }
+  }
+#endif
+
+  return FALSE;
+}
+
+
+char *
+format_float(double f, char *buf)
+{ char digits[20];
+  char *end;
+  int decpt;
+
+  if ( short_float_digits(f, digits, &end, &decpt) )
+  { return format_float_digits(digits, end, decpt, FALSE, buf);
+  } else if ( f < 0.0 && short_float_digits(-f, digits, &end, &decpt) )
+  { return format_float_digits(digits, end, decpt, TRUE, buf);
+  } else
+  { int sign;
+    char *s = dtoa(f, 0, 30, &decpt, &sign, &end);
+
+    format_float_digits(s, end, decpt, sign, buf);
+    freedtoa(s);
+
+    return buf;
+  }
+}
+
+
 static bool
 WriteNumber(Number n, write_options *options)
 { GET_LD